@@ -41,9 +41,13 @@ geom_files := $(core_src)/geom/mgbase.cpp \
               $(core_src)/geom/nanosvg.cpp
 
 graph_files := $(core_src)/graph/gigraph.cpp \
-              $(core_src)/graph/gixform.cpp
+              $(core_src)/graph/gixform.cpp \
+              $(core_src)/graph/gidisplaylist.cpp \
+              $(core_src)/graph/gishapecache.cpp \
+              $(core_src)/graph/githreadpool.cpp
 
-json_files := $(core_src)/jsonstorage/mgjsonstorage.cpp
+json_files := $(core_src)/jsonstorage/mgjsonstorage.cpp \
+              $(core_src)/jsonstorage/mgbinarystorage.cpp
 
 gshape_files := $(core_src)/gshape/mgarc.cpp \
               $(core_src)/gshape/mgbasesp.cpp \
@@ -65,7 +69,10 @@ shape_files := $(core_src)/shape/mgcomposite.cpp \
               $(core_src)/shape/mgimagesp.cpp \
               $(core_src)/shape/mgshape.cpp \
               $(core_src)/shape/mgshapes.cpp \
-              $(core_src)/shape/mgbasicspreg.cpp
+              $(core_src)/shape/mgbasicspreg.cpp \
+              $(core_src)/shape/mgshapeindex.cpp \
+              $(core_src)/shape/mglazyshapes.cpp \
+              $(core_src)/shape/mgdrawprogress.cpp
 
 doc_files  := $(core_src)/shapedoc/mgshapedoc.cpp \
               $(core_src)/shapedoc/mglayer.cpp \
@@ -107,7 +114,9 @@ view_files := $(core_src)/view/GcGraphView.cpp \
               $(core_src)/view/gicorerecord.cpp \
               $(core_src)/export/svgcanvas.cpp \
               $(core_src)/export/girecordcanvas.cpp \
-              $(core_src)/record/recordshapes.cpp
+              $(core_src)/export/girastercanvas.cpp \
+              $(core_src)/record/recordshapes.cpp \
+              $(core_src)/record/recordjournal.cpp
 
 include $(CLEAR_VARS)
 LOCAL_MODULE     := libTouchVGCore
@@ -0,0 +1,29 @@
+// benchutil.h: 性能测试程序共用的计时函数
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_BENCHUTIL_H_
+#define TOUCHVG_BENCHUTIL_H_
+
+#if defined(__WINDOWS__) || defined(WIN32)
+#ifndef _WINDOWS_
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+static double tickMs()
+{
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart * 1000.0 / (double)freq.QuadPart;
+}
+#else
+#include <sys/time.h>
+static double tickMs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, (struct timezone*)0);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+#endif
+
+#endif // TOUCHVG_BENCHUTIL_H_
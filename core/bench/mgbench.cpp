@@ -0,0 +1,210 @@
+// mgbench.cpp: 点数组批量变换、范围计算和折线绘制的性能测试
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+//
+// 与逐点计算比较耗时，并检查批量变换的结果与逐点 Point2d::operator*= 是否完全相同。
+// 用法: mgbench [点数]，结果不同时返回1。
+
+#include "mgmat.h"
+#include "mgbox.h"
+#include "gigraph.h"
+#include "gicanvas.h"
+#include "benchutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+//! 只计数的画布，用于测量绘制前的坐标处理
+class NullCanvas : public GiCanvas
+{
+public:
+    long count;
+    NullCanvas() : count(0) {}
+    virtual void setPen(int, float, int, float, float) {}
+    virtual void setBrush(int, int) {}
+    virtual void clearRect(float, float, float, float) {}
+    virtual void drawRect(float, float, float, float, bool, bool) { count++; }
+    virtual void drawLine(float, float, float, float) { count++; }
+    virtual void drawEllipse(float, float, float, float, bool, bool) { count++; }
+    virtual void beginPath() {}
+    virtual void moveTo(float, float) { count++; }
+    virtual void lineTo(float, float) { count++; }
+    virtual void bezierTo(float, float, float, float, float, float) { count++; }
+    virtual void quadTo(float, float, float, float) { count++; }
+    virtual void closePath() {}
+    virtual void drawPath(bool, bool) {}
+    virtual void saveClip() {}
+    virtual void restoreClip() {}
+    virtual bool clipRect(float, float, float, float) { return true; }
+    virtual bool clipPath() { return true; }
+    virtual bool drawHandle(float, float, int, float) { return true; }
+    virtual bool drawBitmap(const char*, float, float, float, float, float) { return true; }
+    virtual float drawTextAt(const char*, float, float, float h, int, float) { return h; }
+};
+
+static const int kRepeats = 5;      // 每项测试重复次数，取最短耗时
+
+static float randFloat(float minv, float maxv)
+{
+    return minv + (maxv - minv) * ((float)rand() / (float)RAND_MAX);
+}
+
+static void report(const char* name, double ms, int points)
+{
+    printf("  %-34s %9.3f ms  %7.2f ns/pt\n", name, ms, ms * 1e6 / points);
+}
+
+// 以前的逐点变换
+static void transformEach(const Matrix2d& mat, int count, Point2d* pts)
+{
+    for (int i = 0; i < count; i++)
+        pts[i] *= mat;
+}
+
+// 以前的逐点范围计算
+static Box2d extentEach(int count, const Point2d* pts)
+{
+    Box2d box(pts[0], pts[0]);
+    for (int i = 0; i < count; i++) {
+        if (box.xmin > pts[i].x) box.xmin = pts[i].x;
+        if (box.ymin > pts[i].y) box.ymin = pts[i].y;
+        if (box.xmax < pts[i].x) box.xmax = pts[i].x;
+        if (box.ymax < pts[i].y) box.ymax = pts[i].y;
+    }
+    return box;
+}
+
+static bool sameBox(const Box2d& a, const Box2d& b)
+{
+    return a.xmin == b.xmin && a.ymin == b.ymin && a.xmax == b.xmax && a.ymax == b.ymax;
+}
+
+// 检查批量变换和范围与逐点计算的结果是否完全相同，返回不同的点数
+static int verify(const Matrix2d& mat, const std::vector<Point2d>& src)
+{
+    const int n = (int)src.size();
+    std::vector<Point2d> a(src), b(n);
+    Box2d box;
+    int diffs = 0;
+
+    transformEach(mat, n, &a.front());
+    mat.transformPoints(n, &src.front(), &b.front(), &box);
+    for (int i = 0; i < n; i++) {
+        if (memcmp(&a[i], &b[i], sizeof(Point2d)) != 0)
+            diffs++;
+    }
+    if (!sameBox(box, extentEach(n, &a.front())) || !sameBox(Box2d(n, &a.front()), box))
+        diffs++;
+
+    for (int k = 1; k < 8 && k < n; k++) {      // 不足一组的剩余点
+        mat.transformPoints(k, &src.front(), &b.front(), &box);
+        if (!sameBox(box, extentEach(k, &a.front())))
+            diffs++;
+    }
+    return diffs;
+}
+
+int main(int argc, char** argv)
+{
+    const int n = argc > 1 ? atoi(argv[1]) : 100000;
+    const int rounds = mgMax(1, 4000000 / mgMax(n, 1));
+    std::vector<Point2d> src(mgMax(n, 4)), buf(src.size());
+    Matrix2d mat(Matrix2d::rotation(0.3f) * Matrix2d::scaling(1.7f) * Matrix2d::translation(Vector2d(12.5f, -3.f)));
+    double best[7];
+    Box2d box;
+
+    srand(9999);
+    for (size_t i = 0; i < src.size(); i++) {
+        src[i].set(randFloat(-1000.f, 1000.f), randFloat(-1000.f, 1000.f));
+    }
+
+    const int diffs = verify(mat, src);
+    printf("points %d, rounds %d, batch results %s\n", n, rounds,
+           diffs ? "DIFFER from Point2d::operator*=" : "identical to Point2d::operator*=");
+
+    for (int k = 0; k < 7; k++) {
+        best[k] = 1e30;
+    }
+    for (int r = 0; r < kRepeats; r++) {
+        double t[8];
+
+        t[0] = tickMs();
+        for (int i = 0; i < rounds; i++) {
+            buf = src; transformEach(mat, n, &buf.front());
+        }
+        t[1] = tickMs();
+        for (int i = 0; i < rounds; i++) {
+            buf = src; mat.transformPoints(n, &buf.front());
+        }
+        t[2] = tickMs();
+        for (int i = 0; i < rounds; i++) {
+            buf = src; transformEach(mat, n, &buf.front());
+            box = extentEach(n, &buf.front());
+        }
+        t[3] = tickMs();
+        for (int i = 0; i < rounds; i++) {
+            buf = src; mat.transformPoints(n, &buf.front(), &buf.front(), &box);
+        }
+        t[4] = tickMs();
+        for (int i = 0; i < rounds; i++) {
+            box = extentEach(n, &src.front());
+        }
+        t[5] = tickMs();
+        for (int i = 0; i < rounds; i++) {
+            box.set(n, &src.front());
+        }
+        t[6] = tickMs();
+        for (int i = 0; i < rounds; i++) {
+            buf = src;
+        }
+        t[7] = tickMs();
+
+        const double copyMs = t[7] - t[6];      // 前四项包含复制源点的时间，扣除
+        for (int k = 0; k < 6; k++) {
+            double ms = (t[k + 1] - t[k] - (k < 4 ? copyMs : 0)) / rounds;
+            if (best[k] > ms)
+                best[k] = ms;
+        }
+    }
+
+    report("transform, per point", best[0], n);
+    report("transformPoints", best[1], n);
+    report("transform + extent, per point", best[2], n);
+    report("transformPoints with box", best[3], n);
+    report("extent, per point", best[4], n);
+    report("Box2d::set(count, points)", best[5], n);
+
+    GiTransform xf;
+    GiGraphics gs(&xf);
+    NullCanvas canvas;
+    const int segs = (mgMax(n, 4) - 1) / 3 * 3 + 1;     // 贝塞尔曲线的点数为3的倍数加1
+
+    xf.setWndSize(2000, 2000);
+    xf.zoomTo(Box2d(-1000.f, -1000.f, 1000.f, 1000.f));
+    for (int k = 0; k < 3; k++) {
+        best[k] = 1e30;
+    }
+    for (int r = 0; r < kRepeats; r++) {
+        double t[4];
+
+        gs.beginPaint(&canvas);
+        t[0] = tickMs();
+        gs.drawLines((const GiContext*)0, n, &src.front());
+        t[1] = tickMs();
+        gs.drawBeziers((const GiContext*)0, segs, &src.front());
+        t[2] = tickMs();
+        gs.drawPolygon((const GiContext*)0, n, &src.front());
+        t[3] = tickMs();
+        gs.endPaint();
+
+        for (int k = 0; k < 3; k++) {
+            if (best[k] > t[k + 1] - t[k])
+                best[k] = t[k + 1] - t[k];
+        }
+    }
+    report("GiGraphics::drawLines", best[0], n);
+    report("GiGraphics::drawBeziers", best[1], segs);
+    report("GiGraphics::drawPolygon", best[2], n);
+
+    return diffs ? 1 : 0;
+}
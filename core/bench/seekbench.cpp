@@ -0,0 +1,223 @@
+// seekbench.cpp: 录制回放中跳转到指定时刻 MgRecordShapes::seek() 与从头逐帧回放的耗时比较
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+//
+// 分别按每帧两个文件和日志文件(records.vgj)、JSON和二进制格式录制，关键帧间隔为不写、每K帧、每M字节，
+// 测量跳到最后一帧和中间一帧的耗时，并检查跳转与逐帧回放得到的文档是否相同。
+// 用法: seekbench [图形数] [帧数] [临时目录]，默认为500个图形、3000帧、当前目录下的 seekbench.rec。
+
+#include "mgshapedoc.h"
+#include "mgshapet.h"
+#include "mgbasicsps.h"
+#include "mgbasicspreg.h"
+#include "spfactoryimpl.h"
+#include "mgjsonstorage.h"
+#include "recordshapes.h"
+#include "benchutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#if defined(__WINDOWS__) || defined(WIN32)
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#endif
+
+static MgShapeFactoryImpl   _factory;
+
+static MgShapeDoc* createDoc(int count)
+{
+    MgShapeDoc* doc = MgShapeDoc::createDoc();
+
+    for (int i = 0; i < count; i++) {
+        Point2d pt((float)(rand() % 10000), (float)(rand() % 10000));
+        MgShape* sp = MgShapeT<MgSplines>::create();
+
+        for (int k = 0; k < 20; k++) {
+            ((MgBaseLines*)sp->shape())->addPoint(pt + Vector2d((float)k, (float)(k * k % 7)));
+        }
+        doc->getCurrentShapes()->addShapeDirect(sp);
+    }
+    return doc;
+}
+
+static long fileSize(const std::string& filename)
+{
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0 ? (long)st.st_size : 0;
+}
+
+//! 删除录制的文件，返回其总字节数
+static long removeRecord(const std::string& path, int steps)
+{
+    const char* names[] = { "0.vg", "records.json", "records.vgj" };
+    const char* exts[] = { ".vgr", ".vgu", ".vgk" };
+    long bytes = 0;
+    char name[20];
+
+    for (int i = 0; i < 3; i++) {
+        bytes += fileSize(path + names[i]);
+        remove((path + names[i]).c_str());
+    }
+    for (int i = 1; i <= steps; i++) {
+        for (int j = 0; j < 3; j++) {
+            sprintf(name, "%d%s", i, exts[j]);
+            bytes += fileSize(path + name);
+            remove((path + name).c_str());
+        }
+    }
+    return bytes;
+}
+
+//! 录制 steps 帧：增加、修改、删除图形，调整显示次序，动态图形逐渐增加点
+static void record(const std::string& path, bool journal, bool binary, int count, int steps,
+                   int keySteps, int keyBytes)
+{
+    srand(11);
+    MgShapeDoc* doc = createDoc(count);
+    {
+        FILE* fp = fopen((path + "0.vg").c_str(), "wt");
+        MgJsonStorage s;
+        if (fp) {
+            doc->save(s.storageForWrite(fp), 0);
+            fclose(fp);
+        }
+    }
+
+    MgRecordShapes* recorder = new MgRecordShapes(path.c_str(), doc->shallowCopy(), false, 0);
+    MgShapes* shapes = doc->getCurrentShapes();
+    MgShape* dyn = MgShapeT<MgSplines>::create();
+    std::vector<MgShapes*> exts;
+
+    recorder->setBinaryFormat(binary);
+    recorder->setJournalFormat(journal);
+    recorder->setKeyframeInterval(keySteps, keyBytes);
+    recorder->restore(1, 0, 0, 0);
+
+    for (int k = 0; k < steps; k++) {
+        const int op = k % 6;
+
+        if (op == 0) {
+            for (int j = 0; j < 3; j++) {
+                MgShape* sp = MgShapeT<MgLine>::create();
+                sp->shape()->setPoint(1, Point2d(5.f + k, 5.f + j));
+                shapes->addShapeDirect(sp);
+            }
+        } else if (op == 1) {
+            MgShape* sp = shapes->getHeadShape()->cloneShape();
+            sp->shape()->offset(Vector2d(3.f, 3.f), -1);
+            shapes->updateShape(sp);
+        } else if (op == 2) {
+            shapes->removeShape(shapes->getLastShape()->getID() - 2);
+        } else if (op == 3) {
+            shapes->bringToFront(shapes->getHeadShape()->getID());
+        } else {
+            MgShape* sp = dyn->cloneShape();
+            ((MgBaseLines*)sp->shape())->addPoint(Point2d((float)k, (float)k * 2));
+            dyn->release();
+            dyn = sp;
+        }
+        if (k % 50 == 49) {
+            dyn->release();
+            dyn = MgShapeT<MgSplines>::create();
+        }
+
+        MgShapes* dyns = MgShapes::create();
+        dyns->addShapeDirect(dyn->cloneShape());
+        recorder->recordStep(100 + k * 30, k, k + 1, doc->shallowCopy(), dyns, exts);
+    }
+    delete recorder;                            // 等待写线程写完
+    dyn->release();
+    doc->release();
+}
+
+static std::string toJson(MgShapeDoc* doc)
+{
+    MgJsonStorage s;
+    doc->save(s.storageForWrite(), 0);
+    return s.stringify(false);
+}
+
+//! 从头逐帧回放到 tick，与播放器的做法相同，返回耗时(毫秒)
+static double replay(const std::string& path, long tick, std::string& result)
+{
+    double t0 = tickMs();
+    std::vector<int> arr;
+    MgRecordShapes player(path.c_str(), (MgShapeDoc*)0, false, 0);
+    MgShapeDoc* doc = MgShapeDoc::createDoc();
+    MgShapes* dyns = MgShapes::create();
+
+    MgRecordShapes::loadFrameIndex(path, arr);
+    player.applyFirstFile(&_factory, doc);
+    for (size_t i = 0; i + 2 < arr.size() && arr[i + 1] <= tick; i += 3) {
+        dyns->release();
+        dyns = MgShapes::create();
+        player.applyRedoFile(&_factory, doc, dyns, arr[i]);
+    }
+    double ms = tickMs() - t0;
+
+    result = toJson(doc);
+    doc->release();
+    dyns->release();
+    return ms;
+}
+
+//! 用 MgRecordShapes::seek() 跳到 tick，返回耗时(毫秒)
+static double seek(const std::string& path, long tick, std::string& result)
+{
+    double t0 = tickMs();
+    MgRecordShapes player(path.c_str(), (MgShapeDoc*)0, false, 0);
+    MgShapeDoc* doc = MgShapeDoc::createDoc();
+    MgShapes* dyns = MgShapes::create();
+    int ret = player.seek(&_factory, doc, dyns, tick);
+    double ms = tickMs() - t0;
+
+    result = ret ? toJson(doc) : std::string();
+    doc->release();
+    dyns->release();
+    return ms;
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 ? atoi(argv[1]) : 500;
+    const int steps = argc > 2 ? atoi(argv[2]) : 3000;
+    const std::string path(std::string(argc > 3 ? argv[3] : "seekbench.rec") + "/");
+    const int keys[][2] = { { 0, 0 }, { 100, 0 }, { 0, 65536 } };
+    const char* keyNames[] = { "none", "K=100", "M=64KB" };
+    const long lastTick = 100 + (steps - 1) * 30;
+    const long midTick = 100 + steps / 2 * 30;
+    int diffs = 0;
+
+    MgBasicShapes::registerShapes(&_factory);
+    mkdir(path.c_str(), 0755);
+    printf("shapes %d, steps %d, times in ms\n", count, steps);
+    printf("  %-8s %-12s %9s %9s %9s %9s %9s\n", "keys", "layout",
+           "replay", "seek", "replay", "seek", "disk KB");
+    printf("  %-8s %-12s %19s %19s\n", "", "", "last frame", "middle frame");
+
+    for (int k = 0; k < 3; k++) {
+        for (int layout = 0; layout < 4; layout++) {
+            const bool journal = layout >= 2;
+            const bool binary = (layout % 2) != 0;
+            std::string a, b, c, d;
+
+            record(path, journal, binary, count, steps, keys[k][0], keys[k][1]);
+            double t1 = replay(path, lastTick, a);
+            double t2 = seek(path, lastTick, b);
+            double t3 = replay(path, midTick, c);
+            double t4 = seek(path, midTick, d);
+            long bytes = removeRecord(path, steps);
+
+            if (a != b || c != d || a.empty()) {
+                diffs++;
+            }
+            printf("  %-8s %-12s %9.1f %9.1f %9.1f %9.1f %9ld%s\n", keyNames[k],
+                   journal ? (binary ? "journal/bin" : "journal/json") : (binary ? "file/bin" : "file/json"),
+                   t1, t2, t3, t4, bytes / 1024, a != b || c != d ? "  DIFFERENT" : "");
+        }
+    }
+    remove(path.c_str());
+
+    return diffs ? 1 : 0;
+}
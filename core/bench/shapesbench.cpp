@@ -0,0 +1,87 @@
+// shapesbench.cpp: 图形列表 MgShapes 的遍历、查找和显示次序调整的性能测试
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+//
+// 分别在1万、10万和100万个图形上测试，先随机删除1000个图形，使列表中留有空位。
+// 用法: shapesbench [最大图形数]，默认为100万。
+
+#include "mgshapes.h"
+#include "mgshapet.h"
+#include "mgline.h"
+#include "benchutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int randId(int count)
+{
+    return 1 + (int)(((double)rand() / ((double)RAND_MAX + 1)) * count);
+}
+
+static MgShapes* createShapes(int count)
+{
+    MgShapes* shapes = MgShapes::create();
+
+    for (int i = 0; i < count; i++) {
+        MgShape* sp = MgShapeT<MgLine>::create();
+        Point2d pt((float)(rand() % 100000), (float)(rand() % 100000));
+
+        sp->shape()->setPoint(0, pt);
+        sp->shape()->setPoint(1, pt + Vector2d(10.f, 5.f));
+        shapes->addShapeDirect(sp);
+    }
+    for (int i = 0; i < 1000; i++) {
+        shapes->removeShape(randId(count));
+    }
+
+    return shapes;
+}
+
+int main(int argc, char** argv)
+{
+    const int maxCount = argc > 1 ? atoi(argv[1]) : 1000000;
+    long sum = 0;
+
+    srand(9999);
+    printf("%8s %10s %12s %12s %12s %12s %12s\n", "shapes", "iterate",
+           "find x1e6", "front x500", "back x500", "toIndex x100", "atIndex x1e3");
+
+    for (int count = 10000; count <= maxCount; count *= 10) {
+        MgShapes* shapes = createShapes(count);
+        double t[7];
+
+        t[0] = tickMs();
+        for (int r = 0; r < 10; r++) {
+            MgShapeIterator it(shapes);
+            while (const MgShape* sp = it.getNext()) {
+                sum += sp->getID();
+            }
+        }
+        t[1] = tickMs();
+        for (int r = 0; r < 1000000; r++) {
+            sum += shapes->findShape(randId(count)) ? 1 : 0;
+        }
+        t[2] = tickMs();
+        for (int r = 0; r < 500; r++) {
+            shapes->bringToFront(randId(count));
+        }
+        t[3] = tickMs();
+        for (int r = 0; r < 500; r++) {
+            shapes->bringToBack(randId(count));
+        }
+        t[4] = tickMs();
+        for (int r = 0; r < 100; r++) {
+            shapes->bringToIndex(randId(count), rand() % shapes->getShapeCount());
+        }
+        t[5] = tickMs();
+        for (int r = 0; r < 1000; r++) {
+            const MgShape* sp = shapes->getShapeAtIndex(rand() % shapes->getShapeCount());
+            sum += sp ? shapes->getShapeIndex(sp->getID()) : 0;
+        }
+        t[6] = tickMs();
+
+        printf("%8d %10.2f %12.1f %12.1f %12.1f %12.1f %12.1f  ms\n", count, (t[1] - t[0]) / 10,
+               t[2] - t[1], t[3] - t[2], t[4] - t[3], t[5] - t[4], t[6] - t[5]);
+        shapes->release();
+    }
+
+    return sum == -1 ? 1 : 0;                   // 使用 sum 以免被优化掉
+}
@@ -0,0 +1,154 @@
+// storagebench.cpp: JSON 与二进制格式的图形文档保存、读取耗时和文件大小比较
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+//
+// 按 GiCoreView::saveToFile/loadFromFile 的方式读写，JSON 边写边输出、流式读取，二进制映射文件读取。
+// 用法: storagebench [图形数] [临时文件目录]，默认为10万个图形、当前目录。
+
+#include "mgshapedoc.h"
+#include "mgshapet.h"
+#include "mgbasicsps.h"
+#include "mgbasicspreg.h"
+#include "spfactoryimpl.h"
+#include "mgjsonstorage.h"
+#include "mgbinarystorage.h"
+#include "benchutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+static MgShapeDoc* createDoc(int count)
+{
+    MgShapeDoc* doc = MgShapeDoc::createDoc();
+    MgShapes* shapes = doc->getCurrentShapes();
+
+    for (int i = 0; i < count; i++) {
+        Point2d pt((float)(rand() % 10000) + 0.25f, (float)(rand() % 10000) / 3.f);
+        MgShape* sp;
+        GiContext ctx;
+
+        switch (i % 4) {
+        case 0:
+            sp = MgShapeT<MgLine>::create();
+            sp->shape()->setPoint(0, pt);
+            sp->shape()->setPoint(1, pt + Vector2d(10.f, 5.f));
+            break;
+        case 1:
+            sp = MgShapeT<MgSplines>::create();
+            for (int k = 0; k < 20; k++) {
+                ((MgBaseLines*)sp->shape())->addPoint(pt + Vector2d((float)k, (float)(k * k % 7)));
+            }
+            break;
+        case 2:
+            sp = MgShapeT<MgRect>::create();
+            ((MgBaseRect*)sp->shape())->setRect2P(pt, pt + Vector2d(7.f, 4.f));
+            break;
+        default:
+            sp = MgShapeT<MgEllipse>::create();
+            ((MgBaseRect*)sp->shape())->setRect2P(pt, pt + Vector2d(7.f, 4.f));
+            break;
+        }
+        ctx.setLineWidth(-(float)(i % 4), true);
+        ctx.setLineARGB(0x80000000u | i);
+        sp->setContext(ctx);
+        shapes->addShapeDirect(sp);
+    }
+
+    return doc;
+}
+
+static long fileSize(const char* filename)
+{
+    FILE* fp = fopen(filename, "rb");
+    long size = -1;
+
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp);
+        fclose(fp);
+    }
+    return size;
+}
+
+static bool saveJson(MgShapeDoc* doc, const char* filename)
+{
+    FILE* fp = fopen(filename, "wt");
+    MgJsonStorage s;
+    bool ret = fp && doc->save(s.storageForWrite(fp), 0) && !ferror(fp);
+
+    if (fp) fclose(fp);
+    return ret;
+}
+
+static bool saveBinary(MgShapeDoc* doc, const char* filename)
+{
+    FILE* fp = fopen(filename, "wb");
+    MgBinaryStorage s;
+    bool ret = fp && doc->save(s.storageForWrite(), 0) && s.save(fp);
+
+    if (fp) fclose(fp);
+    return ret;
+}
+
+static int load(MgShapeFactory* factory, const char* filename, bool lazy)
+{
+    FILE* fp = fopen(filename, "rt");
+    MgShapeDoc* doc = MgShapeDoc::createDoc();
+    int n = -1;
+
+    if (fp && MgBinaryStorage::isBinaryFile(fp)) {
+        MgBinaryStorage s;
+        s.setLazyLoading(lazy);
+        n = doc->load(factory, s.storageForRead(fp), false) ? doc->getShapeCount() : -1;
+    } else if (fp) {
+        MgJsonStorage s;
+        s.setStreamMode(true);
+        n = doc->load(factory, s.storageForRead(fp), false) ? doc->getShapeCount() : -1;
+    }
+    if (fp) fclose(fp);
+    doc->release();
+
+    return n;
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 ? atoi(argv[1]) : 100000;
+    const std::string dir(argc > 2 ? argv[2] : ".");
+    const std::string jsonFile(dir + "/storagebench.vg");
+    const std::string binFile(dir + "/storagebench.vgb");
+    MgShapeFactoryImpl factory;
+    int loaded[3];
+    double t[6];
+
+    MgBasicShapes::registerShapes(&factory);
+    srand(9999);
+    MgShapeDoc* doc = createDoc(count);
+
+    t[0] = tickMs();
+    bool ret = saveJson(doc, jsonFile.c_str());
+    t[1] = tickMs();
+    ret = saveBinary(doc, binFile.c_str()) && ret;
+    t[2] = tickMs();
+    loaded[0] = load(&factory, jsonFile.c_str(), false);
+    t[3] = tickMs();
+    loaded[1] = load(&factory, binFile.c_str(), false);
+    t[4] = tickMs();
+    loaded[2] = load(&factory, binFile.c_str(), true);
+    t[5] = tickMs();
+    doc->release();
+
+    printf("shapes %d\n", count);
+    printf("  %-14s %10s %10s %10s\n", "", "size KB", "save ms", "load ms");
+    printf("  %-14s %10ld %10.1f %10.1f\n", "JSON", fileSize(jsonFile.c_str()) / 1024, t[1] - t[0], t[3] - t[2]);
+    printf("  %-14s %10ld %10.1f %10.1f\n", "binary", fileSize(binFile.c_str()) / 1024, t[2] - t[1], t[4] - t[3]);
+    printf("  %-14s %10s %10s %10.1f\n", "binary, lazy", "", "", t[5] - t[4]);
+
+    remove(jsonFile.c_str());
+    remove(binFile.c_str());
+
+    if (!ret || loaded[0] != count || loaded[1] != count || loaded[2] != count) {
+        printf("failed: saved %d, loaded %d %d %d shapes\n", ret, loaded[0], loaded[1], loaded[2]);
+        return 1;
+    }
+    return 0;
+}
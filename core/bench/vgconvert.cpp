@@ -0,0 +1,26 @@
+// vgconvert.cpp: 在JSON图形文件和二进制图形文件之间相互转换
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+//
+// 按输入文件的文件头确定转换方向，见 MgBinaryStorage::convertFile()。
+// 用法: vgconvert [-p] 输入文件 输出文件，-p 表示输出缩进格式的JSON。
+
+#include "mgbinarystorage.h"
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char** argv)
+{
+    const bool pretty = argc > 1 && strcmp(argv[1], "-p") == 0;
+    const int i = pretty ? 2 : 1;
+
+    if (argc != i + 2) {
+        fprintf(stderr, "Usage: %s [-p] infile outfile\n"
+                "Converts a .vg (JSON) file to binary, or a binary file to JSON.\n", argv[0]);
+        return 2;
+    }
+    if (!MgBinaryStorage::convertFile(argv[i], argv[i + 1], pretty)) {
+        fprintf(stderr, "Fail to convert %s to %s\n", argv[i], argv[i + 1]);
+        return 1;
+    }
+    return 0;
+}
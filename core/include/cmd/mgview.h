@@ -71,6 +71,7 @@ struct MgView
     virtual void regenAll(bool changed) = 0;                    //!< 标记视图待重新构建显示
     virtual void regenAppend(int sid, long playh = 0) = 0;      //!< 标记视图待追加显示新图形
     virtual void redraw(bool changed = true) = 0;               //!< 标记视图待更新显示
+    virtual void regenShape(const MgShape* shape) = 0;          //!< 标记视图待重新构建图形所在范围的显示，图形改变前后各调用一次
     
     virtual bool useFinger() = 0;                               //!< 使用手指或鼠标交互
     virtual void commandChanged() = 0;                          //!< 命令改变
@@ -0,0 +1,96 @@
+//! \file girastercanvas.h
+//! \brief 定义绘制到RGBA像素缓冲的画布类 GiRasterCanvas
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_CORE_RASTERCANVAS_H_
+#define TOUCHVG_CORE_RASTERCANVAS_H_
+
+#include "gicanvas.h"
+
+//! 光栅画布取图像和显示文字的回调接口
+/*! \ingroup CORE_STORAGE
+    \interface GiRasterCallback
+    \see GiRasterCanvas::setCallback
+ */
+struct GiRasterCallback {
+    virtual ~GiRasterCallback() {}
+
+    //! 返回图像的RGBA像素(非预乘，每行 stride 字节)，没有此图像时返回NULL，像素在下次调用前应有效
+    virtual const unsigned char* getImagePixels(const char* name, int& width, int& height, int& stride) = 0;
+
+    //! 显示一行文字，可用 canvas 的路径函数以当前画刷填充字形，返回显示宽度，参数同 GiCanvas::drawTextAt()
+    virtual float drawTextAt(GiCanvas* canvas, const char* text, float x, float y,
+                             float h, int align, float angle) { return 0; }
+};
+
+//! 绘制到RGBA像素缓冲的画布类，自带抗锯齿的扫描线光栅化，不依赖平台图形库
+/*! 像素缓冲由调用者提供，每个像素依次为 R、G、B、A 四个字节(非预乘)，可在多个线程中各用一个画布。
+    支持路径、贝塞尔曲线、虚线、填充、矩形剪裁和路径剪裁，填充按非零环绕规则。
+    图像和文字通过 GiRasterCallback 由宿主提供，没有回调时不显示。
+    \ingroup CORE_STORAGE
+ */
+class GiRasterCanvas : public GiCanvas
+{
+public:
+    GiRasterCanvas();
+    virtual ~GiRasterCanvas();
+
+#ifndef SWIG
+    //! 设置像素缓冲，stride 为每行字节数(为0则为 width*4)，不复制像素
+    bool attach(unsigned char* pixels, int width, int height, int stride = 0);
+
+    //! 返回像素缓冲
+    unsigned char* getPixels() const;
+
+    //! 将RGBA像素保存为PNG文件
+    static bool writePNG(const char* filename, const unsigned char* pixels,
+                         int width, int height, int stride = 0);
+#endif
+
+    //! 分配像素缓冲，像素全部透明
+    bool create(int width, int height);
+
+    //! 设置取图像和显示文字的回调对象
+    void setCallback(GiRasterCallback* callback);
+
+    int getWidth() const;       //!< 返回像素宽度
+    int getHeight() const;      //!< 返回像素高度
+
+    //! 用给定颜色(ARGB)填充整个画布，忽略剪裁范围
+    void fill(int argb);
+
+    //! 将像素保存为PNG文件
+    bool savePNG(const char* filename) const;
+
+public:
+    virtual void setPen(int argb, float width, int style, float phase, float orgw);
+    virtual void setBrush(int argb, int style);
+    virtual void clearRect(float x, float y, float w, float h);
+    virtual void drawRect(float x, float y, float w, float h, bool stroke, bool fill);
+    virtual void drawLine(float x1, float y1, float x2, float y2);
+    virtual void drawEllipse(float x, float y, float w, float h, bool stroke, bool fill);
+    virtual void beginPath();
+    virtual void moveTo(float x, float y);
+    virtual void lineTo(float x, float y);
+    virtual void bezierTo(float c1x, float c1y, float c2x, float c2y, float x, float y);
+    virtual void quadTo(float cpx, float cpy, float x, float y);
+    virtual void closePath();
+    virtual void drawPath(bool stroke, bool fill);
+    virtual void saveClip();
+    virtual void restoreClip();
+    virtual bool clipRect(float x, float y, float w, float h);
+    virtual bool clipPath();
+    virtual bool drawHandle(float x, float y, int type, float angle);
+    virtual bool drawBitmap(const char* name, float xc, float yc,
+                            float w, float h, float angle);
+    virtual float drawTextAt(const char* text, float x, float y, float h, int align, float angle);
+
+private:
+    GiRasterCanvas(const GiRasterCanvas&);
+    void operator=(const GiRasterCanvas&);
+
+    struct Impl;
+    Impl*   im;
+};
+
+#endif // TOUCHVG_CORE_RASTERCANVAS_H_
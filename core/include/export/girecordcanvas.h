@@ -8,6 +8,7 @@
 #include "gicanvas.h"
 
 class MgRecordShape;
+class GiDisplayList;
 class MgShape;
 class MgShapes;
 class GiTransform;
@@ -50,12 +51,14 @@ private:
     virtual float drawTextAt(GiTextWidthCallback* c, const char* text, float x, float y, float h, int align, float angle);
     
 private:
-    const Matrix2d d2w() const;
+    void createShape();
+    GiDisplayList* list() { if (!_shape) createShape(); return _list; }
 
 private:
     MgShapes*       _shapes;
     MgShape*        _shape;
     MgRecordShape*  _sp;
+    GiDisplayList*  _list;
     const GiTransform* _xf;
     int             _ignoreId;
 };
@@ -6,10 +6,11 @@
 #define TOUCHVG_CORE_GIRECORDSHAPE_H
 
 #include "mgshape.h"
-#include <vector>
+#include "gidisplaylist.h"
 
 //! The shape class to record drawing.
-/*! \ingroup CORE_SHAPE
+/*! The drawing commands are kept in a GiDisplayList in world coordinates.
+    \ingroup CORE_SHAPE
  */
 class MgRecordShape : public MgBaseShape
 {
@@ -17,21 +18,15 @@ public:
     MgRecordShape() : _sid(0) {}
     virtual ~MgRecordShape() { _clear(); }
     
-    //! Interface of recording items.
-    struct ICmd {
-        virtual ~ICmd() {}
-        virtual int type() const = 0;
-        virtual void copy(const ICmd& src) = 0;
-        virtual bool save(MgStorage* s) const = 0;
-        virtual bool load(MgStorage* s) = 0;
-        virtual bool draw(GiGraphics& gs, const Matrix2d& w2d) const = 0;
-        virtual Box2d getExtentW() const { return Box2d(0, 0, 1, 1); }
-    };
-    
-    int getCount() const { return (int)_items.size(); }
-    void addItem(const Matrix2d& w2m, ICmd* p);
+    int getCount() const { return _list.getCount(); }
     void setRefID(int sid) { _sid = sid; }
     
+    //! Return the display list to record drawing.
+    GiDisplayList& getList() { return _list; }
+    
+    //! Set the extent in model coordinates from the display list.
+    void updateExtent(const Matrix2d& w2m);
+    
     static MgRecordShape* create() { return new MgRecordShape(); }
     static int Type() { return 30; }
     
@@ -56,11 +51,10 @@ public:
     
 private:
     void _clear();
-    ICmd* createItem(int type) const;
+    bool loadItems(MgStorage* s);
     
-    typedef std::vector<ICmd*>  ITEMS;
-    ITEMS   _items;
-    int     _sid;
+    GiDisplayList   _list;
+    int             _sid;
 };
 
 #endif // TOUCHVG_CORE_GIRECORDSHAPE_H
@@ -7,6 +7,8 @@
 
 #include "mgpnt.h"
 
+class Box2d;
+
 //! 二维齐次变换矩阵类
 /*!
     \ingroup GEOM_CLASS
@@ -111,6 +113,18 @@ public:
     */
     void transformPoints(int count, Point2d* points) const;
 
+#ifndef SWIG
+    //! 对多个点进行矩阵变换，结果放到另一数组，并可同时得到结果的范围
+    /*! 有 SSE2 指令时每次变换多个点
+        \param[in] count 点的个数
+        \param[in] points 要变换的点的数组，元素个数为count
+        \param[out] result 变换后的点的数组，元素个数为count，可与 points 相同
+        \param[out] box 不为NULL时返回变换后的点的范围
+    */
+    void transformPoints(int count, const Point2d* points, Point2d* result,
+                         Box2d* box = (Box2d*)0) const;
+#endif
+
     //! 对多个矢量进行矩阵变换
     /*! 对矢量进行矩阵变换时，矩阵的平移分量部分不起作用
         \param[in] count 矢量的个数
@@ -0,0 +1,100 @@
+﻿//! \file gidisplaylist.h
+//! \brief 定义记录绘图命令的显示列表类 GiDisplayList
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_GIDISPLAYLIST_H_
+#define TOUCHVG_GIDISPLAYLIST_H_
+
+#include "gicanvas.h"
+#include "mgbox.h"
+#include "mgmat.h"
+#include <vector>
+
+//! 显示列表，将画布的绘图命令记录到一个连续的缓冲中
+/*! 每个命令为一个标记字(类型和参数个数)及其后的整数或浮点数参数，
+    记录时只在缓冲增长时分配内存，缓冲可直接保存。
+    \ingroup GRAPH_INTERFACE
+ */
+class GiDisplayList : public GiCanvas
+{
+public:
+    GiDisplayList();
+    GiDisplayList(const GiDisplayList& src);
+    virtual ~GiDisplayList();
+    GiDisplayList& operator=(const GiDisplayList& src);
+
+    //! 设置后续命令的坐标变换矩阵
+    void setMatrix(const Matrix2d& mat) { _mat = mat; }
+
+    //! 清除所有命令，保留缓冲内存
+    void clear();
+
+    //! 返回命令个数
+    int getCount() const { return _count; }
+
+    //! 返回所记录坐标的范围
+    const Box2d& getExtent() const { return _extent; }
+
+    //! 将各命令输出到画布，mat 不为NULL时对坐标进行变换
+    /*! clipPath() 失败后的绘图命令被跳过，直到下一个 saveClip() 或 restoreClip()。
+        \return 是否有命令
+     */
+    bool replay(GiCanvas* canvas, const Matrix2d* mat = (const Matrix2d*)0) const;
+
+    //! 返回命令缓冲，用于保存
+    const int* getData() const { return _data.empty() ? (const int*)0 : &_data.front(); }
+
+    //! 返回命令缓冲的整数个数
+    int getDataSize() const { return (int)_data.size(); }
+
+    //! 用 getData() 得到的缓冲替换各命令，缓冲无效时返回 false
+    bool setData(const int* data, int size);
+
+    //! 返回命令是否相同
+    bool equals(const GiDisplayList& src) const { return _data == src._data; }
+
+public:
+    virtual void setPen(int argb, float width, int style, float phase, float orgw);
+    virtual void setBrush(int argb, int style);
+    virtual void clearRect(float x, float y, float w, float h);
+    virtual void drawRect(float x, float y, float w, float h, bool stroke, bool fill);
+    virtual void drawLine(float x1, float y1, float x2, float y2);
+    virtual void drawEllipse(float x, float y, float w, float h, bool stroke, bool fill);
+    virtual void beginPath();
+    virtual void moveTo(float x, float y);
+    virtual void lineTo(float x, float y);
+    virtual void bezierTo(float c1x, float c1y, float c2x, float c2y, float x, float y);
+    virtual void quadTo(float cpx, float cpy, float x, float y);
+    virtual void closePath();
+    virtual void drawPath(bool stroke, bool fill);
+    virtual void saveClip();
+    virtual void restoreClip();
+    virtual bool clipRect(float x, float y, float w, float h);
+    virtual bool clipPath();
+    virtual bool drawHandle(float x, float y, int type, float angle);
+    virtual bool drawBitmap(const char* name, float xc, float yc,
+                            float w, float h, float angle);
+    virtual float drawTextAt(const char* text, float x, float y, float h, int align, float angle);
+#ifndef SWIG
+    virtual float drawTextAt(GiTextWidthCallback* c, const char* text,
+                             float x, float y, float h, int align, float angle);
+#endif
+
+private:
+    int* addCmd(int type, int size);
+    int* addString(int type, int size, const char* str);
+    void addPoint(int* p, float x, float y);
+    void addVector(int* p, float x, float y);
+    void addExtent(const int* p);
+    void releaseCallbacks();
+
+private:
+    std::vector<int>    _data;
+    std::vector<GiTextWidthCallback*> _callbacks;
+    Matrix2d    _mat;
+    Box2d       _extent;
+    int         _count;
+    bool        _hasExtent;
+};
+
+#endif // TOUCHVG_GIDISPLAYLIST_H_
@@ -12,6 +12,7 @@
 #ifndef SWIG
 class GiGraphicsImpl;
 class GiCanvas;
+class GiShapeCache;
 struct GiTextWidthCallback;
 #endif
 
@@ -158,6 +159,24 @@ public:
     //! 是否允许虚线偏移量
     bool setPhaseEnabled(bool enabled);
     
+    //! 设置是否合并绘制画笔相同的连续图元，返回原来的设置
+    /*! 合并时省去与上次相同的画笔和画刷设置，将画笔相同的连续描边图元(不填充)收集到一个路径中，
+        在画笔或画刷改变、剪裁框改变、绘制其他图元、调用 getCanvas() 和 endPaint() 时才提交。
+        合并的路径可能跨越 beginShape() 和 endShape()，按图形分组输出的画布不宜使用。
+     */
+    bool setBatching(bool enabled);
+    
+    //! 返回是否合并绘制画笔相同的连续图元
+    bool isBatching() const;
+    
+#ifndef SWIG
+    //! 设置图形显示列表的缓存对象，为NULL时不缓存，返回原来的缓存对象
+    GiShapeCache* setShapeCache(GiShapeCache* cache);
+    
+    //! 返回图形显示列表的缓存对象
+    GiShapeCache* getShapeCache() const;
+#endif
+    
 public:
     //! 绘制直线段，模型坐标或世界坐标
     /*!
@@ -434,6 +453,7 @@ private:
 
 private:
     GiGraphics& operator=(const GiGraphics&);
+    friend class GiShapeCache;
 
     GiGraphicsImpl* m_impl;     //!< 内部实现
 };
@@ -37,7 +37,7 @@
     inline long giAtomicIncrement(volatile long *p) { return ++(*p); }
     inline long giAtomicDecrement(volatile long *p) { return --(*p); }
     inline bool giAtomicCompareAndSwap(volatile long *p, long value, long oldValue) {
-        bool b = *p == oldValue; if (b) *p = value; return oldValue; }
+        bool b = *p == oldValue; if (b) *p = value; return b; }
 #endif
 #endif // SWIG
 
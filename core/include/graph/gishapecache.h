@@ -0,0 +1,70 @@
+﻿//! \file gishapecache.h
+//! \brief 定义图形显示列表的缓存类 GiShapeCache
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_GISHAPECACHE_H_
+#define TOUCHVG_GISHAPECACHE_H_
+
+#include "gigraph.h"
+
+//! 图形显示列表的缓存类，平移或放缩变化不大时重放各图形记下的绘图命令，不再重新计算图形
+/*! 显示列表为模型坐标，重放时用当前的模型到显示坐标的矩阵变换。
+    图形的改变计数、绘图参数、绘制模式或颜色模式改变，显示比例变化超过容差，
+    或可见部分超出记录时的范围(视图周围一屏)时重新记录。
+    用 GiGraphics::setShapeCache() 设置到绘图对象上，可由同一视图的多个绘图对象共用，
+    正被其他线程使用时直接绘制图形。
+    \ingroup GRAPH_INTERFACE
+ */
+class GiShapeCache
+{
+public:
+    GiShapeCache();
+    ~GiShapeCache();
+
+#ifndef SWIG
+    enum { kDrawn, kRecording, kDirect };   //!< beginDraw() 的返回值
+
+    //! 开始绘制一个图形，key 为图形对象，version 为图形的改变计数
+    /*! \return kDrawn 表示已重放缓存的显示列表，drawn 为当时的绘制结果；
+            kRecording 表示已开始记录，应绘制图形后调用 endRecord()；kDirect 表示应直接绘制图形
+     */
+    int beginDraw(GiGraphics& gs, const void* key, int sid, long version, int mode,
+                  const GiContext& ctx, const Box2d& extent, bool& drawn);
+
+    //! 结束记录并输出显示列表，drawn 为图形的绘制结果
+    void endRecord(GiGraphics& gs, bool drawn);
+#endif
+
+    //! 清除所有显示列表
+    void clear();
+
+    //! 设置显示比例的相对容差，默认为0.05
+    void setZoomTolerance(float tol);
+
+    //! 设置显示列表的总字节数上限，超过时清除最近未用的显示列表
+    void setMaxBytes(int bytes);
+
+    //! 返回显示列表的总字节数
+    int getBytes() const;
+
+    //! 返回缓存的图形数
+    int getCount() const;
+
+    //! 返回重放显示列表的次数
+    long getHitCount() const;
+
+    //! 返回重新记录的次数
+    long getMissCount() const;
+
+    //! 重置命中次数
+    void resetCounters();
+
+private:
+    GiShapeCache(const GiShapeCache&);
+    void operator=(const GiShapeCache&);
+
+    struct Impl;
+    Impl* _im;
+};
+
+#endif // TOUCHVG_GISHAPECACHE_H_
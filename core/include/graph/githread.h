@@ -0,0 +1,175 @@
+//! \file githread.h
+//! \brief 定义线程和同步辅助类 GiMutex, GiSemaphore, GiThread
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_GITHREAD_H_
+#define TOUCHVG_GITHREAD_H_
+
+#ifndef SWIG
+#if defined(__WINDOWS__) || defined(WIN32)
+    #ifndef _WINDOWS_
+        #define WIN32_LEAN_AND_MEAN
+        #include <windows.h>
+    #endif
+    #define GI_HAS_THREAD
+#elif defined(_MACOSX) || defined(__APPLE__) || defined(__DARWIN__) \
+    || defined(__ANDROID__) || defined(__linux__) || defined(__unix__)
+    #include <pthread.h>
+    #define GI_HAS_THREAD
+    #define GI_PTHREAD
+#endif
+
+//! 互斥锁
+class GiMutex
+{
+public:
+#if defined(GI_PTHREAD)
+    GiMutex() { pthread_mutex_init(&_m, (pthread_mutexattr_t*)0); }
+    ~GiMutex() { pthread_mutex_destroy(&_m); }
+    void lock() { pthread_mutex_lock(&_m); }
+    void unlock() { pthread_mutex_unlock(&_m); }
+private:
+    pthread_mutex_t _m;
+#elif defined(GI_HAS_THREAD)
+    GiMutex() { InitializeCriticalSection(&_m); }
+    ~GiMutex() { DeleteCriticalSection(&_m); }
+    void lock() { EnterCriticalSection(&_m); }
+    void unlock() { LeaveCriticalSection(&_m); }
+private:
+    CRITICAL_SECTION _m;
+#else
+    GiMutex() {}
+    void lock() {}
+    void unlock() {}
+#endif
+private:
+    GiMutex(const GiMutex&);
+    void operator=(const GiMutex&);
+};
+
+//! 计数信号量，wait() 在计数为0时阻塞
+class GiSemaphore
+{
+public:
+#if defined(GI_PTHREAD)
+    GiSemaphore(int count = 0) : _count(count) {
+        pthread_mutex_init(&_m, (pthread_mutexattr_t*)0);
+        pthread_cond_init(&_cond, (pthread_condattr_t*)0);
+    }
+    ~GiSemaphore() {
+        pthread_cond_destroy(&_cond);
+        pthread_mutex_destroy(&_m);
+    }
+    void wait() {
+        pthread_mutex_lock(&_m);
+        while (_count <= 0)
+            pthread_cond_wait(&_cond, &_m);
+        _count--;
+        pthread_mutex_unlock(&_m);
+    }
+    void post() {
+        pthread_mutex_lock(&_m);
+        _count++;
+        pthread_cond_signal(&_cond);
+        pthread_mutex_unlock(&_m);
+    }
+private:
+    pthread_mutex_t _m;
+    pthread_cond_t  _cond;
+    int             _count;
+#elif defined(GI_HAS_THREAD)
+    GiSemaphore(int count = 0) { _h = CreateSemaphore(NULL, count, 0x7FFFFFFF, NULL); }
+    ~GiSemaphore() { CloseHandle(_h); }
+    void wait() { WaitForSingleObject(_h, INFINITE); }
+    void post() { ReleaseSemaphore(_h, 1, NULL); }
+private:
+    HANDLE _h;
+#else
+    GiSemaphore(int = 0) {}
+    void wait() {}
+    void post() {}
+#endif
+private:
+    GiSemaphore(const GiSemaphore&);
+    void operator=(const GiSemaphore&);
+};
+
+//! 工作线程，不支持线程的平台上 start() 返回 false
+class GiThread
+{
+public:
+    typedef void (*Proc)(void* arg);
+
+    GiThread() : _proc((Proc)0), _arg((void*)0), _started(false) {}
+    ~GiThread() { join(); }
+
+    //! 启动线程执行 proc(arg)，成功则返回 true
+    bool start(Proc proc, void* arg) {
+        if (_started)
+            return false;
+        _proc = proc;
+        _arg = arg;
+#if defined(GI_PTHREAD)
+        _started = pthread_create(&_t, (pthread_attr_t*)0, threadProc, this) == 0;
+#elif defined(GI_HAS_THREAD)
+        _t = CreateThread(NULL, 0, threadProc, this, 0, &_id);
+        _started = _t != NULL;
+#endif
+        return _started;
+    }
+
+    //! 等待线程结束
+    void join() {
+        if (_started) {
+            _started = false;
+#if defined(GI_PTHREAD)
+            pthread_join(_t, (void**)0);
+#elif defined(GI_HAS_THREAD)
+            WaitForSingleObject(_t, INFINITE);
+            CloseHandle(_t);
+#endif
+        }
+    }
+
+    //! 返回线程是否已启动
+    bool started() const { return _started; }
+
+    //! 返回是否在此线程中调用
+    bool isCurrent() const {
+#if defined(GI_PTHREAD)
+        return _started && pthread_equal(pthread_self(), _t) != 0;
+#elif defined(GI_HAS_THREAD)
+        return _started && GetCurrentThreadId() == _id;
+#else
+        return false;
+#endif
+    }
+
+private:
+#if defined(GI_PTHREAD)
+    static void* threadProc(void* p) {
+        GiThread* t = (GiThread*)p;
+        t->_proc(t->_arg);
+        return (void*)0;
+    }
+    pthread_t   _t;
+#elif defined(GI_HAS_THREAD)
+    static DWORD WINAPI threadProc(LPVOID p) {
+        GiThread* t = (GiThread*)p;
+        t->_proc(t->_arg);
+        return 0;
+    }
+    HANDLE      _t;
+    DWORD       _id;
+#endif
+    Proc        _proc;
+    void*       _arg;
+    bool        _started;
+
+    GiThread(const GiThread&);
+    void operator=(const GiThread&);
+};
+
+#endif // SWIG
+
+#endif // TOUCHVG_GITHREAD_H_
@@ -0,0 +1,43 @@
+﻿//! \file githreadpool.h
+//! \brief 定义并行执行任务的线程池类 GiThreadPool
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_GITHREADPOOL_H_
+#define TOUCHVG_GITHREADPOOL_H_
+
+#ifndef SWIG
+
+//! 并行执行多个同类任务的线程池，工作线程常驻以免每次创建线程
+/*! 不支持线程的平台上在调用线程中依次执行。
+    \ingroup GRAPH_INTERFACE
+ */
+class GiThreadPool
+{
+public:
+    typedef void (*Task)(void* arg, int index);
+
+    //! 给定工作线程数，为0则用处理器数减1(调用线程也执行任务)
+    GiThreadPool(int threads = 0);
+    ~GiThreadPool();
+
+    //! 返回工作线程数
+    int getThreadCount() const;
+
+    //! 并行执行 task(arg, i)，i 为 0 到 count-1，调用线程也执行任务，全部完成后返回
+    /*! 多个线程同时调用时依次执行 */
+    void run(Task task, void* arg, int count);
+
+    //! 返回处理器数
+    static int getProcessorCount();
+
+private:
+    GiThreadPool(const GiThreadPool&);
+    void operator=(const GiThreadPool&);
+
+    struct Impl;
+    Impl* _im;
+};
+
+#endif // SWIG
+
+#endif // TOUCHVG_GITHREADPOOL_H_
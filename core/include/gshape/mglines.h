@@ -8,6 +8,8 @@
 
 #include "mgbasesp.h"
 
+struct MgLinesLod;
+
 //! 折线基类
 /*! \ingroup CORE_SHAPE
  */
@@ -45,6 +47,16 @@ public:
 #ifndef SWIG
     virtual int getSubType() const { return isClosed() ? 1 : 0; }
     virtual const Point2d* getPoints() const { return _points; }
+    virtual void resetChangeCount(long count);
+    
+    //! 返回缩小显示用的简化折线顶点(LOD)，没有合适的层次时返回NULL
+    /*! 顶点较多的图形在 update() 时按范围的几个比例用 Douglas-Peucker 算法简化并缓存，
+        按改变计数判断是否有效，曲线则为其折线逼近的简化结果。
+        \param tol 允许的模型坐标误差，一般为半个像素对应的模型长度
+        \param[out] count 简化后的顶点数
+        \return 误差不超过 tol 的最简层次的顶点
+     */
+    const Point2d* getLodPoints(float tol, int& count) const;
 #endif
     
 protected:
@@ -64,11 +76,19 @@ protected:
     bool _hitTestBox(const Box2d& rect) const;
     bool _save(MgStorage* s) const;
     bool _load(MgShapeFactory* factory, MgStorage* s);
+    void _clearCachedData();
+    
+    //! 返回生成LOD时曲线折线化的容差，顶点太少不需要LOD时返回0
+    float lodTolerance() const;
+    //! 由折线(或曲线的折线逼近)生成各层次的简化顶点，err 为该折线与图形的最大偏差
+    void updateLod(int count, const Point2d* points, float err);
+    void clearLod();
     
 protected:
     Point2d*    _points;
     int      _maxCount;
     int      _count;
+    MgLinesLod* _lod;
 };
 
 //! 折线图形类
@@ -84,6 +104,7 @@ protected:
     Point2d _getHandlePoint(int index) const;
     int _getHandleType(int index) const;
     bool _isHandleFixed(int index) const;
+    void _update();
     void _output(MgPath& path) const;
 };
 
@@ -31,6 +31,7 @@ public:
 protected:
     void _copy(const MgSplines& src);
     bool _equals(const MgSplines& src) const;
+    void _update();
     void _transform(const Matrix2d& mat);
     void _clear();
     void _setPoint(int index, const Point2d& pt);
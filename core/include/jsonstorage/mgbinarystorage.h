@@ -0,0 +1,80 @@
+﻿//! \file mgbinarystorage.h
+//! \brief 定义二进制序列化类 MgBinaryStorage
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_CORE_BINARYSTORAGE_H_
+#define TOUCHVG_CORE_BINARYSTORAGE_H_
+
+#ifndef SWIG
+#include <cstdio>
+#include <string>
+#endif
+struct MgStorage;
+
+//! 二进制序列化类，与 MgJsonStorage 的读写顺序和节点命名相同
+/*! 文件以 "TVGB" 和版本号开头，其后为各个键值项，多字节数值为小端字节序。
+    文件头后为名称表，每项依次为类型(1字节)、名称序号、值。名称末尾的数字单独存储，
+    例如 "shape12" 存为名称 "shape" 的序号和数字12。节点的值为4字节内容长度和子项，
+    字符串和数组的值为变长长度和内容。浮点数按原精度存储，读取时不需要文本解析。
+    读取文件时使用内存映射，直接在映射内容上查找，不复制、不建立树。
+    \ingroup CORE_STORAGE
+ */
+class MgBinaryStorage
+{
+public:
+    MgBinaryStorage();
+    ~MgBinaryStorage();
+
+    //! 返回存取接口对象以便开始写数据，写完调用 save()
+    MgStorage* storageForWrite();
+
+#ifndef SWIG
+    //! 给定二进制内容，返回存取接口对象以便开始读取，读取完成前内容要保持有效
+    MgStorage* storageForRead(const void* data, int size);
+
+    //! 给定文件句柄，映射整个文件后返回存取接口对象，此后可关闭文件
+    MgStorage* storageForRead(FILE* fp);
+
+    //! 写数据到给定的文件
+    bool save(FILE* fp);
+
+    //! 将文件内容(含文件头)输出到给定的字符串
+    bool save(std::string& data);
+
+    //! 判断文件是否以二进制格式的文件头开始，不改变文件的读写位置
+    static bool isBinaryFile(FILE* fp);
+
+    //! 判断给定内容是否以二进制格式的文件头开始
+    static bool isBinaryData(const void* data, int size);
+#endif
+
+    //! 给定文件名，映射整个文件后返回存取接口对象
+    MgStorage* storageForReadFile(const char* filename);
+
+    //! 写数据到给定名称的文件
+    bool saveToFile(const char* filename);
+
+    //! 设置读取文件时是否按需加载图形，在 storageForRead() 前调用
+    /*! 图形列表只读取各图形的类型、ID、标记和范围，在显示、选择或遍历到时才加载图形内容。
+        文件映射由图形列表保持引用，直到图形列表清除或释放。给定内存内容读取时不按需加载。
+     */
+    void setLazyLoading(bool lazy);
+
+    //! 清除内存资源，解除文件映射
+    void clear();
+
+    //! 返回读写中的错误，NULL表示没有错误
+    const char* getParseError();
+
+    //! 判断文件名是否为二进制格式的文件后缀(.vgb)
+    static bool isBinaryName(const char* filename);
+
+    //! 在JSON文件和二进制文件之间相互转换，按输入文件的文件头确定方向，返回转换与否
+    static bool convertFile(const char* infile, const char* outfile, bool pretty = false);
+
+private:
+    class Impl;
+    Impl* _impl;
+};
+
+#endif // TOUCHVG_CORE_BINARYSTORAGE_H_
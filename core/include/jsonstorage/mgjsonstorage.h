@@ -62,6 +62,9 @@ public:
 
     //! 写数据到给定的文件
     bool save(FILE* fp, bool pretty = false);
+    
+    //! 返回存取接口对象以便边写边输出到给定的文件，不建立DOM，写完最外层节点后不需要再调用 save()
+    MgStorage* storageForWrite(FILE* fp, bool pretty = false);
 #endif
     
     //! 给定JSON文件对象，返回存取接口对象以便开始读取
@@ -70,6 +73,10 @@ public:
     //! 写数据到给定的文件
     bool save(const MgJsonFile& file, bool pretty = false) { return save(file.getHandle(), pretty); }
     
+    //! 返回存取接口对象以便边写边输出到给定的文件对象
+    MgStorage* storageForWrite(const MgJsonFile& file, bool pretty = false) {
+        return storageForWrite(file.getHandle(), pretty); }
+    
     //! 返回JSON内容
     const char* stringify(bool pretty = false);
     
@@ -85,6 +92,15 @@ public:
     //! 设置是否在保存数值键值时加上引号
     void saveNumberAsString(bool str);
     
+    //! 设置是否使用流式读写模式，在 storageForRead() 或 storageForWrite() 前调用
+    /*! 流式读取时不建立整个DOM树，按文档顺序在 readNode() 时才解析到该节点，节点结束时释放其内容。
+        要求同一节点的键值写在其子节点之前(本库保存的内容都是如此)，子节点可按任意顺序读取。
+        以文件句柄读取时，读取完成前不能关闭文件。
+        流式写时 storageForWrite() 直接输出紧凑格式的文本，stringify() 忽略 pretty 参数。
+        数组模式下仍建立DOM后再输出。
+     */
+    void setStreamMode(bool stream);
+    
     //! UTF-16/32编码的文件转换为UTF-8编码的文件，返回转换与否
     static bool toUTF8(const char* infile, const char* outfile);
     
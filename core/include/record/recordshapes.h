@@ -1,4 +1,4 @@
-// recordshapes.h
+﻿// recordshapes.h
 // Copyright (c) 2013-2014, Zhang Yungui
 // Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
 
@@ -14,6 +14,9 @@ class MgShape;
 struct MgShapeFactory;
 
 //! Helper class for recording shapes.
+/*! recordStep() compares shape versions on the caller thread and hands the changed shapes
+    to a writer thread, which serializes them and writes the .vgr/.vgu files and records.json.
+ */
 class MgRecordShapes
 {
 public:
@@ -31,10 +34,25 @@ public:
 #endif
     bool isLoading() const;
     void setLoading(bool loading);
+    void setBinaryFormat(bool binary);
+    
+    //! Append all frames to records.vgj instead of writing two files per frame and records.json.
+    /*! Call it before restore(). getFileName() returns the journal file name for frames.
+        Playback reads records.vgj automatically if it exists.
+     */
+    void setJournalFormat(bool journal);
+    
+    //! Write a full document snapshot every 'steps' frames or 'bytes' bytes of forward records.
+    /*! Zero disables the corresponding condition. seek() starts from the nearest snapshot.
+     */
+    void setKeyframeInterval(int steps, int bytes);
     bool onResume(long ticks);
     void restore(int index, int count, int tick, long curTick);
     void stopRecordIndex();
     
+    //! Wait for the writer thread to save all recorded frames, and sync files to disk if sync is true.
+    void flush(bool sync);
+    
 #ifndef SWIG
     bool canUndo() const;
     bool canRedo() const;
@@ -52,14 +70,20 @@ public:
     bool applyFirstFile(MgShapeFactory *factory, MgShapeDoc* doc, const char* filename);
     int applyRedoFile(MgShapeFactory *f, MgShapeDoc* doc, MgShapes* dyns, int index);
     int applyUndoFile(MgShapeFactory *f, MgShapeDoc* doc, MgShapes* dyns, int index, long curTick);
+    
+    //! Rebuild the document and dynamic shapes of the last frame not later than tick.
+    /*! Loads the nearest keyframe (or the first file) and applies only the remaining frames.
+        The document is the same as applyFirstFile() and applyRedoFile() for each frame in turn.
+        Returns DOC_CHANGED|DYN_CHANGED, or 0 if failed.
+     */
+    int seek(MgShapeFactory *f, MgShapeDoc* doc, MgShapes* dyns, long tick);
 #ifndef SWIG
     static bool loadFrameIndex(std::string path, std::vector<int>& arr);
 #endif
 
 private:
-    static int applyFile(int& tick, MgShapeFactory *f,
-                         MgShapeDoc* doc, MgShapes* dyns, const char* fn,
-                         long* changeCount = NULL, MgShape* lastShape = NULL);
+    int applyFile(bool back, int index, MgShapeFactory *f, MgShapeDoc* doc, MgShapes* dyns,
+                  long* changeCount = NULL, MgShape* lastShape = NULL);
     
 private:
     struct Impl;
@@ -0,0 +1,109 @@
+﻿//! \file mgdrawprogress.h
+//! \brief 定义分批绘制图形的进度类 MgDrawProgress
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_MGDRAWPROGRESS_H_
+#define TOUCHVG_MGDRAWPROGRESS_H_
+
+#include "mgshape.h"
+#ifndef SWIG
+#include <vector>
+#endif
+
+class MgShapes;
+
+//! 分批绘制图形的进度，记下图层序号、图形序号和剪裁范围，下次在同一画布上接着绘制
+/*! 每次绘制到时间或图形数预算用完时返回，适合在多帧中逐步显示大量图形。
+    本对象保持文档的引用，文档、显示范围或已绘图层的内容改变后从头开始。
+    按大小或离中心远近的优先顺序绘制时，每个图层内重叠图形的上下次序可能与显示顺序不同。
+    \ingroup CORE_SHAPE
+    \see MgShapeDoc::dyndraw(int, GiGraphics&, MgDrawProgress&)
+ */
+class MgDrawProgress
+{
+public:
+    //! 图层内的绘制顺序
+    enum {
+        kDisplayOrder,      //!< 按显示顺序
+        kLargeFirst,        //!< 显示尺寸大的图形优先
+        kCenterFirst        //!< 靠近视图中心的图形优先
+    };
+
+    //! 给定绘制顺序和每次绘制的预算(毫秒、图形数)，为0表示不限
+    MgDrawProgress(int order = kDisplayOrder, float budgetMs = 16.f, int budgetShapes = 0);
+    ~MgDrawProgress();
+
+    void setOrder(int order);                       //!< 设置绘制顺序，从头开始
+    void setBudget(float ms, int shapes = 0);       //!< 设置每次绘制的时间(毫秒)和图形数预算，为0表示不限
+    void reset();                                   //!< 从头开始，释放文档的引用
+
+    bool isFinished() const { return _finished; }   //!< 返回是否已绘制完所有图层
+    int getLayer() const { return _layer; }         //!< 返回下次开始绘制的图层序号
+    int getIndex() const { return _index; }         //!< 返回下次开始绘制的图形在本图层待绘图形中的序号
+    int getTotalInLayer() const { return (int)_list.size(); }   //!< 返回本图层待绘制的图形数
+    int getDrawnCount() const { return _drawn; }    //!< 返回从头开始以来绘制的图形数
+    Box2d getClip() const { return _clip; }         //!< 返回绘制时的模型坐标剪裁范围
+
+    //! 返回能否在给定文档和模型坐标剪裁范围上接着绘制，不检查图层内容是否已改变
+    bool isValid(const MgObject* owner, const Box2d& clip) const;
+
+#ifndef SWIG
+    //! 开始一次绘制，不能接着绘制时从头开始，返回是否接着上次绘制
+    bool begin(const MgObject* owner, const Box2d& clip);
+
+    //! 返回本次绘制的预算是否已用完，本次至少绘制一个图形
+    bool isOverBudget() const;
+
+    //! 返回是否已列出当前图层的待绘图形
+    bool isListed(const MgShapes* shapes) const { return isListed(_layer, shapes); }
+
+    //! 返回是否已列出给定序号的图层的待绘图形，且该图层在列出后未改变
+    bool isListed(int layer, const MgShapes* shapes) const;
+
+    //! 返回给定序号的图层在绘制时对应的图形列表，未绘制该图层时返回NULL
+    const MgShapes* getListedShapes(int layer) const {
+        return layer >= 0 && layer < (int)_listed.size() ? _listed[layer] : (const MgShapes*)0; }
+
+    //! 开始列出当前图层的待绘图形，应按显示顺序添加到返回的数组中，再调用 sortList()
+    std::vector<const MgShape*>& beginList(const MgShapes* shapes, long epoch);
+
+    //! 按绘制顺序排列待绘图形，modelToDisplay 为模型坐标到显示坐标的变换
+    void sortList(const Matrix2d& modelToDisplay);
+
+    //! 返回下一个待绘制的图形，本图层绘制完时返回NULL
+    const MgShape* next();
+
+    //! 取消最近一次 next() 的图形，以便下次重新绘制
+    void undoNext() { if (_index > 0) { _index--; _drawn--; _count--; } }
+
+    //! 返回本图层是否已绘制完
+    bool isLayerDone() const { return getListedShapes(_layer) && _index >= (int)_list.size(); }
+
+    //! 转到下一图层
+    void nextLayer();
+
+    //! 标记已绘制完所有图层
+    void setFinished() { _finished = true; }
+#endif
+
+private:
+    int         _order;
+    float       _budgetMs;
+    int         _budgetShapes;
+    MgObject*   _owner;         // 保持引用的文档，使图形指针有效
+    Box2d       _clip;
+    int         _layer;
+    int         _index;
+    int         _drawn;
+    bool        _finished;
+    double      _tick;          // 本次绘制开始的时刻(毫秒)
+    int         _count;         // 本次绘制的图形数
+    std::vector<const MgShapes*> _listed;   // 按图层序号记下已列出待绘图形的图层
+    std::vector<long> _epochs;              // 列出时各图层的修改位置
+    std::vector<const MgShape*> _list;      // 本图层待绘制的图形
+
+    MgDrawProgress(const MgDrawProgress&);
+    void operator=(const MgDrawProgress&);
+};
+
+#endif // TOUCHVG_MGDRAWPROGRESS_H_
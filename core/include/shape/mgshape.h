@@ -79,6 +79,11 @@ public:
     virtual void copy(const MgObject& src);
     virtual bool equals(const MgObject& src) const;
     virtual bool isKindOf(int type) const;
+    
+#ifndef SWIG
+    //! 返回是否还被其他地方引用，不能确定时返回 true
+    virtual bool isShared() const { return true; }
+#endif
 
     //! 显示内部图形
     static bool drawShape(const MgShapes* shapes, const MgBaseShape& sp, int mode,
@@ -6,6 +6,11 @@
 #define TOUCHVG_MGSHAPES_H_
 
 #include "mgshape.h"
+#ifndef SWIG
+#include <vector>
+#endif
+
+class MgDrawProgress;
 
 //! 图形列表类
 /*! \ingroup CORE_SHAPE
@@ -32,6 +37,9 @@ public:
     void freeIterator(void*& it) const;
     typedef bool (*Filter)(const MgShape* sp, void* data);
     int traverseByType(int type, void (*c)(const MgShape*, void*), void* d);
+    
+    //! 按显示顺序遍历范围与给定矩形框相交的图形，借助空间索引快速查找，返回个数
+    int queryBox(const Box2d& box, void (*c)(const MgShape*, void*), void* d) const;
 #endif
 
     int getShapeCount() const;
@@ -57,6 +65,10 @@ public:
 #ifndef SWIG
     int dyndraw(int mode, GiGraphics& gs, const GiContext *ctx, int segment,
                 const int* ignoreIds = (const int*)0) const;
+    
+    //! 从 progress 记下的位置接着绘制，预算用完或中止绘制时返回，返回本次显示的图形数
+    int dyndraw(int mode, GiGraphics& gs, MgDrawProgress& progress,
+                const int* ignoreIds = (const int*)0) const;
 #endif
 
     bool save(MgStorage* s, int startIndex = 0) const;
@@ -67,9 +79,37 @@ public:
     //! 删除所有图形
     void clear();
     
+    //! 重建空间索引，在直接改变了图形(非 updateShape)后调用
+    void rebuildIndex();
+    
     //! 释放临时数据内存
     void clearCachedData();
 
+#ifndef SWIG
+    //! 修改记录中的修改类型，见 getChangesSince()
+    enum { kShapeAdded = 1, kShapeUpdated = 2, kShapeRemoved = 4, kShapeReordered = 8 };
+    
+    //! 返回修改记录的当前位置，浅拷贝得到的图形列表有相同的修改记录
+    long getChangeEpoch() const;
+    
+    //! 得到自 epoch 以来依次修改的图形ID和修改类型(两个数一组)，记录不可用时返回 false
+    /*! 在 clear、load、transform、rebuildIndex 等整体修改后或记录过多时重新开始记录，
+        此时以前的 epoch 不可用，需要比较所有图形。reorderShapes 记为ID为0的 kShapeReordered。
+        只有图层(拥有者为图形文档)记录修改，其他图形列表只有 epoch 未变时返回 true。
+     */
+    bool getChangesSince(long epoch, std::vector<int>& changes) const;
+    
+    //! 删除所有图形，keepCapacity 为 true 时保留未共享的内部缓冲和图形对象并如同新建的列表分配ID
+    /*! 用于每帧重建的动态图形列表，保留的图形对象由 addShape() 和 reuseShape() 重用 */
+    void clear(bool keepCapacity);
+    
+    //! 取出 clear(true) 保留的给定类型的图形对象，没有则返回NULL，调用者拥有其引用
+    MgShape* reuseShape(int type);
+    
+    //! 返回是否还被其他地方(例如显示线程)引用
+    bool isShared() const;
+#endif
+    
     //! 复制(默认为深拷贝)每一个图形，浅拷贝则添加图形的引用计数且不改变图形的拥有者
     int copyShapes(const MgShapes* src, bool deeply = true, bool needClear = true);
     
@@ -74,6 +74,10 @@ public:
         giAtomicIncrement(&_refcount);
     }
     
+    bool isShared() const {
+        return _refcount > 1;
+    }
+    
     MgObject* clone() const {
         ThisClass *p = new ThisClass;
         p->copy(*this);
@@ -8,6 +8,7 @@
 #include "mgshapes.h"
 
 class MgLayer;
+class MgDrawProgress;
 struct MgShapeFactory;
 
 //! 图形文档
@@ -55,9 +56,23 @@ public:
     //! 动态显示所有图形
     int dyndraw(int mode, GiGraphics& gs) const;
     
+    //! 从 progress 记下的图层和图形接着动态显示，预算用完时返回，返回本次显示的图形数
+    /*! 在同一画布上多次调用直到 progress.isFinished()，文档或显示范围改变后自动从头开始，
+        可先调用 resumeDraw() 判断是否要清除画布
+     */
+    int dyndraw(int mode, GiGraphics& gs, MgDrawProgress& progress) const;
+    
 #ifndef SWIG
+    //! 开始一次分批显示，文档或显示范围改变、已绘图层被删除替换或修改时从头开始，返回是否接着上次显示
+    /*! 从头开始且此前已显示过图形时，调用者应先清除画布上次显示的内容
+     */
+    bool resumeDraw(MgDrawProgress& progress, const Box2d& clip) const;
+    
     //! 显示除了特定ID图形外的所有图形
     int dyndraw(int mode, GiGraphics& gs, const int* ignoreIds) const;
+    
+    //! 按显示顺序遍历未隐藏图层中范围与给定矩形框相交的图形，返回个数
+    int queryBox(const Box2d& box, void (*c)(const MgShape*, void*), void* d) const;
 #endif
     
     //! 返回图形范围
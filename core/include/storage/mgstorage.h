@@ -5,6 +5,32 @@
 #ifndef TOUCHVG_MGSTORAGE_H_
 #define TOUCHVG_MGSTORAGE_H_
 
+#ifndef SWIG
+#include <stddef.h>
+
+struct MgStorage;
+
+//! 可按位置重新读取节点的数据源接口，用于按需加载图形
+/*! \ingroup CORE_STORAGE
+    \interface MgStorageSource
+    \see MgStorage::getSource
+*/
+struct MgStorageSource
+{
+    virtual ~MgStorageSource() {}
+    virtual void addRef() = 0;
+    virtual void release() = 0;
+    
+    //! 返回在给定位置的节点中读取的存取接口，先调用 readNode(NULL, -1, false) 进入该节点
+    /*! 可在多个线程中同时调用，用完调用 endRead() 释放
+     */
+    virtual MgStorage* beginRead(size_t pos) = 0;
+    
+    //! 释放 beginRead() 返回的存取接口
+    virtual void endRead(MgStorage* s) = 0;
+};
+#endif
+
 //! 图形存取接口
 /*! \ingroup CORE_STORAGE
     \interface MgStorage
@@ -76,6 +102,11 @@ struct MgStorage
 
     //! 设置读写错误描述文字，总是返回false
     virtual bool setError(const char* errdesc) { return !errdesc; }
+    
+#ifndef SWIG
+    //! 返回可重新读取当前节点的数据源(未增加引用)及当前节点的位置，不支持按需加载时返回NULL
+    virtual MgStorageSource* getSource(size_t& pos) { pos = 0; return (MgStorageSource*)0; }
+#endif
 };
 
 #endif // TOUCHVG_MGSTORAGE_H_
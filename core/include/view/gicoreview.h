@@ -11,6 +11,7 @@
 
 class GiCanvas;
 class GiCoreViewImpl;
+class MgDrawProgress;
 struct MgView;
 
 //! 获取配置项的回调接口
@@ -26,6 +27,23 @@ struct MgOptionCallback {
     virtual void onGetOptionString(const char* name, const char* text) = 0; //!< 文本选项值
 };
 
+//! 分块显示时提供各分块画布的回调接口
+/*! 画布收到的是整个视图的显示坐标，应平移 (-x, -y) 后绘制到分块图像上。
+    各分块在工作线程中并行绘制，同一画布只在一个线程中使用。
+    \ingroup CORE_VIEW
+    \interface GiTileCanvasFactory
+    \see GiCoreView::drawAll(long, long, GiTileCanvasFactory*, int)
+ */
+struct GiTileCanvasFactory {
+    virtual ~GiTileCanvasFactory() {}
+    
+    //! 在调用线程中返回分块的画布，(x, y, w, h) 为分块在视图中的显示范围，返回NULL则不显示此分块
+    virtual GiCanvas* createTileCanvas(int index, float x, float y, float w, float h) = 0;
+    
+    //! 所有分块绘制完成后在调用线程中按分块序号调用，在此合成分块图像并释放画布
+    virtual void compositeTile(int index, GiCanvas* canvas, float x, float y, float w, float h) = 0;
+};
+
 //! 避免重复触发 regenAll/redraw 的辅助类
 class MgRegenLocker
 {
@@ -61,12 +79,31 @@ public:
     int drawAll(const mgvector<long>& docs, long gs, GiCanvas* canvas);  //!< 显示所有图形
     int drawAll(const mgvector<long>& docs, long gs, GiCanvas* canvas,
                 const mgvector<int>& ignoreIds);                    //!< 显示除特定ID外的图形
+    int drawAll(long doc, long gs, GiCanvas* canvas,
+                float x, float y, float w, float h);                //!< 清除并重新显示局部范围的图形
+    int drawAll(long doc, long gs, GiCanvas* canvas,
+                MgDrawProgress* progress);                          //!< 在同一画布上分批显示图形
+    int drawAll(long doc, long gs, GiTileCanvasFactory* factory,
+                int tiles = 0);                                     //!< 分块并行显示，tiles为0则按处理器数分块
     int drawAppend(long doc, long gs, GiCanvas* canvas, int sid);   //!< 显示新图形
     int dynDraw(long shapes, long gs, GiCanvas* canvas);            //!< 显示动态图形
     int dynDraw(const mgvector<long>& shapes, long gs, GiCanvas* canvas); //!< 显示动态图形
     
     int drawAll(GiView* view, GiCanvas* canvas);                    //!< 显示所有图形，主线程中用
+    int drawAll(GiView* view, GiCanvas* canvas,
+                float x, float y, float w, float h);                //!< 重新显示局部范围的图形，主线程中用
+    int drawAll(GiView* view, GiCanvas* canvas,
+                MgDrawProgress* progress);                          //!< 分批显示图形，主线程中用
+    int drawAll(GiView* view, GiTileCanvasFactory* factory,
+                int tiles = 0);                                     //!< 分块并行显示图形，主线程中用
     int drawAppend(GiView* view, GiCanvas* canvas, int sid);        //!< 显示新图形，主线程中用
+    
+    //! 在工作线程中按当前前端文档和坐标系重新构建显示列表，取消此视图尚未完成的请求，完成后回调 GiView::regenPrepared()
+    bool regenAsync(GiView* view);
+    //! 显示工作线程已构建好的显示列表，坐标系已变时按其变化显示，返回图形数，没有则返回-1，主线程中用
+    int drawPrepared(GiView* view, GiCanvas* canvas);
+    //! 取消视图(为NULL则所有视图)的后台重新构建，等待正在构建的请求结束，在 GiView::regenPrepared() 中调用时不等待
+    void cancelRegen(GiView* view);
     int dynDraw(GiView* view, GiCanvas* canvas);                    //!< 显示动态图形，主线程中用
     
     int setBkColor(GiView* view, int argb);                         //!< 设置背景颜色
@@ -95,6 +132,13 @@ public:
     
     int exportSVG(long doc, long gs, const char* filename);         //!< 导出图形到SVG文件
     int exportSVG(GiView* view, const char* filename);              //!< 导出图形到SVG文件，主线程中用
+    int exportPNG(long doc, long gs, const char* filename);         //!< 导出图形到PNG文件
+    int exportPNG(GiView* view, const char* filename);              //!< 导出图形到PNG文件，主线程中用
+#ifndef SWIG
+    //! 将图形绘制到RGBA像素缓冲(非预乘，每行 stride 字节)，大小与视图不同时放缩显示视图范围，返回图形数
+    int renderToBuffer(long doc, long gs, unsigned char* pixels,
+                       int width, int height, int stride = 0);
+#endif
     bool startRecord(const char* path, long doc,
                      bool forUndo, long curTick,
                      MgStringCallback* c = (MgStringCallback*)0);   //!< 开始录制图形，自动释放，在主线程用
@@ -26,16 +26,18 @@ public:
     void clear();                               //!< 清除图形
     int getTag() const;                         //!< 得到标识号
     
-    long acquireFrontDoc();                     //!< 得到显示用的图形文档句柄，需要并发保护
+    long acquireFrontDoc();                     //!< 得到显示用的图形文档句柄，可在任意线程中调用
     static void releaseDoc(long doc);           //!< 释放 acquireDoc() 返回的句柄
     MgShapeDoc* getBackDoc();                   //!< 得到修改图形用的图形文档
-    void submitBackDoc();                       //!< 提交图形文档结果，需要并发保护
+    void submitBackDoc();                       //!< 提交图形文档结果，只在修改图形的线程中调用
+    int getSkippedDocs() const;                 //!< 返回未被取用就被替换的文档版本数
     
-    long acquireFrontShapes();                  //!< 得到显示用的图形列表句柄，需要并发保护
+    long acquireFrontShapes();                  //!< 得到显示用的图形列表句柄，可在任意线程中调用
     static void releaseShapes(long shapes);     //!< 释放 acquireShapes() 返回的句柄
     long getBackShapesHandle(bool needClear);   //!< 得到修改图形用的动态图形列表句柄
-    MgShapes* getBackShapes(bool needClear);    //!< 得到修改图形用的动态图形列表
-    void submitBackShapes();                    //!< 提交动态图形列表结果，需要并发保护
+    MgShapes* getBackShapes(bool needClear);    //!< 得到修改图形用的动态图形列表，清除时重用显示线程已释放的列表
+    void submitBackShapes();                    //!< 提交动态图形列表结果，只在修改图形的线程中调用
+    int getSkippedShapes() const;               //!< 返回未被取用就被替换的动态图形列表版本数
     
     void stop();                                //!< 标记需要停止
     bool isStopping() const;                    //!< 返回是否待停止
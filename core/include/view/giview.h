@@ -27,6 +27,25 @@ public:
     //! 标记视图待更新显示
     virtual void redraw(bool changed) {}
 
+    //! 标记视图待重新构建局部显示，(x,y,w,h)为图形改变前后所在的显示范围(已限制在视图内，可能为空)
+    /*! 可在 GiCoreView::submitBackDoc() 后用 GiCoreView::drawAll(view,canvas,x,y,w,h) 在缓存图像上只重绘此范围。
+        默认实现为重新构建整个视图。
+     */
+    virtual void regenRect(float x, float y, float w, float h) { regenAll(true); }
+
+    //! 双指放缩平移期间标记视图待按坐标变换更新显示，代替 regenAll(false)
+    /*! 最近一次重新构建的显示内容中的点(x,y)现在应显示在(x*scale+dx, y*scale+dy)，
+        可将缓存图像按此变换显示，放缩超过 gestureRegenScale 选项(默认2倍)或手势结束时再重新构建显示。
+        默认实现为重新构建显示，此时 GiCoreView::drawAll(view,canvas) 重放保留的显示列表而不遍历文档。
+     */
+    virtual void regenXform(float scale, float dx, float dy) { regenAll(false); }
+
+    //! GiCoreView::regenAsync() 请求的显示列表已构建好，可通知主线程用 GiCoreView::drawPrepared() 显示
+    /*! 在工作线程中调用，不支持线程时在 regenAsync() 中调用。可在此取消请求，但不要同步等待主线程，
+        因为主线程取消此视图的请求时会等待本回调结束。
+     */
+    virtual void regenPrepared() {}
+
     //! 使用手指(true)或鼠标(false)交互
     virtual bool useFinger() { return true; }
 
@@ -67,9 +67,8 @@ bool MgCmdErase::click(const MgMotion* sender)
 {
     const MgShape* shape = hitTest(sender);
     if (shape && sender->view->shapeWillDeleted(shape)) {
-        int count = sender->view->removeShape(shape);
+        int count = sender->view->removeShape(shape);   // 由 removeShape 标记重新构建显示
         if (count > 0) {
-            sender->view->regenAll(true);
             if (count == 1) {
                 sender->view->showMessage("@shape1_deleted");
             } else {
@@ -103,18 +102,34 @@ bool MgCmdErase::isIntersectMode(const MgMotion*)
     //        && sender->startPt.y < sender->point.y);
 }
 
+struct EraseBoxData {
+    Box2d               snap;
+    bool                intersect;
+    std::vector<int>*   ids;
+};
+
+static void collectErasing(const MgShape* shape, void* d)
+{
+    EraseBoxData* data = (EraseBoxData*)d;
+    
+    if ((data->intersect ? shape->shapec()->hitTestBox(data->snap)
+         : data->snap.contains(shape->shapec()->getExtent()))
+        && shape->shapec()->isVisible() && !shape->shapec()->isLocked()) {
+        data->ids->push_back(shape->getID());
+    }
+}
+
 bool MgCmdErase::touchMoved(const MgMotion* sender)
 {
-    Box2d snap(sender->startPtM, sender->pointM);
-    MgShapeIterator it(m_boxsel ? sender->view->shapes() : NULL);
+    EraseBoxData data;
+    
+    data.snap = Box2d(sender->startPtM, sender->pointM);
+    data.intersect = isIntersectMode(sender);
+    data.ids = &m_delIds;
     
     m_delIds.clear();
-    while (const MgShape* shape = it.getNext()) {
-        if ((isIntersectMode(sender) ? shape->shapec()->hitTestBox(snap)
-             : snap.contains(shape->shapec()->getExtent()))
-             && shape->shapec()->isVisible() && !shape->shapec()->isLocked()) {
-            m_delIds.push_back(shape->getID());
-        }
+    if (m_boxsel) {
+        sender->view->shapes()->queryBox(data.snap, collectErasing, &data);
     }
     sender->view->redraw();
     
@@ -134,7 +149,6 @@ bool MgCmdErase::touchEnded(const MgMotion* sender)
             count += sender->view->removeShape(s->findShape(*it));
         }
         if (count > 0) {
-            sender->view->regenAll(true);
             char buf[31];
             MgLocalized::formatString(buf, sizeof(buf), sender->view, "@shape_n_deleted", count);
             sender->view->showMessage(buf);
@@ -91,7 +91,6 @@ void MgCmdManagerImpl::eraseWnd(const MgMotion* sender)
             n += sender->view->removeShape(s->findShape(*i));
         }
         if (n > 0) {
-            sender->view->regenAll(true);
             char buf[31];
             MgLocalized::formatString(buf, sizeof(buf), sender->view, "@shape_n_deleted", n);
             sender->view->showMessage(buf);
@@ -1149,11 +1149,16 @@ bool MgCmdSelect::applyCloneShapes(MgView* view, bool apply, bool addNewShapes)
                 }
             }
             else {
-                if (oldsp && !oldsp->equals(*m_clones[i])
+                bool update = (oldsp && !oldsp->equals(*m_clones[i])
                     && (oldsp->getPointCount() < 1 || !m_clones[i]->shapec()->getExtent().isEmpty(tol))
-                    && view->shapeWillChanged(m_clones[i], oldsp)
-                    && view->shapes()->updateShape(m_clones[i])) {
+                    && view->shapeWillChanged(m_clones[i], oldsp));
+                
+                if (update) {
+                    view->regenShape(oldsp);
+                }
+                if (update && view->shapes()->updateShape(m_clones[i])) {
                     view->shapeChanged(m_clones[i]);
+                    view->regenShape(m_clones[i]);
                     changed = true;
                 }
                 else {
@@ -1168,8 +1173,8 @@ bool MgCmdSelect::applyCloneShapes(MgView* view, bool apply, bool addNewShapes)
         m_clones.clear();
     }
     if (changed) {
-        view->regenAll(true);
         if (addNewShapes) {
+            view->regenAll(true);
             selectionChanged(view);
             m_boxsel = false;
         }
@@ -1287,7 +1292,6 @@ bool MgCmdSelect::deleteSelection(const MgMotion* sender)
     }
     
     if (count > 0) {
-        sender->view->regenAll(true);
         selectionChanged(sender->view);
         if (count == 1) {
             sender->view->showMessage("@shape1_deleted");
@@ -1351,7 +1355,7 @@ bool MgCmdSelect::ungroupSelection(const MgMotion* sender)
                     const MgGroup* group = (const MgGroup*)oldsp->shapec();
                     
                     group->shapes()->copyShapesTo(oldsp->getParent());
-                    count += sender->view->removeShape(oldsp);
+                    count += sender->view->removeShape(oldsp);  // 成员图形在原成组图形的范围内
                 }
             }
         }
@@ -1363,7 +1367,6 @@ bool MgCmdSelect::ungroupSelection(const MgMotion* sender)
     }
     
     if (count > 0) {
-        sender->view->regenAll(true);
         selectionChanged(sender->view);
         longPress(sender);
     }
@@ -1429,9 +1432,9 @@ bool MgCmdSelect::deleteVertex(const MgMotion* sender)
         ret = lines->removePoint(m_handleIndex - 1);
         if (ret) {
             newsp->shape()->update();
+            sender->view->regenShape(oldsp);
             oldsp->getParent()->updateShape(newsp);
-            
-            sender->view->regenAll(true);
+            sender->view->regenShape(newsp);
             m_handleIndex = hitTestHandles(newsp, m_hit.nearpt, sender);
         }
         else {
@@ -1460,9 +1463,9 @@ bool MgCmdSelect::insertVertex(const MgMotion* sender)
                && lines->insertPoint(m_hit.segment, m_hit.nearpt));
         if (ret) {
             newsp->shape()->update();
+            sender->view->regenShape(oldsp);
             oldsp->getParent()->updateShape(newsp);
-            
-            sender->view->regenAll(true);
+            sender->view->regenShape(newsp);
             m_handleIndex = hitTestHandles(newsp, m_hit.nearpt, sender);
         }
         else {
@@ -1486,9 +1489,9 @@ bool MgCmdSelect::switchClosed(const MgMotion* sender)
         
         lines->setClosed(!lines->isClosed());
         newsp->shape()->update();
+        sender->view->regenShape(oldsp);
         oldsp->getParent()->updateShape(newsp);
-        
-        sender->view->regenAll(true);
+        sender->view->regenShape(newsp);
         longPress(sender);
         ret = true;
     }
@@ -1512,11 +1515,11 @@ bool MgCmdSelect::setFixedLength(const MgMotion* sender, bool fixed)
             MgShape* newsp = oldsp->cloneShape();
             newsp->shape()->setFlag(kMgFixedLength, fixed);
             oldsp->getParent()->updateShape(newsp);
+            sender->view->regenShape(newsp);
             count++;
         }
     }
     if (count > 0) {
-        sender->view->regenAll(true);
         longPress(sender);
     }
     
@@ -1540,12 +1543,12 @@ bool MgCmdSelect::setLocked(const MgMotion* sender, bool locked)
                 MgShape* newsp = oldsp->cloneShape();
                 newsp->shape()->setFlag(kMgLocked, locked);
                 oldsp->getParent()->updateShape(newsp);
+                sender->view->regenShape(newsp);
                 count++;
             }
         }
     }
     if (count > 0) {
-        sender->view->regenAll(true);
         longPress(sender);
     }
     
@@ -1610,12 +1613,13 @@ bool MgCmdSelect::applyTransform(const MgMotion* sender, const Matrix2d& xf)
         if (oldsp) {
             MgShape* newsp = oldsp->cloneShape();
             newsp->shape()->transform(xf);
+            sender->view->regenShape(oldsp);
             oldsp->getParent()->updateShape(newsp);
+            sender->view->regenShape(newsp);
             count++;
         }
     }
     if (count > 0) {
-        sender->view->regenAll(true);
         longPress(sender);
     }
     
@@ -2,9 +2,13 @@
 
 %{
 #include <svgcanvas.h>
+#include <girastercanvas.h>
 %}
 
 %feature("director") GiCanvas;
 %include <gicanvas.h>
 
-%include <svgcanvas.h>
\ No newline at end of file
+%include <svgcanvas.h>
+
+%feature("director") GiRasterCallback;
+%include <girastercanvas.h>
\ No newline at end of file
@@ -0,0 +1,1014 @@
+// girastercanvas.cpp: 实现绘制到RGBA像素缓冲的画布类 GiRasterCanvas
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#include "girastercanvas.h"
+#include "mgdef.h"
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const float kFlatness = 0.2f;    // 曲线离散为折线的允许误差(像素)
+static const float kKappa = 0.5522847f; // 用四段贝塞尔曲线拟合椭圆的控制点系数
+static const int kBandArea = 1 << 18;   // 每次光栅化的面积累加缓冲的最大元素数
+
+static const float patDash[]      = { 4, 2, 0 };
+static const float patDot[]       = { 1, 2, 0 };
+static const float patDashDot[]   = { 10, 2, 2, 2, 0 };
+static const float dashDotdot[]   = { 20, 2, 2, 2, 2, 2, 0 };
+static const float* const lpats[] = { NULL, patDash, patDot, patDashDot, dashDotdot };
+
+struct RasterPath {                     // 已离散为折线的路径
+    struct Sub { int start, count; bool closed; };
+    std::vector<float>  xy;
+    std::vector<Sub>    subs;
+
+    void clear() { xy.clear(); subs.clear(); }
+    bool empty() const { return subs.empty(); }
+
+    void moveTo(float x, float y) {
+        Sub sub = { (int)xy.size() / 2, 1, false };
+        subs.push_back(sub);
+        xy.push_back(x);
+        xy.push_back(y);
+    }
+    void lineTo(float x, float y) {
+        float x0, y0;
+        if (!lastPoint(x0, y0)) {
+            moveTo(x, y);
+        } else {
+            if (subs.back().closed) {   // 闭合后的后续线段从起点开始
+                moveTo(x0, y0);
+            }
+            if (fabsf(x - x0) > 1e-4f || fabsf(y - y0) > 1e-4f) {
+                xy.push_back(x);
+                xy.push_back(y);
+                subs.back().count++;
+            }
+        }
+    }
+    bool lastPoint(float& x, float& y) const {
+        if (subs.empty()) return false;
+        int i = subs.back().closed ? subs.back().start : subs.back().start + subs.back().count - 1;
+        x = xy[i * 2];
+        y = xy[i * 2 + 1];
+        return true;
+    }
+    void bezierTo(float c1x, float c1y, float c2x, float c2y, float x, float y) {
+        float x0, y0;
+        if (!lastPoint(x0, y0)) {
+            moveTo(x0 = c1x, y0 = c1y);
+        }
+        float ddx = mgMax(fabsf(x0 - 2 * c1x + c2x), fabsf(c1x - 2 * c2x + x));
+        float ddy = mgMax(fabsf(y0 - 2 * c1y + c2y), fabsf(c1y - 2 * c2y + y));
+        int n = (int)ceilf(sqrtf(0.75f * sqrtf(ddx * ddx + ddy * ddy) / kFlatness));
+        n = n < 1 ? 1 : (n > 100 ? 100 : n);
+        for (int i = 1; i < n; i++) {
+            float t = (float)i / n, u = 1 - t;
+            float a = u * u * u, b = 3 * u * u * t, c = 3 * u * t * t, d = t * t * t;
+            lineTo(a * x0 + b * c1x + c * c2x + d * x, a * y0 + b * c1y + c * c2y + d * y);
+        }
+        lineTo(x, y);
+    }
+    void quadTo(float cx, float cy, float x, float y) {
+        float x0, y0;
+        if (!lastPoint(x0, y0)) {
+            moveTo(x0 = cx, y0 = cy);
+        }
+        float ddx = x0 - 2 * cx + x, ddy = y0 - 2 * cy + y;
+        int n = (int)ceilf(sqrtf(0.25f * sqrtf(ddx * ddx + ddy * ddy) / kFlatness));
+        n = n < 1 ? 1 : (n > 100 ? 100 : n);
+        for (int i = 1; i < n; i++) {
+            float t = (float)i / n, u = 1 - t;
+            lineTo(u * u * x0 + 2 * u * t * cx + t * t * x, u * u * y0 + 2 * u * t * cy + t * t * y);
+        }
+        lineTo(x, y);
+    }
+    void closePath() {
+        if (!subs.empty() && !subs.back().closed) {
+            Sub& sub = subs.back();
+            const float* first = &xy[sub.start * 2];
+            if (sub.count > 1 && fabsf(xy[xy.size() - 2] - first[0]) < 1e-4f
+                && fabsf(xy[xy.size() - 1] - first[1]) < 1e-4f) {
+                xy.resize(xy.size() - 2);       // 去掉与起点重合的终点
+                sub.count--;
+            }
+            sub.closed = true;
+        }
+    }
+    void addRect(float x, float y, float w, float h) {
+        moveTo(x, y);
+        lineTo(x + w, y);
+        lineTo(x + w, y + h);
+        lineTo(x, y + h);
+        closePath();
+    }
+    void addEllipse(float x, float y, float w, float h) {
+        float rx = w / 2, ry = h / 2, cx = x + rx, cy = y + ry;
+        float kx = rx * kKappa, ky = ry * kKappa;
+        moveTo(cx + rx, cy);
+        bezierTo(cx + rx, cy + ky, cx + kx, cy + ry, cx, cy + ry);
+        bezierTo(cx - kx, cy + ry, cx - rx, cy + ky, cx - rx, cy);
+        bezierTo(cx - rx, cy - ky, cx - kx, cy - ry, cx, cy - ry);
+        bezierTo(cx + kx, cy - ry, cx + rx, cy - ky, cx + rx, cy);
+        closePath();
+    }
+};
+
+struct RasterClip {                     // 剪裁范围，mask 为空时只按矩形剪裁
+    int x0, y0, x1, y1;
+    std::vector<unsigned char> mask;
+};
+
+struct GiRasterCanvas::Impl
+{
+    unsigned char*  pixels;
+    int             width;
+    int             height;
+    int             stride;
+    std::vector<unsigned char>  owned;
+    GiRasterCallback*           callback;
+
+    int             penColor;
+    float           penWidth;
+    int             penStyle;
+    float           penPhase;
+    int             brushColor;
+
+    RasterPath      path;
+    RasterPath      shape;              // drawRect 等临时图形的路径
+    RasterClip      clip;
+    std::vector<RasterClip>     clipStack;
+
+    std::vector<float>  edges;          // 待光栅化的有向线段 x0,y0,x1,y1
+    float           ex0, ey0, ex1, ey1; // 线段的包络框
+    std::vector<float>  acc;            // 面积累加缓冲
+    std::vector<float>  dashed;         // 虚线的一段折线
+
+    Impl() : pixels((unsigned char*)0), width(0), height(0), stride(0)
+        , callback((GiRasterCallback*)0), penColor(0xFF000000), penWidth(1.f)
+        , penStyle(0), penPhase(0), brushColor(0) {
+        resetClip();
+    }
+
+    void resetClip() {
+        clip.x0 = clip.y0 = 0;
+        clip.x1 = width;
+        clip.y1 = height;
+        clip.mask.clear();
+        clipStack.clear();
+    }
+
+    // 有向线段
+
+    void beginEdges() {
+        edges.clear();
+        ex0 = ey0 = 1e10f;
+        ex1 = ey1 = -1e10f;
+    }
+    void addEdge(float x0, float y0, float x1, float y1) {
+        if (y0 != y1) {
+            edges.push_back(x0);
+            edges.push_back(y0);
+            edges.push_back(x1);
+            edges.push_back(y1);
+            ex0 = mgMin(ex0, mgMin(x0, x1));
+            ex1 = mgMax(ex1, mgMax(x0, x1));
+            ey0 = mgMin(ey0, mgMin(y0, y1));
+            ey1 = mgMax(ey1, mgMax(y0, y1));
+        }
+    }
+    void addPolygon(const float* xy, int n) {
+        for (int i = 0, j = n - 1; i < n; j = i++) {
+            addEdge(xy[j * 2], xy[j * 2 + 1], xy[i * 2], xy[i * 2 + 1]);
+        }
+    }
+    void addFill(const RasterPath& p) {
+        for (size_t i = 0; i < p.subs.size(); i++) {
+            if (p.subs[i].count > 2) {
+                addPolygon(&p.xy[p.subs[i].start * 2], p.subs[i].count);
+            }
+        }
+    }
+
+    // 线宽轮廓，所有多边形的环绕方向一致以便按非零规则合并
+
+    void addQuad(float x0, float y0, float x1, float y1, float hw, float ext0, float ext1) {
+        float dx = x1 - x0, dy = y1 - y0;
+        float len = sqrtf(dx * dx + dy * dy);
+        if (len < 1e-6f) return;
+        dx /= len; dy /= len;
+        x0 -= dx * ext0; y0 -= dy * ext0;
+        x1 += dx * ext1; y1 += dy * ext1;
+        float nx = -dy * hw, ny = dx * hw;
+        float q[8] = { x0 + nx, y0 + ny, x1 + nx, y1 + ny, x1 - nx, y1 - ny, x0 - nx, y0 - ny };
+        addPolygon(q, 4);
+    }
+    void addCircle(float x, float y, float r) {
+        int n = (int)ceilf(_M_PI / acosf(1.f - mgMin(kFlatness / r, 1.f)));
+        n = n < 8 ? 8 : (n > 256 ? 256 : n);
+        float q[512];
+        for (int i = 0; i < n; i++) {           // 顺时针，与 addQuad 方向一致
+            float a = -_M_2PI * i / n;
+            q[i * 2] = x + r * cosf(a);
+            q[i * 2 + 1] = y + r * sinf(a);
+        }
+        addPolygon(q, n);
+    }
+    void addTriangle(float x0, float y0, float x1, float y1, float x2, float y2) {
+        float q[6] = { x0, y0, x1, y1, x2, y2 };
+        if ((x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0) > 0) {
+            q[2] = x2; q[3] = y2; q[4] = x1; q[5] = y1;
+        }
+        addPolygon(q, 3);
+    }
+    void addJoin(const float* a, const float* b, const float* c, float hw) {
+        float x1 = b[0] - a[0], y1 = b[1] - a[1], x2 = c[0] - b[0], y2 = c[1] - b[1];
+        float l1 = sqrtf(x1 * x1 + y1 * y1), l2 = sqrtf(x2 * x2 + y2 * y2);
+        if (l1 < 1e-6f || l2 < 1e-6f) return;
+        float cosa = (x1 * x2 + y1 * y2) / (l1 * l2);
+        float sina = (x1 * y2 - y1 * x2) / (l1 * l2);
+        if (cosa > 0.866f) {                    // 小转角在外侧补斜切三角形，与圆角差别不到半像素
+            if (fabsf(sina) * hw < 0.02f) return;       // 缝隙可忽略，曲线离散后多为此情况
+            float s = sina > 0 ? -hw : hw;
+            addTriangle(b[0], b[1], b[0] - y1 / l1 * s, b[1] + x1 / l1 * s,
+                        b[0] - y2 / l2 * s, b[1] + x2 / l2 * s);
+        } else {
+            addCircle(b[0], b[1], hw);
+        }
+    }
+    void addPolyline(const float* xy, int n, bool closed, float hw, int cap) {
+        if (n < 2) {
+            return;
+        }
+        int nseg = closed ? n : n - 1;
+        for (int i = 0; i < nseg; i++) {
+            const float* p = xy + i * 2;
+            const float* q = xy + ((i + 1) % n) * 2;
+            bool sq = !closed && cap == kLineCapSquare;
+            addQuad(p[0], p[1], q[0], q[1], hw, sq && i == 0 ? hw : 0, sq && i == n - 2 ? hw : 0);
+        }
+        for (int i = closed ? 0 : 1; i < (closed ? n : n - 1); i++) {
+            addJoin(xy + ((i + n - 1) % n) * 2, xy + i * 2, xy + ((i + 1) % n) * 2, hw);
+        }
+        if (!closed && cap == kLineCapRound) {
+            addCircle(xy[0], xy[1], hw);
+            addCircle(xy[n * 2 - 2], xy[n * 2 - 1], hw);
+        }
+    }
+    void addDashed(const float* xy, int n, bool closed, float hw, int cap) {
+        const float* pat = lpats[penStyle];
+        float scale = mgMax(penWidth, 1.f), total = 0;
+        int count = 0;
+
+        for (; pat[count] > 0.1f; count++) {
+            total += pat[count] * scale;
+        }
+        int k = 0;
+        float left = fmodf(penPhase, total);
+        if (left < 0) left += total;
+        while (left >= pat[k] * scale) {       // 跳过相位所在的前几段
+            left -= pat[k] * scale;
+            k = (k + 1) % count;
+        }
+        left = pat[k] * scale - left;
+
+        dashed.clear();
+        if (k % 2 == 0) {
+            dashed.push_back(xy[0]);
+            dashed.push_back(xy[1]);
+        }
+        int nseg = closed ? n : n - 1;
+        for (int i = 0; i < nseg; i++) {
+            float x0 = xy[i * 2], y0 = xy[i * 2 + 1];
+            float x1 = xy[((i + 1) % n) * 2], y1 = xy[((i + 1) % n) * 2 + 1];
+            float len = sqrtf((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0)), pos = 0;
+
+            while (len - pos > left) {
+                pos += left;
+                float x = x0 + (x1 - x0) * pos / len, y = y0 + (y1 - y0) * pos / len;
+                if (k % 2 == 0) {               // 一段实线结束
+                    dashed.push_back(x);
+                    dashed.push_back(y);
+                    addPolyline(&dashed.front(), (int)dashed.size() / 2, false, hw, cap);
+                    dashed.clear();
+                } else {
+                    dashed.push_back(x);
+                    dashed.push_back(y);
+                }
+                k = (k + 1) % count;
+                left = pat[k] * scale;
+            }
+            left -= len - pos;
+            if (k % 2 == 0) {
+                dashed.push_back(x1);
+                dashed.push_back(y1);
+            }
+        }
+        if (k % 2 == 0 && dashed.size() > 2) {
+            addPolyline(&dashed.front(), (int)dashed.size() / 2, false, hw, cap);
+        }
+    }
+    void addStroke(const RasterPath& p) {
+        int style = penStyle & kLineDashMask;
+        int cap = penStyle & kLineCapMask;
+        float hw = mgMax(penWidth, 1.f) / 2;
+        bool dash = style > 0 && style < 5;
+
+        if (cap & kLineCapButt) cap = kLineCapButt;
+        else if (cap & kLineCapRound) cap = kLineCapRound;
+        else if (cap & kLineCapSquare) cap = kLineCapSquare;
+        else cap = dash ? kLineCapButt : kLineCapRound;
+
+        for (size_t i = 0; i < p.subs.size(); i++) {
+            const float* xy = &p.xy[p.subs[i].start * 2];
+            int n = p.subs[i].count;
+            bool closed = p.subs[i].closed && n > 2;
+
+            if (dash) {
+                addDashed(xy, n, closed, hw, cap);
+            } else {
+                addPolyline(xy, n, closed, hw, cap);
+            }
+        }
+    }
+
+    // 光栅化
+
+    bool getBounds(int& x0, int& y0, int& x1, int& y1) const {
+        x0 = mgMax(clip.x0, (int)floorf(ex0));
+        y0 = mgMax(clip.y0, (int)floorf(ey0));
+        x1 = mgMin(clip.x1, (int)ceilf(ex1) + 1);
+        y1 = mgMin(clip.y1, (int)ceilf(ey1) + 1);
+        return !edges.empty() && x0 < x1 && y0 < y1;
+    }
+
+    // 累加有向线段在每个像素下方的带符号面积，逐行求和后即为覆盖率
+    static void accumulate(float* a, int w, int h, float x0, float y0, float x1, float y1) {
+        float dir = 1.f;
+        if (y0 > y1) {
+            float t = x0; x0 = x1; x1 = t;
+            t = y0; y0 = y1; y1 = t;
+            dir = -1.f;
+        }
+        if (y1 <= 0 || y0 >= h) return;
+
+        float dxdy = (x1 - x0) / (y1 - y0);
+        float x = x0;
+        int ystart = (int)floorf(y0);
+        if (y0 < 0) {
+            x -= y0 * dxdy;
+            ystart = 0;
+        }
+        int yend = mgMin(h, (int)ceilf(y1));
+        float fw = (float)w;
+
+        for (int y = ystart; y < yend; y++) {
+            float* row = a + y * (w + 2);
+            float dy = mgMin((float)(y + 1), y1) - mgMax((float)y, y0);
+            float xnext = x + dxdy * dy;
+            float d = dy * dir;
+            float xa = mgMax(0.f, mgMin(fw, x < xnext ? x : xnext));
+            float xb = mgMax(0.f, mgMin(fw, x < xnext ? xnext : x));
+            float xafloor = floorf(xa);
+            int xai = (int)xafloor;
+            int xbi = (int)ceilf(xb);
+
+            if (xbi <= xai + 1) {
+                float xmf = 0.5f * (xa + xb) - xafloor;
+                row[xai] += d - d * xmf;
+                row[xai + 1] += d * xmf;
+            } else {
+                float s = 1.f / (xb - xa);
+                float xaf = xa - xafloor;
+                float a0 = 0.5f * s * (1 - xaf) * (1 - xaf);
+                float xbf = xb - xbi + 1;
+                float am = 0.5f * s * xbf * xbf;
+                row[xai] += d * a0;
+                if (xbi == xai + 2) {
+                    row[xai + 1] += d * (1 - a0 - am);
+                } else {
+                    float a1 = s * (1.5f - xaf);
+                    row[xai + 1] += d * (a1 - a0);
+                    for (int xi = xai + 2; xi < xbi - 1; xi++) {
+                        row[xi] += d * s;
+                    }
+                    float a2 = a1 + (xbi - xai - 3) * s;
+                    row[xbi - 1] += d * (1 - a2 - am);
+                }
+                row[xbi] += d * am;
+            }
+            x = xnext;
+        }
+    }
+
+    // 按带划分光栅化，每行得到覆盖率后调用 span(y, x, n, cov)
+    template <class Span>
+    void rasterize(Span& span) {
+        int x0, y0, x1, y1;
+        if (!getBounds(x0, y0, x1, y1)) return;
+
+        int w = x1 - x0;
+        int band = mgMax(1, mgMin(y1 - y0, kBandArea / (w + 2)));
+        std::vector<float> cov(w);
+
+        acc.assign((size_t)(w + 2) * band, 0.f);
+        for (int by = y0; by < y1; by += band) {
+            int bh = mgMin(band, y1 - by);
+            for (size_t i = 0; i + 3 < edges.size(); i += 4) {
+                const float* e = &edges[i];
+                if (mgMax(e[1], e[3]) > by && mgMin(e[1], e[3]) < by + bh) {
+                    accumulate(&acc.front(), w, bh, e[0] - x0, e[1] - by, e[2] - x0, e[3] - by);
+                }
+            }
+            for (int y = 0; y < bh; y++) {
+                float* row = &acc[y * (w + 2)];
+                float sum = 0;
+                for (int x = 0; x < w; x++) {
+                    sum += row[x];
+                    float c = fabsf(sum);
+                    cov[x] = c < 1.f ? c : 1.f;
+                }
+                memset(row, 0, sizeof(float) * (w + 2));
+                span(by + y, x0, w, &cov.front());
+            }
+        }
+    }
+
+    struct BlendSpan {                  // 用颜色按覆盖率混合到像素
+        Impl* im;
+        int r, g, b;
+        float alpha;
+        void operator()(int y, int x, int n, const float* cov) {
+            unsigned char* p = im->pixels + y * im->stride + x * 4;
+            const unsigned char* m = im->clip.mask.empty() ? (const unsigned char*)0
+                : &im->clip.mask[y * im->width + x];
+            for (int i = 0; i < n; i++, p += 4) {
+                float c = m ? cov[i] * m[i] * (1.f / 255.f) : cov[i];
+                int sa = (int)(c * alpha + 0.5f);
+                if (sa > 0) {
+                    blendPixel(p, r, g, b, sa);
+                }
+            }
+        }
+    };
+
+    struct MaskSpan {                   // 与剪裁掩码相乘
+        std::vector<unsigned char>* mask;
+        std::vector<unsigned char>* out;
+        int width;
+        void operator()(int y, int x, int n, const float* cov) {
+            unsigned char* p = &(*out)[y * width + x];
+            const unsigned char* m = mask->empty() ? (const unsigned char*)0 : &(*mask)[y * width + x];
+            for (int i = 0; i < n; i++) {
+                int c = (int)(cov[i] * 255.f + 0.5f);
+                p[i] = (unsigned char)(m ? c * m[i] / 255 : c);
+            }
+        }
+    };
+
+    static void blendPixel(unsigned char* p, int r, int g, int b, int sa) {
+        if (sa >= 255) {
+            p[0] = (unsigned char)r;
+            p[1] = (unsigned char)g;
+            p[2] = (unsigned char)b;
+            p[3] = 255;
+        } else if (p[3] == 255) {               // 常见的不透明背景
+            p[0] = (unsigned char)(p[0] + (r - p[0]) * sa / 255);
+            p[1] = (unsigned char)(p[1] + (g - p[1]) * sa / 255);
+            p[2] = (unsigned char)(p[2] + (b - p[2]) * sa / 255);
+        } else {                                // 非预乘的源覆盖混合
+            int da = p[3] * (255 - sa) / 255;
+            int oa = sa + da;
+            p[0] = (unsigned char)((r * sa + p[0] * da) / oa);
+            p[1] = (unsigned char)((g * sa + p[1] * da) / oa);
+            p[2] = (unsigned char)((b * sa + p[2] * da) / oa);
+            p[3] = (unsigned char)oa;
+        }
+    }
+
+    void fillEdges(int argb, float alpha) {
+        BlendSpan span;
+        span.im = this;
+        span.r = (argb >> 16) & 0xFF;
+        span.g = (argb >> 8) & 0xFF;
+        span.b = argb & 0xFF;
+        span.alpha = alpha * ((argb >> 24) & 0xFF);
+        if (pixels && span.alpha > 0.5f) {
+            rasterize(span);
+        }
+    }
+
+    void draw(const RasterPath& p, bool stroke, bool fill) {
+        if (fill && ((brushColor >> 24) & 0xFF) != 0) {
+            beginEdges();
+            addFill(p);
+            fillEdges(brushColor, 1.f);
+        }
+        if (stroke && (penStyle & kLineDashMask) != 5 && penWidth > 0) {
+            beginEdges();
+            addStroke(p);
+            fillEdges(penColor, mgMin(penWidth, 1.f));   // 细线按线宽降低透明度
+        }
+    }
+
+    bool intersectClip(int x0, int y0, int x1, int y1) {
+        clip.x0 = mgMax(clip.x0, x0);
+        clip.y0 = mgMax(clip.y0, y0);
+        clip.x1 = mgMin(clip.x1, x1);
+        clip.y1 = mgMin(clip.y1, y1);
+        if (clip.x1 < clip.x0) clip.x1 = clip.x0;
+        if (clip.y1 < clip.y0) clip.y1 = clip.y0;
+        return clip.x0 < clip.x1 && clip.y0 < clip.y1;
+    }
+
+    // 图像
+
+    bool drawImage(const unsigned char* src, int iw, int ih, int istride,
+                   float xc, float yc, float w, float h, float angle) {
+        float c = cosf(angle), s = sinf(angle);
+        float hw = w / 2, hh = h / 2;
+        float bw = fabsf(hw * c) + fabsf(hh * s), bh = fabsf(hw * s) + fabsf(hh * c);
+        int x0 = mgMax(clip.x0, (int)floorf(xc - bw));
+        int y0 = mgMax(clip.y0, (int)floorf(yc - bh));
+        int x1 = mgMin(clip.x1, (int)ceilf(xc + bw) + 1);
+        int y1 = mgMin(clip.y1, (int)ceilf(yc + bh) + 1);
+        float sx = iw / w, sy = ih / h;
+
+        for (int y = y0; y < y1; y++) {
+            unsigned char* p = pixels + y * stride + x0 * 4;
+            const unsigned char* m = clip.mask.empty() ? (const unsigned char*)0 : &clip.mask[y * width + x0];
+            for (int x = x0; x < x1; x++, p += 4) {
+                float dx = x + 0.5f - xc, dy = y + 0.5f - yc;
+                float u = dx * c - dy * s + hw;         // 逆旋转到图像坐标，显示坐标系Y向下
+                float v = dx * s + dy * c + hh;
+                if (u < 0 || v < 0 || u >= w || v >= h) continue;
+
+                float fu = mgMax(0.f, u * sx - 0.5f), fv = mgMax(0.f, v * sy - 0.5f);
+                int iu = mgMin((int)fu, iw - 1), iv = mgMin((int)fv, ih - 1);
+                int iu2 = mgMin(iu + 1, iw - 1), iv2 = mgMin(iv + 1, ih - 1);
+                float tu = fu - iu, tv = fv - iv;
+                const unsigned char* p00 = src + iv * istride + iu * 4;
+                const unsigned char* p01 = src + iv * istride + iu2 * 4;
+                const unsigned char* p10 = src + iv2 * istride + iu * 4;
+                const unsigned char* p11 = src + iv2 * istride + iu2 * 4;
+                float rgba[4];
+                for (int k = 0; k < 4; k++) {
+                    float top = p00[k] + (p01[k] - p00[k]) * tu;
+                    float bottom = p10[k] + (p11[k] - p10[k]) * tu;
+                    rgba[k] = top + (bottom - top) * tv;
+                }
+                int sa = (int)(rgba[3] * (m ? m[x - x0] / 255.f : 1.f) + 0.5f);
+                if (sa > 0) {
+                    blendPixel(p, (int)(rgba[0] + 0.5f), (int)(rgba[1] + 0.5f), (int)(rgba[2] + 0.5f), sa);
+                }
+            }
+        }
+        return true;
+    }
+};
+
+GiRasterCanvas::GiRasterCanvas()
+{
+    im = new Impl();
+}
+
+GiRasterCanvas::~GiRasterCanvas()
+{
+    delete im;
+}
+
+bool GiRasterCanvas::attach(unsigned char* pixels, int width, int height, int stride)
+{
+    if (stride == 0) {
+        stride = width * 4;
+    }
+    if (!pixels || width < 1 || height < 1 || stride < width * 4) {
+        return false;
+    }
+    if (pixels != (im->owned.empty() ? (unsigned char*)0 : &im->owned.front())) {
+        std::vector<unsigned char>().swap(im->owned);
+    }
+    im->pixels = pixels;
+    im->width = width;
+    im->height = height;
+    im->stride = stride;
+    im->resetClip();
+
+    return true;
+}
+
+bool GiRasterCanvas::create(int width, int height)
+{
+    if (width < 1 || height < 1) {
+        return false;
+    }
+    im->owned.assign((size_t)width * height * 4, 0);
+    return attach(&im->owned.front(), width, height);
+}
+
+unsigned char* GiRasterCanvas::getPixels() const
+{
+    return im->pixels;
+}
+
+void GiRasterCanvas::setCallback(GiRasterCallback* callback)
+{
+    im->callback = callback;
+}
+
+int GiRasterCanvas::getWidth() const
+{
+    return im->width;
+}
+
+int GiRasterCanvas::getHeight() const
+{
+    return im->height;
+}
+
+void GiRasterCanvas::fill(int argb)
+{
+    unsigned char c[4] = { (unsigned char)(argb >> 16), (unsigned char)(argb >> 8),
+        (unsigned char)argb, (unsigned char)(argb >> 24) };
+
+    for (int y = 0; y < im->height; y++) {
+        unsigned char* p = im->pixels + y * im->stride;
+        for (int x = 0; x < im->width; x++, p += 4) {
+            memcpy(p, c, 4);
+        }
+    }
+}
+
+void GiRasterCanvas::setPen(int argb, float width, int style, float phase, float)
+{
+    if (argb != 0) {
+        im->penColor = argb;
+    }
+    if (width > 0) {
+        im->penWidth = width;
+    }
+    if (style >= 0) {
+        int dash = style & kLineDashMask;
+        im->penStyle = (dash > 5 ? 0 : dash) | (style & kLineCapMask);
+        im->penPhase = phase;
+    }
+}
+
+void GiRasterCanvas::setBrush(int argb, int style)
+{
+    if (style == 0) {
+        im->brushColor = argb;
+    }
+}
+
+void GiRasterCanvas::clearRect(float x, float y, float w, float h)
+{
+    const RasterClip& clip = im->clip;
+    int x0 = mgMax(clip.x0, mgRound(x)), x1 = mgMin(clip.x1, mgRound(x + w));
+    int y0 = mgMax(clip.y0, mgRound(y)), y1 = mgMin(clip.y1, mgRound(y + h));
+
+    for (int row = y0; row < y1 && x0 < x1; row++) {
+        memset(im->pixels + row * im->stride + x0 * 4, 0, (x1 - x0) * 4);
+    }
+}
+
+void GiRasterCanvas::drawRect(float x, float y, float w, float h, bool stroke, bool fill)
+{
+    im->shape.clear();
+    im->shape.addRect(x, y, w, h);
+    im->draw(im->shape, stroke, fill);
+}
+
+void GiRasterCanvas::drawLine(float x1, float y1, float x2, float y2)
+{
+    im->shape.clear();
+    im->shape.moveTo(x1, y1);
+    im->shape.lineTo(x2, y2);
+    im->draw(im->shape, true, false);
+}
+
+void GiRasterCanvas::drawEllipse(float x, float y, float w, float h, bool stroke, bool fill)
+{
+    im->shape.clear();
+    im->shape.addEllipse(x, y, w, h);
+    im->draw(im->shape, stroke, fill);
+}
+
+void GiRasterCanvas::beginPath()
+{
+    im->path.clear();
+}
+
+void GiRasterCanvas::moveTo(float x, float y)
+{
+    im->path.moveTo(x, y);
+}
+
+void GiRasterCanvas::lineTo(float x, float y)
+{
+    im->path.lineTo(x, y);
+}
+
+void GiRasterCanvas::bezierTo(float c1x, float c1y, float c2x, float c2y, float x, float y)
+{
+    im->path.bezierTo(c1x, c1y, c2x, c2y, x, y);
+}
+
+void GiRasterCanvas::quadTo(float cpx, float cpy, float x, float y)
+{
+    im->path.quadTo(cpx, cpy, x, y);
+}
+
+void GiRasterCanvas::closePath()
+{
+    im->path.closePath();
+}
+
+void GiRasterCanvas::drawPath(bool stroke, bool fill)
+{
+    im->draw(im->path, stroke, fill);
+    im->path.clear();
+}
+
+void GiRasterCanvas::saveClip()
+{
+    im->clipStack.push_back(im->clip);
+}
+
+void GiRasterCanvas::restoreClip()
+{
+    if (!im->clipStack.empty()) {
+        im->clip.mask.swap(im->clipStack.back().mask);
+        im->clip.x0 = im->clipStack.back().x0;
+        im->clip.y0 = im->clipStack.back().y0;
+        im->clip.x1 = im->clipStack.back().x1;
+        im->clip.y1 = im->clipStack.back().y1;
+        im->clipStack.pop_back();
+    }
+}
+
+bool GiRasterCanvas::clipRect(float x, float y, float w, float h)
+{
+    im->path.clear();
+    return im->intersectClip(mgRound(x), mgRound(y), mgRound(x + w), mgRound(y + h));
+}
+
+bool GiRasterCanvas::clipPath()
+{
+    std::vector<unsigned char> mask((size_t)im->width * im->height, 0);
+    Impl::MaskSpan span;
+
+    span.mask = &im->clip.mask;
+    span.out = &mask;
+    span.width = im->width;
+
+    im->beginEdges();
+    im->addFill(im->path);
+    im->path.clear();
+    im->rasterize(span);
+
+    int x0, y0, x1, y1;
+    bool ret = im->getBounds(x0, y0, x1, y1) && im->intersectClip(x0, y0, x1, y1);
+
+    im->clip.mask.swap(mask);
+    return ret;
+}
+
+bool GiRasterCanvas::drawHandle(float, float, int, float)
+{
+    return false;
+}
+
+bool GiRasterCanvas::drawBitmap(const char* name, float xc, float yc,
+                                float w, float h, float angle)
+{
+    int iw = 0, ih = 0, istride = 0;
+    const unsigned char* src = (im->callback && name && w > 0 && h > 0 && im->pixels)
+        ? im->callback->getImagePixels(name, iw, ih, istride) : (const unsigned char*)0;
+
+    if (istride == 0) {
+        istride = iw * 4;
+    }
+    return src && iw > 0 && ih > 0 && im->drawImage(src, iw, ih, istride, xc, yc, w, h, angle);
+}
+
+float GiRasterCanvas::drawTextAt(const char* text, float x, float y, float h, int align, float angle)
+{
+    return im->callback && text ? im->callback->drawTextAt(this, text, x, y, h, align, angle) : 0.f;
+}
+
+// PNG
+
+struct PngWriter {
+    std::vector<unsigned char>  out;    // 压缩数据
+    unsigned long               bits;
+    int                         nbits;
+    unsigned long               crcTable[256];
+
+    PngWriter() : bits(0), nbits(0) {
+        for (unsigned long n = 0; n < 256; n++) {
+            unsigned long c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+            }
+            crcTable[n] = c;
+        }
+    }
+
+    unsigned long crc(const unsigned char* p, size_t n, unsigned long c = 0xFFFFFFFFUL) const {
+        for (size_t i = 0; i < n; i++) {
+            c = crcTable[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+        }
+        return c;
+    }
+
+    void putBits(unsigned long value, int n) {          // 低位先出
+        bits |= value << nbits;
+        nbits += n;
+        while (nbits >= 8) {
+            out.push_back((unsigned char)bits);
+            bits >>= 8;
+            nbits -= 8;
+        }
+    }
+    void putCode(unsigned long code, int n) {           // 霍夫曼码高位先出
+        unsigned long r = 0;
+        for (int i = 0; i < n; i++) {
+            r = (r << 1) | ((code >> i) & 1);
+        }
+        putBits(r, n);
+    }
+    void putSymbol(int sym) {                           // 固定霍夫曼编码
+        if (sym < 144)      putCode(0x30 + sym, 8);
+        else if (sym < 256) putCode(0x190 + sym - 144, 9);
+        else if (sym < 280) putCode(sym - 256, 7);
+        else                putCode(0xC0 + sym - 280, 8);
+    }
+    void putMatch(int len, int dist) {
+        static const short lbase[] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,
+            35,43,51,59,67,83,99,115,131,163,195,227,258 };
+        static const unsigned char lext[] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,
+            3,3,3,3,4,4,4,4,5,5,5,5,0 };
+        static const unsigned short dbase[] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,
+            257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+        static const unsigned char dext[] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,
+            7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+        int i = 28, j = 29;
+        while (lbase[i] > len) i--;
+        while (dbase[j] > dist) j--;
+        putSymbol(257 + i);
+        putBits(len - lbase[i], lext[i]);
+        putCode(j, 5);
+        putBits(dist - dbase[j], dext[j]);
+    }
+
+    // zlib 格式：固定霍夫曼编码的单个块，LZ77 用单次探测的哈希表
+    void deflate(const std::vector<unsigned char>& data) {
+        const int kWindow = 32768, kHashBits = 15;
+        std::vector<int> head(1 << kHashBits, -1);
+        const unsigned char* p = data.empty() ? (const unsigned char*)0 : &data.front();
+        int n = (int)data.size();
+
+        out.push_back(0x78);
+        out.push_back(0x01);
+        putBits(1, 1);                                  // BFINAL
+        putBits(1, 2);                                  // BTYPE = 固定霍夫曼
+
+        for (int i = 0; i < n; ) {
+            int len = 0, dist = 0;
+            if (i + 3 <= n) {
+                unsigned h = ((p[i] << 16 | p[i + 1] << 8 | p[i + 2]) * 2654435761U) >> (32 - kHashBits);
+                int cand = head[h];
+                head[h] = i;
+                if (cand >= 0 && i - cand <= kWindow) {
+                    int maxlen = mgMin(258, n - i);
+                    while (len < maxlen && p[cand + len] == p[i + len]) len++;
+                    dist = i - cand;
+                }
+            }
+            if (len >= 3) {
+                putMatch(len, dist);
+                i += len;
+            } else {
+                putSymbol(p[i++]);
+            }
+        }
+        putSymbol(256);
+        if (nbits > 0) {
+            putBits(0, 8 - nbits);
+        }
+
+        unsigned long a = 1, b = 0;                     // Adler-32
+        for (int i = 0; i < n; ) {
+            int end = mgMin(n, i + 5552);
+            for (; i < end; i++) {
+                a += p[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        unsigned long adler = (b << 16) | a;
+        for (int k = 24; k >= 0; k -= 8) {
+            out.push_back((unsigned char)(adler >> k));
+        }
+    }
+
+    bool writeChunk(FILE* fp, const char* type, const unsigned char* data, size_t n) {
+        unsigned char len[4] = { (unsigned char)(n >> 24), (unsigned char)(n >> 16),
+            (unsigned char)(n >> 8), (unsigned char)n };
+        unsigned long c = crc(data, n, crc((const unsigned char*)type, 4)) ^ 0xFFFFFFFFUL;
+        unsigned char crcbuf[4] = { (unsigned char)(c >> 24), (unsigned char)(c >> 16),
+            (unsigned char)(c >> 8), (unsigned char)c };
+        return (fwrite(len, 1, 4, fp) == 4 && fwrite(type, 1, 4, fp) == 4
+                && (n == 0 || fwrite(data, 1, n, fp) == n) && fwrite(crcbuf, 1, 4, fp) == 4);
+    }
+};
+
+// 每行按使 |差值| 之和最小的方式选择过滤器
+static void filterRows(std::vector<unsigned char>& raw, const unsigned char* pixels,
+                       int width, int height, int stride)
+{
+    int rowsize = width * 4;
+    std::vector<unsigned char> line(rowsize), best(rowsize);
+
+    raw.resize((size_t)(rowsize + 1) * height);
+    for (int y = 0; y < height; y++) {
+        const unsigned char* cur = pixels + y * stride;
+        const unsigned char* prev = y > 0 ? cur - stride : (const unsigned char*)0;
+        long bestsum = -1;
+        int bestf = 0;
+
+        for (int f = 0; f < 5; f++) {
+            long sum = 0;
+            for (int i = 0; i < rowsize; i++) {
+                int a = i >= 4 ? cur[i - 4] : 0;
+                int b = prev ? prev[i] : 0;
+                int c = prev && i >= 4 ? prev[i - 4] : 0;
+                int pred = 0;
+                switch (f) {
+                    case 1: pred = a; break;
+                    case 2: pred = b; break;
+                    case 3: pred = (a + b) / 2; break;
+                    case 4: {
+                        int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+                        pred = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                        break;
+                    }
+                }
+                line[i] = (unsigned char)(cur[i] - pred);
+                sum += line[i] < 128 ? line[i] : 256 - line[i];
+            }
+            if (bestsum < 0 || sum < bestsum) {
+                bestsum = sum;
+                bestf = f;
+                best.swap(line);
+            }
+        }
+        raw[(size_t)(rowsize + 1) * y] = (unsigned char)bestf;
+        memcpy(&raw[(size_t)(rowsize + 1) * y + 1], &best.front(), rowsize);
+    }
+}
+
+bool GiRasterCanvas::writePNG(const char* filename, const unsigned char* pixels,
+                              int width, int height, int stride)
+{
+    if (stride == 0) {
+        stride = width * 4;
+    }
+    if (!filename || !pixels || width < 1 || height < 1 || stride < width * 4) {
+        return false;
+    }
+
+    std::vector<unsigned char> raw;
+    PngWriter writer;
+
+    filterRows(raw, pixels, width, height, stride);
+    writer.deflate(raw);
+
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        return false;
+    }
+
+    static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    unsigned char ihdr[13] = {
+        (unsigned char)(width >> 24), (unsigned char)(width >> 16),
+        (unsigned char)(width >> 8), (unsigned char)width,
+        (unsigned char)(height >> 24), (unsigned char)(height >> 16),
+        (unsigned char)(height >> 8), (unsigned char)height,
+        8, 6, 0, 0, 0 };                // 8位RGBA，不隔行
+    bool ret = (fwrite(signature, 1, 8, fp) == 8
+                && writer.writeChunk(fp, "IHDR", ihdr, 13)
+                && writer.writeChunk(fp, "IDAT", &writer.out.front(), writer.out.size())
+                && writer.writeChunk(fp, "IEND", (const unsigned char*)0, 0));
+
+    return fclose(fp) == 0 && ret;
+}
+
+bool GiRasterCanvas::savePNG(const char* filename) const
+{
+    return writePNG(filename, im->pixels, im->width, im->height, im->stride);
+}
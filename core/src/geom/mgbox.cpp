@@ -3,6 +3,7 @@
 
 #include "mgbox.h"
 #include "mgmat.h"
+#include "mgsimd.h"
 
 Box2d::Box2d(const Box2d& src, bool bNormalize)
 {
@@ -56,18 +57,13 @@ Box2d& Box2d::set(int count, const Point2d* points)
     if (count < 1 || !points)
         return empty();
 
-    set(points[0], points[0]);
-    for (int i = 0; i < count; i++)
-    {
-        if (xmin > points[i].x)
-            xmin = points[i].x;
-        if (ymin > points[i].y)
-            ymin = points[i].y;
-        if (xmax < points[i].x)
-            xmax = points[i].x;
-        if (ymax < points[i].y)
-            ymax = points[i].y;
-    }
+    MgPointsBox box;
+
+    mgPointsExtent(count, points, box);
+    xmin = box.xmin;
+    ymin = box.ymin;
+    xmax = box.xmax;
+    ymax = box.ymax;
 
     return *this;
 }
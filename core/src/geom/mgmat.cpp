@@ -2,6 +2,8 @@
 // Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
 
 #include "mgmat.h"
+#include "mgbox.h"
+#include "mgsimd.h"
 
 Matrix2d::Matrix2d()
 {
@@ -64,8 +66,23 @@ Point2d Point2d::transform(const Matrix2d& m) const
 
 void Matrix2d::transformPoints(int count, Point2d* points) const
 {
-    for (int i = 0; i < count; i++)
-        points[i] *= (*this);
+    const float m[6] = { m11, m12, m21, m22, dx, dy };
+    mgTransformPoints(m, count, points, points, (MgPointsBox*)0);
+}
+
+void Matrix2d::transformPoints(int count, const Point2d* points, Point2d* result,
+                               Box2d* box) const
+{
+    const float m[6] = { m11, m12, m21, m22, dx, dy };
+    MgPointsBox r;
+    
+    mgTransformPoints(m, count, points, result, box ? &r : (MgPointsBox*)0);
+    if (box && count < 1) {
+        box->empty();
+    } else if (box) {
+        box->xmin = r.xmin; box->ymin = r.ymin;
+        box->xmax = r.xmax; box->ymax = r.ymax;
+    }
 }
 
 void Matrix2d::transformVectors(int count, Vector2d* vectors) const
@@ -0,0 +1,184 @@
+// mgsimd.h: 点数组的批量变换和范围计算，有 SSE2/NEON 指令时每次处理多个点
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_MGSIMD_H
+#define TOUCHVG_MGSIMD_H
+
+#include "mgpnt.h"
+
+// NEON 内核还未在 ARM 上编译和验证，默认用标量代码，定义 MG_SIMD_ENABLE_NEON 才使用。
+// 与逐点 Point2d::operator*= 的结果是否相同可用 core/bench 的 mgbench 检查，
+// 编译器将乘加合并为 FMA (例如 ARM64 上 GCC 默认 -ffp-contract=fast)时末位可能不同。
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MG_SIMD_SSE2
+#elif defined(MG_SIMD_ENABLE_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define MG_SIMD_NEON
+#endif
+
+// 批量指令按 {x, y} 连续存放的浮点数处理点数组
+typedef char MgPoint2dLayoutCheck[sizeof(Point2d) == 2 * sizeof(float) ? 1 : -1];
+
+//! 点数组的范围，与逐点比较的结果相同(跳过含非数值的点)
+struct MgPointsBox {
+    float xmin, ymin, xmax, ymax;
+
+    void init(const Point2d& pt) {
+        xmin = xmax = pt.x;
+        ymin = ymax = pt.y;
+    }
+    void add(const Point2d& pt) {
+        if (xmin > pt.x) xmin = pt.x;
+        if (ymin > pt.y) ymin = pt.y;
+        if (xmax < pt.x) xmax = pt.x;
+        if (ymax < pt.y) ymax = pt.y;
+    }
+};
+
+//! 将 count 个点 src 按矩阵 (m11,m12,m21,m22,dx,dy) 变换到 dst (可与 src 相同)，box 不为NULL时计算 dst 的范围
+static inline void mgTransformPoints(const float* m, int count, const Point2d* src,
+                                     Point2d* dst, MgPointsBox* box)
+{
+    int i = 0;
+
+    if (count < 1)
+        return;
+#if defined(MG_SIMD_SSE2)
+    if (count >= 2) {
+        const __m128 m1 = _mm_setr_ps(m[0], m[1], m[0], m[1]);
+        const __m128 m2 = _mm_setr_ps(m[2], m[3], m[2], m[3]);
+        const __m128 d = _mm_setr_ps(m[4], m[5], m[4], m[5]);
+        __m128 vmin, vmax;
+
+        for (; i + 2 <= count; i += 2) {            // 每次两个点 {x0,y0,x1,y1}
+            __m128 v = _mm_loadu_ps(&src[i].x);
+            __m128 xx = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+            __m128 yy = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+
+            v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xx, m1), _mm_mul_ps(yy, m2)), d);
+            _mm_storeu_ps(&dst[i].x, v);
+            if (box) {
+                if (i == 0) {                       // 从第一个点开始
+                    vmin = vmax = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 1, 0));
+                }
+                vmin = _mm_min_ps(v, vmin);         // 有非数值时 minps/maxps 返回第二个操作数
+                vmax = _mm_max_ps(v, vmax);
+            }
+        }
+        if (box) {
+            vmin = _mm_min_ps(_mm_movehl_ps(vmin, vmin), vmin);
+            vmax = _mm_max_ps(_mm_movehl_ps(vmax, vmax), vmax);
+
+            float r[4];
+            _mm_storeu_ps(r, _mm_movelh_ps(vmin, vmax));
+            box->xmin = r[0]; box->ymin = r[1];
+            box->xmax = r[2]; box->ymax = r[3];
+        }
+    }
+#elif defined(MG_SIMD_NEON)
+    if (count >= 4) {
+        const float32x4_t m11 = vdupq_n_f32(m[0]), m12 = vdupq_n_f32(m[1]);
+        const float32x4_t m21 = vdupq_n_f32(m[2]), m22 = vdupq_n_f32(m[3]);
+        const float32x4_t dx = vdupq_n_f32(m[4]), dy = vdupq_n_f32(m[5]);
+        float32x4_t xmin, ymin, xmax, ymax;
+
+        for (; i + 4 <= count; i += 4) {            // 每次四个点，val[0]为X，val[1]为Y
+            float32x4x2_t v = vld2q_f32(&src[i].x);
+            float32x4x2_t r;
+
+            r.val[0] = vaddq_f32(vaddq_f32(vmulq_f32(v.val[0], m11), vmulq_f32(v.val[1], m21)), dx);
+            r.val[1] = vaddq_f32(vaddq_f32(vmulq_f32(v.val[0], m12), vmulq_f32(v.val[1], m22)), dy);
+            vst2q_f32(&dst[i].x, r);
+            if (box) {
+                if (i == 0) {                       // 从第一个点开始
+                    xmin = xmax = vdupq_n_f32(dst[0].x);
+                    ymin = ymax = vdupq_n_f32(dst[0].y);
+                }                                   // 用比较结果选择以跳过非数值
+                xmin = vbslq_f32(vcltq_f32(r.val[0], xmin), r.val[0], xmin);
+                ymin = vbslq_f32(vcltq_f32(r.val[1], ymin), r.val[1], ymin);
+                xmax = vbslq_f32(vcgtq_f32(r.val[0], xmax), r.val[0], xmax);
+                ymax = vbslq_f32(vcgtq_f32(r.val[1], ymax), r.val[1], ymax);
+            }
+        }
+        if (box) {
+            float ax[4], ay[4], bx[4], by[4];
+
+            vst1q_f32(ax, xmin); vst1q_f32(ay, ymin);
+            vst1q_f32(bx, xmax); vst1q_f32(by, ymax);
+            box->init(dst[0]);
+            for (int k = 0; k < 4; k++) {
+                box->add(Point2d(ax[k], ay[k]));
+                box->add(Point2d(bx[k], by[k]));
+            }
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        float x = src[i].x, y = src[i].y;
+
+        dst[i].x = x * m[0] + y * m[2] + m[4];
+        dst[i].y = x * m[1] + y * m[3] + m[5];
+        if (box) {
+            if (i == 0)
+                box->init(dst[0]);
+            box->add(dst[i]);
+        }
+    }
+}
+
+//! 计算 count 个点的范围，count 应大于0
+static inline void mgPointsExtent(int count, const Point2d* pts, MgPointsBox& box)
+{
+    int i = 0;
+
+#if defined(MG_SIMD_SSE2)
+    if (count >= 2) {
+        __m128 vmin = _mm_loadu_ps(&pts[0].x), vmax;
+
+        vmin = vmax = _mm_shuffle_ps(vmin, vmin, _MM_SHUFFLE(1, 0, 1, 0));
+        for (; i + 2 <= count; i += 2) {
+            __m128 v = _mm_loadu_ps(&pts[i].x);
+            vmin = _mm_min_ps(v, vmin);
+            vmax = _mm_max_ps(v, vmax);
+        }
+        vmin = _mm_min_ps(_mm_movehl_ps(vmin, vmin), vmin);
+        vmax = _mm_max_ps(_mm_movehl_ps(vmax, vmax), vmax);
+
+        float r[4];
+        _mm_storeu_ps(r, _mm_movelh_ps(vmin, vmax));
+        box.xmin = r[0]; box.ymin = r[1];
+        box.xmax = r[2]; box.ymax = r[3];
+    }
+#elif defined(MG_SIMD_NEON)
+    if (count >= 4) {
+        float32x4_t xmin = vdupq_n_f32(pts[0].x), ymin = vdupq_n_f32(pts[0].y);
+        float32x4_t xmax = xmin, ymax = ymin;
+
+        for (; i + 4 <= count; i += 4) {
+            float32x4x2_t v = vld2q_f32(&pts[i].x);
+            xmin = vbslq_f32(vcltq_f32(v.val[0], xmin), v.val[0], xmin);
+            ymin = vbslq_f32(vcltq_f32(v.val[1], ymin), v.val[1], ymin);
+            xmax = vbslq_f32(vcgtq_f32(v.val[0], xmax), v.val[0], xmax);
+            ymax = vbslq_f32(vcgtq_f32(v.val[1], ymax), v.val[1], ymax);
+        }
+
+        float ax[4], ay[4], bx[4], by[4];
+        vst1q_f32(ax, xmin); vst1q_f32(ay, ymin);
+        vst1q_f32(bx, xmax); vst1q_f32(by, ymax);
+        box.init(pts[0]);
+        for (int k = 0; k < 4; k++) {
+            box.add(Point2d(ax[k], ay[k]));
+            box.add(Point2d(bx[k], by[k]));
+        }
+    }
+#endif
+    if (i == 0) {
+        box.init(pts[0]);
+    }
+    for (; i < count; i++) {
+        box.add(pts[i]);
+    }
+}
+
+#endif // TOUCHVG_MGSIMD_H
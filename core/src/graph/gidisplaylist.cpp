@@ -0,0 +1,495 @@
+﻿// gidisplaylist.cpp: 实现显示列表类 GiDisplayList
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#include "gidisplaylist.h"
+#include <string.h>
+
+// 命令类型，与 MgRecordShape 原来的记录项类型相同
+enum {
+    kSetPen = 1, kSetBrush, kClearRect, kDrawRect, kDrawLine, kDrawEllipse,
+    kBeginPath, kMoveTo, kLineTo, kBezierTo, kQuadTo, kClosePath, kDrawPath,
+    kDrawHandle, kDrawBitmap, kDrawText, kClipPath, kClipRect, kMaxType = kClipRect
+};
+enum { kClip, kSave, kRestore };    // kClipPath 的参数
+enum { kStroke = 1, kFill = 2 };    // kDrawRect、kDrawEllipse 和 kDrawPath 的参数
+
+// 命令的标记字: 低字节为类型，其余为参数个数
+static inline int makeTag(int type, int size) { return type | (size << 8); }
+static inline int tagType(int tag) { return tag & 0xFF; }
+static inline int tagSize(int tag) { return (int)((unsigned)tag >> 8); }
+
+static inline int f2i(float f) { union { float f; int i; } u; u.f = f; return u.i; }
+static inline float i2f(int i) { union { float f; int i; } u; u.i = i; return u.f; }
+static inline int flags(bool stroke, bool fill) { return (stroke ? kStroke : 0) | (fill ? kFill : 0); }
+static inline int strWords(int len) { return (len + 4) / 4; }   // 含零结束符
+
+// 返回命令类型的固定参数个数，类型无效时返回-1
+static int fixedSize(int type)
+{
+    static const int sizes[kMaxType + 1] = {
+        -1, 5, 2, 4, 5, 4, 5, 0, 2, 2, 6, 4, 0, 1, 4, 6, 8, 1, 4
+    };
+    return type > 0 && type <= kMaxType ? sizes[type] : -1;
+}
+
+// 得到命令的各点，用于计算范围
+static int getPoints(const int* tag, Point2d* pts)
+{
+    const int* p = tag + 1;
+    int n = 0;
+
+    switch (tagType(*tag)) {
+        case kClearRect: case kDrawRect: case kDrawEllipse: case kClipRect:
+        case kDrawBitmap: case kDrawText:
+            pts[0].set(i2f(p[0]), i2f(p[1]));
+            pts[1].set(pts[0].x + i2f(p[2]), pts[0].y + i2f(p[3]));
+            n = 2;
+            break;
+        case kDrawLine: case kQuadTo:
+            pts[0].set(i2f(p[0]), i2f(p[1]));
+            pts[1].set(i2f(p[2]), i2f(p[3]));
+            n = 2;
+            break;
+        case kBezierTo:
+            pts[0].set(i2f(p[0]), i2f(p[1]));
+            pts[1].set(i2f(p[2]), i2f(p[3]));
+            pts[2].set(i2f(p[4]), i2f(p[5]));
+            n = 3;
+            break;
+        case kMoveTo: case kLineTo: case kDrawHandle:
+            pts[0].set(i2f(p[0]), i2f(p[1]));
+            n = 1;
+            break;
+        default:
+            break;
+    }
+    return n;
+}
+
+GiDisplayList::GiDisplayList() : _count(0), _hasExtent(false)
+{
+}
+
+GiDisplayList::GiDisplayList(const GiDisplayList& src)
+    : _data(src._data), _callbacks(src._callbacks), _mat(src._mat)
+    , _extent(src._extent), _count(src._count), _hasExtent(src._hasExtent)
+{
+    for (size_t i = 0; i < _callbacks.size(); i++) {
+        if (_callbacks[i]) _callbacks[i]->addRefTextWidth();
+    }
+}
+
+GiDisplayList::~GiDisplayList()
+{
+    releaseCallbacks();
+}
+
+GiDisplayList& GiDisplayList::operator=(const GiDisplayList& src)
+{
+    if (this != &src) {
+        for (size_t i = 0; i < src._callbacks.size(); i++) {
+            if (src._callbacks[i]) src._callbacks[i]->addRefTextWidth();
+        }
+        releaseCallbacks();
+        _data = src._data;
+        _callbacks = src._callbacks;
+        _mat = src._mat;
+        _extent = src._extent;
+        _count = src._count;
+        _hasExtent = src._hasExtent;
+    }
+    return *this;
+}
+
+void GiDisplayList::releaseCallbacks()
+{
+    for (size_t i = 0; i < _callbacks.size(); i++) {
+        if (_callbacks[i]) _callbacks[i]->releaseTextWidth();
+    }
+    _callbacks.clear();
+}
+
+void GiDisplayList::clear()
+{
+    releaseCallbacks();
+    _data.clear();
+    _extent.empty();
+    _count = 0;
+    _hasExtent = false;
+}
+
+int* GiDisplayList::addCmd(int type, int size)
+{
+    size_t pos = _data.size();
+
+    _data.resize(pos + 1 + size);
+    _data[pos] = makeTag(type, size);
+    _count++;
+
+    return &_data.front() + pos + 1;
+}
+
+void GiDisplayList::addExtent(const int* p)
+{
+    Point2d pts[3];
+    int n = getPoints(p - 1, pts);
+
+    for (int i = 0; i < n; i++) {
+        if (!_hasExtent) {
+            _hasExtent = true;
+            _extent.set(pts[i], pts[i]);
+        } else {
+            _extent.unionWith(pts[i]);
+        }
+    }
+}
+
+void GiDisplayList::addPoint(int* p, float x, float y)
+{
+    Point2d pt(Point2d(x, y) * _mat);
+    p[0] = f2i(pt.x);
+    p[1] = f2i(pt.y);
+}
+
+void GiDisplayList::addVector(int* p, float x, float y)
+{
+    Vector2d vec(Vector2d(x, y) * _mat);
+    p[0] = f2i(vec.x);
+    p[1] = f2i(vec.y);
+}
+
+int* GiDisplayList::addString(int type, int size, const char* str)
+{
+    int len = str ? (int)strlen(str) : 0;
+    int* p = addCmd(type, size + strWords(len));
+
+    p[size - 1] = len;
+    memcpy(p + size, str ? str : "", len + 1);
+
+    return p;
+}
+
+void GiDisplayList::setPen(int argb, float width, int style, float phase, float orgw)
+{
+    int* p = addCmd(kSetPen, 5);
+    p[0] = argb;
+    p[1] = f2i(width);
+    p[2] = style;
+    p[3] = f2i(phase);
+    p[4] = f2i(orgw);
+}
+
+void GiDisplayList::setBrush(int argb, int style)
+{
+    int* p = addCmd(kSetBrush, 2);
+    p[0] = argb;
+    p[1] = style;
+}
+
+void GiDisplayList::clearRect(float x, float y, float w, float h)
+{
+    int* p = addCmd(kClearRect, 4);
+    addPoint(p, x, y);
+    addVector(p + 2, w, h);
+    addExtent(p);
+}
+
+void GiDisplayList::drawRect(float x, float y, float w, float h, bool stroke, bool fill)
+{
+    int* p = addCmd(kDrawRect, 5);
+    addPoint(p, x, y);
+    addVector(p + 2, w, h);
+    p[4] = flags(stroke, fill);
+    addExtent(p);
+}
+
+void GiDisplayList::drawLine(float x1, float y1, float x2, float y2)
+{
+    int* p = addCmd(kDrawLine, 4);
+    addPoint(p, x1, y1);
+    addPoint(p + 2, x2, y2);
+    addExtent(p);
+}
+
+void GiDisplayList::drawEllipse(float x, float y, float w, float h, bool stroke, bool fill)
+{
+    int* p = addCmd(kDrawEllipse, 5);
+    addPoint(p, x, y);
+    addVector(p + 2, w, h);
+    p[4] = flags(stroke, fill);
+    addExtent(p);
+}
+
+void GiDisplayList::beginPath()
+{
+    addCmd(kBeginPath, 0);
+}
+
+void GiDisplayList::moveTo(float x, float y)
+{
+    int* p = addCmd(kMoveTo, 2);
+    addPoint(p, x, y);
+    addExtent(p);
+}
+
+void GiDisplayList::lineTo(float x, float y)
+{
+    int* p = addCmd(kLineTo, 2);
+    addPoint(p, x, y);
+    addExtent(p);
+}
+
+void GiDisplayList::bezierTo(float c1x, float c1y, float c2x, float c2y, float x, float y)
+{
+    int* p = addCmd(kBezierTo, 6);
+    addPoint(p, c1x, c1y);
+    addPoint(p + 2, c2x, c2y);
+    addPoint(p + 4, x, y);
+    addExtent(p);
+}
+
+void GiDisplayList::quadTo(float cpx, float cpy, float x, float y)
+{
+    int* p = addCmd(kQuadTo, 4);
+    addPoint(p, cpx, cpy);
+    addPoint(p + 2, x, y);
+    addExtent(p);
+}
+
+void GiDisplayList::closePath()
+{
+    addCmd(kClosePath, 0);
+}
+
+void GiDisplayList::drawPath(bool stroke, bool fill)
+{
+    *addCmd(kDrawPath, 1) = flags(stroke, fill);
+}
+
+void GiDisplayList::saveClip()
+{
+    *addCmd(kClipPath, 1) = kSave;
+}
+
+void GiDisplayList::restoreClip()
+{
+    *addCmd(kClipPath, 1) = kRestore;
+}
+
+bool GiDisplayList::clipRect(float x, float y, float w, float h)
+{
+    int* p = addCmd(kClipRect, 4);
+    addPoint(p, x, y);
+    addVector(p + 2, w, h);
+    addExtent(p);
+    return true;
+}
+
+bool GiDisplayList::clipPath()
+{
+    *addCmd(kClipPath, 1) = kClip;
+    return true;
+}
+
+bool GiDisplayList::drawHandle(float x, float y, int type, float angle)
+{
+    int* p = addCmd(kDrawHandle, 4);
+    addPoint(p, x, y);
+    p[2] = type;
+    p[3] = f2i(angle);
+    addExtent(p);
+    return true;
+}
+
+bool GiDisplayList::drawBitmap(const char* name, float xc, float yc,
+                               float w, float h, float angle)
+{
+    int* p = addString(kDrawBitmap, 6, name);
+    addPoint(p, xc, yc);
+    addVector(p + 2, w, h);
+    p[4] = f2i(angle);
+    addExtent(p);
+    return true;
+}
+
+float GiDisplayList::drawTextAt(const char* text, float x, float y, float h, int align, float angle)
+{
+    return drawTextAt((GiTextWidthCallback*)0, text, x, y, h, align, angle);
+}
+
+float GiDisplayList::drawTextAt(GiTextWidthCallback* c, const char* text,
+                                float x, float y, float h, int align, float angle)
+{
+    int* p = addString(kDrawText, 8, text);
+    addPoint(p, x, y);
+    addVector(p + 2, h, h);
+    p[4] = align;
+    p[5] = f2i(angle);
+    p[6] = -1;
+    if (c) {
+        c->addRefTextWidth();
+        p[6] = (int)_callbacks.size();
+        _callbacks.push_back(c);
+    }
+    addExtent(p);
+    return h;
+}
+
+bool GiDisplayList::setData(const int* data, int size)
+{
+    std::vector<int> buf(data, data + (data && size > 0 ? size : 0));
+    int count = 0;
+
+    for (int i = 0; i < (int)buf.size(); count++) {
+        int type = tagType(buf[i]);
+        int n = tagSize(buf[i]);
+        int fixed = fixedSize(type);
+
+        if (fixed < 0 || n > (int)buf.size() - i - 1) {
+            return false;
+        }
+        if (type == kDrawBitmap || type == kDrawText) {
+            int len = n > fixed ? buf[i + fixed] : -1;
+            if (len < 0 || n != fixed + strWords(len)) {
+                return false;
+            }
+            ((char*)&buf[i + 1 + fixed])[len] = 0;
+            if (type == kDrawText) {
+                buf[i + 7] = -1;                // 文字宽度回调对象不保存
+            }
+        } else if (n != fixed) {
+            return false;
+        }
+        i += 1 + n;
+    }
+
+    clear();
+    _data.swap(buf);
+    _count = count;
+    for (int i = 0; i < (int)_data.size(); i += 1 + tagSize(_data[i])) {
+        addExtent(&_data[i + 1]);
+    }
+
+    return true;
+}
+
+bool GiDisplayList::replay(GiCanvas* canvas, const Matrix2d* mat) const
+{
+    const int* p = getData();
+    const int* end = p + _data.size();
+    bool candraw = true;
+    Point2d pts[3];
+    Vector2d vec;
+
+    for (; p < end; p += tagSize(p[-1])) {
+        int type = tagType(*p++);
+
+        if (type == kClipPath) {
+            switch (*p) {
+                case kClip:
+                    candraw = canvas->clipPath();
+                    break;
+                case kSave:
+                    canvas->saveClip();
+                    candraw = true;
+                    break;
+                case kRestore:
+                    canvas->restoreClip();
+                    candraw = true;
+                    break;
+            }
+            continue;
+        }
+        if (!candraw) {
+            continue;
+        }
+
+        int n = 0;      // 要变换的点数
+
+        switch (type) {
+            case kClearRect: case kDrawRect: case kDrawEllipse: case kClipRect:
+            case kDrawBitmap: case kDrawText:
+                pts[0].set(i2f(p[0]), i2f(p[1]));
+                vec.set(i2f(p[2]), i2f(p[3]));
+                if (mat) {
+                    pts[0] *= *mat;
+                    vec *= *mat;
+                }
+                break;
+            case kBezierTo:
+                pts[2].set(i2f(p[4]), i2f(p[5]));
+                n++;
+            case kDrawLine: case kQuadTo:
+                pts[1].set(i2f(p[2]), i2f(p[3]));
+                n++;
+            case kMoveTo: case kLineTo: case kDrawHandle:
+                pts[0].set(i2f(p[0]), i2f(p[1]));
+                n++;
+                for (int i = 0; mat && i < n; i++) {
+                    pts[i] *= *mat;
+                }
+                break;
+        }
+
+        switch (type) {
+            case kSetPen:
+                canvas->setPen(p[0], i2f(p[1]), p[2], i2f(p[3]), i2f(p[4]));
+                break;
+            case kSetBrush:
+                canvas->setBrush(p[0], p[1]);
+                break;
+            case kClearRect:
+                canvas->clearRect(pts[0].x, pts[0].y, vec.x, vec.y);
+                break;
+            case kDrawRect:
+                canvas->drawRect(pts[0].x, pts[0].y, vec.x, vec.y, !!(p[4] & kStroke), !!(p[4] & kFill));
+                break;
+            case kDrawLine:
+                canvas->drawLine(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+                break;
+            case kDrawEllipse:
+                canvas->drawEllipse(pts[0].x, pts[0].y, vec.x, vec.y, !!(p[4] & kStroke), !!(p[4] & kFill));
+                break;
+            case kBeginPath:
+                canvas->beginPath();
+                break;
+            case kMoveTo:
+                canvas->moveTo(pts[0].x, pts[0].y);
+                break;
+            case kLineTo:
+                canvas->lineTo(pts[0].x, pts[0].y);
+                break;
+            case kBezierTo:
+                canvas->bezierTo(pts[0].x, pts[0].y, pts[1].x, pts[1].y, pts[2].x, pts[2].y);
+                break;
+            case kQuadTo:
+                canvas->quadTo(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+                break;
+            case kClosePath:
+                canvas->closePath();
+                break;
+            case kDrawPath:
+                canvas->drawPath(!!(*p & kStroke), !!(*p & kFill));
+                break;
+            case kClipRect:
+                canvas->clipRect(pts[0].x, pts[0].y, vec.x, vec.y);
+                break;
+            case kDrawHandle:
+                canvas->drawHandle(pts[0].x, pts[0].y, p[2], i2f(p[3]));
+                break;
+            case kDrawBitmap:
+                canvas->drawBitmap((const char*)(p + 6), pts[0].x, pts[0].y, vec.x, vec.y, i2f(p[4]));
+                break;
+            case kDrawText: {
+                float w = canvas->drawTextAt((const char*)(p + 8), pts[0].x, pts[0].y,
+                                             vec.x, p[4], i2f(p[5]));
+                GiTextWidthCallback* c = p[6] >= 0 && p[6] < (int)_callbacks.size()
+                    ? _callbacks[p[6]] : (GiTextWidthCallback*)0;
+                if (c) c->drawTextEnded(c, w);
+                break;
+            }
+        }
+    }
+
+    return !_data.empty();
+}
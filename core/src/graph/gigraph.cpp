@@ -39,6 +39,8 @@ void GiGraphics::copy(const GiGraphics& src)
         m_impl->bkcolor = src.m_impl->bkcolor;
         m_impl->maxPenWidth = src.m_impl->maxPenWidth;
         m_impl->drawColors = src.m_impl->drawColors;
+        m_impl->batching = src.m_impl->batching;
+        m_impl->shapeCache = src.m_impl->shapeCache;
         m_impl->xform->copy(src.xf());
     }
 }
@@ -60,6 +62,34 @@ bool GiGraphics::setPhaseEnabled(bool enabled)
     return old;
 }
 
+bool GiGraphics::setBatching(bool enabled)
+{
+    bool old = m_impl->batching;
+    if (m_impl->canvas) {
+        m_impl->flushBatch();
+    }
+    m_impl->batching = enabled;
+    m_impl->resetSent();
+    return old;
+}
+
+bool GiGraphics::isBatching() const
+{
+    return m_impl->batching;
+}
+
+GiShapeCache* GiGraphics::setShapeCache(GiShapeCache* cache)
+{
+    GiShapeCache* old = m_impl->shapeCache;
+    m_impl->shapeCache = cache;
+    return old;
+}
+
+GiShapeCache* GiGraphics::getShapeCache() const
+{
+    return m_impl->shapeCache;
+}
+
 bool GiGraphics::beginPaint(GiCanvas* canvas, const RECT_2D& clipBox)
 {
     if (!canvas || m_impl->canvas || isStopping()) {
@@ -69,6 +99,9 @@ bool GiGraphics::beginPaint(GiCanvas* canvas, const RECT_2D& clipBox)
     m_impl->canvas = canvas;
     m_impl->ctxused = 0;
     m_impl->stopping = 0;
+    m_impl->batchPath.clear();
+    m_impl->target = (GiPathBuffer*)0;
+    m_impl->resetSent();
     
     float phase = fabsf(m_impl->phase);
     m_impl->phase = (phase < 1e4f ? phase + 0.5f : 0.5f) * (m_impl->phase > 0 ? 1.f : -1.f);
@@ -95,6 +128,9 @@ bool GiGraphics::beginPaint(GiCanvas* canvas, const RECT_2D& clipBox)
 
 void GiGraphics::endPaint()
 {
+    if (m_impl->canvas) {
+        m_impl->flushBatch();
+    }
     m_impl->canvas = (GiCanvas *)0;
 }
 
@@ -123,6 +159,10 @@ void GiGraphics::stopDrawing(bool stopped)
 
 GiCanvas* GiGraphics::getCanvas()
 {
+    if (m_impl->canvas) {               // 调用者可能直接在画布上绘图或改变画笔
+        m_impl->flushBatch();
+        m_impl->resetSent();
+    }
     return m_impl->canvas;
 }
 
@@ -157,6 +197,8 @@ bool GiGraphics::setClipBox(const RECT_2D& rc)
             m_impl->rectDraw.inflate(GiGraphicsImpl::CLIP_INFLATE);
             m_impl->rectDrawM = m_impl->rectDraw * xf().displayToModel();
             m_impl->rectDrawW = m_impl->rectDrawM * xf().modelToWorld();
+            m_impl->flushBatch();
+            m_impl->resetSent();
             SafeCall(m_impl->canvas, clipRect(m_impl->clipBox.left, m_impl->clipBox.top,
                                               m_impl->clipBox.width(),
                                               m_impl->clipBox.height()));
@@ -182,6 +224,8 @@ bool GiGraphics::setClipWorld(const Box2d& rectWorld)
                 m_impl->rectDraw.inflate(GiGraphicsImpl::CLIP_INFLATE);
                 m_impl->rectDrawM = m_impl->rectDraw * xf().displayToModel();
                 m_impl->rectDrawW = m_impl->rectDrawM * xf().modelToWorld();
+                m_impl->flushBatch();
+                m_impl->resetSent();
                 SafeCall(m_impl->canvas, clipRect(m_impl->clipBox.left, m_impl->clipBox.top,
                                                   m_impl->clipBox.width(), m_impl->clipBox.height()));
             }
@@ -348,107 +392,142 @@ public:
     }
 };
 
-static bool DrawEdge(int count, int &i, Point2d* pts, Point2d &ptLast, 
-                     const PolylineAux& aux, const Box2d& rectDraw)
+//! 分段流式绘制辅助类，各段的点转换、去重和剪裁后接到画布的同一路径中，以保持虚线连续
+/*! 每段最多 kChunk+1 个点，在本对象的缓冲区中转换，任意点数都不需要分配内存
+ */
+class PathStream
 {
-    int n, si, ei;
-    Point2d pt1, pt2;
+public:
+    enum { kChunk = 255 };          //!< 每段的点数，为3的倍数以免拆开贝塞尔曲线段
 
-    pt1 = ptLast;
-    ptLast = pts[i+1];
-    pt2 = ptLast;
-    if (!mglnrel::clipLine(pt1, pt2, rectDraw))    // 该边不可见
-        return false;
+    PathStream(GiGraphicsImpl* impl, const Matrix2d& matD, bool clip, bool closed)
+        : m_impl(impl), m_mat(matD), m_clip(clip), m_closed(closed)
+        , m_started(false), m_inRun(false), m_hasPrev(false) {}
+
+    //! 返回缓冲区，可先填入模型坐标点再调用 transform()
+    Point2d* buffer() { return m_buf; }
+
+    //! 将缓冲区中的前n个点转换到像素坐标
+    Point2d* transform(int n) {
+        m_mat.transformPoints(n, m_buf);
+        return m_buf;
+    }
+
+    //! 将n个点转换到缓冲区中的像素坐标，n 不超过 kChunk+1
+    Point2d* load(const Point2d* pts, int n) {
+        m_mat.transformPoints(n, pts, m_buf);
+        return m_buf;
+    }
 
-    si = i;                                 // 收集第一条可见边
-    ei = i+1;
-    pts[i] = pt1;                           // 收集起点
-    if (pt2 != ptLast) {                    // 如果该边终点不可见
-        pts[i+1] = pt2;                     // 收集交点
-    } else {                                // 否则继续收集后续点
-        i++;                                // 下一边的起点可见，跳过
-        for (; i < count - 1; i++) {        // 依次处理后续可见边
-            pt1 = ptLast;
-            ptLast = pts[i+1];
-            pt2 = ptLast;
-            if (!mglnrel::clipLine(pt1, pt2, rectDraw)) // 该边不可见
-                break;
-            ei++;
-            if (pt2 != ptLast) {            // 该边起点可见，终点不可见
-                pts[i+1] = pt2;             // 收集交点
-                break;
+    //! 添加折线的后续顶点，跳过与上一点相距2像素内的点，剪裁时只输出可见的各段
+    void addPoints(const Point2d* pxs, int n) {
+        for (int i = 0; i < n; i++) {
+            if (pxs[i].isDegenerate()) {            // 在无效点处断开
+                m_hasPrev = m_inRun = false;
+            } else if (!m_clip) {
+                addVisible(pxs[i]);
+            } else if (!m_hasPrev) {
+                m_prev = pxs[i];
+                m_hasPrev = true;
+            } else {
+                Point2d pt1(m_prev), pt2(pxs[i]);
+                
+                m_prev = pxs[i];
+                if (!mglnrel::clipLine(pt1, pt2, m_impl->rectDraw)) {  // 该边不可见
+                    m_inRun = false;
+                } else {
+                    if (!m_inRun) {                 // 收集可见边的起点
+                        moveTo(pt1);
+                    }
+                    addVisible(pt2);
+                    m_inRun = (pt2 == pxs[i]);      // 终点被剪掉时，下一可见边另起子路径
+                }
             }
         }
     }
 
-    // 显示找到的多条线段
-    n = ei - si + 1;
-    if (n > 1) {
-        vector<Point2d> pxpoints;
-        pxpoints.resize(n);
-        Point2d* pxs = &pxpoints.front();
-        n = 0;
-        for (int j = si; j <= ei; j++) {
-            // 记下第一个点，其他点如果和上一点不重合则记下，否则跳过
-            if (j == si || fabsf(pt1.x - pts[j].x) > 2
-                || fabsf(pt1.y - pts[j].y) > 2)
-            {
-                pt1 = pts[j];
-                pxs[n++] = pt1;
+    //! 添加贝塞尔曲线段，pxs[0]为起点(即上一段的终点)，其后每三个点为一段，剪裁时跳过不可见的曲线段
+    void addBeziers(const Point2d* pxs, int n) {
+        for (int i = 0; i + 3 < n; i += 3) {
+            const Point2d* p = pxs + i;
+            if (p[0].isDegenerate() || p[1].isDegenerate()
+                || p[2].isDegenerate() || p[3].isDegenerate()
+                || (m_clip && !m_impl->rectDraw.isIntersect(Box2d(4, p)))) {
+                m_inRun = false;
+                continue;
+            }
+            if (!m_inRun) {
+                moveTo(p[0]);
             }
+            m_impl->bezierTo(p[1].x, p[1].y, p[2].x, p[2].y, p[3].x, p[3].y);
         }
+    }
 
-        return aux.draw(pxs, n);
+    //! 提交路径，返回是否有输出
+    bool end() {
+        if (m_started) {
+            if (m_closed) {
+                m_impl->closePath();
+            }
+            m_impl->endPath(true, m_closed);
+        }
+        return m_started;
     }
 
-    return false;
-}
+private:
+    void moveTo(const Point2d& pt) {
+        if (!m_started) {
+            m_started = true;
+            m_impl->beginPath(!m_closed);       // 闭合时用当前画刷填充，不合并
+        }
+        m_impl->moveTo(pt.x, pt.y);
+        m_last = pt;
+        m_inRun = true;
+    }
+
+    void addVisible(const Point2d& pt) {
+        if (!m_inRun) {
+            moveTo(pt);
+        } else if (fabsf(m_last.x - pt.x) > 2 || fabsf(m_last.y - pt.y) > 2) {
+            m_impl->lineTo(pt.x, pt.y);
+            m_last = pt;
+        }
+    }
+
+    GiGraphicsImpl* m_impl;
+    const Matrix2d  m_mat;
+    bool        m_clip;             // 是否需要剪裁
+    bool        m_closed;
+    bool        m_started;          // 是否已开始路径
+    bool        m_inRun;            // 是否正在输出一个子路径
+    bool        m_hasPrev;          // 剪裁时是否有上一个顶点
+    Point2d     m_prev;             // 剪裁时的上一个顶点
+    Point2d     m_last;             // 最近输出的点
+    Point2d     m_buf[kChunk + 1];  // 当前段的像素坐标点
+};
 
 bool GiGraphics::drawLines(const GiContext* ctx, int count, 
                            const Point2d* points, bool modelUnit)
 {
     if (count < 2 || !points || isStopping())
         return false;
-    if (count > 0x2000)
-        count = 0x2000;
-
-    int i;
-    Point2d pt1, pt2, ptLast;
-    vector<Point2d> pxpoints;
-    vector<Point2d> pointBuf;
-    bool ret = false;
-    Matrix2d matD(S2D(xf(), modelUnit));
 
     const Box2d extent (count, points);                     // 模型坐标范围
     if (!DRAW_RECT(m_impl, modelUnit).isIntersect(extent))  // 全部在显示区域外
         return false;
+    if (!m_impl->canvas || !setPen(ctx))
+        return false;
 
-    if (DRAW_MAXR(m_impl, modelUnit).contains(extent)) {    // 全部在显示区域内
-        pxpoints.resize(count);
-        Point2d* pxs = &pxpoints.front();
-        int n = 0;
-        for (i = 0; i < count; i++) {
-            pt2 = points[i] * matD;
-            if (i == 0 || fabsf(pt1.x - pt2.x) > 2 || fabsf(pt1.y - pt2.y) > 2) {
-                pt1 = pt2;
-                pxs[n++] = pt2;
-            }
-        }
-        ret = rawLines(ctx, pxs, n);
-    } else {                                        // 部分在显示区域内
-        pointBuf.resize(count);
-        for (i = 0; i < count; i++)                 // 转换到像素坐标
-            pointBuf[i] = points[i] * matD;
-        Point2d* pts = &pointBuf.front();
-
-        ptLast = pts[0];
-        PolylineAux aux(this, ctx);
-        for (i = 0; i < count - 1; i++) {
-            ret = DrawEdge(count, i, pts, ptLast, aux, m_impl->rectDraw) || ret;
-        }
+    // 全部在显示区域内时不用剪裁，否则只显示可见的各段
+    PathStream stream(m_impl, S2D(xf(), modelUnit),
+                      !DRAW_MAXR(m_impl, modelUnit).contains(extent), false);
+
+    for (int i = 0; i < count && !isStopping(); i += PathStream::kChunk) {
+        int n = mgMin(count - i, (int)PathStream::kChunk);
+        stream.addPoints(stream.load(points + i, n), n);
     }
 
-    return ret;
+    return stream.end();
 }
 
 bool GiGraphics::drawBeziers(const GiContext* ctx, int count, 
@@ -456,56 +535,23 @@ bool GiGraphics::drawBeziers(const GiContext* ctx, int count,
 {
     if (count < 4 || !points || isStopping())
         return false;
-    if (count > 0x2000)
-        count = 0x2000;
     count = 1 + (count - 1) / 3 * 3;
 
-    bool ret = false;
-    vector<Point2d> pxpoints;
-    vector<Point2d> pointBuf;
-    int i, j, n, si, ei;
-    Point2d * pxs;
-    Matrix2d matD(S2D(xf(), modelUnit));
-
     const Box2d extent (count, points);                 // 模型坐标范围
     if (!DRAW_RECT(m_impl, modelUnit).isIntersect(extent))  // 全部在显示区域外
         return false;
-    
-    if (closed) {
-        pxpoints.resize(count);
-        pxs = &pxpoints.front();
-        for (i = 0; i < count; i++)
-            pxs[i] = points[i] * matD;
-        ret = rawBeziers(ctx, pxs, count, closed);
-    }
-    else if (DRAW_MAXR(m_impl, modelUnit).contains(extent)) {   // 全部在显示区域内
-        pxpoints.resize(count);
-        pxs = &pxpoints.front();
-        for (i = 0; i < count; i++)
-            pxs[i] = points[i] * matD;
-        ret = rawBeziers(ctx, pxs, count);
-    } else {
-        pointBuf.resize(count);
-        for (i = 0; i < count; i++)                 // 转换到像素坐标
-            pointBuf[i] = points[i] * matD;
-        Point2d* pts = &pointBuf.front();
-
-        for (i = 0; i + 3 < count;) {
-            for (; i + 3 < count && !m_impl->rectDraw.isIntersect(Box2d(4, &pts[i])); i += 3) ;
-            si = ei = i;
-            for (; i + 3 < count && m_impl->rectDraw.isIntersect(Box2d(4, &pts[i])); i += 3)
-                ei = i + 3;
-            if (ei > si) {
-                n = ei - si + 1;
-                pxpoints.resize(n);
-                pxs = &pxpoints.front();
-                for (j=0; j<n; j++)
-                    pxs[j] = pts[si + j];
-                ret = rawBeziers(ctx, pxs, n);
-            }
-        }
+    if (!m_impl->canvas || !setPen(ctx))
+        return false;
+
+    PathStream stream(m_impl, S2D(xf(), modelUnit),
+                      !closed && !DRAW_MAXR(m_impl, modelUnit).contains(extent), closed);
+
+    for (int i = 0; i + 1 < count && !isStopping(); i += PathStream::kChunk) {
+        int n = mgMin(count - i, (int)PathStream::kChunk + 1);  // 与下一段共用端点
+        stream.addBeziers(stream.load(points + i, n), n);
     }
-    return ret;
+
+    return stream.end();
 }
 
 bool GiGraphics::drawBeziers(const GiContext* ctx, int count,
@@ -514,68 +560,31 @@ bool GiGraphics::drawBeziers(const GiContext* ctx, int count,
 {
     if (count < 2 || !knot || !knotvs || isStopping())
         return false;
-    if (count > 0x1000)
-        count = 0x1000;
-    
-    bool ret = false;
-    vector<Point2d> pxpoints;
-    vector<Point2d> pointBuf;
-    int i, j, n, si, ei;
-    Point2d * pxs;
-    Matrix2d matD(S2D(xf(), modelUnit));
     
     const Box2d extent (count, knot);                       // 模型坐标范围
     if (!DRAW_RECT(m_impl, modelUnit).isIntersect(extent))  // 全部在显示区域外
         return false;
+    if (!m_impl->canvas || !setPen(ctx))
+        return false;
     
-    pointBuf.resize(1 + (count - 1) * 3);
-    pxs = &pointBuf.front();
+    PathStream stream(m_impl, S2D(xf(), modelUnit),
+                      !closed && !DRAW_MAXR(m_impl, modelUnit).contains(extent), closed);
+    const int segs = PathStream::kChunk / 3;                // 每段的曲线段数
     
-    if (closed) {
-        pxs[0] = knot[0] * matD;
-        for (i = 0, j = 1; i + 1 < count; i++) {
-            pxs[j++] = (knot[i] + knotvs[i]) * matD;
-            pxs[j++] = (knot[i+1] - knotvs[i+1]) * matD;
-            pxs[j++] = knot[i+1] * matD;
-        }
-        ret = rawBeziers(ctx, pxs, j, closed);
-    }
-    else if (DRAW_MAXR(m_impl, modelUnit).contains(extent)) {   // 全部在显示区域内
-        pxs[0] = knot[0] * matD;
-        for (i = 0, j = 1; i + 1 < count; i++) {
-            pxs[j++] = (knot[i] + knotvs[i]) * matD;
-            pxs[j++] = (knot[i+1] - knotvs[i+1]) * matD;
-            pxs[j++] = knot[i+1] * matD;
-        }
-        ret = rawBeziers(ctx, pxs, j);
-    } else {
-        pxs[0] = knot[0] * matD;
-        for (i = 0, j = 1; i + 1 < count; i++) {
-            pxs[j++] = (knot[i] + knotvs[i]) * matD;
-            pxs[j++] = (knot[i+1] - knotvs[i+1]) * matD;
-            pxs[j++] = knot[i+1] * matD;
-        }
-        
-        Point2d* pts = pxs;
+    for (int i = 0; i + 1 < count && !isStopping(); i += segs) {
+        int n = mgMin(count - 1 - i, segs);
+        Point2d* pxs = stream.buffer();
         
-        count = 1 + (count - 1) * 3;
-        for (i = 0; i + 3 < count;) {
-            for (; i + 3 < count && !m_impl->rectDraw.isIntersect(Box2d(4, &pts[i])); i += 3) ;
-            si = ei = i;
-            for (; i + 3 < count && m_impl->rectDraw.isIntersect(Box2d(4, &pts[i])); i += 3)
-                ei = i + 3;
-            if (ei > si) {
-                n = ei - si + 1;
-                pxpoints.resize(n);
-                pxs = &pxpoints.front();
-                for (j=0; j<n; j++)
-                    pxs[j] = pts[si + j];
-                ret = rawBeziers(ctx, pxs, n);
-            }
+        pxs[0] = knot[i];
+        for (int k = i, j = 1; k < i + n; k++) {
+            pxs[j++] = knot[k] + knotvs[k];
+            pxs[j++] = knot[k+1] - knotvs[k+1];
+            pxs[j++] = knot[k+1];
         }
+        stream.addBeziers(stream.transform(1 + n * 3), 1 + n * 3);
     }
     
-    return ret;
+    return stream.end();
 }
 
 bool GiGraphics::drawArc(const GiContext* ctx,
@@ -677,21 +686,21 @@ bool GiGraphics::_drawPolygon(const GiContext* ctx, int count, const Point2d* po
         return false;
 
     vector<Point2d> pxpoints;
-    Point2d pt1, pt2;
-    Matrix2d matD(S2D(xf(), modelUnit));
 
-    pxpoints.resize(count);
+    if (m2d) {
+        pxpoints.resize(count);
+        S2D(xf(), modelUnit).transformPoints(count, points, &pxpoints.front());
+    } else {
+        pxpoints.assign(points, points + count);
+    }
+
     Point2d *pxs = &pxpoints.front();
-    int n = 0;
-    for (int i = 0; i < count; i++) {
-        pt2 = points[i];
-        if (m2d)
-            pt2 *= matD;
-        if (i == 0 || count <= 4
-            || fabsf(pt1.x - pt2.x) > 2
-            || fabsf(pt1.y - pt2.y) > 2) {
-            pt1 = pt2;
-            pxs[n++] = pt1;
+    int n = 1;
+    for (int i = 1; i < count; i++) {       // 就地去掉与上一点相距2像素内的点
+        if (count <= 4
+            || fabsf(pxs[n-1].x - pxs[i].x) > 2
+            || fabsf(pxs[n-1].y - pxs[i].y) > 2) {
+            pxs[n++] = pxs[i];
         }
     }
 
@@ -1157,13 +1166,16 @@ bool GiGraphics::setPen(const GiContext* ctx)
     ctx = &(m_impl->ctx);
     if (m_impl->canvas && changed) {
         m_impl->ctxused &= 1;
-        float w = calcPenWidth(ctx->getLineWidth(), ctx->isAutoScale());
+        float w = calcPenWidth(ctx->getLineWidth(), ctx->isAutoScale()) + ctx->getExtraWidth();
         float orgw = ctx->getLineWidth();
         orgw = (orgw < -0.1f && ctx->isAutoScale()) ? orgw - 1e4f : orgw;
-        m_impl->canvas->setPen(calcPenColor(ctx->getLineColor()).getARGB(),
-                               w + ctx->getExtraWidth(),
-                               ctx->getLineStyleEx(),
-                               mgMax(m_impl->phase, 0.f), orgw);
+        int argb = calcPenColor(ctx->getLineColor()).getARGB();
+        float phase = mgMax(m_impl->phase, 0.f);
+        
+        if (!m_impl->batching || m_impl->penChanged(argb, w, ctx->getLineStyleEx(), phase, orgw)) {
+            m_impl->flushBatch();       // 合并的路径用原来的画笔
+            m_impl->canvas->setPen(argb, w, ctx->getLineStyleEx(), phase, orgw);
+        }
     }
     
     return !ctx->isNullLine();
@@ -1183,7 +1195,11 @@ bool GiGraphics::setBrush(const GiContext* ctx)
     ctx = &(m_impl->ctx);
     if (m_impl->canvas && changed) {
         m_impl->ctxused &= 2;
-        m_impl->canvas->setBrush(calcPenColor(ctx->getFillColor()).getARGB(), 0);
+        int argb = calcPenColor(ctx->getFillColor()).getARGB();
+        if (!m_impl->batching || m_impl->brushChanged(argb)) {
+            m_impl->flushBatch();
+            m_impl->canvas->setBrush(argb, 0);
+        }
     }
     
     return ctx->hasFillColor();
@@ -1193,7 +1209,12 @@ bool GiGraphics::rawLine(const GiContext* ctx, float x1, float y1, float x2, flo
 {
     if (m_impl->canvas && !m_impl->stopping && setPen(ctx)
         && !isnan(x1) && !isnan(y1) && !isnan(x2) && !isnan(y2)) {
-        m_impl->canvas->drawLine(x1, y1, x2, y2);
+        if (m_impl->batching) {
+            m_impl->batchPath.moveTo(x1, y1);
+            m_impl->batchPath.lineTo(x2, y2);
+        } else {
+            m_impl->canvas->drawLine(x1, y1, x2, y2);
+        }
         return true;
     }
     return false;
@@ -1202,16 +1223,16 @@ bool GiGraphics::rawLine(const GiContext* ctx, float x1, float y1, float x2, flo
 bool GiGraphics::rawLines(const GiContext* ctx, const Point2d* pxs, int count)
 {
     if (m_impl->canvas && setPen(ctx) && pxs && count > 0) {
-        m_impl->canvas->beginPath();
+        m_impl->beginPath(true);
         if (pxs[0].isDegenerate())
             return false;
-        m_impl->canvas->moveTo(pxs[0].x, pxs[0].y);
+        m_impl->moveTo(pxs[0].x, pxs[0].y);
         for (int i = 1; i < count && !m_impl->stopping; i++) {
             if (pxs[i].isDegenerate())
                 return false;
-            m_impl->canvas->lineTo(pxs[i].x, pxs[i].y);
+            m_impl->lineTo(pxs[i].x, pxs[i].y);
         }
-        m_impl->canvas->drawPath(true, false);
+        m_impl->endPath(true, false);
         return true;
     }
     return false;
@@ -1220,20 +1241,20 @@ bool GiGraphics::rawLines(const GiContext* ctx, const Point2d* pxs, int count)
 bool GiGraphics::rawBeziers(const GiContext* ctx, const Point2d* pxs, int count, bool closed)
 {
     if (m_impl->canvas && setPen(ctx) && pxs && count > 0) {
-        m_impl->canvas->beginPath();
+        m_impl->beginPath(!closed);             // 闭合时用当前画刷填充，不合并
         if (pxs[0].isDegenerate())
             return false;
-        m_impl->canvas->moveTo(pxs[0].x, pxs[0].y);
+        m_impl->moveTo(pxs[0].x, pxs[0].y);
         for (int i = 1; i + 2 < count && !m_impl->stopping; i += 3) {
             if (pxs[i].isDegenerate() || pxs[i+1].isDegenerate() || pxs[i+2].isDegenerate())
                 return false;
-            m_impl->canvas->bezierTo(pxs[i].x, pxs[i].y, pxs[i+1].x, pxs[i+1].y,
-                                     pxs[i+2].x, pxs[i+2].y);
+            m_impl->bezierTo(pxs[i].x, pxs[i].y, pxs[i+1].x, pxs[i+1].y,
+                             pxs[i+2].x, pxs[i+2].y);
         }
         if (closed) {
-            m_impl->canvas->closePath();
+            m_impl->closePath();
         }
-        m_impl->canvas->drawPath(true, closed);
+        m_impl->endPath(true, closed);
         return true;
     }
     return false;
@@ -1245,17 +1266,17 @@ bool GiGraphics::rawPolygon(const GiContext* ctx, const Point2d* pxs, int count)
     bool useBrush = setBrush(ctx);
     
     if (m_impl->canvas && pxs && count > 0) {
-        m_impl->canvas->beginPath();
+        m_impl->beginPath(usePen && !useBrush);
         if (pxs[0].isDegenerate())
             return false;
-        m_impl->canvas->moveTo(pxs[0].x, pxs[0].y);
+        m_impl->moveTo(pxs[0].x, pxs[0].y);
         for (int i = 1; i < count && !m_impl->stopping; i++) {
             if (pxs[i].isDegenerate())
                 return false;
-            m_impl->canvas->lineTo(pxs[i].x, pxs[i].y);
+            m_impl->lineTo(pxs[i].x, pxs[i].y);
         }
-        m_impl->canvas->closePath();
-        m_impl->canvas->drawPath(usePen, useBrush);
+        m_impl->closePath();
+        m_impl->endPath(usePen, useBrush);
         return true;
     }
     return false;
@@ -1268,6 +1289,9 @@ bool GiGraphics::rawRect(const GiContext* ctx, float x, float y, float w, float
     
     if (m_impl->canvas && !m_impl->stopping
         && !isnan(x) && !isnan(y) && !isnan(w) && !isnan(h)) {
+        if (useBrush) {                     // 只描边时与合并的路径先后无关
+            m_impl->flushBatch();
+        }
         m_impl->canvas->drawRect(x, y, w, h, usePen, useBrush);
         return true;
     }
@@ -1281,6 +1305,9 @@ bool GiGraphics::rawEllipse(const GiContext* ctx, float x, float y, float w, flo
     
     if (m_impl->canvas && !m_impl->stopping
         && !isnan(x) && !isnan(y) && !isnan(w) && !isnan(h)) {
+        if (useBrush) {                     // 只描边时与合并的路径先后无关
+            m_impl->flushBatch();
+        }
         m_impl->canvas->drawEllipse(x, y, w, h, usePen, useBrush);
         return true;
     }
@@ -1289,7 +1316,10 @@ bool GiGraphics::rawEllipse(const GiContext* ctx, float x, float y, float w, flo
 
 bool GiGraphics::rawBeginPath()
 {
-    if (m_impl->canvas) {
+    if (m_impl->canvas && m_impl->batching) {   // 到 rawEndPath() 时再决定是否合并
+        m_impl->shapePath.clear();
+        m_impl->target = &m_impl->shapePath;
+    } else if (m_impl->canvas) {
         m_impl->canvas->beginPath();
     }
     return !!m_impl->canvas;
@@ -1300,6 +1330,18 @@ bool GiGraphics::rawEndPath(const GiContext* ctx, bool fill)
     bool usePen = setPen(ctx);
     bool useBrush = fill && setBrush(ctx);
     
+    if (m_impl->canvas && m_impl->target == &m_impl->shapePath) {
+        m_impl->target = (GiPathBuffer*)0;
+        if (usePen && !useBrush) {
+            m_impl->batchPath.append(m_impl->shapePath);
+        } else {
+            m_impl->flushBatch();
+            m_impl->canvas->beginPath();
+            m_impl->shapePath.output(m_impl->canvas);
+            m_impl->canvas->drawPath(usePen, useBrush);
+        }
+        return true;
+    }
     if (m_impl->canvas) {
         m_impl->canvas->drawPath(usePen, useBrush);
         return true;
@@ -1310,7 +1352,7 @@ bool GiGraphics::rawEndPath(const GiContext* ctx, bool fill)
 bool GiGraphics::rawMoveTo(float x, float y)
 {
     if (m_impl->canvas && !isnan(x) && !isnan(y)) {
-        m_impl->canvas->moveTo(x, y);
+        m_impl->moveTo(x, y);
         return true;
     }
     return false;
@@ -1319,7 +1361,7 @@ bool GiGraphics::rawMoveTo(float x, float y)
 bool GiGraphics::rawLineTo(float x, float y)
 {
     if (m_impl->canvas && !isnan(x) && !isnan(y)) {
-        m_impl->canvas->lineTo(x, y);
+        m_impl->lineTo(x, y);
         return true;
     }
     return false;
@@ -1331,7 +1373,7 @@ bool GiGraphics::rawBezierTo(float c1x, float c1y, float c2x,
     if (m_impl->canvas && !m_impl->stopping
         && !isnan(c1x) && !isnan(c1y) && !isnan(c2x) && !isnan(c2y)
         && !isnan(x) && !isnan(y)) {
-        m_impl->canvas->bezierTo(c1x, c1y, c2x, c2y, x, y);
+        m_impl->bezierTo(c1x, c1y, c2x, c2y, x, y);
         return true;
     }
     return false;
@@ -1341,7 +1383,7 @@ bool GiGraphics::rawQuadTo(float cpx, float cpy, float x, float y)
 {
     if (m_impl->canvas && !m_impl->stopping
         && !isnan(cpx) && !isnan(cpy) && !isnan(x) && !isnan(y)) {
-        m_impl->canvas->quadTo(cpx, cpy, x, y);
+        m_impl->quadTo(cpx, cpy, x, y);
         return true;
     }
     return false;
@@ -1350,7 +1392,7 @@ bool GiGraphics::rawQuadTo(float cpx, float cpy, float x, float y)
 bool GiGraphics::rawClosePath()
 {
     if (m_impl->canvas) {
-        m_impl->canvas->closePath();
+        m_impl->closePath();
     }
     return !!m_impl->canvas;
 }
@@ -1359,6 +1401,7 @@ float GiGraphics::rawText(const char* text, float x, float y, float h, int align
 {
     if (m_impl->canvas && text && !m_impl->stopping
         && !isnan(x) && !isnan(y)) {
+        m_impl->flushBatch();
         return m_impl->canvas->drawTextAt(text, x, y, h, align, 0);
     }
     return 0;
@@ -1369,6 +1412,7 @@ bool GiGraphics::rawImage(const char* name, float xc, float yc,
 {
     if (m_impl->canvas && name && !m_impl->stopping
         && !isnan(xc) && !isnan(yc)) {
+        m_impl->flushBatch();
         return m_impl->canvas->drawBitmap(name, xc, yc, w, h, angle);
     }
     return false;
@@ -1378,6 +1422,7 @@ bool GiGraphics::drawHandle(const Point2d& pnt, int type, float angle, bool mode
 {
     if (m_impl->canvas && type >= 0 && !m_impl->stopping && !pnt.isDegenerate()) {
         Point2d ptd(pnt * S2D(xf(), modelUnit));
+        m_impl->flushBatch();
         return m_impl->canvas->drawHandle(ptd.x, ptd.y, type, angle);
     }
     return false;
@@ -1424,6 +1469,7 @@ float GiGraphics::drawTextAt(GiTextWidthCallback* c, int argb, const char* text,
         ctx.setFillARGB(argb ? argb : 0xFF000000);
         if (setBrush(&ctx)) {
             TextWidthCallback1 *cw = c ? new TextWidthCallback1(c, w2d) : (TextWidthCallback1 *)0;
+            m_impl->flushBatch();
             ret = m_impl->canvas->drawTextAt(cw, text, ptd.x, ptd.y, h, align, angle) / w2d;
         }
     }
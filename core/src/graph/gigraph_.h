@@ -5,6 +5,74 @@
 #include "gigraph.h"
 #include "gicanvas.h"
 #include "gilock.h"
+#include <vector>
+
+//! 暂存的路径命令，合并绘制时提交前按原样输出到画布
+struct GiPathBuffer
+{
+    std::vector<char>       ops;    //!< kMgMoveTo, kMgLineTo, kMgBezierTo, kMgQuadTo 或 kMgCloseFigure
+    std::vector<Point2d>    pts;    //!< 各命令的点，依次有1、1、3、2、0个点
+
+    bool empty() const { return ops.empty(); }
+    void clear() { ops.clear(); pts.clear(); }
+
+    bool isLine() const {
+        return ops.size() == 2 && ops[0] == kMgMoveTo && ops[1] == kMgLineTo;
+    }
+    void moveTo(float x, float y) {
+        ops.push_back(kMgMoveTo);
+        pts.push_back(Point2d(x, y));
+    }
+    void lineTo(float x, float y) {
+        ops.push_back(kMgLineTo);
+        pts.push_back(Point2d(x, y));
+    }
+    void bezierTo(float c1x, float c1y, float c2x, float c2y, float x, float y) {
+        ops.push_back(kMgBezierTo);
+        pts.push_back(Point2d(c1x, c1y));
+        pts.push_back(Point2d(c2x, c2y));
+        pts.push_back(Point2d(x, y));
+    }
+    void quadTo(float cpx, float cpy, float x, float y) {
+        ops.push_back(kMgQuadTo);
+        pts.push_back(Point2d(cpx, cpy));
+        pts.push_back(Point2d(x, y));
+    }
+    void closePath() {
+        ops.push_back(kMgCloseFigure);
+    }
+    void append(const GiPathBuffer& src) {
+        ops.insert(ops.end(), src.ops.begin(), src.ops.end());
+        pts.insert(pts.end(), src.pts.begin(), src.pts.end());
+    }
+
+    void output(GiCanvas* canvas) const {
+        const Point2d* p = pts.empty() ? (const Point2d*)0 : &pts.front();
+        for (size_t i = 0; i < ops.size(); i++) {
+            switch (ops[i]) {
+            case kMgMoveTo:
+                canvas->moveTo(p[0].x, p[0].y);
+                p++;
+                break;
+            case kMgLineTo:
+                canvas->lineTo(p[0].x, p[0].y);
+                p++;
+                break;
+            case kMgBezierTo:
+                canvas->bezierTo(p[0].x, p[0].y, p[1].x, p[1].y, p[2].x, p[2].y);
+                p += 3;
+                break;
+            case kMgQuadTo:
+                canvas->quadTo(p[0].x, p[0].y, p[1].x, p[1].y);
+                p += 2;
+                break;
+            default:
+                canvas->closePath();
+                break;
+            }
+        }
+    }
+};
 
 //! GiGraphics的内部实现类
 class GiGraphicsImpl
@@ -36,6 +104,20 @@ public:
     Box2d       rectDrawMaxM;       //!< 最大剪裁矩形，模型坐标
     Box2d       rectDrawMaxW;       //!< 最大剪裁矩形，世界坐标
 
+    bool        batching;           //!< 是否合并画笔相同的连续图元
+    GiPathBuffer    batchPath;      //!< 待提交的只描边路径，画布上已是其画笔
+    GiPathBuffer    shapePath;      //!< 合并时在 rawBeginPath() 后构造的路径
+    GiPathBuffer*   target;         //!< 路径命令的输出目标，为NULL时直接输出到画布
+    bool        penSent;            //!< 画布是否已有下列画笔
+    bool        brushSent;          //!< 画布是否已有下列画刷
+    int         penArgb;            //!< 最近设置到画布的画笔颜色
+    float       penWidth;           //!< 最近设置到画布的画笔宽度
+    int         penStyle;           //!< 最近设置到画布的线型
+    float       penPhase;           //!< 最近设置到画布的虚线偏移
+    float       penOrgw;            //!< 最近设置到画布的原始线宽
+    int         brushArgb;          //!< 最近设置到画布的画刷颜色
+    GiShapeCache*   shapeCache;     //!< 图形显示列表的缓存对象
+
     GiGraphicsImpl(GiTransform* x, bool needFree)
         : xform(x), needFreeXf(needFree), canvas((GiCanvas*)0)
     {
@@ -47,6 +129,10 @@ public:
         phase = -1;
         maxPenWidth = 100;
         minPenWidth = 1;
+        batching = false;
+        target = (GiPathBuffer*)0;
+        shapeCache = (GiShapeCache*)0;
+        resetSent();
     }
 
     ~GiGraphicsImpl()
@@ -55,6 +141,94 @@ public:
             delete xform;
     }
 
+    //! 画布的画笔和画刷可能已被外部改变，下次需重新设置
+    void resetSent()
+    {
+        penSent = false;
+        brushSent = false;
+    }
+
+    //! 与最近设置到画布的画笔相同时返回 false，否则记下新画笔并返回 true
+    bool penChanged(int argb, float width, int style, float phase, float orgw)
+    {
+        if (penSent && argb == penArgb && width == penWidth && style == penStyle
+            && phase == penPhase && orgw == penOrgw) {
+            return false;
+        }
+        penSent = true;
+        penArgb = argb;
+        penWidth = width;
+        penStyle = style;
+        penPhase = phase;
+        penOrgw = orgw;
+        return true;
+    }
+
+    //! 与最近设置到画布的画刷相同时返回 false，否则记下新画刷并返回 true
+    bool brushChanged(int argb)
+    {
+        if (brushSent && argb == brushArgb) {
+            return false;
+        }
+        brushSent = true;
+        brushArgb = argb;
+        return true;
+    }
+
+    //! 提交合并的描边路径，只有一条线段时用 drawLine
+    void flushBatch()
+    {
+        if (!batchPath.empty()) {
+            if (batchPath.isLine()) {
+                const Point2d* p = &batchPath.pts.front();
+                canvas->drawLine(p[0].x, p[0].y, p[1].x, p[1].y);
+            } else {
+                canvas->beginPath();
+                batchPath.output(canvas);
+                canvas->drawPath(true, false);
+            }
+            batchPath.clear();
+        }
+    }
+
+    //! 开始一个图元的路径，可合并(batch)时加到待提交路径中
+    void beginPath(bool batch)
+    {
+        if (batching && batch) {
+            target = &batchPath;
+        } else {
+            flushBatch();
+            canvas->beginPath();
+            target = (GiPathBuffer*)0;
+        }
+    }
+
+    //! 结束一个图元的路径，已加到待提交路径时留待 flushBatch() 提交
+    void endPath(bool stroke, bool fill)
+    {
+        if (!target) {
+            canvas->drawPath(stroke, fill);
+        }
+        target = (GiPathBuffer*)0;
+    }
+
+    void moveTo(float x, float y) {
+        if (target) target->moveTo(x, y); else canvas->moveTo(x, y);
+    }
+    void lineTo(float x, float y) {
+        if (target) target->lineTo(x, y); else canvas->lineTo(x, y);
+    }
+    void bezierTo(float c1x, float c1y, float c2x, float c2y, float x, float y) {
+        if (target) target->bezierTo(c1x, c1y, c2x, c2y, x, y);
+        else canvas->bezierTo(c1x, c1y, c2x, c2y, x, y);
+    }
+    void quadTo(float cpx, float cpy, float x, float y) {
+        if (target) target->quadTo(cpx, cpy, x, y); else canvas->quadTo(cpx, cpy, x, y);
+    }
+    void closePath() {
+        if (target) target->closePath(); else canvas->closePath();
+    }
+
     void zoomChanged()
     {
         rectDrawM = rectDraw * xform->displayToModel();
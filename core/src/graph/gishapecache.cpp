@@ -0,0 +1,228 @@
+﻿// gishapecache.cpp: 实现图形显示列表的缓存类 GiShapeCache
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#include "gishapecache.h"
+#include "gigraph_.h"
+#include "gidisplaylist.h"
+#include "gilock.h"
+#include <map>
+#include <math.h>
+
+static const float kMarginPixels = 50;      // 记录范围在图形范围外的余量，容纳箭头等
+
+//! 一个图形的显示列表及其记录条件
+struct GiShapeCacheItem {
+    int         sid;
+    long        version;        //!< 图形的改变计数
+    int         mode;
+    GiContext   ctx;
+    Box2d       extent;         //!< 图形范围，模型坐标
+    Box2d       rectM;          //!< 记录时的剪裁矩形，模型坐标
+    float       scale;          //!< 记录时单位像素对应的模型长度
+    bool        gray;
+    bool        drawn;          //!< 图形的绘制结果
+    bool        used;           //!< 上次清理后是否用过
+    GiDisplayList   list;
+};
+
+struct GiShapeCache::Impl {
+    typedef std::map<const void*, GiShapeCacheItem*> Items;
+
+    Items       items;
+    volatile long   busy;       //!< 正在使用时为1，其他绘图对象直接绘制
+    GiShapeCacheItem*   recording;
+    GiCanvas*   canvas;         //!< 记录期间原来的画布
+    Box2d       rectDraw;       //!< 记录期间原来的剪裁矩形
+    Box2d       rectDrawM;
+    Box2d       rectDrawW;
+    float       zoomTol;
+    int         maxBytes;
+    int         bytes;
+    long        hits;
+    long        misses;
+
+    Impl() : busy(0), recording((GiShapeCacheItem*)0), canvas((GiCanvas*)0)
+        , zoomTol(0.05f), maxBytes(32 << 20), bytes(0), hits(0), misses(0) {}
+    ~Impl() { clear(); }
+
+    void clear() {
+        for (Items::iterator it = items.begin(); it != items.end(); ++it) {
+            delete it->second;
+        }
+        items.clear();
+        bytes = 0;
+    }
+
+    //! 删除上次清理后未用过的显示列表，仍超过上限时全部删除
+    void purge() {
+        for (Items::iterator it = items.begin(); it != items.end();) {
+            if (it->second->used) {
+                it->second->used = false;
+                ++it;
+            } else {
+                bytes -= it->second->list.getDataSize() * (int)sizeof(int);
+                delete it->second;
+                items.erase(it++);
+            }
+        }
+        if (bytes > maxBytes) {
+            clear();
+        }
+    }
+
+    bool matched(const GiShapeCacheItem* p, GiGraphics& gs, int sid, long version, int mode,
+                 const GiContext& ctx, const Box2d& extent, float scale, const Box2d& rect) const {
+        return (p && p->sid == sid && p->version == version && p->mode == mode
+                && p->gray == gs.isGrayMode() && p->extent == extent && p->ctx == ctx
+                && fabsf(scale / p->scale - 1.f) <= zoomTol && p->rectM.contains(rect));
+    }
+};
+
+GiShapeCache::GiShapeCache() : _im(new Impl())
+{
+}
+
+GiShapeCache::~GiShapeCache()
+{
+    delete _im;
+}
+
+int GiShapeCache::beginDraw(GiGraphics& gs, const void* key, int sid, long version, int mode,
+                            const GiContext& ctx, const Box2d& extent, bool& drawn)
+{
+    GiGraphicsImpl* g = gs.m_impl;
+
+    if (!g->canvas || extent.isEmpty(Tol::gTol(), false)
+        || !giAtomicCompareAndSwap(&_im->busy, 1, 0)) {
+        return kDirect;
+    }
+
+    const GiTransform& xf = gs.xf();
+    float scale = xf.displayToModel(1.f);
+    Box2d rect(extent);
+
+    rect.inflate(kMarginPixels * scale);
+
+    Box2d visible(rect);                        // 图形当前需要显示的部分
+    visible.intersectWith(g->rectDrawM);
+
+    GiShapeCacheItem*& item = _im->items[key];
+
+    if (_im->matched(item, gs, sid, version, mode, ctx, extent, scale, visible)) {
+        _im->hits++;
+        item->used = true;
+        item->list.replay(gs.getCanvas(), &xf.modelToDisplay());
+        g->resetSent();                         // 画布的画笔和画刷已改变
+        drawn = item->drawn;
+        giAtomicCompareAndSwap(&_im->busy, 0, 1);
+        return kDrawn;
+    }
+
+    _im->misses++;
+    if (!item) {
+        item = new GiShapeCacheItem();
+    } else {
+        _im->bytes -= item->list.getDataSize() * (int)sizeof(int);
+    }
+    item->sid = sid;
+    item->version = version;
+    item->mode = mode;
+    item->ctx = ctx;
+    item->extent = extent;
+    item->scale = scale;
+    item->gray = gs.isGrayMode();
+    item->used = true;
+    item->list.clear();
+    item->list.setMatrix(xf.displayToModel());
+
+    Box2d around(g->rectDrawM);                 // 记录视图周围一屏内的部分，平移时可重放
+    around.inflate(around.width(), around.height());
+    item->rectM = rect.intersectWith(around);
+
+    g->flushBatch();
+    _im->recording = item;
+    _im->canvas = g->canvas;
+    _im->rectDraw = g->rectDraw;
+    _im->rectDrawM = g->rectDrawM;
+    _im->rectDrawW = g->rectDrawW;
+
+    g->canvas = &item->list;                    // 不按可见部分剔除，以便平移后重放
+    g->rectDrawM = item->rectM;
+    g->rectDraw = item->rectM * xf.modelToDisplay();
+    g->rectDrawW = item->rectM * xf.modelToWorld();
+    g->resetSent();
+
+    return kRecording;
+}
+
+void GiShapeCache::endRecord(GiGraphics& gs, bool drawn)
+{
+    GiGraphicsImpl* g = gs.m_impl;
+    GiShapeCacheItem* item = _im->recording;
+
+    if (!item) {
+        return;
+    }
+    g->flushBatch();
+    g->canvas = _im->canvas;
+    g->rectDraw = _im->rectDraw;
+    g->rectDrawM = _im->rectDrawM;
+    g->rectDrawW = _im->rectDrawW;
+    g->resetSent();
+
+    item->drawn = drawn;
+    item->list.replay(g->canvas, &gs.xf().modelToDisplay());
+    g->resetSent();
+
+    _im->recording = (GiShapeCacheItem*)0;
+    _im->canvas = (GiCanvas*)0;
+    _im->bytes += item->list.getDataSize() * (int)sizeof(int);
+    if (_im->bytes > _im->maxBytes) {
+        _im->purge();
+    }
+    giAtomicCompareAndSwap(&_im->busy, 0, 1);
+}
+
+void GiShapeCache::clear()
+{
+    if (giAtomicCompareAndSwap(&_im->busy, 1, 0)) {
+        _im->clear();
+        giAtomicCompareAndSwap(&_im->busy, 0, 1);
+    }
+}
+
+void GiShapeCache::setZoomTolerance(float tol)
+{
+    _im->zoomTol = tol;
+}
+
+void GiShapeCache::setMaxBytes(int bytes)
+{
+    _im->maxBytes = bytes;
+}
+
+int GiShapeCache::getBytes() const
+{
+    return _im->bytes;
+}
+
+int GiShapeCache::getCount() const
+{
+    return (int)_im->items.size();
+}
+
+long GiShapeCache::getHitCount() const
+{
+    return _im->hits;
+}
+
+long GiShapeCache::getMissCount() const
+{
+    return _im->misses;
+}
+
+void GiShapeCache::resetCounters()
+{
+    _im->hits = 0;
+    _im->misses = 0;
+}
@@ -0,0 +1,114 @@
+﻿// githreadpool.cpp: 实现并行执行任务的线程池类 GiThreadPool
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#include "githreadpool.h"
+#include "githread.h"
+#include "gilock.h"
+#include <vector>
+#if defined(GI_PTHREAD)
+#include <unistd.h>
+#endif
+
+struct GiThreadPool::Impl {
+    std::vector<GiThread*> threads;
+    GiSemaphore     started;        //!< 每个工作线程开始一轮任务前等待
+    GiSemaphore     finished;       //!< 每个工作线程完成一轮任务后通知
+    GiMutex         running;        //!< 同时只执行一轮任务
+    Task            task;
+    void*           arg;
+    int             count;
+    volatile long   next;           //!< 下一个待执行的任务序号加1
+    bool            quit;
+
+    Impl() : task((Task)0), arg((void*)0), count(0), next(0), quit(false) {}
+
+    //! 领取并执行任务，直到本轮任务都已领取
+    void work() {
+        long i;
+        while ((i = giAtomicIncrement(&next)) <= count) {
+            task(arg, (int)i - 1);
+        }
+    }
+
+    static void threadProc(void* p) {
+        Impl* im = (Impl*)p;
+        for (;;) {
+            im->started.wait();
+            if (im->quit)
+                break;
+            im->work();
+            im->finished.post();
+        }
+    }
+};
+
+GiThreadPool::GiThreadPool(int threads) : _im(new Impl())
+{
+    if (threads < 1) {
+        threads = getProcessorCount() - 1;
+    }
+    for (int i = 0; i < threads; i++) {
+        GiThread* t = new GiThread();
+        if (!t->start(Impl::threadProc, _im)) {
+            delete t;
+            break;
+        }
+        _im->threads.push_back(t);
+    }
+}
+
+GiThreadPool::~GiThreadPool()
+{
+    _im->quit = true;
+    for (size_t i = 0; i < _im->threads.size(); i++) {
+        _im->started.post();
+    }
+    for (size_t i = 0; i < _im->threads.size(); i++) {
+        delete _im->threads[i];         // 等待线程结束
+    }
+    delete _im;
+}
+
+int GiThreadPool::getThreadCount() const
+{
+    return (int)_im->threads.size();
+}
+
+void GiThreadPool::run(Task task, void* arg, int count)
+{
+    if (!task || count < 1) {
+        return;
+    }
+
+    _im->running.lock();
+    _im->task = task;
+    _im->arg = arg;
+    _im->count = count;
+    _im->next = 0;
+
+    int n = count - 1;                  // 调用线程也执行任务，不必唤醒多余的线程
+    if (n > (int)_im->threads.size()) {
+        n = (int)_im->threads.size();
+    }
+    for (int i = 0; i < n; i++) {
+        _im->started.post();
+    }
+    _im->work();
+    for (int i = 0; i < n; i++) {
+        _im->finished.wait();
+    }
+    _im->running.unlock();
+}
+
+int GiThreadPool::getProcessorCount()
+{
+    int n = 1;
+#if defined(GI_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+    n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#elif defined(GI_HAS_THREAD)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    n = (int)info.dwNumberOfProcessors;
+#endif
+    return n > 0 ? n : 1;
+}
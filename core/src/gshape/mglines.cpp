@@ -3,11 +3,78 @@
 
 #include "mglines.h"
 #include "mgshape_.h"
+#include <vector>
+
+static const int kLodMinPoints = 32;    // 顶点少于此数时不生成LOD
+static const float kLodRatios[] = {     // 各层次的误差与范围对角线长度之比
+    1.f / 1024, 1.f / 256, 1.f / 64, 1.f / 16 };
+
+//! 折线的各层次简化顶点，供 MgBaseLines 内部使用
+struct MgLinesLod {
+    enum { kMaxLevels = sizeof(kLodRatios) / sizeof(kLodRatios[0]) };
+    long        changeCount;            // 生成时图形的改变计数
+    int         levels;                 // 层次数，按误差从小到大
+    float       tols[kMaxLevels];       // 各层次的模型坐标误差
+    int         starts[kMaxLevels + 1]; // 各层次在 points 中的起始序号
+    Point2d*    points;
+    
+    MgLinesLod() : changeCount(0), levels(0), points((Point2d*)0) { starts[0] = 0; }
+    ~MgLinesLod() { delete[] points; }
+    
+    MgLinesLod* clone() const {
+        MgLinesLod* p = new MgLinesLod(*this);
+        p->points = new Point2d[starts[levels]];
+        for (int i = 0; i < starts[levels]; i++)
+            p->points[i] = points[i];
+        return p;
+    }
+};
+
+// 计算各顶点的 Douglas-Peucker 显著度，误差小于显著度时该点保留，不超过 minTol 的子段不再细分
+static void lodSignificance(int count, const Point2d* pts, float* sig, float minTol)
+{
+    std::vector<int> stack;
+    
+    for (int i = 1; i < count - 1; i++)
+        sig[i] = 0;
+    sig[0] = sig[count - 1] = _FLT_MAX;
+    stack.push_back(0);
+    stack.push_back(count - 1);
+    
+    while (!stack.empty()) {
+        int last = stack.back(); stack.pop_back();
+        int first = stack.back(); stack.pop_back();
+        const Vector2d vec(pts[last] - pts[first]);
+        const float len2 = vec.lengthSquare();
+        int index = -1;
+        float maxdist = -1;
+        
+        for (int i = first + 1; i < last; i++) {    // 到弦(线段)的距离
+            Vector2d v(pts[i] - pts[first]);
+            float d = vec.dotProduct(v);
+            float dist = (d <= 0 || len2 < _MGZERO ? v.length()
+                          : d >= len2 ? pts[i].distanceTo(pts[last])
+                          : fabsf(vec.crossProduct(v)) / sqrtf(len2));
+            if (maxdist < dist) {
+                maxdist = dist;
+                index = i;
+            }
+        }
+        if (index > 0 && maxdist > minTol) {    // 子段在父段保留时才会细分，显著度不超过父段的
+            sig[index] = mgMin(maxdist, mgMin(sig[first], sig[last]));
+            stack.push_back(first);
+            stack.push_back(index);
+            stack.push_back(index);
+            stack.push_back(last);
+        }
+    }
+}
 
 // MgBaseLines
 //
 
-MgBaseLines::MgBaseLines() : _points((Point2d*)0), _maxCount(0), _count(0)
+MgBaseLines::MgBaseLines()
+    : _points((Point2d*)0), _maxCount(0), _count(0), _lod((MgLinesLod*)0)
 {
 }
 
@@ -15,6 +82,7 @@ MgBaseLines::~MgBaseLines()
 {
     if (_points)
         delete[] _points;
+    delete _lod;
 }
 
 bool MgBaseLines::_isClosed() const
@@ -37,6 +105,7 @@ void MgBaseLines::_setPoint(int index, const Point2d& pt)
 {
     if (index >= 0 && index < _count) {
         _points[index] = pt;
+        clearLod();
     }
 }
 
@@ -47,6 +116,8 @@ void MgBaseLines::_copy(const MgBaseLines& src)
         _points[i] = src._points[i];
 
     __super::_copy(src);
+    if (src._lod)
+        _lod = src._lod->clone();
 }
 
 bool MgBaseLines::_equals(const MgBaseLines& src) const
@@ -91,15 +162,117 @@ void MgBaseLines::_update()
 void MgBaseLines::_transform(const Matrix2d& mat)
 {
     mat.transformPoints(_count, _points);
+    clearLod();
     __super::_transform(mat);
 }
 
 void MgBaseLines::_clear()
 {
     _count = 0;
+    clearLod();
     __super::_clear();
 }
 
+void MgBaseLines::_clearCachedData()
+{
+    clearLod();
+    __super::_clearCachedData();
+}
+
+void MgBaseLines::resetChangeCount(long count)
+{
+    bool valid = _lod && _lod->changeCount == getChangeCount();
+    
+    __super::resetChangeCount(count);
+    if (valid)
+        _lod->changeCount = count;
+}
+
+void MgBaseLines::clearLod()
+{
+    if (_lod) {
+        delete _lod;
+        _lod = (MgLinesLod*)0;
+    }
+}
+
+float MgBaseLines::lodTolerance() const
+{
+    if (_count < kLodMinPoints || _extent.isEmpty())
+        return 0;
+    return Vector2d(_extent.width(), _extent.height()).length() * kLodRatios[0] / 4;
+}
+
+void MgBaseLines::updateLod(int count, const Point2d* points, float err)
+{
+    clearLod();
+    if (lodTolerance() <= 0 || count < 2 || !points)
+        return;
+    
+    const float diag = Vector2d(_extent.width(), _extent.height()).length();
+    const int minCount = isClosed() ? 3 : 2;
+    int counts[MgLinesLod::kMaxLevels], levels = 0, total = 0;
+    int limit = err > 0 ? count + 1 : count - count / 4;    // 折线的层次要减少足够多的顶点
+    float tols[MgLinesLod::kMaxLevels];
+    float* sig = new float[count];
+    
+    lodSignificance(count, points, sig, diag * kLodRatios[0] - err);
+    for (int k = 0; k < MgLinesLod::kMaxLevels; k++) {
+        float tol = diag * kLodRatios[k] - err;
+        int n = 0;
+        
+        if (tol <= 0)
+            continue;
+        for (int i = 0; i < count; i++) {
+            if (sig[i] > tol)
+                n++;
+        }
+        if (n < minCount)
+            break;
+        if (n < limit) {
+            tols[levels] = tol;
+            counts[levels++] = n;
+            total += n;
+            limit = n;
+        }
+    }
+    
+    if (levels > 0) {
+        _lod = new MgLinesLod();
+        _lod->changeCount = getChangeCount();
+        _lod->levels = levels;
+        _lod->points = new Point2d[total];
+        for (int k = 0; k < levels; k++) {
+            Point2d* pts = _lod->points + _lod->starts[k];
+            
+            _lod->tols[k] = tols[k] + err;
+            _lod->starts[k + 1] = _lod->starts[k] + counts[k];
+            for (int i = 0, j = 0; i < count; i++) {
+                if (sig[i] > tols[k])
+                    pts[j++] = points[i];
+            }
+        }
+    }
+    delete[] sig;
+}
+
+const Point2d* MgBaseLines::getLodPoints(float tol, int& count) const
+{
+    const MgLinesLod* lod = _lod;
+    int level = -1;
+    
+    if (lod && lod->changeCount == getChangeCount()) {
+        while (level + 1 < lod->levels && lod->tols[level + 1] <= tol)
+            level++;
+    }
+    if (level < 0) {
+        count = 0;
+        return (const Point2d*)0;
+    }
+    count = lod->starts[level + 1] - lod->starts[level];
+    return lod->points + lod->starts[level];
+}
+
 Point2d MgBaseLines::endPoint() const
 {
     return _count > 0 ? _points[_count - 1] : Point2d();
@@ -107,6 +280,7 @@ Point2d MgBaseLines::endPoint() const
 
 bool MgBaseLines::resize(int count)
 {
+    clearLod();
     if (_maxCount < count) {
         _maxCount = (count + 32 - 1) / 32 * 32;
 
@@ -157,6 +331,7 @@ bool MgBaseLines::removePoint(int index)
         for (int i = index + 1; i < _count; i++)
             _points[i - 1] = _points[i];
         _count--;
+        clearLod();
         ret = true;
     }
     
@@ -217,6 +392,12 @@ MgLines::~MgLines()
 {
 }
 
+void MgLines::_update()
+{
+    __super::_update();
+    updateLod(_count, _points, 0);
+}
+
 void MgLines::_output(MgPath& path) const
 {
     if (_count > 1) {
@@ -3,9 +3,27 @@
 
 #include "mgsplines.h"
 #include "mgshape_.h"
+#include <vector>
 
 MG_IMPLEMENT_CREATE(MgSplines)
 
+// 将一段三次贝塞尔曲线等分为折线，添加除起点外的各点，返回折线与曲线的最大偏差
+static float flattenBezier(const Point2d* pts, float tol, std::vector<Point2d>& points)
+{
+    float d = mgMax(((pts[0] - pts[1]) + (pts[2] - pts[1])).length(),
+                    ((pts[1] - pts[2]) + (pts[3] - pts[2])).length());
+    int n = mgMax(1, mgMin(64, (int)ceilf(sqrtf(0.75f * d / tol))));
+    Point2d pt;
+    
+    for (int i = 1; i < n; i++) {
+        mgcurv::fitBezier(pts, (float)i / n, pt);
+        points.push_back(pt);
+    }
+    points.push_back(pts[3]);
+    
+    return 0.75f * d / (n * n);
+}
+
 MgSplines::MgSplines() : _knotvs((Vector2d*)0)
 {
 }
@@ -100,6 +118,50 @@ bool MgSplines::_equals(const MgSplines& src) const
     return true;
 }
 
+void MgSplines::_update()
+{
+    __super::_update();
+    
+    float tol = lodTolerance();
+    if (tol <= 0) {
+        clearLod();
+        return;
+    }
+    
+    std::vector<Point2d> points;
+    Point2d bz[4], quad[3];
+    float err = 0;
+    
+    points.reserve(_count * 4);
+    if (_knotvs) {                      // 与 GiGraphics::drawBeziers 的分段相同
+        points.push_back(_points[0]);
+        for (int i = 0; i + 1 < _count; i++) {
+            bz[0] = _points[i];
+            bz[1] = _points[i] + _knotvs[i];
+            bz[2] = _points[i+1] - _knotvs[i+1];
+            bz[3] = _points[i+1];
+            err = mgMax(err, flattenBezier(bz, tol, points));
+        }
+    }
+    else {                              // 与 GiGraphics::drawQuadSplines 的分段相同
+        for (int i = 0; i < (isClosed() ? _count : _count - 2); i++) {
+            if (i == 0) {
+                quad[2] = isClosed() ? (_points[0] + _points[1]) / 2 : _points[0];
+                points.push_back(quad[2]);
+            }
+            quad[0] = quad[2];
+            quad[1] = _points[(i+1) % _count];
+            if (isClosed() || i + 3 < _count)
+                quad[2] = (_points[(i+1) % _count] + _points[(i+2) % _count]) / 2;
+            else
+                quad[2] = _points[i+2];
+            mgcurv::quadBezierToCubic(quad, bz);
+            err = mgMax(err, flattenBezier(bz, tol, points));
+        }
+    }
+    updateLod((int)points.size(), &points.front(), err);
+}
+
 void MgSplines::_transform(const Matrix2d& mat)
 {
     if (_knotvs) {
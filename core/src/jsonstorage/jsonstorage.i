@@ -3,7 +3,9 @@
 %{
 #include <mgstorage.h>
 #include <mgjsonstorage.h>
+#include <mgbinarystorage.h>
 %}
 
 %include <mgstorage.h>
-%include <mgjsonstorage.h>
\ No newline at end of file
+%include <mgjsonstorage.h>
+%include <mgbinarystorage.h>
\ No newline at end of file
@@ -0,0 +1,1294 @@
+﻿// mgbinarystorage.cpp
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#include "mgbinarystorage.h"
+#include "mgjsonstorage.h"
+#include "mgstorage.h"
+#include <vector>
+#include <string>
+#include <float.h>
+#include <math.h>
+#include "mglog.h"
+#include "gilock.h"
+#include "utf8_unchecked.h"
+#include "rapidjson/document.h"
+#include "rapidjson/filestream.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const char kMagic[4] = { 'T', 'V', 'G', 'B' };
+static const int kVersion = 1;
+static const int kHeadSize = 8;         // 标识(4字节)、版本号(1字节)、保留(3字节)
+
+//! 键值项的类型
+enum { kBinNode = 1, kBinBool, kBinInt, kBinUInt, kBinFloat, kBinDouble,
+    kBinString, kBinFloatArray, kBinDoubleArray, kBinIntArray };
+
+static inline bool isLittleEndian()
+{
+    const int one = 1;
+    return *(const char*)&one == 1;
+}
+
+//! 从可能未对齐的小端字节序内容中取出数值
+template <typename T>
+static inline T getValue(const char* p)
+{
+    T v;
+    if (isLittleEndian()) {
+        memcpy(&v, p, sizeof(T));
+    } else {
+        char* d = (char*)&v;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            d[i] = p[sizeof(T) - 1 - i];
+        }
+    }
+    return v;
+}
+
+//! 将数值按小端字节序写到 p 处
+template <typename T>
+static inline void setValue(char* p, T v)
+{
+    if (isLittleEndian()) {
+        memcpy(p, &v, sizeof(T));
+    } else {
+        const char* s = (const char*)&v;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            p[i] = s[sizeof(T) - 1 - i];
+        }
+    }
+}
+
+//! 取出数值数组，类型相同且为小端字节序时整块复制
+template <typename T, typename V>
+struct BinArray {
+    static void get(const char* p, V* values, int n) {
+        for (int i = 0; i < n; i++, p += sizeof(T)) {
+            values[i] = (V)getValue<T>(p);
+        }
+    }
+};
+
+template <typename T>
+struct BinArray<T, T> {
+    static void get(const char* p, T* values, int n) {
+        if (isLittleEndian()) {
+            memcpy(values, p, n * sizeof(T));
+        } else {
+            for (int i = 0; i < n; i++, p += sizeof(T)) {
+                values[i] = getValue<T>(p);
+            }
+        }
+    }
+};
+
+//! 读取变长无符号整数(每字节7位，低位在前)，内容不完整时返回NULL
+static const char* getVarint(const char* p, const char* end, unsigned& v)
+{
+    v = 0;
+    for (int shift = 0; p < end && shift < 32; shift += 7) {
+        unsigned char c = (unsigned char)*p++;
+        v |= (unsigned)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            return p;
+        }
+    }
+    return (const char*)0;
+}
+
+//! 名称拆分为名称表中的前缀和末尾的序号，例如 "shape12" 为 "shape" 和 12
+struct BinKey {
+    const char* name;       //!< 名称前缀，没有零结束符
+    unsigned    len;
+    unsigned    num;        //!< 名称末尾的序号(不以0开头)，0表示没有序号
+};
+
+//! 拆分节点或键值的名称，index 不小于0时名称后加上 index+1，buf 用于存放临时名称
+static void splitKey(const char* name, int index, BinKey& key, char* buf, size_t bufsize)
+{
+    key.name = name ? name : "";
+    key.len = (unsigned)strlen(key.name);
+    key.num = 0;
+
+    if (index >= 0) {
+        if (key.len == 0 || key.name[key.len - 1] < '0' || key.name[key.len - 1] > '9') {
+            key.num = (unsigned)index + 1;
+            return;
+        }
+#if defined(_MSC_VER) && _MSC_VER >= 1400 // VC8
+        sprintf_s(buf, bufsize, "%s%d", key.name, index + 1);
+#else
+        snprintf(buf, bufsize, "%s%d", key.name, index + 1);
+#endif
+        key.name = buf;                 // 名称以数字结尾时按完整名称拆分
+        key.len = (unsigned)strlen(buf);
+    }
+
+    const char* end = key.name + key.len;
+    const char* p = end;
+    unsigned num = 0;
+
+    while (p > key.name && p[-1] >= '0' && p[-1] <= '9') {
+        p--;
+    }
+    if (p == key.name || p == end || *p == '0' || end - p > 10) {
+        return;
+    }
+    for (const char* d = p; d < end; d++) {
+        unsigned n = (unsigned)(*d - '0');
+        if (num > (0xFFFFFFFFu - n) / 10) {
+            return;
+        }
+        num = num * 10 + n;
+    }
+    key.len = (unsigned)(p - key.name);
+    key.num = num;
+}
+
+//! 名称的散列值(FNV-1a)
+static inline unsigned hashName(const char* name, size_t len)
+{
+    unsigned hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+//! 写入变长无符号整数
+static void putVarint(std::vector<char>& buf, unsigned v)
+{
+    while (v >= 0x80) {
+        buf.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    buf.push_back((char)v);
+}
+
+//! 一个键值项在内容中的位置
+struct BinItem {
+    int         type;
+    unsigned    nameid;     //!< 名称前缀在名称表中的序号
+    unsigned    num;        //!< 名称末尾的序号，0表示没有序号
+    unsigned    count;      //!< 节点内容的字节数，字符串的字符数或数组的元素个数
+    const char* value;      //!< 值的内容
+    const char* end;        //!< 本项结束处，即下一项开始处
+};
+
+//! 解析 p 处的一项，内容无效时返回false
+static bool parseItem(const char* p, const char* end, BinItem& item)
+{
+    unsigned elemsize = 1;
+
+    if (p >= end) {
+        return false;
+    }
+    item.type = (unsigned char)*p++;
+    p = getVarint(p, end, item.nameid);
+    item.num = 0;
+    if (p && (item.nameid & 1)) {       // 最低位表示有序号
+        p = getVarint(p, end, item.num);
+    }
+    if (!p) {
+        return false;
+    }
+    item.nameid >>= 1;
+    item.count = 1;
+
+    switch (item.type) {
+        case kBinNode:
+            if (end - p < 4) {
+                return false;
+            }
+            item.count = getValue<unsigned>(p);
+            p += 4;
+            break;
+        case kBinBool:
+            break;
+        case kBinInt:
+        case kBinUInt:
+        case kBinFloat:
+            elemsize = 4;
+            break;
+        case kBinDouble:
+            elemsize = 8;
+            break;
+        case kBinString:
+            p = getVarint(p, end, item.count);
+            break;
+        case kBinFloatArray:
+        case kBinIntArray:
+            elemsize = 4;
+            p = getVarint(p, end, item.count);
+            break;
+        case kBinDoubleArray:
+            elemsize = 8;
+            p = getVarint(p, end, item.count);
+            break;
+        default:
+            return false;
+    }
+    if (!p || item.count > (unsigned)(end - p) / elemsize) {
+        return false;
+    }
+    item.value = p;
+    item.end = p + item.count * elemsize;
+
+    return true;
+}
+
+//! 取出数值数组项的前 n 个元素
+template <typename V>
+static void getNumbers(const BinItem& item, V* values, int n)
+{
+    switch (item.type) {
+        case kBinFloatArray:
+            BinArray<float, V>::get(item.value, values, n);
+            break;
+        case kBinDoubleArray:
+            BinArray<double, V>::get(item.value, values, n);
+            break;
+        default:
+            BinArray<int, V>::get(item.value, values, n);
+            break;
+    }
+}
+
+static inline bool isNumbers(int type)
+{
+    return type == kBinFloatArray || type == kBinDoubleArray || type == kBinIntArray;
+}
+
+#if defined(_WIN32)
+static void setBinaryMode(FILE* fp) { _setmode(_fileno(fp), _O_BINARY); }
+#else
+static void setBinaryMode(FILE*) {}
+#endif
+
+//! 二进制序列化适配器类，内部实现类
+class MgBinaryStorage::Impl : public MgStorage
+{
+public:
+    class Source;
+
+    Impl() : _data((const char*)0), _end((const char*)0), _src((Source*)0)
+        , _lazy(false), _err((const char*)0) {}
+    virtual ~Impl() { clear(); }
+
+    void clear();
+    bool beginRead(const char* data, size_t size);
+    bool beginNode(size_t pos);
+    bool mapFile(FILE* fp);
+    void setLazy(bool lazy) { _lazy = lazy; }
+    void beginWrite();
+    bool save(FILE* fp);
+    bool save(std::string& data);
+    void getHead(std::vector<char>& head) const;
+    bool copyTo(MgStorage* w);
+    const char* getError() const { return _err; }
+
+private:
+    //! 正在读取的节点
+    struct Node {
+        const char* begin;
+        const char* end;
+        const char* next;           //!< 上次找到的项之后，下次先从此处查找
+    };
+
+    //! 名称表中的一项
+    struct Name {
+        const char* str;
+        unsigned    len;
+    };
+
+    bool findItem(Node& node, const BinKey& key, BinItem& item);
+    bool findValue(const char* name, BinItem& item);
+    bool copyItems(const char* p, const char* end, MgStorage* w);
+    unsigned nameId(const char* name, unsigned len);
+    void putKey(int type, const char* name, int index = -1);
+    template <typename T> void putNumbers(const T* values, int count);
+    template <typename V> int readNumbers(const char* name, V* values, int count,
+                                          bool report, const char* func);
+
+    bool readNode(const char* name, int index, bool ended);
+    bool writeNode(const char* name, int index, bool ended);
+    bool setError(const char* err);
+    MgStorageSource* getSource(size_t& pos);
+
+    int readInt(const char* name, int defvalue);
+    bool readBool(const char* name, bool defvalue);
+    float readFloat(const char* name, float defvalue);
+    double readDouble(const char* name, double defvalue);
+    int readFloatArray(const char* name, float* values, int count, bool report = true);
+    int readDoubleArray(const char* name, double* values, int count, bool report = true);
+    int readString(const char* name, char* value, int count);
+    int readIntArray(const char* name, int* values, int count, bool report = true);
+
+    void writeInt(const char* name, int value);
+    void writeUInt(const char* name, int value);
+    void writeBool(const char* name, bool value);
+    void writeFloat(const char* name, float value);
+    void writeDouble(const char* name, double value);
+    void writeFloatArray(const char* name, const float* values, int count);
+    void writeDoubleArray(const char* name, const double* values, int count);
+    void writeString(const char* name, const char* value);
+    void writeIntArray(const char* name, const int* values, int count);
+
+private:
+    std::vector<Node> _stack;
+    Node _root;
+    std::vector<Name> _table;       // 读取的名称表
+    std::vector<size_t> _wstack;    // 写时各层节点长度的位置，无名根节点为 npos
+    std::vector<std::string> _names;    // 写时的名称表
+    std::vector<unsigned> _slots;   // 写时名称的散列表，值为名称序号+1
+    std::vector<char> _buf;         // 写入的键值项
+    const char* _data;              // 读取的键值项，在名称表之后
+    const char* _end;
+    Source* _src;                   // 读取的文件内容
+    bool _lazy;
+    const char* _err;
+};
+
+//! 映射的文件内容，按需加载时由图形列表保持引用以便重新读取图形节点
+class MgBinaryStorage::Impl::Source : public MgStorageSource
+{
+public:
+    Source() : _map((void*)0), _size(0)
+#if defined(_WIN32)
+        , _mapping((HANDLE)0)
+#endif
+        , _refcount(1) {}
+
+    bool map(FILE* fp);
+    const char* data() const { return _map ? (const char*)_map
+        : _buf.empty() ? (const char*)0 : &_buf.front(); }
+    size_t size() const { return _map ? _size : _buf.size(); }
+
+    void addRef() { giAtomicIncrement(&_refcount); }
+    void release() {
+        if (giAtomicDecrement(&_refcount) == 0)
+            delete this;
+    }
+    MgStorage* beginRead(size_t pos);
+    void endRead(MgStorage* s) { delete (Impl*)s; }
+
+private:
+    virtual ~Source();
+
+    void* _map;
+    size_t _size;
+#if defined(_WIN32)
+    HANDLE _mapping;
+#endif
+    std::vector<char> _buf;         // 不能映射时读入的文件内容
+    volatile long _refcount;
+};
+
+void MgBinaryStorage::Impl::clear()
+{
+    _stack.clear();
+    _table.clear();
+    _wstack.clear();
+    _names.clear();
+    _slots.clear();
+    std::vector<char>().swap(_buf);
+    _data = _end = (const char*)0;
+    _root.begin = _root.end = _root.next = (const char*)0;
+    if (_src) {
+        _src->release();
+        _src = (Source*)0;
+    }
+    _err = (const char*)0;
+}
+
+bool MgBinaryStorage::Impl::setError(const char* err)
+{
+    _err = err;
+    if (err) {
+        LOGE("storage error: %s", err);
+    }
+    return false;
+}
+
+bool MgBinaryStorage::Impl::beginRead(const char* data, size_t size)
+{
+    if (!data || size < (size_t)kHeadSize || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        return setError("Invalid binary file header.");
+    }
+    if (data[4] > kVersion) {
+        return setError("Unsupported binary file version.");
+    }
+
+    const char* end = data + size;
+    unsigned n = 0;
+    const char* p = getVarint(data + kHeadSize, end, n);
+
+    if (!p || n > (unsigned)(end - p)) {
+        return setError("Invalid binary content.");
+    }
+    _table.resize(n);
+    for (unsigned i = 0; i < n; i++) {  // 名称表，直接引用文件内容
+        p = getVarint(p, end, _table[i].len);
+        if (!p || _table[i].len > (unsigned)(end - p)) {
+            _table.clear();
+            return setError("Invalid binary content.");
+        }
+        _table[i].str = p;
+        p += _table[i].len;
+    }
+    _data = p;
+    _end = end;
+    _root.begin = _root.next = _data;
+    _root.end = _end;
+
+    return true;
+}
+
+bool MgBinaryStorage::Impl::beginNode(size_t pos)
+{
+    const char* p = _data && pos < (size_t)(_end - _src->data()) ? _src->data() + pos : _data;
+
+    if (p - 4 < _data) {                // 节点内容之前是其长度
+        return setError("Invalid node position.");
+    }
+
+    unsigned len = getValue<unsigned>(p - 4);
+
+    if (len > (unsigned)(_end - p)) {
+        return setError("Invalid node position.");
+    }
+    _root.begin = _root.next = p;
+    _root.end = p + len;
+
+    return true;
+}
+
+MgStorageSource* MgBinaryStorage::Impl::getSource(size_t& pos)
+{
+    if (!_lazy || !_src || _stack.empty() || _stack.back().begin == _data) {
+        pos = 0;
+        return (MgStorageSource*)0;
+    }
+    pos = (size_t)(_stack.back().begin - _src->data());
+    return _src;
+}
+
+bool MgBinaryStorage::Impl::mapFile(FILE* fp)
+{
+    _src = new Source();
+    _src->map(fp);
+    return beginRead(_src->data(), _src->size());
+}
+
+MgBinaryStorage::Impl::Source::~Source()
+{
+    if (_map) {
+#if defined(_WIN32)
+        UnmapViewOfFile(_map);
+        CloseHandle(_mapping);
+#else
+        munmap(_map, _size);
+#endif
+    }
+}
+
+bool MgBinaryStorage::Impl::Source::map(FILE* fp)
+{
+#if defined(_WIN32)
+    HANDLE file = (HANDLE)_get_osfhandle(_fileno(fp));
+    LARGE_INTEGER size;
+
+    if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &size)
+        && size.QuadPart > 0 && size.HighPart == 0) {
+        _mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (_mapping) {
+            _map = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+            if (_map) {
+                _size = (size_t)size.LowPart;
+            } else {
+                CloseHandle(_mapping);
+                _mapping = (HANDLE)0;
+            }
+        }
+    }
+#else
+    struct stat st;
+
+    if (fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap((void*)0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+        if (p != MAP_FAILED) {
+            _map = p;
+            _size = (size_t)st.st_size;
+        }
+    }
+#endif
+    if (_map) {
+        return true;
+    }
+
+    char buf[16 * 1024];                // 不能映射时读入整个文件
+    size_t n;
+
+    setBinaryMode(fp);
+    fseek(fp, 0, SEEK_SET);
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        _buf.insert(_buf.end(), buf, buf + n);
+    }
+
+    return !_buf.empty();
+}
+
+MgStorage* MgBinaryStorage::Impl::Source::beginRead(size_t pos)
+{
+    Impl* s = new Impl();
+
+    addRef();
+    s->_src = this;
+    if (!s->beginRead(data(), size()) || !s->beginNode(pos)) {
+        s->_data = (const char*)0;      // readNode 都返回false
+    }
+    return s;
+}
+
+bool MgBinaryStorage::Impl::findItem(Node& node, const BinKey& key, BinItem& item)
+{
+    const char* p = node.next;
+    const char* end = node.end;
+
+    for (int pass = 0; pass < 2; pass++) { // 先从上次找到的项之后查找，再从头找
+        while (p < end) {
+            if (!parseItem(p, node.end, item)) {
+                return setError("Invalid binary content.");
+            }
+            if (item.num == key.num && item.nameid < _table.size()
+                && _table[item.nameid].len == key.len
+                && memcmp(_table[item.nameid].str, key.name, key.len) == 0) {
+                node.next = item.end;
+                return true;
+            }
+            p = item.end;
+        }
+        p = node.begin;
+        end = node.next;
+    }
+
+    return false;
+}
+
+bool MgBinaryStorage::Impl::findValue(const char* name, BinItem& item)
+{
+    char tmpname[64];
+    BinKey key;
+
+    splitKey(name, -1, key, tmpname, sizeof(tmpname));
+    return _data && findItem(_stack.empty() ? _root : _stack.back(), key, item);
+}
+
+bool MgBinaryStorage::Impl::readNode(const char* name, int index, bool ended)
+{
+    if (!_data) {
+        return false;
+    }
+    if (!ended) {                       // 开始一个新节点
+        if (_stack.empty() && (!name || !*name)) {
+            _root.next = _root.begin;
+            _stack.push_back(_root);
+            _err = (const char*)0;
+            return true;
+        }
+
+        char tmpname[64];
+        BinKey key;
+        BinItem item;
+
+        splitKey(name, index, key, tmpname, sizeof(tmpname));
+        if (!findItem(_stack.empty() ? _root : _stack.back(), key, item)
+            || item.type != kBinNode) {
+            return false;               // 没有此节点
+        }
+        if (_stack.empty()) {
+            _err = (const char*)0;
+        }
+        Node node = { item.value, item.end, item.value };
+        _stack.push_back(node);
+    }
+    else if (!_stack.empty()) {         // 当前节点读取完成
+        _stack.pop_back();
+    }
+
+    return true;
+}
+
+void MgBinaryStorage::Impl::beginWrite()
+{
+    _buf.reserve(64 * 1024);
+}
+
+unsigned MgBinaryStorage::Impl::nameId(const char* name, unsigned len)
+{
+    if (_slots.empty()) {
+        _slots.assign(64, 0);
+    }
+
+    size_t mask = _slots.size() - 1;
+
+    for (size_t i = hashName(name, len) & mask; ; i = (i + 1) & mask) {
+        unsigned id = _slots[i];
+
+        if (id == 0) {                  // 新名称
+            _names.push_back(std::string(name, len));
+            _slots[i] = (unsigned)_names.size();
+            if (_names.size() * 2 > _slots.size()) {
+                std::vector<unsigned> slots(_slots.size() * 2, 0);
+                mask = slots.size() - 1;
+                for (size_t j = 0; j < _names.size(); j++) {
+                    size_t k = hashName(_names[j].data(), _names[j].size()) & mask;
+                    while (slots[k]) {
+                        k = (k + 1) & mask;
+                    }
+                    slots[k] = (unsigned)j + 1;
+                }
+                _slots.swap(slots);
+            }
+            return (unsigned)_names.size() - 1;
+        }
+        if (_names[id - 1].size() == len && memcmp(_names[id - 1].data(), name, len) == 0) {
+            return id - 1;
+        }
+    }
+}
+
+void MgBinaryStorage::Impl::putKey(int type, const char* name, int index)
+{
+    char tmpname[64];
+    BinKey key;
+
+    splitKey(name, index, key, tmpname, sizeof(tmpname));
+    unsigned id = nameId(key.name, key.len);
+
+    _buf.push_back((char)type);
+    putVarint(_buf, id << 1 | (key.num ? 1 : 0));
+    if (key.num) {
+        putVarint(_buf, key.num);
+    }
+}
+
+template <typename T>
+void MgBinaryStorage::Impl::putNumbers(const T* values, int count)
+{
+    count = values && count > 0 ? count : 0;
+    putVarint(_buf, (unsigned)count);
+
+    size_t pos = _buf.size();
+
+    _buf.resize(pos + count * sizeof(T));
+    if (isLittleEndian() && count > 0) {
+        memcpy(&_buf[pos], values, count * sizeof(T));
+    } else {
+        for (int i = 0; i < count; i++, pos += sizeof(T)) {
+            setValue(&_buf[pos], values[i]);
+        }
+    }
+}
+
+bool MgBinaryStorage::Impl::writeNode(const char* name, int index, bool ended)
+{
+    if (!ended) {                       // 开始一个新节点
+        if (_wstack.empty()) {
+            _err = (const char*)0;
+            if (!name || !*name) {      // 无名根节点的项直接写在名称表之后
+                _wstack.push_back((size_t)-1);
+                return true;
+            }
+        }
+        putKey(kBinNode, name, index);
+        _wstack.push_back(_buf.size());
+        _buf.resize(_buf.size() + 4);   // 节点内容的长度，写完节点时填写
+    }
+    else if (!_wstack.empty()) {        // 当前节点写完
+        size_t pos = _wstack.back();
+
+        _wstack.pop_back();
+        if (pos != (size_t)-1) {
+            size_t len = _buf.size() - pos - 4;
+            if (len > 0xFFFFFFFFu) {
+                return setError("Binary node is too large.");
+            }
+            setValue(&_buf[pos], (unsigned)len);
+        }
+    }
+
+    return true;
+}
+
+void MgBinaryStorage::Impl::getHead(std::vector<char>& head) const
+{
+    head.assign(kMagic, kMagic + sizeof(kMagic));
+    head.resize(kHeadSize, 0);
+    head[4] = (char)kVersion;
+    putVarint(head, (unsigned)_names.size());
+    for (size_t i = 0; i < _names.size(); i++) {
+        putVarint(head, (unsigned)_names[i].size());
+        head.insert(head.end(), _names[i].begin(), _names[i].end());
+    }
+}
+
+bool MgBinaryStorage::Impl::save(FILE* fp)
+{
+    std::vector<char> head;
+
+    getHead(head);
+    setBinaryMode(fp);
+
+    return (fwrite(&head.front(), 1, head.size(), fp) == head.size()
+            && (_buf.empty() || fwrite(&_buf.front(), 1, _buf.size(), fp) == _buf.size())
+            && !ferror(fp));
+}
+
+bool MgBinaryStorage::Impl::save(std::string& data)
+{
+    std::vector<char> head;
+
+    getHead(head);
+    data.assign(head.begin(), head.end());
+    data.append(_buf.begin(), _buf.end());
+    return true;
+}
+
+int MgBinaryStorage::Impl::readInt(const char* name, int defvalue)
+{
+    int ret = defvalue;
+    BinItem item;
+
+    if (findValue(name, item)) {
+        switch (item.type) {
+            case kBinInt:
+                ret = getValue<int>(item.value);
+                break;
+            case kBinUInt:
+                ret = (int)getValue<unsigned>(item.value);
+                break;
+            case kBinBool:
+                ret = *item.value ? 1 : 0;
+                break;
+            case kBinString:
+                if (MgJsonStorage::parseInt(std::string(item.value, item.count).c_str(), defvalue)) {
+                    ret = defvalue;
+                    break;
+                }
+            default:
+                LOGD("Invalid value for readInt(%s)", name);
+                break;
+        }
+    }
+
+    return ret;
+}
+
+bool MgBinaryStorage::Impl::readBool(const char* name, bool defvalue)
+{
+    return !!readInt(name, defvalue ? 1 : 0);
+}
+
+float MgBinaryStorage::Impl::readFloat(const char* name, float defvalue)
+{
+    return (float)readDouble(name, defvalue);
+}
+
+double MgBinaryStorage::Impl::readDouble(const char* name, double defvalue)
+{
+    double ret = defvalue;
+    BinItem item;
+
+    if (findValue(name, item)) {
+        switch (item.type) {
+            case kBinFloat:
+                ret = getValue<float>(item.value);
+                break;
+            case kBinDouble:
+                ret = getValue<double>(item.value);
+                break;
+            case kBinInt:
+                ret = getValue<int>(item.value);
+                break;
+            case kBinUInt:
+                ret = getValue<unsigned>(item.value);
+                break;
+            case kBinString:
+                if (MgJsonStorage::parseFloat(std::string(item.value, item.count).c_str(), defvalue)) {
+                    ret = defvalue;
+                    break;
+                }
+            default:
+                LOGD("Invalid value for readFloat(%s)", name);
+                break;
+        }
+    }
+
+    return ret;
+}
+
+template <typename V>
+int MgBinaryStorage::Impl::readNumbers(const char* name, V* values, int count,
+                                       bool report, const char* func)
+{
+    int ret = 0;
+    BinItem item;
+
+    report = report && count > 0 && values;
+    if (findValue(name, item)) {
+        if (isNumbers(item.type)) {
+            ret = (int)item.count;
+            if (values) {
+                ret = ret < count ? ret : count;
+                getNumbers(item, values, ret);
+            }
+        }
+        else if (report) {
+            LOGD("Invalid value for %s(%s)", func, name);
+        }
+    }
+    if (values && ret < count && report) {
+        LOGD("%s(%s, %d): %d", func, name, count, ret);
+        setError("readNumbers: lose numbers");
+    }
+
+    return ret;
+}
+
+int MgBinaryStorage::Impl::readFloatArray(const char* name, float* values, int count, bool report)
+{
+    return readNumbers(name, values, count, report, "readFloatArray");
+}
+
+int MgBinaryStorage::Impl::readDoubleArray(const char* name, double* values, int count, bool report)
+{
+    return readNumbers(name, values, count, report, "readDoubleArray");
+}
+
+int MgBinaryStorage::Impl::readIntArray(const char* name, int* values, int count, bool report)
+{
+    return readNumbers(name, values, count, report, "readIntArray");
+}
+
+int MgBinaryStorage::Impl::readString(const char* name, char* value, int count)
+{
+    int ret = 0;
+    BinItem item;
+
+    if (findValue(name, item)) {
+        if (item.type == kBinString) {
+            ret = (int)item.count;
+            if (value) {
+                ret = ret < count ? ret : count;
+                memcpy(value, item.value, ret);
+            }
+        }
+        else {
+            LOGD("Invalid value for readString(%s)", name);
+        }
+    }
+    if (value) {
+        value[ret] = 0;
+    }
+
+    return ret;
+}
+
+void MgBinaryStorage::Impl::writeInt(const char* name, int value)
+{
+    putKey(kBinInt, name);
+    _buf.resize(_buf.size() + 4);
+    setValue(&_buf[_buf.size() - 4], value);
+}
+
+void MgBinaryStorage::Impl::writeUInt(const char* name, int value)
+{
+    putKey(kBinUInt, name);
+    _buf.resize(_buf.size() + 4);
+    setValue(&_buf[_buf.size() - 4], (unsigned)value);
+}
+
+void MgBinaryStorage::Impl::writeBool(const char* name, bool value)
+{
+    putKey(kBinBool, name);
+    _buf.push_back(value ? 1 : 0);
+}
+
+void MgBinaryStorage::Impl::writeFloat(const char* name, float value)
+{
+    putKey(kBinFloat, name);
+    _buf.resize(_buf.size() + 4);
+    setValue(&_buf[_buf.size() - 4], value);
+}
+
+void MgBinaryStorage::Impl::writeDouble(const char* name, double value)
+{
+    putKey(kBinDouble, name);
+    _buf.resize(_buf.size() + 8);
+    setValue(&_buf[_buf.size() - 8], value);
+}
+
+void MgBinaryStorage::Impl::writeString(const char* name, const char* value)
+{
+    size_t len = value ? strlen(value) : 0;
+
+    putKey(kBinString, name);
+    putVarint(_buf, (unsigned)len);
+    _buf.insert(_buf.end(), value, value + len);
+}
+
+void MgBinaryStorage::Impl::writeFloatArray(const char* name, const float* values, int count)
+{
+    putKey(kBinFloatArray, name);
+    putNumbers(values, count);
+}
+
+void MgBinaryStorage::Impl::writeDoubleArray(const char* name, const double* values, int count)
+{
+    putKey(kBinDoubleArray, name);
+    putNumbers(values, count);
+}
+
+void MgBinaryStorage::Impl::writeIntArray(const char* name, const int* values, int count)
+{
+    putKey(kBinIntArray, name);
+    putNumbers(values, count);
+}
+
+bool MgBinaryStorage::Impl::copyTo(MgStorage* w)
+{
+    return (_data && w->writeNode("", -1, false)
+            && copyItems(_data, _end, w)
+            && w->writeNode("", -1, true));
+}
+
+bool MgBinaryStorage::Impl::copyItems(const char* p, const char* end, MgStorage* w)
+{
+    BinItem item;
+    std::string name;
+    char num[16];
+
+    for (; p < end; p = item.end) {
+        if (!parseItem(p, end, item) || item.nameid >= _table.size()) {
+            return setError("Invalid binary content.");
+        }
+        name.assign(_table[item.nameid].str, _table[item.nameid].len);
+        if (item.num) {
+#if defined(_MSC_VER) && _MSC_VER >= 1400 // VC8
+            sprintf_s(num, sizeof(num), "%u", item.num);
+#else
+            snprintf(num, sizeof(num), "%u", item.num);
+#endif
+            name += num;
+        }
+
+        switch (item.type) {
+            case kBinNode:
+                if (!w->writeNode(name.c_str(), -1, false)
+                    || !copyItems(item.value, item.end, w)
+                    || !w->writeNode(name.c_str(), -1, true)) {
+                    return false;
+                }
+                break;
+            case kBinBool:
+                w->writeBool(name.c_str(), *item.value != 0);
+                break;
+            case kBinInt:
+                w->writeInt(name.c_str(), getValue<int>(item.value));
+                break;
+            case kBinUInt:
+                w->writeUInt(name.c_str(), (int)getValue<unsigned>(item.value));
+                break;
+            case kBinFloat:
+                w->writeFloat(name.c_str(), getValue<float>(item.value));
+                break;
+            case kBinDouble:
+                w->writeDouble(name.c_str(), getValue<double>(item.value));
+                break;
+            case kBinString:
+                w->writeString(name.c_str(), std::string(item.value, item.count).c_str());
+                break;
+            case kBinFloatArray: {
+                std::vector<float> v(item.count + 1);
+                getNumbers(item, &v.front(), (int)item.count);
+                w->writeFloatArray(name.c_str(), &v.front(), (int)item.count);
+                break;
+            }
+            case kBinDoubleArray: {
+                std::vector<double> v(item.count + 1);
+                getNumbers(item, &v.front(), (int)item.count);
+                w->writeDoubleArray(name.c_str(), &v.front(), (int)item.count);
+                break;
+            }
+            default: {
+                std::vector<int> v(item.count + 1);
+                getNumbers(item, &v.front(), (int)item.count);
+                w->writeIntArray(name.c_str(), &v.front(), (int)item.count);
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+MgBinaryStorage::MgBinaryStorage() : _impl(new Impl())
+{
+}
+
+MgBinaryStorage::~MgBinaryStorage()
+{
+    delete _impl;
+}
+
+MgStorage* MgBinaryStorage::storageForWrite()
+{
+    _impl->clear();
+    _impl->beginWrite();
+    return _impl;
+}
+
+MgStorage* MgBinaryStorage::storageForRead(const void* data, int size)
+{
+    _impl->clear();
+    _impl->beginRead((const char*)data, size > 0 ? (size_t)size : 0);
+    return _impl;
+}
+
+MgStorage* MgBinaryStorage::storageForRead(FILE* fp)
+{
+    _impl->clear();
+    if (fp) {
+        _impl->mapFile(fp);
+    }
+    return _impl;
+}
+
+MgStorage* MgBinaryStorage::storageForReadFile(const char* filename)
+{
+    FILE* fp = mgopenfile(filename, "rb");
+    MgStorage* s = storageForRead(fp);
+
+    if (fp) {
+        fclose(fp);
+    } else {
+        LOGE("Fail to read file: %s", filename);
+    }
+    return s;
+}
+
+bool MgBinaryStorage::save(FILE* fp)
+{
+    return fp && _impl->save(fp);
+}
+
+bool MgBinaryStorage::save(std::string& data)
+{
+    return _impl->save(data);
+}
+
+bool MgBinaryStorage::saveToFile(const char* filename)
+{
+    FILE* fp = mgopenfile(filename, "wb");
+    bool ret = save(fp);
+
+    if (fp) {
+        fclose(fp);
+    } else {
+        LOGE("Fail to save file: %s", filename);
+    }
+    return ret;
+}
+
+void MgBinaryStorage::setLazyLoading(bool lazy)
+{
+    _impl->setLazy(lazy);
+}
+
+void MgBinaryStorage::clear()
+{
+    _impl->clear();
+}
+
+const char* MgBinaryStorage::getParseError()
+{
+    return _impl->getError();
+}
+
+bool MgBinaryStorage::isBinaryFile(FILE* fp)
+{
+    char head[sizeof(kMagic)];
+    long pos = fp ? ftell(fp) : -1L;
+    bool ret = (pos >= 0 && fread(head, 1, sizeof(head), fp) == sizeof(head)
+                && memcmp(head, kMagic, sizeof(kMagic)) == 0);
+
+    if (pos >= 0) {
+        fseek(fp, pos, SEEK_SET);
+    }
+    return ret;
+}
+
+bool MgBinaryStorage::isBinaryData(const void* data, int size)
+{
+    return data && size >= (int)sizeof(kMagic) && memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool MgBinaryStorage::isBinaryName(const char* filename)
+{
+    size_t len = filename ? strlen(filename) : 0;
+    const char* ext = filename + len - 4;
+
+    return (len > 4 && ext[0] == '.' && (ext[1] | 0x20) == 'v'
+            && (ext[2] | 0x20) == 'g' && (ext[3] | 0x20) == 'b');
+}
+
+using namespace rapidjson;
+
+//! 浮点数可用单精度保存而不损失JSON文本中的有效数字
+static bool isFloatValue(double d)
+{
+    double f = (float)d;
+    return f == d || fabs(f - d) <= fabs(d) * FLT_EPSILON;
+}
+
+static bool copyJsonArray(const char* name, const Value& arr, MgStorage* w)
+{
+    bool isint = true, isfloat = true;
+    SizeType i, n = arr.Size();
+
+    for (i = 0; i < n; i++) {
+        const Value& v = arr[i];
+        if (!v.IsNumber()) {
+            LOGE("Unsupported JSON array: %s", name);
+            return false;                   // 只支持数值数组，不支持数组模式的节点
+        }
+        isint = isint && v.IsInt();
+        isfloat = isfloat && (v.IsInt() || isFloatValue(v.GetDouble()));
+    }
+    if (isint) {
+        std::vector<int> values(n + 1);
+        for (i = 0; i < n; i++) {
+            values[i] = arr[i].GetInt();
+        }
+        w->writeIntArray(name, &values.front(), (int)n);
+    }
+    else if (isfloat) {
+        std::vector<float> values(n + 1);
+        for (i = 0; i < n; i++) {
+            values[i] = (float)arr[i].GetDouble();
+        }
+        w->writeFloatArray(name, &values.front(), (int)n);
+    }
+    else {
+        std::vector<double> values(n + 1);
+        for (i = 0; i < n; i++) {
+            values[i] = arr[i].GetDouble();
+        }
+        w->writeDoubleArray(name, &values.front(), (int)n);
+    }
+
+    return true;
+}
+
+static bool copyJsonObject(const Value& node, MgStorage* w)
+{
+    for (Value::ConstMemberIterator it = node.MemberBegin(); it != node.MemberEnd(); ++it) {
+        const char* name = it->name.GetString();
+        const Value& v = it->value;
+
+        if (v.IsObject()) {
+            if (!w->writeNode(name, -1, false) || !copyJsonObject(v, w)
+                || !w->writeNode(name, -1, true)) {
+                return false;
+            }
+        }
+        else if (v.IsArray()) {
+            if (!copyJsonArray(name, v, w)) {
+                return false;
+            }
+        }
+        else if (v.IsBool()) {
+            w->writeBool(name, v.GetBool());
+        }
+        else if (v.IsInt()) {
+            w->writeInt(name, v.GetInt());
+        }
+        else if (v.IsUint()) {
+            w->writeUInt(name, (int)v.GetUint());
+        }
+        else if (v.IsNumber()) {
+            if (isFloatValue(v.GetDouble())) {
+                w->writeFloat(name, (float)v.GetDouble());
+            } else {
+                w->writeDouble(name, v.GetDouble());
+            }
+        }
+        else if (v.IsString()) {
+            w->writeString(name, v.GetString());
+        }
+    }
+
+    return true;
+}
+
+bool MgBinaryStorage::convertFile(const char* infile, const char* outfile, bool pretty)
+{
+    FILE* fp = mgopenfile(infile, "rb");
+    FILE* fpo = (FILE*)0;
+    bool ret = false;
+
+    if (!fp) {
+        LOGE("Fail to read file: %s", infile);
+        return false;
+    }
+    if (isBinaryFile(fp)) {             // 二进制转为JSON
+        MgBinaryStorage bs;
+
+        bs.storageForRead(fp);
+        if (!bs.getParseError() && (fpo = mgopenfile(outfile, "wt")) != 0) {
+            MgJsonStorage js;
+            ret = bs._impl->copyTo(js.storageForWrite(fpo, pretty)) && !ferror(fpo);
+        }
+    }
+    else {                              // JSON转为二进制
+        utf8::uint8_t head[3];
+        Document doc;
+
+        if (fread(head, 1, sizeof(head), fp) < sizeof(head)
+            || !utf8::starts_with_bom(head, head + sizeof(head))) {
+            fseek(fp, 0, SEEK_SET);
+        }
+        FileStream fs(fp);
+        doc.ParseStream<0>(fs);
+
+        if (doc.HasParseError() || !doc.IsObject()) {
+            LOGE("parse error: %s", doc.HasParseError() ? doc.GetParseError() : infile);
+        }
+        else if ((fpo = mgopenfile(outfile, "wb")) != 0) {
+            MgBinaryStorage bs;
+            MgStorage* s = bs.storageForWrite();
+
+            ret = (s->writeNode("", -1, false) && copyJsonObject(doc, s)
+                   && s->writeNode("", -1, true) && bs.save(fpo));
+        }
+    }
+
+    fclose(fp);
+    if (fpo) {
+        fclose(fpo);
+    } else {
+        LOGE("Fail to convert file: %s", infile);
+    }
+
+    return ret;
+}
@@ -10,23 +10,471 @@
 
 using namespace rapidjson;
 
+typedef Document::AllocatorType JsonAllocator;
+
+//! 从JSON文本或文件中顺序读取的解析器，供流式读取模式使用
+class JsonReadStream
+{
+public:
+    JsonReadStream(const char* content)
+        : _fp((FILE*)0), _p(content), _end(content + strlen(content)), _err((const char*)0) {}
+    JsonReadStream(FILE* fp)
+        : _fp(fp), _buf(16 * 1024), _p((const char*)0), _end((const char*)0), _err((const char*)0) {}
+
+    const char* getError() const { return _err; }
+
+    //! 跳过空白字符，返回下一个字符，已结束或出错时返回0
+    char peek();
+
+    //! 下一个字符为c时跳过该字符并返回true
+    bool expect(char c);
+
+    //! 读取对象的下一个成员名称及冒号，遇到对象结束符时返回false，first表示是否为第一个成员
+    bool nextName(bool& first, std::string& name);
+
+    //! 解析一个值，字符串都复制到 allocator 中
+    bool parseValue(Value& v, JsonAllocator& allocator);
+
+    //! 跳过一个值，不保存内容
+    bool skipValue();
+
+private:
+    char cur() { return _p != _end || fill() ? *_p : 0; }
+    bool fill();
+    bool parseString(std::string& str);
+    bool parseHex4(unsigned& code);
+    bool parseScalar(Value& v);
+    bool error(const char* err) { if (!_err) _err = err; _p = _end = (const char*)0; _fp = (FILE*)0; return false; }
+
+    FILE*               _fp;
+    std::vector<char>   _buf;
+    const char*         _p;
+    const char*         _end;
+    const char*         _err;
+    std::string         _str;
+};
+
+bool JsonReadStream::fill()
+{
+    if (!_fp) {
+        return false;
+    }
+    size_t n = fread(&_buf.front(), 1, _buf.size(), _fp);
+    if (n == 0) {
+        _fp = (FILE*)0;
+        return false;
+    }
+    _p = &_buf.front();
+    _end = _p + n;
+    return true;
+}
+
+char JsonReadStream::peek()
+{
+    char c = cur();
+    while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+        _p++;
+        c = cur();
+    }
+    return c;
+}
+
+bool JsonReadStream::expect(char c)
+{
+    if (peek() != c) {
+        return false;
+    }
+    _p++;
+    return true;
+}
+
+bool JsonReadStream::nextName(bool& first, std::string& name)
+{
+    if (expect('}')) {
+        return false;
+    }
+    if (!first && !expect(',')) {
+        return error("Missing a comma or '}' after an object member");
+    }
+    first = false;
+    if (peek() != '"' || !parseString(name)) {
+        return error("Name of an object member must be a string");
+    }
+    return expect(':') || error("There must be a colon after the name of object member");
+}
+
+bool JsonReadStream::parseString(std::string& str)
+{
+    str.clear();
+    _p++;                               // 跳过引号
+    for (;;) {
+        const char* start = _p;         // 先成段复制普通字符
+        while (_p != _end && *_p != '"' && *_p != '\\') {
+            _p++;
+        }
+        str.append(start, _p);
+        
+        char c = cur();
+        if (!c) {
+            return error("lacks ending quotation before the end of string");
+        }
+        _p++;
+        if (c == '"') {
+            return true;
+        }
+        if (c != '\\') {
+            str += c;
+            continue;
+        }
+        c = cur();
+        _p++;
+        switch (c) {
+            case 'b': str += '\b'; break;
+            case 'f': str += '\f'; break;
+            case 'n': str += '\n'; break;
+            case 'r': str += '\r'; break;
+            case 't': str += '\t'; break;
+            case 'u': {
+                unsigned code, low;
+                if (!parseHex4(code)) {
+                    return false;
+                }
+                if (code >= 0xD800 && code <= 0xDBFF) {     // 代理对
+                    if (cur() != '\\' || (++_p, cur()) != 'u') {
+                        return error("The surrogate pair in string is invalid.");
+                    }
+                    _p++;
+                    if (!parseHex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                        return error("The surrogate pair in string is invalid.");
+                    }
+                    code = (((code - 0xD800) << 10) | (low - 0xDC00)) + 0x10000;
+                }
+                utf8::unchecked::append(code, std::back_inserter(str));
+                break;
+            }
+            case '"': case '\\': case '/':
+                str += c;
+                break;
+            default:
+                return error("Unknown escape character");
+        }
+    }
+}
+
+// 快速解析有效数字不超过15位的十进制数，结果与 strtod 相同，不能快速解析时返回false
+static bool parseDecimal(const char* s, double& d)
+{
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const bool neg = (*s == '-');
+    double m = 0;
+    int digits = 0, scale = 0;
+    
+    if (neg) {
+        s++;
+    }
+    for (; *s >= '0' && *s <= '9'; s++, digits++) {
+        m = m * 10 + (*s - '0');
+    }
+    if (*s == '.') {
+        for (s++; *s >= '0' && *s <= '9'; s++, digits++, scale++) {
+            m = m * 10 + (*s - '0');
+        }
+    }
+    if (*s == 'e' || *s == 'E') {
+        const bool negexp = (*++s == '-');
+        int e = 0;
+        
+        if (*s == '-' || *s == '+') {
+            s++;
+        }
+        if (*s < '0' || *s > '9') {
+            return false;
+        }
+        for (; *s >= '0' && *s <= '9' && e < 1000; s++) {
+            e = e * 10 + (*s - '0');
+        }
+        scale += negexp ? e : -e;
+    }
+    if (*s || digits == 0 || digits > 15 || scale > 22 || scale < -22) {
+        return false;
+    }
+    d = scale >= 0 ? m / pow10[scale] : m * pow10[-scale];   // 只舍入一次
+    d = neg ? -d : d;
+    
+    return true;
+}
+
+bool JsonReadStream::parseHex4(unsigned& code)
+{
+    code = 0;
+    for (int i = 0; i < 4; i++, _p++) {
+        char c = cur();
+        code <<= 4;
+        if (c >= '0' && c <= '9')
+            code |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            code |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            code |= c - 'A' + 10;
+        else
+            return error("Incorrect hex digit after \\u escape");
+    }
+    return true;
+}
+
+bool JsonReadStream::parseScalar(Value& v)
+{
+    char c = peek();
+
+    if (c == 't' || c == 'f' || c == 'n') {
+        const char* word = c == 't' ? "true" : c == 'f' ? "false" : "null";
+        for (const char* p = word; *p; p++, _p++) {
+            if (cur() != *p)
+                return error("Invalid value");
+        }
+        if (c == 'n')
+            v.SetNull();
+        else
+            v.SetBool(c == 't');
+        return true;
+    }
+
+    char buf[64];
+    int n = 0;
+    bool isInt = true;
+
+    for (c = cur(); (c >= '0' && c <= '9') || c == '-' || c == '+'
+         || c == '.' || c == 'e' || c == 'E'; c = cur()) {
+        if (n + 1 >= (int)sizeof(buf)) {
+            return error("Number too long");
+        }
+        isInt = isInt && c != '.' && c != 'e' && c != 'E';
+        buf[n++] = c;
+        _p++;
+    }
+    buf[n] = 0;
+
+    double d;
+    char *endptr = buf;
+
+    if (!parseDecimal(buf, d) && (d = strtod(buf, &endptr), n == 0 || *endptr)) {
+        return error("Expect a value here.");
+    }
+    if (isInt && d >= -2147483648.0 && d <= 2147483647.0) {
+        v.SetInt((int)d);
+    }
+    else if (isInt && d >= 0 && d <= 4294967295.0) {
+        v.SetUint((unsigned)d);
+    }
+    else {
+        v.SetDouble(d);
+    }
+    return true;
+}
+
+bool JsonReadStream::parseValue(Value& v, JsonAllocator& allocator)
+{
+    switch (peek()) {
+        case '{': {
+            bool first = true;
+            _p++;
+            v.SetObject();
+            while (nextName(first, _str)) {
+                Value name(_str.c_str(), (SizeType)_str.size(), allocator);
+                Value item;
+                if (!parseValue(item, allocator)) {
+                    return false;
+                }
+                v.AddMember(name, item, allocator);
+            }
+            return !_err;
+        }
+        case '[':
+            _p++;
+            v.SetArray();
+            if (expect(']')) {
+                return true;
+            }
+            do {
+                Value item;
+                if (!parseValue(item, allocator)) {
+                    return false;
+                }
+                v.PushBack(item, allocator);
+            } while (expect(','));
+            return expect(']') || error("Must be a comma or ']' after an array element.");
+        case '"':
+            if (!parseString(_str)) {
+                return false;
+            }
+            v.SetString(_str.c_str(), (SizeType)_str.size(), allocator);
+            return true;
+        default:
+            return parseScalar(v);
+    }
+}
+
+bool JsonReadStream::skipValue()
+{
+    char c = peek();
+
+    if (c == '"') {
+        return parseString(_str);
+    }
+    if (c != '{' && c != '[') {
+        Value v;
+        return parseScalar(v);
+    }
+
+    int depth = 0;
+
+    for (c = cur(); c; c = cur()) {
+        if (c == '"') {
+            if (!parseString(_str))
+                return false;
+            continue;
+        }
+        _p++;
+        if (c == '{' || c == '[') {
+            depth++;
+        }
+        else if ((c == '}' || c == ']') && --depth == 0) {
+            return true;
+        }
+    }
+    return error("Unexpected end of JSON text");
+}
+
+//! 流式读取模式下正在读取的一个对象节点
+struct JsonStreamNode {
+    size_t          buffer[256];    //!< 内存池的初始缓冲区，多数节点不需要再分配内存
+    JsonAllocator   allocator;      //!< 本节点已解析内容的内存池，节点结束时一起释放
+    Value           props;          //!< 已解析的成员
+    std::string     name;           //!< 已读出名称但还未解析值的成员名称
+    bool            pending;        //!< 是否有已读出名称但还未解析值的成员
+    bool            first;          //!< 是否还未读取任何成员
+    bool            open;           //!< 文本中是否还有未读取的成员
+
+    JsonStreamNode() : allocator((char*)buffer, sizeof(buffer), sizeof(buffer))
+        , props(kObjectType), pending(false), first(true), open(true) {}
+};
+
+//! 带缓冲的文件输出流，供 rapidjson::Writer 使用
+class JsonFileWriteStream
+{
+public:
+    typedef char Ch;
+    
+    JsonFileWriteStream(FILE* fp) : _fp(fp), _n(0) {}
+    ~JsonFileWriteStream() { flush(); }
+    
+    void Put(char c) {
+        if (_n == sizeof(_buf)) {
+            flush();
+        }
+        _buf[_n++] = c;
+    }
+    
+    bool flush() {
+        bool ret = fwrite(_buf, 1, _n, _fp) == _n;
+        _n = 0;
+        return ret && !ferror(_fp);
+    }
+    
+private:
+    FILE*   _fp;
+    size_t  _n;
+    char    _buf[16 * 1024];
+};
+
+//! 将写入的节点和键值直接输出为JSON文本的接口，供流式写模式使用
+struct JsonWriteStream {
+    virtual ~JsonWriteStream() {}
+    virtual void key(const char* name) = 0;
+    virtual void startObject() = 0;
+    virtual void endObject() = 0;
+    virtual void startArray() = 0;
+    virtual void endArray() = 0;
+    virtual void writeInt(int value) = 0;
+    virtual void writeUInt(unsigned value) = 0;
+    virtual void writeDouble(double value) = 0;
+    virtual void writeBool(bool value) = 0;
+    virtual void writeString(const char* value, SizeType len) = 0;
+};
+
+//! 用 rapidjson::Writer 或 PrettyWriter 实现的 JsonWriteStream
+template <class WriterT>
+class JsonWriteStreamT : public JsonWriteStream
+{
+public:
+    template <class StreamT>
+    JsonWriteStreamT(StreamT& stream) : _writer(stream) {}
+    
+    virtual void key(const char* name) { _writer.String(name, (SizeType)strlen(name)); }
+    virtual void startObject() { _writer.StartObject(); }
+    virtual void endObject() { _writer.EndObject(); }
+    virtual void startArray() { _writer.StartArray(); }
+    virtual void endArray() { _writer.EndArray(); }
+    virtual void writeInt(int value) { _writer.Int(value); }
+    virtual void writeUInt(unsigned value) { _writer.Uint(value); }
+    virtual void writeDouble(double value) { _writer.Double(value); }
+    virtual void writeBool(bool value) { _writer.Bool(value); }
+    virtual void writeString(const char* value, SizeType len) { _writer.String(value, len); }
+    
+private:
+    WriterT _writer;
+};
+
+//! 将DOM树输出为JSON文本
+template <class StreamT>
+static void acceptDocument(Document& doc, StreamT& stream, bool pretty)
+{
+    Document::AllocatorType allocator;
+    
+    if (pretty) {
+        PrettyWriter<StreamT> writer(stream, &allocator);
+        doc.Accept(writer);
+    }
+    else {
+        Writer<StreamT> writer(stream, &allocator);
+        doc.Accept(writer);
+    }
+}
+
 //! JSON序列化适配器类，内部实现类
 class MgJsonStorage::Impl : public MgStorage
 {
 public:
-    Impl() : _fs((FileStream *)0), _err((const char*)0), _arrmode(false), _numAsStr(false) {}
-    virtual ~Impl() { if (_fs) delete(_fs); }
+    Impl() : _fs((FileStream *)0), _err((const char*)0), _rs((JsonReadStream*)0)
+        , _sroot((JsonStreamNode*)0), _rootNext(0), _ws((JsonWriteStream*)0), _wfs((JsonFileWriteStream*)0)
+        , _wlevel(0), _wroot(false), _wpretty(false), _arrmode(false), _numAsStr(false), _streamMode(false) {}
+    virtual ~Impl() { clear(); }
     
     void clear();
     const char* stringify(bool pretty);
     Document& document() { return _doc; }
-    const char* getError() { return _err ? _err : _doc.GetParseError(); }
+    const char* getError() { return _err ? _err : _rs ? _rs->getError() : _doc.GetParseError(); }
     FileStream& createStream(FILE* fp);
     bool save(FILE* fp, bool pretty);
     void setArrayMode(bool arr) { _arrmode = arr; }
     void saveNumberAsString(bool str) { _numAsStr = str; }
+    void setStreamMode(bool stream) { _streamMode = stream; }
+    bool isStreamMode() const { return _streamMode; }
+    bool beginStream(JsonReadStream* rs);
+    void beginWrite(FILE* fp, bool pretty);
+    bool hasContent() const { return !_doc.IsNull() || (_wlevel == 0 && _strbuf.Size() > 0); }
     
 private:
+    enum { kNotFound, kFoundNode, kFoundValue };
+
+    void pushNode(Value* node, JsonStreamNode* snode);
+    void popNode();
+    Value::Member* findMember(Value& node, SizeType& next, const char* name);
+    int readStreamMember(JsonStreamNode* snode, const char* name, bool forNode);
+    void endStreamNode(JsonStreamNode* snode);
+    const Value* findValue(const char* name);
+    
     bool readNode(const char* name, int index, bool ended);
     bool writeNode(const char* name, int index, bool ended);
     bool setError(const char* err);
@@ -50,18 +498,29 @@ private:
     int readIntArray(const char* name, int* values, int count, bool report = true);
     void writeIntArray(const char* name, const int* values, int count);
     
-    bool hasNum(const char* name) { return strspn(name, "01234567890") > 0; }
+    bool hasNum(const char* name) { return strpbrk(name, "0123456789") != NULL; }
     
 private:
     Document _doc;
     std::vector<Value*> _stack;
+    std::vector<SizeType> _next;            // 与 _stack 对应，下一个同级成员的序号
+    std::vector<JsonStreamNode*> _snodes;   // 与 _stack 对应，流式读取的节点或NULL
     std::vector<Value*> _created;
     StringBuffer _strbuf;
     FileStream  *_fs;
     const char* _err;
+    JsonReadStream* _rs;
+    JsonStreamNode* _sroot;                 // 流式读取的根对象
+    SizeType _rootNext;
+    JsonWriteStream* _ws;                   // 流式写的输出
+    JsonFileWriteStream* _wfs;
+    int _wlevel;                            // 流式写时已开始的节点层数
+    bool _wroot;                            // 流式写时是否另有外层对象
+    bool _wpretty;
     int _nodeCount;
     bool _arrmode;
     bool _numAsStr;
+    bool _streamMode;
 };
 
 MgJsonStorage::MgJsonStorage() : _impl(new Impl())
@@ -80,7 +539,7 @@ const char* MgJsonStorage::stringify(bool pretty)
 
 bool MgJsonStorage::save(FILE* fp, bool pretty)
 {
-    return fp && !_impl->document().IsNull() && _impl->save(fp, pretty);
+    return fp && _impl->hasContent() && _impl->save(fp, pretty);
 }
 
 void MgJsonStorage::setArrayMode(bool arr)
@@ -93,11 +552,20 @@ void MgJsonStorage::saveNumberAsString(bool str)
     _impl->saveNumberAsString(str);
 }
 
+void MgJsonStorage::setStreamMode(bool stream)
+{
+    _impl->setStreamMode(stream);
+}
+
 MgStorage* MgJsonStorage::storageForRead(const char* content)
 {
     _impl->clear();
     if (content && *content) {
-        _impl->document().Parse<0>(content);
+        if (_impl->isStreamMode()) {
+            _impl->beginStream(new JsonReadStream(content));
+        } else {
+            _impl->document().Parse<0>(content);
+        }
         if (_impl->getError()) {
             LOGE("parse error: %s", _impl->getError());
         }
@@ -114,7 +582,11 @@ MgStorage* MgJsonStorage::storageForRead(FILE* fp)
         fread(head, 1, sizeof(head), fp);
         if (!utf8::starts_with_bom(head, head + sizeof(head)))
             fseek(fp, 0, SEEK_SET);
-        _impl->document().ParseStream<0>(_impl->createStream(fp));
+        if (_impl->isStreamMode()) {
+            _impl->beginStream(new JsonReadStream(fp));
+        } else {
+            _impl->document().ParseStream<0>(_impl->createStream(fp));
+        }
         if (_impl->getError()) {
             LOGE("parse error: %s", _impl->getError());
         }
@@ -136,13 +608,54 @@ const char* MgJsonStorage::getParseError()
 MgStorage* MgJsonStorage::storageForWrite()
 {
     _impl->clear();
+    if (_impl->isStreamMode()) {
+        _impl->beginWrite((FILE*)0, false);
+    }
+    return _impl;
+}
+
+MgStorage* MgJsonStorage::storageForWrite(FILE* fp, bool pretty)
+{
+    _impl->clear();
+    if (fp) {
+        _impl->beginWrite(fp, pretty);
+    }
     return _impl;
 }
 
+void MgJsonStorage::Impl::beginWrite(FILE* fp, bool pretty)
+{
+    if (fp) {
+        _wfs = new JsonFileWriteStream(fp);
+        _wpretty = pretty;
+        if (_arrmode)
+            return;
+        if (pretty)
+            _ws = new JsonWriteStreamT<PrettyWriter<JsonFileWriteStream> >(*_wfs);
+        else
+            _ws = new JsonWriteStreamT<Writer<JsonFileWriteStream> >(*_wfs);
+    }
+    else if (!_arrmode) {
+        _ws = new JsonWriteStreamT<Writer<StringBuffer> >(_strbuf);
+    }
+}
+
 void MgJsonStorage::Impl::clear()
 {
     _doc.SetNull();
-    _stack.clear();
+    while (!_stack.empty()) {
+        popNode();
+    }
+    _rootNext = 0;
+    delete _sroot;
+    _sroot = (JsonStreamNode*)0;
+    delete _rs;
+    _rs = (JsonReadStream*)0;
+    delete _ws;
+    _ws = (JsonWriteStream*)0;
+    delete _wfs;
+    _wfs = (JsonFileWriteStream*)0;
+    _wlevel = 0;
     _strbuf.Clear();
     _nodeCount = 0;
     if (_fs) {
@@ -171,9 +684,130 @@ bool MgJsonStorage::Impl::setError(const char* err)
     return false;
 }
 
+bool MgJsonStorage::Impl::beginStream(JsonReadStream* rs)
+{
+    _rs = rs;
+    if (_rs->expect('{')) {
+        _sroot = new JsonStreamNode();
+        return true;
+    }
+    return _rs->parseValue(_doc, _doc.GetAllocator());  // 根不是对象时整个解析
+}
+
+void MgJsonStorage::Impl::pushNode(Value* node, JsonStreamNode* snode)
+{
+    _stack.push_back(node);
+    _next.push_back(0);
+    _snodes.push_back(snode);
+}
+
+void MgJsonStorage::Impl::popNode()
+{
+    JsonStreamNode* snode = _snodes.back();
+    
+    if (snode != _sroot) {
+        delete snode;
+    }
+    _stack.pop_back();
+    _next.pop_back();
+    _snodes.pop_back();
+}
+
+Value::Member* MgJsonStorage::Impl::findMember(Value& node, SizeType& next, const char* name)
+{
+    if (!node.IsObject()) {
+        return (Value::Member*)0;
+    }
+    
+    // 多数情况下按文档顺序读取，先检查上次找到的成员的下一个成员
+    Value::MemberIterator it = node.MemberBegin() + next;
+    
+    if (it != node.MemberEnd() && strcmp(it->name.GetString(), name) == 0) {
+        next++;
+        return it;
+    }
+    for (it = node.MemberBegin(); it != node.MemberEnd(); ++it) {
+        if (strcmp(it->name.GetString(), name) == 0) {
+            next = (SizeType)(it - node.MemberBegin()) + 1;
+            return it;
+        }
+    }
+    
+    return (Value::Member*)0;
+}
+
+int MgJsonStorage::Impl::readStreamMember(JsonStreamNode* snode, const char* name, bool forNode)
+{
+    while (snode->open) {
+        if (!snode->pending) {
+            if (!_rs->nextName(snode->first, snode->name)) {
+                snode->open = false;
+                break;
+            }
+            snode->pending = true;
+        }
+        
+        bool matched = (snode->name == name);
+        
+        if (_rs->peek() == '{') {
+            if (matched && forNode) {
+                return kFoundNode;          // 由调用者解析此子节点
+            }
+            if (!forNode) {
+                break;                      // 键值在子节点之前，不为查找键值而解析子节点
+            }
+        }
+        
+        Value key(snode->name.c_str(), (SizeType)snode->name.size(), snode->allocator);
+        Value item;
+        
+        if (!_rs->parseValue(item, snode->allocator)) {
+            snode->open = false;
+            break;
+        }
+        snode->props.AddMember(key, item, snode->allocator);
+        snode->pending = false;
+        if (matched) {
+            return kFoundValue;
+        }
+    }
+    
+    return kNotFound;
+}
+
+void MgJsonStorage::Impl::endStreamNode(JsonStreamNode* snode)
+{
+    while (snode->open) {
+        if (!snode->pending && !_rs->nextName(snode->first, snode->name)) {
+            snode->open = false;
+        }
+        else {
+            snode->pending = false;
+            snode->open = _rs->skipValue();
+        }
+    }
+}
+
+const Value* MgJsonStorage::Impl::findValue(const char* name)
+{
+    if (_stack.empty()) {
+        return (const Value*)0;
+    }
+    
+    Value::Member* m = findMember(*_stack.back(), _next.back(), name);
+    JsonStreamNode* snode = _snodes.back();
+    
+    if (!m && snode && readStreamMember(snode, name, false) == kFoundValue) {
+        m = snode->props.MemberEnd() - 1;
+        _next.back() = (SizeType)(m - snode->props.MemberBegin()) + 1;
+    }
+    
+    return m ? &m->value : (const Value*)0;
+}
+
 bool MgJsonStorage::Impl::readNode(const char* name, int index, bool ended)
 {
-    if (_doc.IsNull()) {
+    if (_doc.IsNull() && !_sroot) {
         return false;
     }
     if (!ended) {                       // 开始一个新节点
@@ -188,33 +822,51 @@ bool MgJsonStorage::Impl::readNode(const char* name, int index, bool ended)
             name = tmpname;
         }
         
-        if (_stack.empty()) {
-            if (name && *name) {
-                if (!_doc.IsObject() || !_doc.HasMember(name)) {
-                    return false;           // 没有此节点
-                }
-                _stack.push_back(&_doc[name]);  // 当前JSON对象压栈
-            } else {
-                _stack.push_back(&_doc);
-            }
-            _err = (const char*)0;
+        bool isroot = _stack.empty();
+        Value &parent = !isroot ? *_stack.back() : _sroot ? _sroot->props : _doc;
+        JsonStreamNode* snode = isroot ? _sroot : _snodes.back();
+        SizeType &next = isroot ? _rootNext : _next.back();
+        Value::Member* m;
+        
+        if (isroot && (!name || !*name)) {
+            pushNode(&parent, snode);
+        }
+        else if (!isroot && parent.IsArray() && index >= 0 && index < (int)parent.Size()) {
+            pushNode(&parent[index], (JsonStreamNode*)0);
+        }
+        else if ((m = findMember(parent, next, name)) != 0) {
+            pushNode(&m->value, (JsonStreamNode*)0);    // 当前JSON对象压栈
+        }
+        else if (!snode) {
+            return false;                               // 没有此节点
         }
         else {
-            Value &parent = *_stack.back();
-            if (parent.IsArray() && index >= 0 && index < (int)parent.Size()) {
-                _stack.push_back(&parent[index]);
-            }
-            else if (parent.IsObject() && parent.HasMember(name)) {
-                _stack.push_back(&parent[name]);
-            }
-            else {
-                return false;
+            switch (readStreamMember(snode, name, true)) {
+                case kFoundNode:                        // 流式解析此子节点
+                    _rs->expect('{');
+                    snode->pending = false;
+                    snode = new JsonStreamNode();
+                    pushNode(&snode->props, snode);
+                    break;
+                case kFoundValue:
+                    m = snode->props.MemberEnd() - 1;
+                    next = (SizeType)(m - snode->props.MemberBegin()) + 1;
+                    pushNode(&m->value, (JsonStreamNode*)0);
+                    break;
+                default:
+                    return false;
             }
         }
+        if (isroot) {
+            _err = (const char*)0;
+        }
     }
     else {                              // 当前节点读取完成
         if (!_stack.empty()) {
-            _stack.pop_back();          // 出栈
+            if (_snodes.back() && _snodes.back() != _sroot) {
+                endStreamNode(_snodes.back());  // 跳过未读取的内容
+            }
+            popNode();                  // 出栈
         }
         if (_stack.empty()) {           // 根节点已出栈
             clear();
@@ -238,9 +890,25 @@ bool MgJsonStorage::Impl::writeNode(const char* name, int index, bool ended)
             name = tmpname;
         }
         
+        if (_ws) {                      // 流式写，直接输出
+            if (_wlevel == 0) {
+                _wroot = (name && *name);
+                if (_wroot) {
+                    _ws->startObject(); // 节点有名称时要有外层对象
+                }
+                _err = (const char*)0;
+            }
+            if (_wlevel > 0 || _wroot) {
+                _ws->key(name);
+            }
+            _ws->startObject();
+            _wlevel++;
+            return true;
+        }
+        
         if (_stack.empty() && (!name || !*name)) {
             _doc.SetObject();
-            _stack.push_back(&_doc);
+            pushNode(&_doc, (JsonStreamNode*)0);
             _err = (const char*)0;
             return true;
         }
@@ -252,7 +920,7 @@ bool MgJsonStorage::Impl::writeNode(const char* name, int index, bool ended)
             if (!parent.IsArray())
                 parent.SetArray();
             parent.PushBack(tmpnode, _doc.GetAllocator());
-            _stack.push_back(parent.End() - 1);
+            pushNode(parent.End() - 1, (JsonStreamNode*)0);
             return true;
         }
         
@@ -261,20 +929,40 @@ bool MgJsonStorage::Impl::writeNode(const char* name, int index, bool ended)
         if (_stack.empty()) {
             _doc.SetObject();
             _doc.AddMember(namenode, tmpnode, _doc.GetAllocator());
-            _stack.push_back(&(_doc.MemberEnd() - 1)->value); // 新节点压栈
+            pushNode(&(_doc.MemberEnd() - 1)->value, (JsonStreamNode*)0); // 新节点压栈
             _err = (const char*)0;
         }
         else {
             Value &parent = *_stack.back();
             parent.AddMember(namenode, tmpnode, _doc.GetAllocator());
-            _stack.push_back(&(parent.MemberEnd() - 1)->value);
+            pushNode(&(parent.MemberEnd() - 1)->value, (JsonStreamNode*)0);
+        }
+    }
+    else if (_ws) {
+        _nodeCount++;
+        if (_wlevel > 0) {
+            _ws->endObject();
+            if (--_wlevel == 0) {       // 最外层节点写完
+                if (_wroot) {
+                    _ws->endObject();
+                }
+                if (_wfs && !_wfs->flush()) {
+                    return setError("Fail to write file.");
+                }
+            }
         }
     }
     else {                              // 当前节点写完
         if (!_stack.empty()) {
-            _stack.pop_back();          // 出栈
+            popNode();                  // 出栈
         }
         _nodeCount++;
+        if (_stack.empty() && _wfs) {   // 数组模式下写完再输出到文件
+            acceptDocument(_doc, *_wfs, _wpretty);
+            if (!_wfs->flush()) {
+                return setError("Fail to write file.");
+            }
+        }
     }
     
     return true;
@@ -283,18 +971,11 @@ bool MgJsonStorage::Impl::writeNode(const char* name, int index, bool ended)
 const char* MgJsonStorage::Impl::stringify(bool pretty)
 {
     if (_strbuf.Size() == 0 && !_doc.IsNull()) {
-        Document::AllocatorType allocator;
-        
-        if (pretty) {
-            PrettyWriter<StringBuffer> writer(_strbuf, &allocator);
-            _doc.Accept(writer);    // DOM树转换到文本流
-        }
-        else {
-            Writer<StringBuffer> writer(_strbuf, &allocator);
-            _doc.Accept(writer);
-        }
+        acceptDocument(_doc, _strbuf, pretty);  // DOM树转换到文本流
         _doc.SetNull();
-        _stack.clear();
+        while (!_stack.empty()) {
+            popNode();
+        }
     }
     
     return _strbuf.GetString();
@@ -302,33 +983,16 @@ const char* MgJsonStorage::Impl::stringify(bool pretty)
 
 bool MgJsonStorage::Impl::save(FILE* fp, bool pretty)
 {
-    Document::AllocatorType allocator;
-    
-    if (_nodeCount < 100) {
-        if (pretty) {
-            PrettyWriter<StringBuffer> writer(_strbuf, &allocator);
-            _doc.Accept(writer);
-        }
-        else {
-            Writer<StringBuffer> writer(_strbuf, &allocator);
-            _doc.Accept(writer);
-        }
-        fputs(_strbuf.GetString(), fp);
-    } else {
-        FileStream& fs = createStream(fp);
-        
-        if (pretty) {
-            PrettyWriter<FileStream> writer(fs, &allocator);
-            document().Accept(writer);
-        }
-        else {
-            Writer<FileStream> writer(fs, &allocator);
-            document().Accept(writer);
-        }
+    if (_doc.IsNull()) {                // 已流式写到 _strbuf 中
+        return fputs(_strbuf.GetString(), fp) >= 0;
     }
+    
+    JsonFileWriteStream fs(fp);
+    
+    acceptDocument(_doc, fs, pretty);
     _strbuf.Clear();
     
-    return true;
+    return fs.flush();
 }
 
 bool MgJsonStorage::parseInt(const char* str, int& value)
@@ -341,10 +1005,10 @@ bool MgJsonStorage::parseInt(const char* str, int& value)
 int MgJsonStorage::Impl::readInt(const char* name, int defvalue)
 {
     int ret = defvalue;
-    Value *node = _stack.empty() ? (Value *)0 : _stack.back();
+    const Value *node = findValue(name);
     
-    if (node && node->HasMember(name)) {
-        const Value &item = (*node)[name];
+    if (node) {
+        const Value &item = *node;
         
         if (item.IsInt()) {
             ret = item.GetInt();
@@ -388,10 +1052,10 @@ bool MgJsonStorage::parseFloat(const char* str, double& value)
 float MgJsonStorage::Impl::readFloat(const char* name, float defvalue)
 {
     float ret = defvalue;
-    Value *node = _stack.empty() ? (Value *)0 : _stack.back();
+    const Value *node = findValue(name);
     
-    if (node && node->HasMember(name)) {
-        const Value &item = node->GetMember(name);
+    if (node) {
+        const Value &item = *node;
         
         if (item.IsDouble()) {
             ret = (float)item.GetDouble();
@@ -413,10 +1077,10 @@ float MgJsonStorage::Impl::readFloat(const char* name, float defvalue)
 double MgJsonStorage::Impl::readDouble(const char* name, double defvalue)
 {
     double ret = defvalue;
-    Value *node = _stack.empty() ? (Value *)0 : _stack.back();
+    const Value *node = findValue(name);
     
-    if (node && node->HasMember(name)) {
-        const Value &item = node->GetMember(name);
+    if (node) {
+        const Value &item = *node;
         
         if (item.IsDouble()) {
             ret = item.GetDouble();
@@ -439,11 +1103,11 @@ int MgJsonStorage::Impl::readFloatArray(const char* name, float* values,
                                         int count, bool report)
 {
     int ret = 0;
-    Value *node = _stack.empty() ? (Value *)0 : _stack.back();
+    const Value *node = findValue(name);
     
     report = report && count > 0 && values;
-    if (node && node->HasMember(name)) {
-        const Value &item = node->GetMember(name);
+    if (node) {
+        const Value &item = *node;
         
         if (item.IsArray()) {
             ret = item.Size();
@@ -484,11 +1148,11 @@ int MgJsonStorage::Impl::readDoubleArray(const char* name, double* values,
                                          int count, bool report)
 {
     int ret = 0;
-    Value *node = _stack.empty() ? (Value *)0 : _stack.back();
+    const Value *node = findValue(name);
     
     report = report && count > 0 && values;
-    if (node && node->HasMember(name)) {
-        const Value &item = node->GetMember(name);
+    if (node) {
+        const Value &item = *node;
         
         if (item.IsArray()) {
             ret = item.Size();
@@ -528,10 +1192,10 @@ int MgJsonStorage::Impl::readDoubleArray(const char* name, double* values,
 int MgJsonStorage::Impl::readString(const char* name, char* value, int count)
 {
     int ret = 0;
-    Value *node = _stack.empty() ? (Value *)0 : _stack.back();
+    const Value *node = findValue(name);
     
-    if (node && node->HasMember(name)) {
-        const Value &item = node->GetMember(name);
+    if (node) {
+        const Value &item = *node;
         
         if (item.IsString()) {
             ret = item.GetStringLength();
@@ -564,6 +1228,11 @@ void MgJsonStorage::Impl::writeInt(const char* name, int value)
 #else
         snprintf(buf, sizeof(buf), "%d", value);
 #endif
+        if (_ws) {
+            _ws->key(name);
+            _ws->writeString(buf, (SizeType)strlen(buf));
+            return;
+        }
         Value* v = new Value(buf, (unsigned)strlen(buf), _doc.GetAllocator());
         _created.push_back(v);
         
@@ -573,6 +1242,9 @@ void MgJsonStorage::Impl::writeInt(const char* name, int value)
         } else {
             _stack.back()->AddMember(name, *v, _doc.GetAllocator());
         }
+    } else if (_ws) {
+        _ws->key(name);
+        _ws->writeInt(value);
     } else {
         if (hasNum(name)) {
             Value namenode(name, _doc.GetAllocator());
@@ -588,7 +1260,12 @@ void MgJsonStorage::Impl::writeInt(const char* name, int value)
 void MgJsonStorage::Impl::writeUInt(const char* name, int value)
 {
     if (value >= 0 && value <= 0xFF && !_numAsStr) {
-        _stack.back()->AddMember(name, (unsigned)value, _doc.GetAllocator());
+        if (_ws) {
+            _ws->key(name);
+            _ws->writeUInt((unsigned)value);
+        } else {
+            _stack.back()->AddMember(name, (unsigned)value, _doc.GetAllocator());
+        }
     } else {
         char buf[20];
 #if defined(_MSC_VER) && _MSC_VER >= 1400 // VC8
@@ -596,6 +1273,11 @@ void MgJsonStorage::Impl::writeUInt(const char* name, int value)
 #else
         snprintf(buf, sizeof(buf), "0x%x", value);
 #endif
+        if (_ws) {
+            _ws->key(name);
+            _ws->writeString(buf, (SizeType)strlen(buf));
+            return;
+        }
         Value* v = new Value(buf, (unsigned)strlen(buf), _doc.GetAllocator());
         _created.push_back(v);
         
@@ -610,12 +1292,21 @@ void MgJsonStorage::Impl::writeUInt(const char* name, int value)
 
 void MgJsonStorage::Impl::writeBool(const char* name, bool value)
 {
-    _stack.back()->AddMember(name, value, _doc.GetAllocator());
+    if (_ws) {
+        _ws->key(name);
+        _ws->writeBool(value);
+    } else {
+        _stack.back()->AddMember(name, value, _doc.GetAllocator());
+    }
 }
 
 void MgJsonStorage::Impl::writeFloat(const char* name, float value)
 {
-    if (hasNum(name)) {
+    if (_ws) {
+        _ws->key(name);
+        _ws->writeDouble((double)value);
+    }
+    else if (hasNum(name)) {
         Value namenode(name, _doc.GetAllocator());
         Value* v = new Value((double)value);
         _created.push_back(v);
@@ -627,7 +1318,11 @@ void MgJsonStorage::Impl::writeFloat(const char* name, float value)
 
 void MgJsonStorage::Impl::writeDouble(const char* name, double value)
 {
-    if (hasNum(name)) {
+    if (_ws) {
+        _ws->key(name);
+        _ws->writeDouble((double)value);
+    }
+    else if (hasNum(name)) {
         Value namenode(name, _doc.GetAllocator());
         Value* v = new Value((double)value);
         _created.push_back(v);
@@ -639,6 +1334,16 @@ void MgJsonStorage::Impl::writeDouble(const char* name, double value)
 
 void MgJsonStorage::Impl::writeFloatArray(const char* name, const float* values, int count)
 {
+    if (_ws) {
+        _ws->key(name);
+        _ws->startArray();
+        for (int i = 0; i < count; i++) {
+            _ws->writeDouble((double)values[i]);
+        }
+        _ws->endArray();
+        return;
+    }
+    
     Value node(kArrayType);
     
     for (int i = 0; i < count; i++) {
@@ -649,6 +1354,16 @@ void MgJsonStorage::Impl::writeFloatArray(const char* name, const float* values,
 
 void MgJsonStorage::Impl::writeDoubleArray(const char* name, const double* values, int count)
 {
+    if (_ws) {
+        _ws->key(name);
+        _ws->startArray();
+        for (int i = 0; i < count; i++) {
+            _ws->writeDouble(values[i]);
+        }
+        _ws->endArray();
+        return;
+    }
+    
     Value node(kArrayType);
     
     for (int i = 0; i < count; i++) {
@@ -659,7 +1374,11 @@ void MgJsonStorage::Impl::writeDoubleArray(const char* name, const double* value
 
 void MgJsonStorage::Impl::writeString(const char* name, const char* value)
 {
-    if (value) {
+    if (_ws) {
+        _ws->key(name);
+        _ws->writeString(value ? value : "", value ? (SizeType)strlen(value) : 0);
+    }
+    else if (value) {
         Value* v = new Value(value, (unsigned)strlen(value), _doc.GetAllocator());
         _created.push_back(v);
         _stack.back()->AddMember(name, *v, _doc.GetAllocator());
@@ -671,11 +1390,11 @@ void MgJsonStorage::Impl::writeString(const char* name, const char* value)
 int MgJsonStorage::Impl::readIntArray(const char* name, int* values, int count, bool report)
 {
     int ret = 0;
-    Value *node = _stack.empty() ? (Value *)0 : _stack.back();
+    const Value *node = findValue(name);
     
     report = report && count > 0 && values;
-    if (node && node->HasMember(name)) {
-        const Value &item = node->GetMember(name);
+    if (node) {
+        const Value &item = *node;
         
         if (item.IsArray()) {
             ret = item.Size();
@@ -711,6 +1430,16 @@ int MgJsonStorage::Impl::readIntArray(const char* name, int* values, int count,
 
 void MgJsonStorage::Impl::writeIntArray(const char* name, const int* values, int count)
 {
+    if (_ws) {
+        _ws->key(name);
+        _ws->startArray();
+        for (int i = 0; i < count; i++) {
+            _ws->writeInt(values[i]);
+        }
+        _ws->endArray();
+        return;
+    }
+    
     Value node(kArrayType);
     
     for (int i = 0; i < count; i++) {
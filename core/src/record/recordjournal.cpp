@@ -0,0 +1,291 @@
+// recordjournal.cpp: 实现录制日志文件类 MgRecordJournal
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#include "recordjournal.h"
+#include "mgjsonstorage.h"
+#include "mglog.h"
+#include <string.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char kMagic[4] = { 'T', 'V', 'G', 'J' };
+static const char kRecMagic[4] = { 'V', 'G', 'J', 'R' };
+static const int kVersion = 2;          // 版本2增加了关键帧记录
+static const int kHeadSize = 8;         // 文件头: kMagic、版本号
+static const int kRecHeadSize = 28;     // 记录头: kRecMagic、长度、序号、时刻、标志、类型、校验值
+enum { kForward, kBackward, kKeyframe };
+
+static void putInt(char* p, unsigned v)
+{
+    p[0] = (char)(v & 0xFF);
+    p[1] = (char)((v >> 8) & 0xFF);
+    p[2] = (char)((v >> 16) & 0xFF);
+    p[3] = (char)((v >> 24) & 0xFF);
+}
+
+static unsigned getInt(const char* p)
+{
+    const unsigned char* s = (const unsigned char*)p;
+    return s[0] | (s[1] << 8) | (s[2] << 16) | ((unsigned)s[3] << 24);
+}
+
+//! FNV-1a 校验值
+static unsigned checksum(const char* data, size_t size)
+{
+    unsigned h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ (unsigned char)data[i]) * 16777619u;
+    }
+    return h;
+}
+
+MgRecordJournal::MgRecordJournal() : _fp((FILE*)0), _size(0)
+{
+}
+
+MgRecordJournal::~MgRecordJournal()
+{
+    close();
+}
+
+std::string MgRecordJournal::getFileName(const std::string& path)
+{
+    std::string filename(path);
+    if (!filename.empty() && *filename.rbegin() != '/' && *filename.rbegin() != '\\')
+        filename += '/';
+    return filename + "records.vgj";
+}
+
+bool MgRecordJournal::open(const char* filename, bool forWrite, bool create)
+{
+    close();
+    if (!create) {
+        _fp = mgopenfile(filename, forWrite ? "r+b" : "rb");
+    }
+    if (!_fp && forWrite) {
+        _fp = mgopenfile(filename, "w+b");
+        create = true;
+    }
+    if (!_fp) {
+        return false;
+    }
+    if (create) {
+        return this->create();
+    }
+
+    char head[kHeadSize];
+    if (fread(head, 1, kHeadSize, _fp) != (size_t)kHeadSize
+        || memcmp(head, kMagic, sizeof(kMagic)) != 0
+        || (int)getInt(head + 4) > kVersion) {
+        if (forWrite) {
+            LOGE("Invalid record journal, recreated: %s", filename);
+            return this->create();
+        }
+        close();
+        return false;
+    }
+    scan(forWrite);
+
+    return true;
+}
+
+bool MgRecordJournal::create()
+{
+    char head[kHeadSize];
+
+    memcpy(head, kMagic, sizeof(kMagic));
+    putInt(head + 4, kVersion);
+    _frames.clear();
+    _size = 0;
+
+    if (!truncate(0) || fseek(_fp, 0, SEEK_SET) != 0
+        || fwrite(head, 1, kHeadSize, _fp) != (size_t)kHeadSize || fflush(_fp) != 0) {
+        close();
+        return false;
+    }
+    _size = kHeadSize;
+    return true;
+}
+
+void MgRecordJournal::scan(bool forWrite)
+{
+    char head[kRecHeadSize];
+    long pos = kHeadSize, filesize;
+    std::string data;
+
+    fseek(_fp, 0, SEEK_END);
+    filesize = ftell(_fp);
+    _frames.clear();
+
+    while (pos + kRecHeadSize <= filesize) {
+        fseek(_fp, pos, SEEK_SET);
+        if (fread(head, 1, kRecHeadSize, _fp) != (size_t)kRecHeadSize
+            || memcmp(head, kRecMagic, sizeof(kRecMagic)) != 0) {
+            break;
+        }
+        long size = (long)getInt(head + 4);
+        long next = pos + kRecHeadSize + size;
+
+        if (size < 0 || next > filesize) {
+            break;
+        }
+        if (next == filesize) {             // 只有最后一个记录可能没写完，校验其内容
+            data.resize(size);
+            if (size > 0 && (fread(&data[0], 1, size, _fp) != (size_t)size
+                             || checksum(data.data(), size) != getInt(head + 24))) {
+                break;
+            }
+        }
+        addRecord((int)getInt(head + 8), (int)getInt(head + 20), pos,
+                  (int)getInt(head + 12), (int)getInt(head + 16));
+        pos = next;
+    }
+
+    _size = pos;
+    if (pos < filesize) {
+        if (forWrite && truncate(pos)) {
+            LOGD("Truncate %ld bytes of incomplete record in journal", filesize - pos);
+        }
+    }
+}
+
+void MgRecordJournal::close()
+{
+    if (_fp) {
+        fclose(_fp);
+        _fp = (FILE*)0;
+    }
+    _frames.clear();
+    _size = 0;
+}
+
+void MgRecordJournal::addRecord(int index, int type, long pos, int tick, int flags)
+{
+    if (index < 0 || type < kForward || type > kKeyframe) {
+        return;
+    }
+    if (type == kForward || index >= (int)_frames.size()) {     // 从该帧重新录制，丢弃后面的帧
+        Frame frame = { { -1, -1, -1 }, 0, 0 };
+        _frames.resize(index + 1, frame);
+        _frames[index] = frame;
+    }
+    _frames[index].pos[type] = pos;
+    if (type == kForward) {
+        _frames[index].tick = tick;
+        _frames[index].flags = flags;
+    }
+}
+
+bool MgRecordJournal::append(int index, bool back, int tick, int flags, const std::string& data)
+{
+    return appendRecord(index, back ? kBackward : kForward, tick, flags, data);
+}
+
+bool MgRecordJournal::appendKeyframe(int index, int tick, const std::string& data)
+{
+    return appendRecord(index, kKeyframe, tick, 0, data);
+}
+
+bool MgRecordJournal::appendRecord(int index, int type, int tick, int flags, const std::string& data)
+{
+    char head[kRecHeadSize];
+
+    if (!_fp) {
+        return false;
+    }
+    memcpy(head, kRecMagic, sizeof(kRecMagic));
+    putInt(head + 4, (unsigned)data.size());
+    putInt(head + 8, (unsigned)index);
+    putInt(head + 12, (unsigned)tick);
+    putInt(head + 16, (unsigned)flags);
+    putInt(head + 20, (unsigned)type);
+    putInt(head + 24, checksum(data.data(), data.size()));
+
+    bool ret = (fseek(_fp, _size, SEEK_SET) == 0
+                && fwrite(head, 1, kRecHeadSize, _fp) == (size_t)kRecHeadSize
+                && (data.empty() || fwrite(data.data(), 1, data.size(), _fp) == data.size())
+                && fflush(_fp) == 0);
+    if (ret) {
+        addRecord(index, type, _size, tick, flags);
+        _size += kRecHeadSize + (long)data.size();
+    } else {
+        truncate(_size);
+    }
+
+    return ret;
+}
+
+bool MgRecordJournal::read(int index, bool back, std::string& data)
+{
+    return readRecord(index, back ? kBackward : kForward, data);
+}
+
+bool MgRecordJournal::readKeyframe(int index, std::string& data)
+{
+    return readRecord(index, kKeyframe, data);
+}
+
+bool MgRecordJournal::hasKeyframe(int index) const
+{
+    return index >= 0 && index < (int)_frames.size() && _frames[index].pos[kKeyframe] >= 0;
+}
+
+bool MgRecordJournal::readRecord(int index, int type, std::string& data)
+{
+    char head[kRecHeadSize];
+    long pos = (_fp && index >= 0 && index < (int)_frames.size())
+        ? _frames[index].pos[type] : -1;
+
+    if (pos < 0 || fseek(_fp, pos, SEEK_SET) != 0
+        || fread(head, 1, kRecHeadSize, _fp) != (size_t)kRecHeadSize) {
+        return false;
+    }
+
+    size_t size = getInt(head + 4);
+    if (pos + kRecHeadSize + (long)size > _size) {
+        return false;
+    }
+    data.resize(size);
+
+    return (memcmp(head, kRecMagic, sizeof(kRecMagic)) == 0
+            && (int)getInt(head + 8) == index && (int)getInt(head + 20) == type
+            && (size == 0 || fread(&data[0], 1, size, _fp) == size)
+            && checksum(data.data(), size) == getInt(head + 24));
+}
+
+bool MgRecordJournal::getFrame(int index, int& tick, int& flags) const
+{
+    if (index < 0 || index >= (int)_frames.size() || _frames[index].pos[0] < 0) {
+        return false;
+    }
+    tick = _frames[index].tick;
+    flags = _frames[index].flags;
+    return true;
+}
+
+bool MgRecordJournal::truncate(long size)
+{
+    if (!_fp || fflush(_fp) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _chsize(_fileno(_fp), size) == 0;
+#else
+    return ftruncate(fileno(_fp), size) == 0;
+#endif
+}
+
+bool MgRecordJournal::sync()
+{
+    if (!_fp || fflush(_fp) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _commit(_fileno(_fp)) == 0;
+#else
+    return fsync(fileno(_fp)) == 0;
+#endif
+}
@@ -0,0 +1,80 @@
+//! \file recordjournal.h
+//! \brief 定义录制日志文件类 MgRecordJournal
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_RECORD_JOURNAL_H_
+#define TOUCHVG_RECORD_JOURNAL_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+//! 录制日志文件，将各帧的正向和反向记录依次追加到一个文件中，供 MgRecordShapes 内部使用
+/*! 文件以 "TVGJ" 和版本号开头，其后为各个记录，每个记录为28字节的记录头和内容。
+    记录头依次为 "VGJR"、内容长度、帧序号、时刻、标志、类型(0为正向、1为反向、2为关键帧)和内容的校验值，
+    整数为4字节小端字节序。打开时扫描各记录头建立帧索引，可直接定位到某一帧。
+    关键帧记录为该帧之后的完整文档，回放时从最近的关键帧开始应用后续各帧。
+    某帧的正向记录之后的记录表示从该帧重新录制，丢弃此前序号更大的帧。
+    可写打开时截断末尾写了一部分的记录，以便异常退出后继续录制。
+ */
+class MgRecordJournal
+{
+public:
+    MgRecordJournal();
+    ~MgRecordJournal();
+
+    //! 返回录制目录中的日志文件名
+    static std::string getFileName(const std::string& path);
+
+    //! 打开日志文件并建立帧索引，create 为 true 时清空原有内容
+    bool open(const char* filename, bool forWrite, bool create);
+
+    //! 关闭文件
+    void close();
+
+    //! 返回是否已打开
+    bool isOpen() const { return !!_fp; }
+
+    //! 追加一帧的正向(back=false)或反向记录
+    bool append(int index, bool back, int tick, int flags, const std::string& data);
+
+    //! 读取一帧的正向或反向记录，没有该记录或校验失败时返回 false
+    bool read(int index, bool back, std::string& data);
+
+    //! 返回帧数，即最大帧序号加1
+    int getFrameCount() const { return (int)_frames.size(); }
+
+    //! 追加一帧的关键帧记录
+    bool appendKeyframe(int index, int tick, const std::string& data);
+
+    //! 读取一帧的关键帧记录
+    bool readKeyframe(int index, std::string& data);
+
+    //! 返回该帧是否有关键帧记录
+    bool hasKeyframe(int index) const;
+
+    //! 得到有正向记录的帧的时刻和标志
+    bool getFrame(int index, int& tick, int& flags) const;
+
+    //! 将已写内容刷到存储设备
+    bool sync();
+
+private:
+    struct Frame {
+        long    pos[3];     // 正向、反向和关键帧记录的位置，-1表示没有
+        int     tick;
+        int     flags;
+    };
+    void addRecord(int index, int type, long pos, int tick, int flags);
+    bool appendRecord(int index, int type, int tick, int flags, const std::string& data);
+    bool readRecord(int index, int type, std::string& data);
+    bool truncate(long size);
+    bool create();
+    void scan(bool forWrite);
+
+    std::vector<Frame> _frames;
+    FILE*   _fp;
+    long    _size;          // 有效内容的长度
+};
+
+#endif // TOUCHVG_RECORD_JOURNAL_H_
@@ -7,20 +7,77 @@
 #include "mglayer.h"
 #include "mglines.h"
 #include "mgjsonstorage.h"
+#include "mgbinarystorage.h"
 #include "mgstorage.h"
 #include "mgvector.h"
 #include "mglog.h"
+#include "githread.h"
+#include "recordjournal.h"
 #include <sstream>
-#include <map>
+#include <set>
+#include <deque>
+#include <algorithm>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 static const bool VG_PRETTY = false;
+static const int kMaxPendingFrames = 16;    // 写线程中未写完的帧数上限，超过则 recordStep 等待
+
+//! 一帧记录的快照，在调用线程中比较图形版本后生成，在写线程中序列化并写文件
+/*! 只保持图形和文档的引用，文档中的图形在提交后不再改变，可在写线程中读取。
+ */
+struct RecordFrame
+{
+    int             index;              // 帧序号
+    int             tick;
+    int             fileTick;           // 写在记录文件中的时刻，为上一帧的时刻
+    int             flags[2];
+    int             changeCount[2];     // 新、旧改变计数
+    bool            binary;
+    std::string     filename[2];        // .vgr 和 .vgu 文件名
+    MgShapeDoc      *doc;               // 用于写图形列表序号和页面变换，可为NULL
+    std::vector<MgShape*> shapes[2];    // 正向写新增和改变的图形，反向写原图形(可为NULL)
+    std::vector<int> delids[2];         // 正向删除的图形ID，反向删除的新图形ID
+    std::vector<int> reorder[2];        // 正向为现在的图形ID顺序，反向为原顺序
+    bool            recorded;           // 是否比较了图形列表
+    MgShapes        *dynShapes;         // 动态图形，增量记录时也保留以便写关键帧
+    std::vector<float> dyninc;          // 动态折线的新增点
+    int             indexNo;            // 在 records.json 中的序号，-1表示不写
+    bool            saveIndex;          // 是否保存 records.json
+    GiSemaphore     *barrier;           // 非NULL时为同步点，写完此前的帧后通知
+    bool            sync;               // 同步点是否将已写文件刷到存储设备
+    
+    RecordFrame() : index(0), tick(0), fileTick(0), binary(false), doc(NULL), recorded(false), dynShapes(NULL)
+        , indexNo(-1), saveIndex(false), barrier(NULL), sync(false)
+    {
+        flags[0] = flags[1] = 0;
+        changeCount[0] = changeCount[1] = 0;
+    }
+    ~RecordFrame() {
+        for (int i = 0; i < 2; i++) {
+            for (size_t j = 0; j < shapes[i].size(); j++) {
+                MgObject::release_pointer(shapes[i][j]);
+            }
+        }
+        MgObject::release_pointer(doc);
+        MgObject::release_pointer(dynShapes);
+    }
+    void addShape(int i, const MgShape* sp) {
+        MgShape* p = const_cast<MgShape*>(sp);
+        if (p)
+            p->addRef();
+        shapes[i].push_back(p);
+    }
+};
 
 struct MgRecordShapes::Impl
 {
     std::string     path;
     int             type;
-    std::map<int, long> id2ver;
-    std::vector<int>    lastids;
+    long            epoch;              // 上次比较时当前图层的修改记录位置
     volatile int    fileCount;
     volatile int    maxCount;
     volatile long   loading;
@@ -29,32 +86,66 @@ struct MgRecordShapes::Impl
     volatile long   startTick;
     int             tick, lastTick;
     int             flags[2];
-    int             shapeCount;
-    MgJsonStorage   *js[3];
-    MgStorage       *s[3];
+    MgJsonStorage   *js;                // records.json，启动写线程后只在写线程中使用
+    MgStorage       *s;
+    bool            binary;
+    bool            journaled;          // 是否写到日志文件中，而不是每帧两个文件
+    bool            restored;           // 是否继续录制，此时日志文件不清空
+    bool            journalTried;       // 回放时是否已查找过日志文件
+    MgRecordJournal *journal;
+    int             keySteps;           // 每隔多少帧写一个关键帧，0表示不按帧数
+    int             keyBytes;           // 正向记录累计多少字节后写一个关键帧，0表示不按字节数
+    int             stepsAfterKey;      // 上一关键帧后的帧数，只在写线程中使用
+    long            bytesAfterKey;      // 上一关键帧后的正向记录字节数，只在写线程中使用
+    std::vector<int> frameTicks;        // 回放定位用的各帧时刻
+    std::vector<int> keyframes;         // 回放定位用的关键帧序号，从小到大
+    
+    GiThread        writer;             // 写线程
+    GiMutex         mutex;              // 保护 frames
+    GiSemaphore     slots;              // 队列空位
+    GiSemaphore     pending;            // 队列中的帧数
+    std::deque<RecordFrame*> frames;
+    std::set<std::string>    unsynced;  // 已写但未刷到存储设备的文件，只在写线程中使用
     
-    Impl(long curTick) : fileCount(0), maxCount(0), loading(0), lastDoc(NULL)
+    Impl(long curTick) : epoch(0), fileCount(0), maxCount(0), loading(0), lastDoc(NULL)
         , lastShape(NULL), startTick(curTick), tick(0), lastTick(0)
+        , js(NULL), s(NULL), binary(false), journaled(false), restored(false)
+        , journalTried(false), journal(NULL), keySteps(0), keyBytes(0)
+        , stepsAfterKey(0), bytesAfterKey(0), slots(kMaxPendingFrames)
     {
         memset(flags, 0, sizeof(flags));
-        memset(js, 0, sizeof(js));
-        memset(s, 0, sizeof(s));
     }
     ~Impl() {
+        stopWriter();
+        delete journal;
         MgObject::release_pointer(lastDoc);
         MgObject::release_pointer(lastShape);
     }
     
-    void beginJsonFile();
-    bool saveJsonFile();
+    RecordFrame* beginFrame();
+    void pushFrame(RecordFrame* f);
+    void flush(bool sync);
+    void stopWriter();
+    static void writerProc(void* arg);
+    void writeFrame(RecordFrame* f);
+    void writeShapes(RecordFrame* f, MgStorage* s[2]);
+    bool writeKeyframe(RecordFrame* f);
+    void syncFiles();
     std::string getFileName(bool back, int index = -1) const;
+    std::string getKeyFileName(int index) const;
+    MgRecordJournal* getJournal();
+    MgStorage* openRecord(bool back, int index, MgJsonStorage& js,
+                          MgBinaryStorage& bs, std::string& data);
+    MgStorage* openKeyframe(int index, MgJsonStorage& js, MgBinaryStorage& bs, std::string& data);
+    bool applyKeyframe(int index, MgShapeFactory *f, MgShapeDoc* doc, MgShapes* dyns);
+    bool loadSeekIndex();
     void resetVersion(const MgShapes* shapes);
     void startRecord();
     void stopRecordIndex();
     bool saveIndexFile(bool ended);
-    void recordShapes(const MgShapes* shapes);
+    void recordShapes(const MgShapes* shapes, RecordFrame* f);
     bool forUndo() const { return type == 0; }
-    bool incrementRecord(MgShapes* dynShapes);
+    bool incrementRecord(MgShapes* dynShapes, RecordFrame* f);
 };
 
 MgRecordShapes::MgRecordShapes(const char* path, MgShapeDoc* doc, bool forUndo, long curTick)
@@ -78,6 +169,11 @@ MgRecordShapes::~MgRecordShapes()
     delete _im;
 }
 
+//! 按文件头以二进制或JSON格式读取
+static MgStorage* storageForRead(FILE* fp, MgJsonStorage& js, MgBinaryStorage& bs)
+{
+    return MgBinaryStorage::isBinaryFile(fp) ? bs.storageForRead(fp) : js.storageForRead(fp);
+}
 void MgRecordShapes::stopRecordIndex()
 {
     _im->stopRecordIndex();
@@ -125,13 +221,15 @@ bool MgRecordShapes::onResume(long ticks)
 bool MgRecordShapes::recordStep(long tick, long changeCountOld, long changeCountNew, MgShapeDoc* doc,
                                 MgShapes* dynShapes, const std::vector<MgShapes*>& extShapes)
 {
-    _im->beginJsonFile();
+    RecordFrame* f = _im->beginFrame();
+    f->fileTick = _im->tick;
     _im->tick = (int)tick;
+    f->tick = (int)tick;
     
     bool needDyn = _im->lastDoc && !_im->forUndo();
     if (doc) {
         if (_im->lastDoc) {     // undo() set lastDoc as null
-            _im->recordShapes(doc->getCurrentLayer());
+            _im->recordShapes(doc->getCurrentLayer(), f);
             MgObject::release_pointer(_im->lastDoc);
             if (_im->flags[0])
                 MgObject::release_pointer(_im->lastShape);
@@ -149,38 +247,55 @@ bool MgRecordShapes::recordStep(long tick, long changeCountOld, long changeCount
         dynShapes = newsp;
     }
     if (needDyn && dynShapes && dynShapes->getShapeCount() > 0) {
-        if (!_im->incrementRecord(dynShapes)) {
+        if (!_im->incrementRecord(dynShapes, f)) {
             _im->flags[0] |= DYN;
-            _im->s[0]->writeNode("dynamic", -1, false);
-            dynShapes->save(_im->s[0]);
-            _im->s[0]->writeNode("dynamic", -1, true);
+            f->dynShapes = dynShapes;   // 在写线程中保存并释放
+            dynShapes = NULL;
+        } else if (!f->dyninc.empty()) {
+            f->dynShapes = dynShapes;   // 只写新增点，完整图形用于写关键帧
+            dynShapes = NULL;
         }
     }
     MgObject::release_pointer(dynShapes);
     
-    _im->s[0]->writeInt("flags", _im->flags[0]);
-    if (_im->flags[0] != DYN) {
-        _im->s[0]->writeInt("changeCount", (int)changeCountNew);
-        _im->s[1]->writeInt("changeCount", (int)changeCountOld);
+    f->changeCount[0] = (int)changeCountNew;
+    f->changeCount[1] = (int)changeCountOld;
+    
+    if (_im->flags[0] == DYN && _im->tick - _im->lastTick < 20) {
+        //LOGD("Ignore record at the same time %d", tick);
+        _im->flags[0] = _im->flags[1] = 0;
+    }
+    bool ret = _im->flags[0] != 0 || _im->flags[1] != 0;
+    
+    if (!ret) {
+        delete f;
+        return false;
     }
     
-    bool ret = _im->saveJsonFile();
+    f->flags[0] = _im->flags[0];
+    f->flags[1] = _im->flags[1];
+    f->doc = _im->lastDoc;
+    if (f->doc)
+        f->doc->addRef();
+    f->index = _im->fileCount;
+    for (int i = 0; i < 2; i++) {
+        if (f->flags[i] && !_im->journaled)
+            f->filename[i] = _im->getFileName(i > 0);
+    }
     
-    if (ret && _im->s[2]) {
-        _im->s[2]->writeNode("r", _im->fileCount - 2, false);
-        _im->s[2]->writeInt("tick", _im->tick);
-        _im->s[2]->writeInt("flags", _im->flags[0]);
-        _im->s[2]->writeNode("r", _im->fileCount - 2, true);
-        
-        if (_im->fileCount % 10 == 0 || _im->flags[0] != MgRecordShapes::DYN) {
-            _im->saveIndexFile(false);
-        }
+    _im->maxCount = ++_im->fileCount;
+    _im->lastTick = _im->tick;
+    
+    if (_im->s) {
+        f->indexNo = _im->fileCount - 2;
+        f->saveIndex = (_im->fileCount % 10 == 0 || _im->flags[0] != MgRecordShapes::DYN);
     }
+    _im->pushFrame(f);
     
     return ret;
 }
 
-bool MgRecordShapes::Impl::incrementRecord(MgShapes* dynShapes)
+bool MgRecordShapes::Impl::incrementRecord(MgShapes* dynShapes, RecordFrame* f)
 {
     bool ret = false;
     
@@ -196,9 +311,8 @@ bool MgRecordShapes::Impl::incrementRecord(MgShapes* dynShapes)
         const MgBaseLines* lines = (const MgBaseLines*)dynShapes->getLastShape()->shapec();
         
         if (lines->isIncrementFrom(*oldlines)) {
-            const Point2d* pts = lines->getPoints() + oldlines->getPointCount();
-            s[0]->writeFloatArray("dyninc", (const float*)pts,
-                                  (lines->getPointCount() - oldlines->getPointCount()) * 2);
+            const float* pts = (const float*)(lines->getPoints() + oldlines->getPointCount());
+            f->dyninc.assign(pts, pts + (lines->getPointCount() - oldlines->getPointCount()) * 2);
             flags[0] |= DYN;
             ret = true;
         }
@@ -219,29 +333,29 @@ void MgRecordShapes::resetDoc(MgShapeDoc* doc)
     }
 }
 
-void MgRecordShapes::restore(int index, int count, int tick, long curTick)
+//! 读取各帧的序号、时刻和标志，keys 不为NULL时还得到关键帧的序号
+static bool loadFrames(std::string path, std::vector<int>& arr, std::vector<int>* keys)
 {
-    std::vector<int> arr;
+    if (*path.rbegin() != '/' && *path.rbegin() != '\\')
+        path += '/';
     
-    if (_im->s[2] && loadFrameIndex(_im->path, arr)) {
-        for (unsigned i = 0; i + 2 < arr.size(); i += 3) {
-            _im->s[2]->writeNode("r", i / 3, false);
-            _im->s[2]->writeInt("tick", arr[i + 1]);
-            _im->s[2]->writeInt("flags", arr[i + 2]);
-            _im->s[2]->writeNode("r", i / 3, true);
+    MgRecordJournal journal;
+    
+    if (journal.open(MgRecordJournal::getFileName(path).c_str(), false, false)) {
+        int tick, flags;
+        for (int i = 1; i < journal.getFrameCount(); i++) {
+            if (journal.getFrame(i, tick, flags)) {
+                arr.push_back(i);
+                arr.push_back(tick);
+                arr.push_back(flags);
+            }
+            if (keys && journal.hasKeyframe(i)) {
+                keys->push_back(i);
+            }
         }
+        return true;
     }
-    _im->fileCount = index;
-    _im->maxCount = count ? count : index;
-    _im->startTick = curTick - tick;
-    LOGD("restore fileCount=%d, maxCount=%d, startTick=%d, frames=%d",
-         _im->fileCount, _im->maxCount, tick, (int)arr.size() / 3);
-}
-
-bool MgRecordShapes::loadFrameIndex(std::string path, std::vector<int>& arr)
-{
-    if (*path.rbegin() != '/' && *path.rbegin() != '\\')
-        path += '/';
+    
     path += "records.json";
     
     FILE *fp = mgopenfile(path.c_str(), "rt");
@@ -260,14 +374,56 @@ bool MgRecordShapes::loadFrameIndex(std::string path, std::vector<int>& arr)
         arr.push_back(i + 1);
         arr.push_back(s->readInt("tick", 0));
         arr.push_back(s->readInt("flags", 0));
+        if (keys && s->readInt("key", 0)) {
+            keys->push_back(i + 1);
+        }
         s->readNode("r", i, true);
     }
     
     return s->readNode("records", -1, true);
 }
 
+void MgRecordShapes::restore(int index, int count, int tick, long curTick)
+{
+    std::vector<int> arr, keys;
+    
+    _im->flush(false);
+    _im->restored = true;
+    if (_im->journaled && _im->getJournal()) {      // 截断末尾不完整的记录，只恢复完整的帧
+        int n = std::max(1, _im->journal->getFrameCount());
+        index = std::min(index, n);
+        count = std::min(count, n);
+    }
+    if (_im->s && loadFrames(_im->path, arr, &keys)) {
+        for (unsigned i = 0; i + 2 < arr.size(); i += 3) {
+            _im->s->writeNode("r", i / 3, false);
+            _im->s->writeInt("tick", arr[i + 1]);
+            _im->s->writeInt("flags", arr[i + 2]);
+            if (std::binary_search(keys.begin(), keys.end(), arr[i])) {
+                _im->s->writeInt("key", 1);
+            }
+            _im->s->writeNode("r", i / 3, true);
+        }
+    }
+    _im->fileCount = index;
+    _im->maxCount = count ? count : index;
+    _im->startTick = curTick - tick;
+    _im->stepsAfterKey = 0;
+    _im->bytesAfterKey = 0;
+    LOGD("restore fileCount=%d, maxCount=%d, startTick=%d, frames=%d",
+         _im->fileCount, _im->maxCount, tick, (int)arr.size() / 3);
+}
+
+bool MgRecordShapes::loadFrameIndex(std::string path, std::vector<int>& arr)
+{
+    return loadFrames(path, arr, (std::vector<int>*)0);
+}
+
 std::string MgRecordShapes::getFileName(bool back, int index) const
 {
+    if (_im->journaled && index != 0) {
+        return MgRecordJournal::getFileName(_im->path);
+    }
     return _im->getFileName(back, index);
 }
 
@@ -291,6 +447,34 @@ bool MgRecordShapes::canRedo() const
     return _im->fileCount < _im->maxCount && !_im->loading;
 }
 
+void MgRecordShapes::flush(bool sync)
+{
+    _im->flush(sync);
+}
+
+void MgRecordShapes::setBinaryFormat(bool binary)
+{
+    _im->binary = binary;
+}
+
+void MgRecordShapes::setJournalFormat(bool journal)
+{
+    _im->flush(false);
+    _im->journaled = journal && !isPlaying();
+    if (_im->journaled && _im->js) {        // 日志文件中已有各帧的时刻和标志
+        delete _im->js;
+        _im->js = NULL;
+        _im->s = NULL;
+    }
+}
+
+void MgRecordShapes::setKeyframeInterval(int steps, int bytes)
+{
+    _im->flush(false);
+    _im->keySteps = std::max(0, steps);
+    _im->keyBytes = std::max(0, bytes);
+}
+
 void MgRecordShapes::setLoading(bool loading)
 {
     if (loading)
@@ -305,15 +489,16 @@ bool MgRecordShapes::undo(MgShapeFactory *factory, MgShapeDoc* doc, long* change
         return false;
     
     giAtomicIncrement(&_im->loading);
+    _im->flush(false);
     
-    std::string fn(_im->getFileName(true, _im->fileCount - 1));
-    int ret = applyFile(_im->tick, factory, doc, NULL, fn.c_str(), changeCount);
+    int index = _im->fileCount - 1;
+    int ret = applyFile(true, index, factory, doc, NULL, changeCount);
     
     if (ret) {
         _im->fileCount--;
         _im->resetVersion(doc->getCurrentLayer());
         MgObject::release_pointer(_im->lastDoc);
-        LOGD("Undo with %s", fn.c_str());
+        LOGD("Undo with record %d", index);
     }
     giAtomicDecrement(&_im->loading);
     
@@ -326,15 +511,16 @@ bool MgRecordShapes::redo(MgShapeFactory *factory, MgShapeDoc* doc, long* change
         return false;
     
     giAtomicIncrement(&_im->loading);
+    _im->flush(false);
     
-    std::string fn(_im->getFileName(false, _im->fileCount));
-    int ret = applyFile(_im->tick, factory, doc, NULL, fn.c_str(), changeCount);
+    int index = _im->fileCount;
+    int ret = applyFile(false, index, factory, doc, NULL, changeCount);
     
     if (ret) {
         _im->fileCount++;
         _im->resetVersion(doc->getCurrentLayer());
         MgObject::release_pointer(_im->lastDoc);
-        LOGD("Redo with %s", fn.c_str());
+        LOGD("Redo with record %d", index);
     }
     giAtomicDecrement(&_im->loading);
     
@@ -352,183 +538,432 @@ static void saveIds(const std::vector<int>& ids, MgStorage *s, const char* group
     s->writeNode(group, -1, true);
 }
 
-void MgRecordShapes::Impl::recordShapes(const MgShapes* shapes)
+static bool lessIndex(const std::pair<int, const MgShape*>& a, const std::pair<int, const MgShape*>& b)
 {
-    MgShapeIterator it(shapes);
-    std::map<int, long> tmpids(id2ver);
-    std::map<int, long>::iterator i;
-    int i2 = 0;
+    return a.first < b.first;
+}
+
+void MgRecordShapes::Impl::recordShapes(const MgShapes* shapes, RecordFrame* f)
+{
+    const MgShapes* oldShapes = lastDoc->getCurrentLayer();
+    std::vector<std::pair<int, const MgShape*> > nowsps;    // 现有的可能改变了的图形，按显示顺序
+    std::vector<int> changes, delids;
+    bool reordered = false;
     int sid;
-    std::vector<int> newids, nowids;
+    size_t i;
     
-    s[0]->writeNode("shapes", shapes->getIndex(), false);
-    s[1]->writeNode("shapes", shapes->getIndex(), false);
+    f->recorded = true;
+    if (shapes->getChangesSince(epoch, changes)) {              // 只比较修改记录中的图形
+        std::vector<int> ids;
+        
+        for (i = 0; i + 1 < changes.size(); i += 2) {
+            if (changes[i + 1] == MgShapes::kShapeReordered) {
+                reordered = true;
+            } else {
+                ids.push_back(changes[i]);
+            }
+        }
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        
+        for (i = 0; i < ids.size(); i++) {
+            const MgShape* sp = shapes->findShape(ids[i]);
+            if (sp) {
+                nowsps.push_back(std::make_pair(shapes->getShapeIndex(ids[i]), sp));
+            } else if (oldShapes->findShape(ids[i])) {
+                delids.push_back(ids[i]);                       // 按ID顺序
+            }
+        }
+        std::sort(nowsps.begin(), nowsps.end(), lessIndex);
+    } else {                                                    // 修改记录不可用，比较所有图形
+        MgShapeIterator it(shapes);
+        MgShapeIterator oldit(oldShapes);
+        
+        while (const MgShape* sp = it.getNext()) {
+            nowsps.push_back(std::make_pair(0, sp));
+        }
+        while (const MgShape* sp = oldit.getNext()) {
+            if (!shapes->findShape(sp->getID()))
+                delids.push_back(sp->getID());
+        }
+        std::sort(delids.begin(), delids.end());
+        reordered = true;
+    }
     
-    while (const MgShape* sp = it.getNext()) {
-        sid = sp->getID();
-        i = id2ver.find(sid);                                   // 查找是否之前已存在
-        nowids.push_back(sid);
+    for (i = 0; i < nowsps.size(); i++) {
+        const MgShape* sp = nowsps[i].second;
+        const MgShape* oldsp = oldShapes->findShape(sp->getID());
         
-        if (i == id2ver.end()) {                                // 是新增的图形
-            newids.push_back(sid);
-            id2ver[sid] = sp->shapec()->getChangeCount();       // 增加记录版本
-            shapes->saveShape(s[0], sp, shapeCount++);          // 写图形节点
+        if (!oldsp) {                                           // 是新增的图形
+            f->delids[1].push_back(sp->getID());
+            f->addShape(0, sp);                                 // 待写图形节点
             flags[0] |= flags[0] ? EDIT : ADD;
-        } else {
-            tmpids.erase(tmpids.find(sid));                     // 标记是已有图形
-            if (i->second != sp->shapec()->getChangeCount()) {  // 改变的图形
-                i->second = sp->shapec()->getChangeCount();
-                id2ver[sid] = sp->shapec()->getChangeCount();   // 更新版本
-                shapes->saveShape(s[0], sp, shapeCount++);
-                flags[0] |= EDIT;
-                i2 += shapes->saveShape(s[1], lastDoc->findShape(sid), i2) ? 1 : 0;
-                flags[1] |= EDIT;
-            }
+        } else if (oldsp->shapec()->getChangeCount() != sp->shapec()->getChangeCount()) {
+            f->addShape(0, sp);                                 // 改变的图形
+            flags[0] |= EDIT;
+            f->addShape(1, oldsp);
+            flags[1] |= EDIT;
         }
     }
-    s[0]->writeNode("shapes", shapes->getIndex(), true);
-    s[0]->writeInt("count", shapeCount += (int)tmpids.size());
     
-    if (!tmpids.empty()) {                                      // 之前存在，现在已删除
+    if (!delids.empty()) {                                      // 之前存在，现在已删除
         flags[0] |= DEL;
-        s[0]->writeNode("delete", -1, false);
-        int j = 0;
-        for (i = tmpids.begin(); i != tmpids.end(); ++i) {
-            sid = i->first;
-            id2ver.erase(id2ver.find(sid));
-            
-            std::stringstream ss;
-            ss << "d" << j++;
-            s[0]->writeInt(ss.str().c_str(), sid);              // 记下删除的图形的ID
+        for (i = 0; i < delids.size(); i++) {
+            sid = delids[i];
+            f->delids[0].push_back(sid);                        // 记下删除的图形的ID
             flags[1] |= ADD;
-            i2 += shapes->saveShape(s[1], lastDoc->findShape(sid), i2) ? 1 : 0;
+            f->addShape(1, oldShapes->findShape(sid));
         }
-        s[0]->writeNode("delete", -1, true);
     }
-    
-    s[1]->writeNode("shapes", shapes->getIndex(), true);
-    
-    if (!newids.empty()) {
+    if (!f->delids[1].empty()) {
         flags[1] |= DEL;
-        s[1]->writeNode("delete", -1, false);
-        for (unsigned j = 0; j < newids.size(); j++) {
-            std::stringstream ss;
-            ss << "d" << j;
-            s[1]->writeInt(ss.str().c_str(), newids[j]);
+    }
+    if (!flags[0] && reordered && shapes->getShapeCount() == oldShapes->getShapeCount()) {
+        MgShapeIterator it(shapes);
+        MgShapeIterator oldit(oldShapes);
+        std::vector<int> nowids, lastids;
+        
+        while (const MgShape* sp = it.getNext()) {
+            nowids.push_back(sp->getID());
+        }
+        while (const MgShape* sp = oldit.getNext()) {
+            lastids.push_back(sp->getID());
         }
-        s[1]->writeNode("delete", -1, true);
+        if (nowids != lastids) {
+            flags[0] |= EDIT;
+            flags[1] |= EDIT;
+            f->reorder[1] = lastids;
+            f->reorder[0] = nowids;
+        }
+    }
+    epoch = shapes->getChangeEpoch();
+    f->flags[1] = flags[1];
+}
+
+void MgRecordShapes::Impl::writeShapes(RecordFrame* f, MgStorage* s[2])
+{
+    const MgShapes* shapes = f->doc->getCurrentLayer();
+    int i2 = 0, n = 0;
+    size_t j;
+    
+    s[0]->writeNode("shapes", shapes->getIndex(), false);
+    for (j = 0; j < f->shapes[0].size(); j++) {
+        shapes->saveShape(s[0], f->shapes[0][j], n++);
+    }
+    s[0]->writeNode("shapes", shapes->getIndex(), true);
+    s[0]->writeInt("count", n + (int)f->delids[0].size());
+    if (!f->delids[0].empty()) {
+        saveIds(f->delids[0], s[0], "delete");
     }
-    if (!flags[0] && nowids.size() == lastids.size() && nowids != lastids) {
-        flags[0] |= EDIT;
-        flags[1] |= EDIT;
-        saveIds(lastids, s[1], "reorder");
-        saveIds(nowids, s[0], "reorder");
+    
+    s[1]->writeNode("shapes", shapes->getIndex(), false);
+    for (j = 0; j < f->shapes[1].size(); j++) {
+        i2 += shapes->saveShape(s[1], f->shapes[1][j], i2) ? 1 : 0;
+    }
+    s[1]->writeNode("shapes", shapes->getIndex(), true);
+    if (!f->delids[1].empty()) {
+        saveIds(f->delids[1], s[1], "delete");
+    }
+    if (!f->reorder[0].empty()) {
+        saveIds(f->reorder[1], s[1], "reorder");
+        saveIds(f->reorder[0], s[0], "reorder");
     }
-    lastids = nowids;
     
-    s[1]->writeInt("flags", flags[1]);
-    s[1]->writeInt("count", i2 + (int)newids.size());
+    s[1]->writeInt("flags", f->flags[1]);
+    s[1]->writeInt("count", i2 + (int)f->delids[1].size());
 }
 
 void MgRecordShapes::Impl::resetVersion(const MgShapes* shapes)
 {
-    MgShapeIterator it(shapes);
-    
-    id2ver.clear();
-    lastids.clear();
-    while (const MgShape* sp = it.getNext()) {
-        id2ver[sp->getID()] = sp->shapec()->getChangeCount();
-        lastids.push_back(sp->getID());
-    }
+    epoch = shapes->getChangeEpoch();
 }
 
 void MgRecordShapes::Impl::startRecord()
 {
     if (!forUndo()) {
-        js[2] = new MgJsonStorage();
-        s[2] = js[2]->storageForWrite();
-        s[2]->writeNode("records", -1, false);
+        js = new MgJsonStorage();
+        s = js->storageForWrite();
+        s->writeNode("records", -1, false);
     }
     fileCount = 1;
     maxCount = 1;
 }
 
-void MgRecordShapes::Impl::beginJsonFile()
+RecordFrame* MgRecordShapes::Impl::beginFrame()
 {
     if (maxCount == 0) {
         maxCount = fileCount = 1;
     }
     flags[0] = 0;
     flags[1] = 0;
-    shapeCount = 0;
     
-    for (int i = 0; i < 2; i++) {
-        js[i] = new MgJsonStorage();
-        s[i] = js[i]->storageForWrite();
-        s[i]->writeNode("record", -1, false);
-        s[i]->writeInt("tick", tick);
+    RecordFrame* f = new RecordFrame();
+    f->binary = binary;
+    return f;
+}
+
+void MgRecordShapes::Impl::pushFrame(RecordFrame* f)
+{
+    if (!writer.started() && !writer.start(writerProc, this)) {
+        writeFrame(f);                          // 不支持线程时直接写
+        delete f;
+        return;
     }
+    slots.wait();                               // 队列满时等待写线程
+    mutex.lock();
+    frames.push_back(f);
+    mutex.unlock();
+    pending.post();
 }
 
-std::string MgRecordShapes::Impl::getFileName(bool back, int index) const
+void MgRecordShapes::Impl::flush(bool sync)
 {
-    std::stringstream ss;
-    if (index < 0)
-        index = fileCount;
-    ss << path << index << (index > 0 ? (back ? ".vgu" : ".vgr") : ".vg");
-    return ss.str();
+    if (writer.started()) {
+        GiSemaphore done;
+        RecordFrame* f = new RecordFrame();
+        
+        f->barrier = &done;
+        f->sync = sync;
+        pushFrame(f);
+        done.wait();
+    } else if (sync) {
+        syncFiles();
+    }
 }
 
-bool MgRecordShapes::Impl::saveJsonFile()
+void MgRecordShapes::Impl::stopWriter()
 {
-    bool ret = false;
-    std::string filename;
+    if (writer.started()) {
+        pushFrame(NULL);                        // 写线程取到NULL后退出
+        writer.join();
+    }
+}
+
+void MgRecordShapes::Impl::writerProc(void* arg)
+{
+    Impl* im = (Impl*)arg;
     
-    if (flags[0] == DYN && tick - lastTick < 20) {
-        //LOGD("Ignore record at the same time %d", tick);
-        flags[0] = flags[1] = 0;
+    for (;;) {
+        im->pending.wait();
+        im->mutex.lock();
+        RecordFrame* f = im->frames.front();
+        im->frames.pop_front();
+        im->mutex.unlock();
+        im->slots.post();
+        
+        if (!f)
+            break;
+        if (f->barrier) {
+            GiSemaphore* barrier = f->barrier;
+            if (f->sync)
+                im->syncFiles();
+            delete f;
+            barrier->post();
+        } else {
+            im->writeFrame(f);
+            delete f;
+        }
     }
+}
+
+void MgRecordShapes::Impl::writeFrame(RecordFrame* f)
+{
+    MgJsonStorage *js[2] = { NULL, NULL };
+    MgBinaryStorage *bs[2] = { NULL, NULL };
+    MgStorage *s[2];
+    bool ret = false, key = false;
+    long bytes = 0;
+    int i;
     
-    for (int i = 0; i < 2; i++) {
-        if (lastDoc && flags[i] && flags[i] != DYN) {
-            s[i]->writeFloatArray("transform", &lastDoc->modelTransform().m11, 6);
-            s[i]->writeFloatArray("pageExtent", &lastDoc->getPageRectW().xmin, 4);
-            s[i]->writeFloat("viewScale", lastDoc->getViewScale());
-        }
-        if (flags[i] != 0) {
-            filename = getFileName(i > 0);
-            FILE *fp = mgopenfile(filename.c_str(), "wt");
+    for (i = 0; i < 2; i++) {
+        if (f->binary) {
+            bs[i] = new MgBinaryStorage();
+            s[i] = bs[i]->storageForWrite();
+        } else {
+            js[i] = new MgJsonStorage();
+            s[i] = js[i]->storageForWrite();
+        }
+        s[i]->writeNode("record", -1, false);
+        s[i]->writeInt("tick", f->fileTick);
+    }
+    if (f->recorded) {
+        writeShapes(f, s);
+    }
+    if (!f->dyninc.empty()) {
+        s[0]->writeFloatArray("dyninc", &f->dyninc.front(), (int)f->dyninc.size());
+    } else if (f->dynShapes) {
+        s[0]->writeNode("dynamic", -1, false);
+        f->dynShapes->save(s[0]);
+        s[0]->writeNode("dynamic", -1, true);
+    }
+    s[0]->writeInt("flags", f->flags[0]);
+    if (f->flags[0] != DYN) {
+        s[0]->writeInt("changeCount", f->changeCount[0]);
+        s[1]->writeInt("changeCount", f->changeCount[1]);
+    }
+    
+    for (i = 0; i < 2; i++) {
+        if (f->doc && f->flags[i] && f->flags[i] != DYN) {
+            s[i]->writeFloatArray("transform", &f->doc->modelTransform().m11, 6);
+            s[i]->writeFloatArray("pageExtent", &f->doc->getPageRectW().xmin, 4);
+            s[i]->writeFloat("viewScale", f->doc->getViewScale());
+        }
+        if (f->flags[i] != 0 && journaled) {
+            std::string data;
+            MgRecordJournal* j = getJournal();
+            
+            ret = s[i]->writeNode("record", -1, true);
+            if (ret && bs[i]) {
+                ret = bs[i]->save(data);
+            } else if (ret) {
+                data = js[i]->stringify(VG_PRETTY);
+            }
+            ret = ret && j && j->append(f->index, i > 0, f->tick, f->flags[0], data);
+            bytes += i > 0 ? 0 : (long)data.size();
+            if (!ret) {
+                LOGE("Fail to record shapes: %d", f->index);
+            }
+        }
+        else if (f->flags[i] != 0) {
+            const char* filename = f->filename[i].c_str();
+            FILE *fp = mgopenfile(filename, bs[i] ? "wb" : "wt");
             
             if (!fp) {
-                LOGE("Fail to save file: %s", filename.c_str());
+                LOGE("Fail to save file: %s", filename);
             } else {
-                ret = s[i]->writeNode("record", -1, true) && js[i]->save(fp, VG_PRETTY);
+                ret = (s[i]->writeNode("record", -1, true)
+                       && (bs[i] ? bs[i]->save(fp) : js[i]->save(fp, VG_PRETTY)));
+                bytes += i > 0 ? 0 : ftell(fp);
                 fclose(fp);
+                unsynced.insert(f->filename[i]);
                 if (!ret) {
-                    LOGE("Fail to record shapes: %s", filename.c_str());
+                    LOGE("Fail to record shapes: %s", filename);
                 }
             }
         }
         delete js[i];
-        js[i] = NULL;
-        s[i] = NULL;
+        delete bs[i];
     }
-    if (ret) {
-        /*if (flags[0] && !forUndo()) {
-            struct stat stat1;
-            filename = getFileName(false);
-            stat(filename.c_str(), &stat1);
-            
-            LOGD("Record %03d: tick=%d, flags=%d, count=%d, filesize=%ld",
-                 fileCount, tick, flags[0], shapeCount, (long)stat1.st_size);
-        }*/
-        maxCount = ++fileCount;
-        lastTick = tick;
+    
+    if (ret && f->doc && !forUndo() && (keySteps > 0 || keyBytes > 0)) {
+        stepsAfterKey++;
+        bytesAfterKey += bytes;
+        if ((keySteps > 0 && stepsAfterKey >= keySteps)
+            || (keyBytes > 0 && bytesAfterKey >= keyBytes)) {
+            key = writeKeyframe(f);
+            stepsAfterKey = 0;
+            bytesAfterKey = 0;
+        }
+    }
+    
+    if (ret && f->indexNo >= 0 && this->s) {
+        this->s->writeNode("r", f->indexNo, false);
+        this->s->writeInt("tick", f->tick);
+        this->s->writeInt("flags", f->flags[0]);
+        if (key) {
+            this->s->writeInt("key", 1);
+        }
+        this->s->writeNode("r", f->indexNo, true);
+        
+        if (f->saveIndex) {
+            saveIndexFile(false);
+        }
+    }
+}
+
+bool MgRecordShapes::Impl::writeKeyframe(RecordFrame* f)
+{
+    MgJsonStorage js;
+    MgBinaryStorage bs;
+    MgStorage* s = f->binary ? bs.storageForWrite() : js.storageForWrite();
+    bool ret;
+    
+    s->writeNode("record", -1, false);
+    s->writeInt("tick", f->fileTick);
+    ret = f->doc->save(s, 0);
+    if (f->dynShapes) {
+        s->writeNode("dynamic", -1, false);
+        f->dynShapes->save(s);
+        s->writeNode("dynamic", -1, true);
     }
+    s->writeInt("flags", f->flags[0]);
+    s->writeInt("changeCount", f->changeCount[0]);
+    ret = s->writeNode("record", -1, true) && ret;
     
+    if (ret && journaled) {
+        std::string data;
+        MgRecordJournal* j = getJournal();
+        
+        if (f->binary) {
+            ret = bs.save(data);
+        } else {
+            data = js.stringify(VG_PRETTY);
+        }
+        ret = ret && j && j->appendKeyframe(f->index, f->tick, data);
+    }
+    else if (ret) {
+        std::string filename(getKeyFileName(f->index));
+        FILE *fp = mgopenfile(filename.c_str(), f->binary ? "wb" : "wt");
+        
+        ret = fp && (f->binary ? bs.save(fp) : js.save(fp, VG_PRETTY));
+        if (fp) {
+            fclose(fp);
+            unsynced.insert(filename);
+        }
+    }
+    if (!ret) {
+        LOGE("Fail to record keyframe: %d", f->index);
+    }
+    
+    return ret;
+}
+
+//! 将已写的文件内容刷到存储设备
+static bool syncFile(const char* filename)
+{
+    FILE *fp = mgopenfile(filename, "r+b");
+    bool ret = false;
+    
+    if (fp) {
+#if defined(_WIN32)
+        ret = _commit(_fileno(fp)) == 0;
+#else
+        ret = fsync(fileno(fp)) == 0;
+#endif
+        fclose(fp);
+    }
     return ret;
 }
 
+void MgRecordShapes::Impl::syncFiles()
+{
+    for (std::set<std::string>::const_iterator it = unsynced.begin(); it != unsynced.end(); ++it) {
+        if (!syncFile(it->c_str())) {
+            LOGE("Fail to sync file: %s", it->c_str());
+        }
+    }
+    unsynced.clear();
+    if (journal && !journal->sync()) {
+        LOGE("Fail to sync record journal in %s", path.c_str());
+    }
+}
+
+std::string MgRecordShapes::Impl::getFileName(bool back, int index) const
+{
+    std::stringstream ss;
+    if (index < 0)
+        index = fileCount;
+    ss << path << index << (index > 0 ? (back ? ".vgu" : ".vgr") : ".vg");
+    return ss.str();
+}
+
+std::string MgRecordShapes::Impl::getKeyFileName(int index) const
+{
+    std::stringstream ss;
+    ss << path << index << ".vgk";
+    return ss.str();
+}
+
 bool MgRecordShapes::Impl::saveIndexFile(bool ended)
 {
     std::string filename(path + "records.json");
@@ -539,13 +974,14 @@ bool MgRecordShapes::Impl::saveIndexFile(bool ended)
         LOGE("Fail to save file: %s", filename.c_str());
     } else {
         if (ended) {
-            s[2]->writeNode("records", -1, true);
+            s->writeNode("records", -1, true);
         }
-        ret = js[2]->save(fp, VG_PRETTY);
+        ret = js->save(fp, VG_PRETTY);
         if (!ret) {
             LOGE("Fail to save records: %s", filename.c_str());
         }
         fclose(fp);
+        unsynced.insert(filename);
     }
     
     return ret;
@@ -553,33 +989,186 @@ bool MgRecordShapes::Impl::saveIndexFile(bool ended)
 
 void MgRecordShapes::Impl::stopRecordIndex()
 {
-    if (js[2]) {
+    flush(false);                               // 写完已记录的帧后再写索引
+    if (js) {
         if (fileCount > 1 && saveIndexFile(true)) {
             LOGD("Save records.json in %s", path.c_str());
         }
-        delete js[2];
-        js[2] = NULL;
-        s[2] = NULL;
+        delete js;
+        js = NULL;
+        s = NULL;
     }
+    flush(true);
     MgObject::release_pointer(lastShape);
 }
 
-int MgRecordShapes::applyFile(int& tick, MgShapeFactory *f,
-                              MgShapeDoc* doc, MgShapes* dyns, const char* fn,
-                              long* changeCount, MgShape* lastShape)
+MgRecordJournal* MgRecordShapes::Impl::getJournal()
+{
+    if (!journal && (journaled || (type > 1 && !journalTried))) {
+        journalTried = true;
+        journal = new MgRecordJournal();
+        if (!journal->open(MgRecordJournal::getFileName(path).c_str(),
+                           journaled, journaled && !restored)) {
+            if (journaled) {
+                LOGE("Fail to open record journal in %s", path.c_str());
+            }
+            delete journal;
+            journal = NULL;
+            journaled = false;              // 回放时没有日志文件则读取各帧的文件
+        }
+    }
+    return journal;
+}
+
+MgStorage* MgRecordShapes::Impl::openRecord(bool back, int index, MgJsonStorage& js,
+                                            MgBinaryStorage& bs, std::string& data)
 {
-    FILE *fp = mgopenfile(fn, "rt");
+    MgRecordJournal* j = getJournal();
+    
+    if (j) {
+        if (!j->read(index, back, data)) {
+            return NULL;
+        }
+        return (MgBinaryStorage::isBinaryData(data.data(), (int)data.size())
+                ? bs.storageForRead(data.data(), (int)data.size())
+                : js.storageForRead(data.c_str()));
+    }
+    
+    std::string filename(getFileName(back, index));
+    FILE *fp = mgopenfile(filename.c_str(), "rt");
     if (!fp) {
-        //LOGE("Fail to read file: %s", fn);
+        //LOGE("Fail to read file: %s", filename.c_str());
+        return NULL;
+    }
+    
+    MgStorage* s = storageForRead(fp, js, bs);
+    fclose(fp);
+    
+    return s;
+}
+
+MgStorage* MgRecordShapes::Impl::openKeyframe(int index, MgJsonStorage& js,
+                                              MgBinaryStorage& bs, std::string& data)
+{
+    MgRecordJournal* j = getJournal();
+    
+    if (j) {
+        if (!j->readKeyframe(index, data)) {
+            return NULL;
+        }
+        return (MgBinaryStorage::isBinaryData(data.data(), (int)data.size())
+                ? bs.storageForRead(data.data(), (int)data.size())
+                : js.storageForRead(data.c_str()));
+    }
+    
+    std::string filename(getKeyFileName(index));
+    FILE *fp = mgopenfile(filename.c_str(), "rt");
+    if (!fp) {
+        LOGE("Fail to read file: %s", filename.c_str());
+        return NULL;
+    }
+    
+    MgStorage* s = storageForRead(fp, js, bs);
+    fclose(fp);
+    
+    return s;
+}
+
+bool MgRecordShapes::Impl::applyKeyframe(int index, MgShapeFactory *f, MgShapeDoc* doc, MgShapes* dyns)
+{
+    MgJsonStorage js;
+    MgBinaryStorage bs;
+    std::string data;
+    MgStorage* s = openKeyframe(index, js, bs, data);
+    
+    if (!s || !s->readNode("record", -1, false) || !doc->load(f, s, false)) {
+        return false;
+    }
+    if (s->readNode("dynamic", -1, false)) {
+        dyns->load(f, s);
+        s->readNode("dynamic", -1, true);
+    }
+    tick = s->readInt("tick", tick);
+    s->readNode("record", -1, true);
+    
+    fileCount = index + 1;
+    MgObject::release_pointer(lastShape);
+    lastShape = const_cast<MgShape*>(dyns->getLastShape());
+    if (lastShape)
+        lastShape->addRef();
+    
+    return true;
+}
+
+bool MgRecordShapes::Impl::loadSeekIndex()
+{
+    std::vector<int> arr;
+    
+    frameTicks.clear();
+    keyframes.clear();
+    frameTicks.push_back(0);                    // 第0帧为初始文档
+    if (!loadFrames(path, arr, &keyframes)) {
+        return false;
+    }
+    for (unsigned i = 0; i + 2 < arr.size(); i += 3) {
+        frameTicks.resize(arr[i] + 1, frameTicks.back());
+        frameTicks[arr[i]] = arr[i + 1];
+    }
+    return true;
+}
+
+int MgRecordShapes::seek(MgShapeFactory *f, MgShapeDoc* doc, MgShapes* dyns, long tick)
+{
+    if (!doc) {
+        return 0;
+    }
+    _im->flush(false);
+    if ((_im->frameTicks.empty() || tick > _im->frameTicks.back()) && !_im->loadSeekIndex()) {
         return 0;
     }
     
+    const std::vector<int>& ticks = _im->frameTicks;
+    const std::vector<int>& keys = _im->keyframes;
+    int index = (int)(std::upper_bound(ticks.begin(), ticks.end(), (int)tick) - ticks.begin()) - 1;
+    std::vector<int>::const_iterator it = std::upper_bound(keys.begin(), keys.end(), index);
+    int key = it == keys.begin() ? 0 : *(it - 1);
+    MgShapes* shapes = MgShapes::create();
+    int ret = 0;
+    
+    if (key > 0 && _im->applyKeyframe(key, f, doc, shapes)) {
+        ret = DOC_CHANGED | DYN_CHANGED;
+    } else if (applyFirstFile(f, doc)) {        // 没有关键帧则从初始文档开始
+        key = 0;
+        _im->tick = 0;
+        ret = DOC_CHANGED | DYN_CHANGED;
+    }
+    if (ret) {
+        for (int i = key + 1; i <= index; i++) {
+            MgObject::release_pointer(shapes);  // 回放时每帧的动态图形是独立的
+            shapes = MgShapes::create();
+            applyRedoFile(f, doc, shapes, i);
+        }
+        if (dyns) {
+            dyns->copyShapes(shapes, false);
+        }
+        LOGD("Seek to record %d from keyframe %d", index, key);
+    }
+    MgObject::release_pointer(shapes);
+    
+    return ret;
+}
+
+int MgRecordShapes::applyFile(bool back, int index, MgShapeFactory *f, MgShapeDoc* doc,
+                              MgShapes* dyns, long* changeCount, MgShape* lastShape)
+{
     MgJsonStorage js;
-    MgStorage* s = js.storageForRead(fp);
+    MgBinaryStorage bs;
+    std::string data;
+    MgStorage* s = _im->openRecord(back, index, js, bs, data);
+    int& tick = _im->tick;
     int ret = 0;
     
-    fclose(fp);
-    if (s->readNode("record", -1, false)) {
+    if (s && s->readNode("record", -1, false)) {
         if (doc) {
             if (s->readFloatArray("transform", &doc->modelTransform().m11, 6, false) == 6) {
                 Box2d rect(doc->getPageRectW());
@@ -675,7 +1264,8 @@ bool MgRecordShapes::applyFirstFile(MgShapeFactory *factory, MgShapeDoc* doc, co
     }
     
     MgJsonStorage js;
-    MgStorage* s = js.storageForRead(fp);
+    MgBinaryStorage bs;
+    MgStorage* s = storageForRead(fp, js, bs);
     
     fclose(fp);
     _im->fileCount = 1;
@@ -689,8 +1279,7 @@ int MgRecordShapes::applyRedoFile(MgShapeFactory *f, MgShapeDoc* doc, MgShapes*
     if (index <= 0)
         index = _im->fileCount;
     
-    std::string filename(_im->getFileName(false, index));
-    int ret = applyFile(_im->tick, f, doc, dyns, filename.c_str(), NULL, _im->lastShape);
+    int ret = applyFile(false, index, f, doc, dyns, NULL, _im->lastShape);
     
     if (ret) {
         _im->fileCount = index + 1;
@@ -718,11 +1307,8 @@ int MgRecordShapes::applyUndoFile(MgShapeFactory *f, MgShapeDoc* doc,
         return DYN_CHANGED;
     }
     
-    std::string filename(_im->getFileName(true, index - 1));
-    int ret = applyFile(_im->tick, f, doc, NULL, filename.c_str());
-    
-    filename = _im->getFileName(false, index - 1);
-    ret |= applyFile(_im->tick, f, NULL, dyns, filename.c_str()) | DYN_CHANGED;
+    int ret = applyFile(true, index - 1, f, doc, NULL);
+    ret |= applyFile(false, index - 1, f, NULL, dyns) | DYN_CHANGED;
     
     if (ret) {
         _im->fileCount = index - 1;
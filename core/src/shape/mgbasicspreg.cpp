@@ -106,8 +106,26 @@ static bool drawParallel(const MgParallel& sp, int, GiGraphics& gs, const GiCont
     return gs.drawPolygon(&ctx, 4, sp.getPoints());
 }
 
+// 缩小显示时按半个像素的误差取简化顶点绘制，没有合适的层次时返回false
+static bool drawLod(const MgBaseLines& sp, GiGraphics& gs, const GiContext& ctx, bool& ret)
+{
+    int n = 0;
+    const Point2d* pts = sp.getLodPoints(gs.xf().displayToModel(0.5f), n);
+    
+    if (!pts) {
+        return false;
+    }
+    ret = sp.isClosed() ? gs.drawPolygon(&ctx, n, pts) : gs.drawLines(&ctx, n, pts);
+    return true;
+}
+
 static bool drawLines(const MgLines& sp, int, GiGraphics& gs, const GiContext& ctx, int)
 {
+    bool ret = false;
+    
+    if (drawLod(sp, gs, ctx, ret)) {
+        return ret;
+    }
     return (sp.isClosed() ? gs.drawPolygon(&ctx, sp.getPointCount(), sp.getPoints())
             : gs.drawLines(&ctx, sp.getPointCount(), sp.getPoints()));
 }
@@ -115,7 +133,11 @@ static bool drawLines(const MgLines& sp, int, GiGraphics& gs, const GiContext& c
 static bool drawSplines(const MgSplines& sp, int, GiGraphics& gs, const GiContext& ctx, int)
 {
     int n = sp.getPointCount();
+    bool ret = false;
     
+    if (drawLod(sp, gs, ctx, ret)) {
+        return ret;
+    }
     if (n == 2) {
         return gs.drawLine(&ctx, sp.getPoint(0), sp.getPoint(1));
     }
@@ -0,0 +1,215 @@
+//! \file mgchunkarray.h
+//! \brief 定义分块共享的数组模板 MgChunkArray
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_CHUNKARRAY_H_
+#define TOUCHVG_CHUNKARRAY_H_
+
+#include "gilock.h"
+#include <vector>
+#include <algorithm>
+
+//! 元素无需引用计数时 MgChunkArray 使用的元素操作
+template <typename T>
+struct MgChunkPlain {
+    static void retain(const T&) {}
+    static void release(const T&) {}
+};
+
+//! 分块共享的数组，复制时只复制块指针，修改时只复制被修改的块(写时复制)
+/*! 块内元素由块拥有，在复制块时调用 Traits::retain，释放块时调用 Traits::release。
+    块的引用计数为原子操作，共享相同块的数组可分别在不同线程中使用。
+    只有一块时该块按元素数从 kMinChunkSize 倍增到 kChunkSize，以免小数组占用整块。
+ */
+template <typename T, class Traits = MgChunkPlain<T> >
+class MgChunkArray
+{
+public:
+    enum { kChunkBits = 8, kChunkSize = 1 << kChunkBits, kChunkMask = kChunkSize - 1, kMinChunkSize = 4 };
+
+    MgChunkArray() : _size(0) {}
+    MgChunkArray(const MgChunkArray& src) : _chunks(src._chunks), _size(src._size) {
+        for (size_t i = 0; i < _chunks.size(); i++) {
+            giAtomicIncrement(&_chunks[i]->refcount);
+        }
+    }
+    ~MgChunkArray() { clear(); }
+
+    MgChunkArray& operator=(const MgChunkArray& src) {
+        if (this != &src) {
+            MgChunkArray tmp(src);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    void swap(MgChunkArray& src) {
+        _chunks.swap(src._chunks);
+        std::swap(_size, src._size);
+    }
+
+    int size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    //! 只读访问元素
+    const T& operator[](int i) const {
+        return _chunks[i >> kChunkBits]->items[i & kChunkMask];
+    }
+
+    //! 可写访问元素，所在块与其他数组共享时先复制该块
+    T& at(int i) {
+        return unique(i >> kChunkBits)->items[i & kChunkMask];
+    }
+
+    const T& back() const { return (*this)[_size - 1]; }
+
+    void reserve(int n) {
+        _chunks.reserve((n + kChunkMask) >> kChunkBits);
+        if (_chunks.empty() && n > 0) {
+            _chunks.push_back(newChunk(n));
+        } else if (_chunks.size() == 1 && n > _chunks[0]->capacity) {
+            growFirst(n);
+        }
+    }
+
+    void push_back(const T& v) {
+        int c = _size >> kChunkBits;
+        if (c == (int)_chunks.size()) {
+            _chunks.push_back(newChunk(c > 0 ? kChunkSize : kMinChunkSize));
+        } else if (c == 0 && _size == _chunks[0]->capacity) {   // 只有首块可能未满整块
+            growFirst(_size * 2);
+        }
+        int i = _size++;
+        at(i) = v;
+    }
+
+    //! 去掉末尾元素，该元素应为默认值(例如空指针)
+    void pop_back() {
+        if ((--_size & kChunkMask) == 0) {
+            releaseChunk(_chunks.back());
+            _chunks.pop_back();
+        }
+    }
+
+    //! 在前面插入 n 个块的默认值元素，不复制已有元素
+    void insertChunks(int n) {
+        if (!_chunks.empty()) {
+            growFirst(kChunkSize);
+        }
+        _chunks.insert(_chunks.begin(), n, (Chunk*)0);
+        for (int i = 0; i < n; i++) {
+            _chunks[i] = newChunk(kChunkSize);
+        }
+        _size += n * kChunkSize;
+    }
+
+    //! 清除原有元素，设置为 n 个相同值
+    void assign(int n, const T& v) {
+        clear(true);
+        _chunks.resize((n + kChunkMask) >> kChunkBits);
+        for (size_t i = 0; i < _chunks.size(); i++) {
+            _chunks[i] = newChunk(n > kChunkSize ? kChunkSize : n);
+            std::fill(_chunks[i]->items, _chunks[i]->items + _chunks[i]->capacity, v);
+        }
+        _size = n;
+    }
+
+    //! 清除元素，keepChunks 为 true 时保留独占的块，以后添加元素时重用而不再分配
+    void clear(bool keepChunks = false) {
+        for (size_t i = 0; i < _chunks.size(); i++) {
+            Chunk* chunk = _chunks[i];
+            if (keepChunks && chunk->refcount == 1) {   // 独占的块不会再被其他数组引用
+                for (int j = 0; j < chunk->capacity; j++) {
+                    Traits::release(chunk->items[j]);
+                    chunk->items[j] = T();
+                }
+                _spare.push_back(chunk);
+            } else {
+                releaseChunk(chunk);
+            }
+        }
+        _chunks.clear();
+        _size = 0;
+        if (!keepChunks) {
+            for (size_t i = 0; i < _spare.size(); i++) {
+                delete _spare[i];
+            }
+            _spare.clear();
+        }
+    }
+
+private:
+    struct Chunk {
+        volatile long   refcount;
+        int             capacity;       // 元素个数，只有首块可能少于 kChunkSize
+        T*              items;
+
+        Chunk(int n) : refcount(1), capacity(n), items(new T[n]) {
+            std::fill(items, items + n, T());
+        }
+        Chunk(const Chunk& src) : refcount(1), capacity(src.capacity), items(new T[src.capacity]) {
+            for (int i = 0; i < capacity; i++) {
+                items[i] = src.items[i];
+                Traits::retain(items[i]);
+            }
+        }
+        ~Chunk() { delete[] items; }
+    };
+
+    Chunk* newChunk(int n) {
+        int capacity = kMinChunkSize;
+        while (capacity < n && capacity < kChunkSize) {
+            capacity *= 2;
+        }
+        if (_spare.empty() || _spare.back()->capacity < capacity)
+            return new Chunk(capacity);
+        Chunk* chunk = _spare.back();
+        _spare.pop_back();
+        return chunk;
+    }
+
+    //! 将唯一的块扩大到至少 n 个元素，元素移到新块中
+    void growFirst(int n) {
+        Chunk* chunk = _chunks[0];
+        if (chunk->capacity >= n || chunk->capacity == kChunkSize)
+            return;
+
+        Chunk* p = newChunk(n);
+        for (int i = 0; i < chunk->capacity; i++) {
+            p->items[i] = chunk->items[i];
+        }
+        if (giAtomicDecrement(&chunk->refcount) == 0) {
+            delete chunk;                   // 元素已移到新块，不必释放
+        } else {
+            for (int i = 0; i < chunk->capacity; i++) {
+                Traits::retain(p->items[i]);
+            }
+        }
+        _chunks[0] = p;
+    }
+
+    Chunk* unique(int c) {
+        Chunk* chunk = _chunks[c];
+        if (chunk->refcount > 1) {
+            _chunks[c] = new Chunk(*chunk);
+            releaseChunk(chunk);
+            chunk = _chunks[c];
+        }
+        return chunk;
+    }
+
+    static void releaseChunk(Chunk* chunk) {
+        if (giAtomicDecrement(&chunk->refcount) == 0) {
+            for (int i = 0; i < chunk->capacity; i++) {
+                Traits::release(chunk->items[i]);
+            }
+            delete chunk;
+        }
+    }
+
+    std::vector<Chunk*> _chunks;
+    std::vector<Chunk*> _spare;     //!< clear(true) 保留的空块，不与其他数组共享
+    int                 _size;
+};
+
+#endif // TOUCHVG_CHUNKARRAY_H_
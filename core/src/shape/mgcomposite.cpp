@@ -129,6 +129,7 @@ void MgComposite::_transform(const Matrix2d& mat)
     while (MgShape* sp = const_cast<MgShape*>(it.getNext())) {
         sp->shape()->transform(mat);
     }
+    _shapes->rebuildIndex();
     _extent = _shapes->getExtent();
 }
 
@@ -186,6 +187,9 @@ bool MgComposite::_offset(const Vector2d& vec, int)
     while (MgShape* sp = const_cast<MgShape*>(it.getNext())) {
         n += sp->shape()->offset(vec, -1) ? 1 : 0;
     }
+    if (n > 0) {
+        _shapes->rebuildIndex();
+    }
 
     return n > 0;
 }
@@ -325,7 +329,9 @@ bool MgGroup::_offset(const Vector2d& vec, int segment)
     MgShape* sp = const_cast<MgShape*>(_shapes->findShape(segment));
 
     if (sp && canOffsetShapeAlone(sp)) {
-        return sp->shape()->offset(vec, -1);
+        bool ret = sp->shape()->offset(vec, -1);
+        _shapes->rebuildIndex();
+        return ret;
     }
     if (!sp) {
         _insert += vec;
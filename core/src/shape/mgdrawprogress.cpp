@@ -0,0 +1,172 @@
+// mgdrawprogress.cpp: 实现分批绘制图形的进度类 MgDrawProgress
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#include "mgdrawprogress.h"
+#include "mgshapes.h"
+#include <math.h>
+
+#if defined(__WINDOWS__) || defined(WIN32)
+#ifndef _WINDOWS_
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+static double tickMs()
+{
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart * 1000.0 / (double)freq.QuadPart;
+}
+#else
+#include <sys/time.h>
+static double tickMs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, (struct timezone*)0);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+#endif
+
+static const int kBuckets = 32;     // 排序的分组数，组内保持显示顺序
+
+MgDrawProgress::MgDrawProgress(int order, float budgetMs, int budgetShapes)
+    : _order(order), _budgetMs(budgetMs), _budgetShapes(budgetShapes), _owner((MgObject*)0)
+    , _layer(0), _index(0), _drawn(0), _finished(false), _tick(0), _count(0)
+{
+}
+
+MgDrawProgress::~MgDrawProgress()
+{
+    reset();
+}
+
+void MgDrawProgress::setOrder(int order)
+{
+    if (_order != order) {
+        _order = order;
+        reset();
+    }
+}
+
+void MgDrawProgress::setBudget(float ms, int shapes)
+{
+    _budgetMs = ms;
+    _budgetShapes = shapes;
+}
+
+void MgDrawProgress::reset()
+{
+    MgObject::release_pointer(_owner);
+    _listed.clear();
+    _epochs.clear();
+    _clip.empty();
+    _layer = 0;
+    _index = 0;
+    _drawn = 0;
+    _finished = false;
+    _list.clear();
+}
+
+bool MgDrawProgress::isValid(const MgObject* owner, const Box2d& clip) const
+{
+    return _owner && _owner == owner && _clip == clip;
+}
+
+bool MgDrawProgress::isListed(int layer, const MgShapes* shapes) const
+{
+    return (shapes && getListedShapes(layer) == shapes
+            && shapes->getChangeEpoch() == _epochs[layer]);
+}
+
+bool MgDrawProgress::begin(const MgObject* owner, const Box2d& clip)
+{
+    bool resumed = isValid(owner, clip);
+
+    if (!resumed) {
+        reset();
+        _owner = (MgObject*)owner;
+        _owner->addRef();
+        _clip = clip;
+    }
+    _tick = tickMs();
+    _count = 0;
+
+    return resumed;
+}
+
+bool MgDrawProgress::isOverBudget() const
+{
+    return _count > 0 && ((_budgetShapes > 0 && _count >= _budgetShapes)
+                          || (_budgetMs > 0 && tickMs() - _tick >= _budgetMs));
+}
+
+std::vector<const MgShape*>& MgDrawProgress::beginList(const MgShapes* shapes, long epoch)
+{
+    if (_layer >= (int)_listed.size()) {
+        _listed.resize(_layer + 1, (const MgShapes*)0);
+        _epochs.resize(_layer + 1, 0);
+    }
+    _listed[_layer] = shapes;
+    _epochs[_layer] = epoch;
+    _index = 0;
+    _list.clear();
+    return _list;
+}
+
+void MgDrawProgress::sortList(const Matrix2d& modelToDisplay)
+{
+    int n = (int)_list.size();
+
+    if (_order == kDisplayOrder || n < 2) {
+        return;
+    }
+
+    // 按分组计数排序，代价与图形数成正比，大量图形时比比较排序快
+    std::vector<unsigned char> keys(n);
+    int counts[kBuckets + 1] = { 0 };
+    Point2d center(_clip.center());
+    float radius = mgMax(_clip.width(), _clip.height()) / 2;
+    float scale = (Vector2d(1.f, 0.f) * modelToDisplay).length();
+
+    for (int i = 0; i < n; i++) {
+        Box2d rect(_list[i]->shapec()->getExtent());
+        int key;
+
+        if (_order == kLargeFirst) {                // 按显示尺寸的对数从大到小分组
+            float size = mgMax(rect.width(), rect.height()) * scale;
+            key = kBuckets - 1 - (size < 1.f ? 0 : mgMin(kBuckets - 1, (int)(logf(size) * 1.4427f)));
+        } else {                                    // 按离中心的距离从近到远分组
+            float d = rect.center().distanceTo(center) / mgMax(radius, 1e-6f);
+            key = mgMin(kBuckets - 1, (int)(d * (kBuckets - 1)));
+        }
+        keys[i] = (unsigned char)key;
+        counts[key + 1]++;
+    }
+    for (int k = 0; k < kBuckets; k++) {
+        counts[k + 1] += counts[k];
+    }
+
+    std::vector<const MgShape*> sorted(n);
+
+    for (int i = 0; i < n; i++) {
+        sorted[counts[keys[i]]++] = _list[i];
+    }
+    _list.swap(sorted);
+}
+
+const MgShape* MgDrawProgress::next()
+{
+    if (_index >= (int)_list.size()) {
+        return (const MgShape*)0;
+    }
+    _drawn++;
+    _count++;
+    return _list[_index++];
+}
+
+void MgDrawProgress::nextLayer()
+{
+    _layer++;
+    _index = 0;
+    _list.clear();
+}
@@ -0,0 +1,123 @@
+// mglazyshapes.cpp: 实现按需加载的图形桩表 MgLazyShapes
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#include "mglazyshapes.h"
+#include "mgspfactory.h"
+#include "mglog.h"
+#include <algorithm>
+#include <functional>
+
+enum { kStub, kLoading, kLoaded };
+
+MgLazyShapes::MgLazyShapes(MgStorageSource* src, MgShapeFactory* factory)
+    : _src(src), _factory(factory), _pending(0), _refcount(1)
+{
+    _src->addRef();
+}
+
+MgLazyShapes::~MgLazyShapes()
+{
+    for (size_t i = 0; i < _entries.size(); i++) {
+        if (_entries[i].state != kLoaded) {
+            _entries[i].sp->release();
+        }
+    }
+    _src->release();
+}
+
+void MgLazyShapes::release()
+{
+    if (giAtomicDecrement(&_refcount) == 0)
+        delete this;
+}
+
+void MgLazyShapes::add(MgShape* sp, size_t pos)
+{
+    Entry e;
+    
+    e.sp = sp;
+    e.pos = pos;
+    e.state = kStub;
+    sp->addRef();
+    _entries.push_back(e);
+    _pending++;
+}
+
+// 按图形对象地址比较
+struct LessEntry {
+    template <class E> bool operator()(const E& a, const E& b) const {
+        return std::less<const MgShape*>()(a.sp, b.sp); }
+    template <class E> bool operator()(const E& a, const MgShape* sp) const {
+        return std::less<const MgShape*>()(a.sp, sp); }
+};
+
+void MgLazyShapes::ready()
+{
+    std::sort(_entries.begin(), _entries.end(), LessEntry());
+}
+
+MgLazyShapes::Entry* MgLazyShapes::find(const MgShape* sp) const
+{
+    std::vector<Entry>::const_iterator it = std::lower_bound(_entries.begin(), _entries.end(),
+                                                             sp, LessEntry());
+    return it != _entries.end() && it->sp == sp ? const_cast<Entry*>(&*it) : (Entry*)0;
+}
+
+bool MgLazyShapes::loadShape(MgShape* sp, size_t pos) const
+{
+    MgStorage* s = _src->beginRead(pos);
+    bool ret = s->readNode((const char*)0, -1, false);
+    
+    if (ret) {
+        ret = sp->load(_factory, s);
+        sp->shape()->setFlag(kMgClosed, sp->shape()->isClosed());
+        s->readNode((const char*)0, -1, true);
+    }
+    _src->endRead(s);
+    if (!ret) {
+        LOGE("Fail to load shape (id=%d, type=%d)", sp->getID(), sp->shapec()->getType());
+    }
+    
+    return ret;
+}
+
+void MgLazyShapes::load(const MgShape* sp)
+{
+    Entry* e = _pending > 0 ? find(sp) : (Entry*)0;
+    
+    if (e && !giAtomicCompareAndSwap(&e->state, kLoaded, kLoaded)) {
+        _loading.lock();            // 其他线程正在加载时在此等待，加载要读数据源，可能很慢
+        if (giAtomicCompareAndSwap(&e->state, kLoading, kStub)) {
+            loadShape(e->sp, e->pos);
+            giAtomicCompareAndSwap(&e->state, kLoaded, kLoading);
+            giAtomicDecrement(&_pending);
+            e->sp->release();       // 已加载的图形地址被重用也没关系了
+        }
+        _loading.unlock();
+    }
+}
+
+MgShape* MgLazyShapes::loadCopy(const MgShape* sp) const
+{
+    Entry* e = _pending > 0 ? find(sp) : (Entry*)0;
+    
+    while (e && !giAtomicCompareAndSwap(&e->state, kLoaded, kLoaded)) {
+        if (giAtomicCompareAndSwap(&e->state, kStub, kStub)) {
+            MgShape* newsp = _factory->createShape(sp->shapec()->getType());
+            
+            if (newsp) {
+                newsp->setParent(sp->getParent(), sp->getID());
+                newsp->shape()->setExtent(sp->shapec()->getExtent());
+                if (!loadShape(newsp, e->pos)) {
+                    newsp->release();
+                    newsp = MgShape::Null();
+                }
+            }
+            return newsp;
+        }
+        _loading.lock();            // 其他线程正在加载，等其加载完成
+        _loading.unlock();
+    }
+    
+    return MgShape::Null();
+}
@@ -0,0 +1,64 @@
+//! \file mglazyshapes.h
+//! \brief 定义按需加载的图形桩表 MgLazyShapes
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_LAZYSHAPES_H_
+#define TOUCHVG_LAZYSHAPES_H_
+
+#include "mgshape.h"
+#include "mgstorage.h"
+#include "githread.h"
+#include <vector>
+
+struct MgShapeFactory;
+
+//! 按需加载的图形桩表，供 MgShapes 内部使用
+/*! 图形桩是只有类型、ID、标记和范围的图形对象，记下其节点在数据源中的位置，
+    用到图形内容时在原对象上加载，共享同一图形数组的图形列表(shallowCopy)共用本表。
+    本表保持未加载图形桩的引用，以免其地址被新图形重用，加载后释放该引用。
+ */
+class MgLazyShapes
+{
+public:
+    MgLazyShapes(MgStorageSource* src, MgShapeFactory* factory);
+
+    void addRef() { giAtomicIncrement(&_refcount); }
+    void release();
+
+    //! 登记一个图形桩，全部登记后调用 ready()
+    void add(MgShape* sp, size_t pos);
+
+    //! 登记完成，按对象地址排序以便查找
+    void ready();
+
+    //! 返回未加载的图形桩个数
+    int pendingCount() const { return (int)_pending; }
+
+    //! 如果是未加载的图形桩就加载其内容，可在多个线程中同时调用
+    void load(const MgShape* sp);
+
+    //! 如果是未加载的图形桩就加载到新的图形对象中，不改变图形桩，否则返回NULL
+    MgShape* loadCopy(const MgShape* sp) const;
+
+private:
+    ~MgLazyShapes();
+    MgLazyShapes(const MgLazyShapes&);
+    void operator=(const MgLazyShapes&);
+
+    struct Entry {
+        MgShape*    sp;
+        size_t      pos;            // 图形节点在数据源中的位置
+        volatile long state;        // kStub, kLoading(持有 _loading 锁), kLoaded
+    };
+    Entry* find(const MgShape* sp) const;
+    bool loadShape(MgShape* sp, size_t pos) const;
+
+    std::vector<Entry> _entries;
+    MgStorageSource* _src;
+    MgShapeFactory* _factory;
+    volatile long _pending;
+    volatile long _refcount;
+    mutable GiMutex _loading;       // 加载图形桩时加锁，其他线程等待此锁而不空转
+};
+
+#endif // TOUCHVG_LAZYSHAPES_H_
@@ -4,6 +4,7 @@
 #include "mgshape.h"
 #include "mgstorage.h"
 #include "mgcomposite.h"
+#include "gishapecache.h"
 
 bool MgShape::hasFillColor() const
 {
@@ -45,7 +46,17 @@ bool MgShape::draw(int mode, GiGraphics& gs, const GiContext *ctx, int segment)
     if (gs.beginShape(shapec()->getType(), getID(),
                       (int)shapec()->getChangeCount(),
                       rect.xmin, rect.ymin, rect.width(), rect.height())) {
-        ret = drawShape(getParent(), *shapec(), mode, gs, tmpctx, segment);
+        GiShapeCache* cache = segment < 0 ? gs.getShapeCache() : (GiShapeCache*)0;
+        int state = !cache ? GiShapeCache::kDirect :
+            cache->beginDraw(gs, this, getID(), shapec()->getChangeCount(), mode,
+                             tmpctx, shapec()->getExtent(), ret);
+        
+        if (state != GiShapeCache::kDrawn) {
+            ret = drawShape(getParent(), *shapec(), mode, gs, tmpctx, segment);
+        }
+        if (state == GiShapeCache::kRecording) {
+            cache->endRecord(gs, ret);
+        }
         gs.endShape(shapec()->getType(), getID(), rect.xmin, rect.ymin);
     }
     return ret;
@@ -0,0 +1,486 @@
+// mgshapeindex.cpp: 实现图形空间索引类 MgShapeIndex
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#include "mgshapeindex.h"
+#include "gilock.h"
+#include <algorithm>
+#include <math.h>
+
+static const int kMaxEntries = 16;      // 每个节点的最多项数
+static const int kMinEntries = 6;       // 非根节点的最少项数，少于此数时节点被拆散重新插入
+static const int kFillEntries = 14;     // 批量装载时每个节点的项数
+
+struct MgShapeIndex::Entry {
+    Box2d       box;                    // 子节点或图形的范围
+    union {
+        Node*   child;                  // 子节点，用于非叶节点
+        int     sid;                    // 图形ID，用于叶节点
+    };
+};
+
+// 节点可被多个索引共享，修改前须用 uniqueNode 得到独占的节点
+struct MgShapeIndex::Node {
+    volatile long refcount;
+    int         count;
+    bool        leaf;
+    Entry       entries[kMaxEntries + 1];   // 多出一项用于分裂前暂存
+
+    Node(bool isLeaf) : refcount(1), count(0), leaf(isLeaf) {}
+};
+
+// 闭区间相交，允许退化的范围
+static inline bool overlaps(const Box2d& a, const Box2d& b)
+{
+    return a.xmin <= b.xmax && b.xmin <= a.xmax && a.ymin <= b.ymax && b.ymin <= a.ymax;
+}
+
+static inline bool encloses(const Box2d& a, const Box2d& b)
+{
+    return a.xmin <= b.xmin && a.ymin <= b.ymin && a.xmax >= b.xmax && a.ymax >= b.ymax;
+}
+
+static inline void extend(Box2d& a, const Box2d& b)
+{
+    if (a.xmin > b.xmin) a.xmin = b.xmin;
+    if (a.ymin > b.ymin) a.ymin = b.ymin;
+    if (a.xmax < b.xmax) a.xmax = b.xmax;
+    if (a.ymax < b.ymax) a.ymax = b.ymax;
+}
+
+static inline float area(const Box2d& a)
+{
+    return (a.xmax - a.xmin) * (a.ymax - a.ymin);
+}
+
+static inline float margin(const Box2d& a)
+{
+    return (a.xmax - a.xmin) + (a.ymax - a.ymin);
+}
+
+// 返回排除非规范化和无效坐标后可用于索引的范围
+static Box2d indexBox(const Box2d& box)
+{
+    Box2d rect(box);
+
+    if (!(rect.xmin <= rect.xmax) || !(rect.ymin <= rect.ymax)) {
+        rect.empty();   // 非规范化或NAN坐标作为原点
+    }
+    return rect;
+}
+
+template <class Node, class Entry>
+static Box2d nodeBounds(const Node* node)
+{
+    Box2d rect(node->entries[0].box);
+    for (int i = 1; i < node->count; i++) {
+        extend(rect, node->entries[i].box);
+    }
+    return rect;
+}
+
+template <class Node>
+static void freeTree(Node* node)
+{
+    if (node && giAtomicDecrement(&node->refcount) == 0) {
+        if (!node->leaf) {
+            for (int i = 0; i < node->count; i++) {
+                freeTree(node->entries[i].child);
+            }
+        }
+        delete node;
+    }
+}
+
+// 返回可修改的节点，节点被共享时复制一份(子节点仍共享)
+template <class Node>
+static Node* uniqueNode(Node* node)
+{
+    if (node->refcount > 1) {
+        Node* p = new Node(node->leaf);
+        p->count = node->count;
+        for (int i = 0; i < node->count; i++) {
+            p->entries[i] = node->entries[i];
+            if (!p->leaf) {
+                giAtomicIncrement(&p->entries[i].child->refcount);
+            }
+        }
+        freeTree(node);
+        node = p;
+    }
+    return node;
+}
+
+template <class Node, class Entry>
+static void collectLeafEntries(const Node* node, std::vector<Entry>& entries)
+{
+    for (int i = 0; i < node->count; i++) {
+        if (node->leaf) {
+            entries.push_back(node->entries[i]);
+        } else {
+            collectLeafEntries(node->entries[i].child, entries);
+        }
+    }
+}
+
+template <class Entry>
+struct LessCenterX {
+    bool operator()(const Entry& a, const Entry& b) const {
+        return a.box.xmin + a.box.xmax < b.box.xmin + b.box.xmax;
+    }
+};
+
+template <class Entry>
+struct LessCenterY {
+    bool operator()(const Entry& a, const Entry& b) const {
+        return a.box.ymin + a.box.ymax < b.box.ymin + b.box.ymax;
+    }
+};
+
+MgShapeIndex::MgShapeIndex() : _root((Node*)0), _count(0)
+{
+}
+
+MgShapeIndex::MgShapeIndex(const MgShapeIndex& src)
+    : _root(src._root), _count(src._count)
+{
+    if (_root) {
+        giAtomicIncrement(&_root->refcount);
+    }
+}
+
+MgShapeIndex::~MgShapeIndex()
+{
+    freeTree(_root);
+}
+
+MgShapeIndex& MgShapeIndex::operator=(const MgShapeIndex& src)
+{
+    if (this != &src) {
+        if (src._root) {
+            giAtomicIncrement(&src._root->refcount);
+        }
+        freeTree(_root);
+        _root = src._root;
+        _count = src._count;
+    }
+    return *this;
+}
+
+void MgShapeIndex::clear()
+{
+    if (_root && _root->refcount == 1) {             // 独占的根节点改为空的叶节点，不必重新分配
+        if (!_root->leaf) {
+            for (int i = 0; i < _root->count; i++) {
+                freeTree(_root->entries[i].child);
+            }
+            _root->leaf = true;
+        }
+        _root->count = 0;
+    } else {
+        freeTree(_root);
+        _root = (Node*)0;
+    }
+    _count = 0;
+}
+
+Box2d MgShapeIndex::getBounds() const
+{
+    return _root && _root->count > 0 ? nodeBounds<Node, Entry>(_root) : Box2d();
+}
+
+void MgShapeIndex::insert(int sid, const Box2d& box)
+{
+    Entry e;
+    e.box = indexBox(box);
+    e.sid = sid;
+    insertRoot(e);
+    _count++;
+}
+
+void MgShapeIndex::insertRoot(const Entry& e)
+{
+    _root = _root ? uniqueNode(_root) : new Node(true);    // 第一次添加时才分配根节点
+
+    Node* sibling = insertEntry(_root, e);
+    if (sibling) {                      // 根节点分裂，树增高一层
+        Node* root = new Node(false);
+        root->entries[0].box = nodeBounds<Node, Entry>(_root);
+        root->entries[0].child = _root;
+        root->entries[1].box = nodeBounds<Node, Entry>(sibling);
+        root->entries[1].child = sibling;
+        root->count = 2;
+        _root = root;
+    }
+}
+
+// 在独占的节点中插入一个叶节点项，节点溢出时分裂，返回新分出的兄弟节点
+MgShapeIndex::Node* MgShapeIndex::insertEntry(Node* node, const Entry& e)
+{
+    if (node->leaf) {
+        node->entries[node->count++] = e;
+    }
+    else {
+        int best = 0;
+        float bestGrow = _FLT_MAX, bestArea = _FLT_MAX, bestMargin = _FLT_MAX;
+
+        for (int i = 0; i < node->count; i++) { // 选择范围增大最少的子节点
+            Box2d rect(node->entries[i].box);
+            extend(rect, e.box);
+
+            float a = area(node->entries[i].box);
+            float grow = area(rect) - a;
+            float m = margin(rect) - margin(node->entries[i].box);
+
+            if (grow < bestGrow || (grow == bestGrow
+                                    && (m < bestMargin || (m == bestMargin && a < bestArea)))) {
+                best = i;
+                bestGrow = grow;
+                bestArea = a;
+                bestMargin = m;
+            }
+        }
+
+        Entry& child = node->entries[best];
+        child.child = uniqueNode(child.child);
+        Node* sibling = insertEntry(child.child, e);
+
+        if (!sibling) {
+            extend(child.box, e.box);
+        } else {
+            child.box = nodeBounds<Node, Entry>(child.child);
+            node->entries[node->count].box = nodeBounds<Node, Entry>(sibling);
+            node->entries[node->count].child = sibling;
+            node->count++;
+        }
+    }
+
+    if (node->count <= kMaxEntries) {
+        return (Node*)0;
+    }
+
+    // 沿中心分布较宽的方向排序，在使两半重叠面积最小处分开
+    Entry* first = node->entries;
+    Entry* last = first + node->count;
+    Box2d centers;
+
+    centers.set(first->box.center(), first->box.center());
+    for (int i = 1; i < node->count; i++) {
+        centers.unionWith(node->entries[i].box.center());
+    }
+    if (centers.width() >= centers.height()) {
+        std::sort(first, last, LessCenterX<Entry>());
+    } else {
+        std::sort(first, last, LessCenterY<Entry>());
+    }
+
+    Box2d lower[kMaxEntries + 1], upper[kMaxEntries + 1];
+    const int n = node->count;
+
+    lower[0] = first[0].box;
+    for (int i = 1; i < n; i++) {
+        lower[i] = lower[i - 1];
+        extend(lower[i], first[i].box);
+    }
+    upper[n - 1] = first[n - 1].box;
+    for (int i = n - 2; i >= 0; i--) {
+        upper[i] = upper[i + 1];
+        extend(upper[i], first[i].box);
+    }
+
+    int split = kMinEntries;
+    float bestOverlap = _FLT_MAX, bestArea = _FLT_MAX;
+
+    for (int k = kMinEntries; k <= n - kMinEntries; k++) {
+        const Box2d& a = lower[k - 1];
+        const Box2d& b = upper[k];
+        float w = mgMin(a.xmax, b.xmax) - mgMax(a.xmin, b.xmin);
+        float h = mgMin(a.ymax, b.ymax) - mgMax(a.ymin, b.ymin);
+        float overlap = (w > 0 && h > 0) ? w * h : 0;
+        float total = area(a) + area(b);
+
+        if (overlap < bestOverlap || (overlap == bestOverlap && total < bestArea)) {
+            split = k;
+            bestOverlap = overlap;
+            bestArea = total;
+        }
+    }
+
+    Node* sibling = new Node(node->leaf);
+    for (int i = split; i < n; i++) {
+        sibling->entries[sibling->count++] = node->entries[i];
+    }
+    node->count = split;
+
+    return sibling;
+}
+
+bool MgShapeIndex::remove(int sid, const Box2d& box)
+{
+    std::vector<int> path;
+    Box2d rect(indexBox(box));
+
+    if (!_root) {
+        return false;
+    }
+    if (!findPath(_root, sid, &rect, path)
+        && !findPath(_root, sid, (const Box2d*)0, path)) {
+        return false;
+    }
+    _count--;
+
+    // 沿路径复制共享的节点，再删除叶节点项
+    std::vector<Node*> nodes(path.size());
+    Node** ref = &_root;
+
+    for (unsigned level = 0; level < path.size(); level++) {
+        *ref = uniqueNode(*ref);
+        nodes[level] = *ref;
+        if (!(*ref)->leaf) {
+            ref = &(*ref)->entries[path[level]].child;
+        }
+    }
+
+    Node* leaf = nodes.back();
+    std::vector<Entry> orphans;
+
+    leaf->entries[path.back()] = leaf->entries[--leaf->count];
+
+    // 自下而上调整范围，项数过少的节点拆散，其叶节点项待重新插入
+    for (int level = (int)path.size() - 2; level >= 0; level--) {
+        Node* node = nodes[level];
+        Node* child = nodes[level + 1];
+        const int i = path[level];
+
+        if (child->count < kMinEntries) {
+            collectLeafEntries<Node, Entry>(child, orphans);
+            freeTree(child);
+            node->entries[i] = node->entries[--node->count];
+        } else {
+            node->entries[i].box = nodeBounds<Node, Entry>(child);
+        }
+    }
+
+    while (!_root->leaf && _root->count < 2) {  // 根节点只有一个子节点时降低树高
+        Node* root = _root;
+        if (root->count == 0) {
+            _root = uniqueNode(root);
+            _root->leaf = true;
+            break;
+        }
+        _root = root->entries[0].child;
+        giAtomicIncrement(&_root->refcount);
+        freeTree(root);
+    }
+    for (unsigned i = 0; i < orphans.size(); i++) {
+        insertRoot(orphans[i]);
+    }
+
+    return true;
+}
+
+// 查找叶节点项，path 依次为各层所经过的项的序号，box 为空时遍历所有子节点
+bool MgShapeIndex::findPath(const Node* node, int sid, const Box2d* box,
+                            std::vector<int>& path) const
+{
+    for (int i = 0; i < node->count; i++) {
+        if (node->leaf ? node->entries[i].sid == sid
+            : ((!box || encloses(node->entries[i].box, *box))
+               && findPath(node->entries[i].child, sid, box, path))) {
+            path.insert(path.begin(), i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void MgShapeIndex::update(int sid, const Box2d& oldbox, const Box2d& newbox)
+{
+    Box2d oldrect(indexBox(oldbox));
+    Box2d newrect(indexBox(newbox));
+
+    if (oldrect.xmin != newrect.xmin || oldrect.ymin != newrect.ymin
+        || oldrect.xmax != newrect.xmax || oldrect.ymax != newrect.ymax) {
+        remove(sid, oldrect);
+        insert(sid, newrect);
+    }
+}
+
+void MgShapeIndex::build(int n, const int* ids, const Box2d* boxes)
+{
+    std::vector<Entry> entries(n > 0 ? n : 0);
+    bool leaf = true;
+
+    for (int i = 0; i < n; i++) {
+        entries[i].box = indexBox(boxes[i]);
+        entries[i].sid = ids[i];
+    }
+    freeTree(_root);
+    _root = (Node*)0;
+
+    if (entries.empty()) {
+        _count = 0;
+        return;
+    }
+    while (entries.size() > (unsigned)kMaxEntries) {
+        buildLevel(entries, leaf);
+        leaf = false;
+    }
+    _root = new Node(leaf);
+    for (unsigned i = 0; i < entries.size(); i++) {
+        _root->entries[_root->count++] = entries[i];
+    }
+    _count = n > 0 ? n : 0;
+}
+
+// 按STR方法将一层的项打包为节点，entries 改为新节点对应的上一层的项
+void MgShapeIndex::buildLevel(std::vector<Entry>& entries, bool leaf)
+{
+    const int n = (int)entries.size();
+    const int nodes = (n + kFillEntries - 1) / kFillEntries;
+    const int slices = (int)ceil(sqrt((double)nodes));
+    const int sliceSize = slices * kFillEntries;
+    std::vector<Entry> parents;
+
+    parents.reserve(nodes);
+    std::sort(entries.begin(), entries.end(), LessCenterX<Entry>());
+
+    for (int start = 0; start < n; start += sliceSize) {
+        int end = mgMin(start + sliceSize, n);
+        std::sort(entries.begin() + start, entries.begin() + end, LessCenterY<Entry>());
+
+        for (int i = start; i < end; i += kFillEntries) {
+            Node* node = new Node(leaf);
+            for (int j = i; j < end && j < i + kFillEntries; j++) {
+                node->entries[node->count++] = entries[j];
+            }
+            Entry e;
+            e.box = nodeBounds<Node, Entry>(node);
+            e.child = node;
+            parents.push_back(e);
+        }
+    }
+    entries.swap(parents);
+}
+
+template <class Node>
+static void queryNode(const Node* node, const Box2d& box, std::vector<int>& ids)
+{
+    for (int i = 0; i < node->count; i++) {
+        if (overlaps(node->entries[i].box, box)) {
+            if (node->leaf) {
+                ids.push_back(node->entries[i].sid);
+            } else {
+                queryNode(node->entries[i].child, box, ids);
+            }
+        }
+    }
+}
+
+int MgShapeIndex::query(const Box2d& box, std::vector<int>& ids) const
+{
+    size_t n = ids.size();
+    if (_root) {
+        queryNode(_root, box, ids);
+    }
+    return (int)(ids.size() - n);
+}
@@ -0,0 +1,61 @@
+//! \file mgshapeindex.h
+//! \brief 定义图形空间索引类 MgShapeIndex
+// Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
+
+#ifndef TOUCHVG_SHAPEINDEX_H_
+#define TOUCHVG_SHAPEINDEX_H_
+
+#include "mgbox.h"
+#include <vector>
+
+//! 按图形范围建立的R树空间索引，供 MgShapes 内部使用
+/*! 每项为图形ID和图形范围，查询结果为范围与给定矩形框相交的图形ID，不保证顺序。
+    范围按闭区间比较，包括退化为点或线段的范围。
+    复制索引时共享所有节点，修改时只复制从根到所改叶节点路径上的节点。
+ */
+class MgShapeIndex
+{
+public:
+    MgShapeIndex();
+    MgShapeIndex(const MgShapeIndex& src);
+    ~MgShapeIndex();
+    MgShapeIndex& operator=(const MgShapeIndex& src);
+
+    //! 清除所有项
+    void clear();
+
+    //! 返回项数
+    int count() const { return _count; }
+
+    //! 返回所有项的总范围，没有项时为空矩形
+    Box2d getBounds() const;
+
+    //! 添加一项
+    void insert(int sid, const Box2d& box);
+
+    //! 删除一项，box 为添加时的范围，与实际不符时将遍历查找
+    bool remove(int sid, const Box2d& box);
+
+    //! 改变一项的范围，oldbox 为添加时的范围
+    void update(int sid, const Box2d& oldbox, const Box2d& newbox);
+
+    //! 清除原有项并批量装载(STR)，比逐个添加更快且树更紧凑
+    void build(int n, const int* ids, const Box2d* boxes);
+
+    //! 查找范围与给定矩形框相交的项，将其ID追加到 ids 中，返回找到的个数
+    int query(const Box2d& box, std::vector<int>& ids) const;
+
+private:
+    struct Node;
+    struct Entry;
+
+    void insertRoot(const Entry& e);
+    Node* insertEntry(Node* node, const Entry& e);
+    bool findPath(const Node* node, int sid, const Box2d* box, std::vector<int>& path) const;
+    void buildLevel(std::vector<Entry>& entries, bool leaf);
+
+    Node*   _root;      //!< 没有项时可为NULL
+    int     _count;
+};
+
+#endif // TOUCHVG_SHAPEINDEX_H_
@@ -5,42 +5,116 @@
 #include "mgspfactory.h"
 #include "mglog.h"
 #include "mgcomposite.h"
-#include <list>
-#include <map>
+#include "mgshapeindex.h"
+#include "mglazyshapes.h"
+#include "mgdrawprogress.h"
+#include "mgchunkarray.h"
+#include "mgshapetype.h"
+#include <vector>
 #include <set>
+#include <algorithm>
 
+//! 图形数组中图形的引用计数操作，数组块被复制或释放时调用
+struct MgShapeRefs {
+    static void retain(MgShape* sp) { if (sp) sp->addRef(); }
+    static void release(MgShape* sp) { if (sp) sp->release(); }
+};
+
+static volatile long _changeStamp = 0;     // 全局递增的修改序号，同一序号表示同一次修改
+
+// 图形数组、ID散列表和空间索引都是分块共享的，shallowCopy 只复制块指针，
+// 修改时只复制所改的块，因此每次提交后台文档的代价与修改量而不是图形数成正比
 struct MgShapes::I
 {
-    typedef std::list<MgShape*> Container;
-    typedef Container::const_iterator citerator;
-    typedef Container::iterator iterator;
-    typedef std::map<int, MgShape*>  ID2SHAPE;
+    typedef MgChunkArray<MgShape*, MgShapeRefs> Container;  // 按显示顺序，已删除的位置为空
+    
+    //! 跳过已删除位置的只读迭代器
+    class citerator {
+    public:
+        citerator(const Container& arr, int pos) : _arr(&arr), _pos(pos) { skip(); }
+        MgShape* operator*() const { return (*_arr)[_pos]; }
+        citerator& operator++() { ++_pos; skip(); return *this; }
+        bool operator==(const citerator& it) const { return _pos == it._pos; }
+        bool operator!=(const citerator& it) const { return _pos != it._pos; }
+    private:
+        void skip() { while (_pos < _arr->size() && !(*_arr)[_pos]) ++_pos; }
+        const Container* _arr;
+        int _pos;
+    };
+    struct Bucket {
+        int         sid;            // 0 表示空桶，-1 表示已删除
+        int         pos;            // 图形在 shapes 中的位置
+    };
+    struct Change {
+        long        stamp;          // 修改序号
+        int         sid;
+        int         type;           // kShapeAdded 等
+    };
     
     Container   shapes;
-    ID2SHAPE    id2shape;
+    int         head;               // 首个图形的位置，前面的空位供 bringToBack 使用
+    int         holes;              // head 之后已删除的位置数
+    std::vector<int> blockHoles;    // 每块(kBlockSize个位置)中已删除的位置数，用于序号换算
+    int         origin;             // 所有位置整体后移的累计量，供迭代器换算位置
+    MgChunkArray<Bucket> buckets;   // 开放寻址的ID散列表，桶数为2的幂，图形少时为空
+    int         used;               // 已用的桶数(含已删除)
+    volatile long iterating;        // 未释放的迭代器个数，期间不压缩
+    MgShapeIndex rtree;             // 图形范围的空间索引，图形少时为空
+    MgLazyShapes* lazy;             // 按需加载的图形桩，没有时为NULL
+    std::vector<MgShape*> spares;   // clear(true) 保留的未共享图形，供添加图形时重用
+    MgChunkArray<Change> changes;   // 修改记录，浅拷贝时共享，序号递增，只有图层才记录
+    long        changeBase;         // 修改记录开始时的序号
+    bool        logging;            // 是否记录修改，录制时只比较图层的修改记录
     MgObject*   owner;
     int         index;
     int         newShapeID;
     volatile long refcount;
     
-    MgShape* findShape(int sid) const;
-    int getNewID(int sid);
+    enum { kBlockBits = 10, kBlockSize = 1 << kBlockBits };
+    enum { kMaxChanges = 4096 };    // 修改记录过多时重新开始，使用者改为比较所有图形
+    enum { kMaxSpares = 64 };
+    enum { kHashMinCount = 16 };    // 图形多于此数才建立ID散列表，否则顺序查找
+    enum { kIndexMinCount = 64 };   // 图形达到此数才建立空间索引，否则遍历所有图形
     
-    iterator findPositionOfID(int sid) {
-        iterator it = shapes.begin();
-        for (; it != shapes.end() && (*it)->getID() != sid; ++it) ;
-        return it;
-    }
-    iterator findPositionOfIndex(int index) {
-        iterator it = shapes.begin();
-        for (int i = 0; it != shapes.end() && i != index; ++it, ++i) ;
-        return it;
+    I() : head(0), holes(0), origin(0), used(0), iterating(0), lazy((MgLazyShapes*)0) {
+        resetChanges();
     }
-    citerator findPositionOfIndex(int index) const {
-        citerator it = shapes.begin();
-        for (int i = 0; it != shapes.end() && i != index; ++it, ++i) ;
-        return it;
+    
+    int count() const { return (int)shapes.size() - head - holes; }
+    bool indexed() const { return rtree.count() > 0; }
+    citerator begin() const { return citerator(shapes, head); }
+    citerator end() const { return citerator(shapes, shapes.size()); }
+    
+    MgShape* findShape(int sid) const;
+    template <class T> T* loaded(T* sp) const { // 用到图形内容前加载图形桩
+        if (lazy && sp)
+            lazy->load(sp);
+        return sp;
     }
+    int getNewID(int sid);
+    int findPos(int sid) const;
+    void setPos(int sid, int pos);
+    void removePos(int sid);
+    void shiftPos(int first, int last, int delta);
+    void rehash();
+    int rawPos(int index) const;
+    int indexOf(int pos) const;
+    int blockLive(int b) const;
+    void markHole(int pos, int delta);
+    void recountHoles(int first, int last);
+    void append(MgShape* sp, bool indexed = true);
+    void replace(int pos, MgShape* newsp, bool indexed = true);
+    MgShape* detach(int pos);
+    void erase(int pos);
+    void compact();
+    void growFront(int gap);
+    void share(const I& src);
+    void clear(bool keepCapacity = false);
+    MgShape* takeSpare(int type);
+    void rebuildIndex();
+    void logChange(int sid, int type);
+    void resetChanges(bool keepCapacity = false);
+    bool queryShapes(const Box2d& box, std::vector<const MgShape*>& arr) const;
 };
 
 MgShapes* MgShapes::create(MgObject* owner, int index)
@@ -55,6 +129,7 @@ MgShapes::MgShapes(MgObject* owner, int index)
     //LOGD("+MgShapes %ld", giAtomicIncrement(&_n));
     im = new I();
     im->owner = owner;
+    im->logging = owner && owner->isKindOf(kMgShapeDoc);
     im->index = index;
     im->newShapeID = 1;
     im->refcount = 1;
@@ -98,6 +173,12 @@ MgShapes* MgShapes::shallowCopy() const
 
 int MgShapes::copyShapes(const MgShapes* src, bool deeply, bool needClear)
 {
+    if (!deeply && needClear) {
+        if (src != this) {
+            im->share(*src->im);
+        }
+        return im->count();
+    }
     if (needClear)
         clear();
     
@@ -109,8 +190,8 @@ int MgShapes::copyShapes(const MgShapes* src, bool deeply, bool needClear)
             ret += addShape(*sp) ? 1 : 0;
         } else {
             sp->addRef();
-            im->shapes.push_back(sp);
-            im->id2shape[sp->getID()] = sp;
+            im->append(sp);
+            im->logChange(sp->getID(), kShapeAdded);
             ret++;
         }
     }
@@ -124,7 +205,10 @@ bool MgShapes::equals(const MgObject& src) const
     
     if (src.isKindOf(Type())) {
         const MgShapes& _src = (const MgShapes&)src;
-        ret = (im->shapes == _src.im->shapes);
+        I::citerator it = im->begin(), it2 = _src.im->begin();
+        
+        for (; it != im->end() && it2 != _src.im->end() && *it == *it2; ++it, ++it2) ;
+        ret = (it == im->end() && it2 == _src.im->end());
     }
     
     return ret;
@@ -132,16 +216,27 @@ bool MgShapes::equals(const MgObject& src) const
 
 void MgShapes::clear()
 {
-    for (I::iterator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
-        (*it)->release();
-    }
-    im->shapes.clear();
-    im->id2shape.clear();
+    im->clear();
+}
+
+void MgShapes::clear(bool keepCapacity)
+{
+    im->clear(keepCapacity);
+}
+
+bool MgShapes::isShared() const
+{
+    return im->refcount > 1;
+}
+
+MgShape* MgShapes::reuseShape(int type)
+{
+    return im->takeSpare(type);
 }
 
 void MgShapes::clearCachedData()
 {
-    for (I::iterator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
+    for (I::citerator it = im->begin(); it != im->end(); ++it) {
         (*it)->shape()->clearCachedData();
     }
 }
@@ -159,15 +254,15 @@ int MgShapes::getIndex() const
 bool MgShapes::updateShape(MgShape* shape, bool force)
 {
     if (shape && (force || !shape->getParent() || shape->getParent() == this)) {
-        I::iterator it = im->findPositionOfID(shape->getID());
-        if (it != im->shapes.end()) {
+        int pos = im->findPos(shape->getID());
+        if (pos >= 0) {
+            const MgShape* oldsp = im->shapes[pos];
             shape->shape()->update();
-            shape->shape()->resetChangeCount((*it)->shapec()->getChangeCount()
-                                             + ((*it)->equals(*shape) ? 0 : 1));
-            (*it)->release();
-            *it = shape;
+            shape->shape()->resetChangeCount(oldsp->shapec()->getChangeCount()
+                                             + (oldsp->equals(*shape) ? 0 : 1));
             shape->setParent(this, shape->getID());
-            im->id2shape[shape->getID()] = shape;
+            im->replace(pos, shape);
+            im->logChange(shape->getID(), kShapeUpdated);
             return true;
         }
     }
@@ -176,27 +271,45 @@ bool MgShapes::updateShape(MgShape* shape, bool force)
 
 void MgShapes::transform(const Matrix2d& mat)
 {
-    for (I::iterator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
-        MgShape* newsp = (*it)->cloneShape();
+    for (int pos = im->head; pos < (int)im->shapes.size(); pos++) {
+        const MgShape* oldsp = im->loaded(im->shapes[pos]);
+        if (!oldsp)
+            continue;
+        MgShape* newsp = oldsp->cloneShape();
         newsp->shape()->transform(mat);
-        if (!updateShape(newsp, true))
-            MgObject::release_pointer(newsp);
+        newsp->shape()->update();
+        newsp->shape()->resetChangeCount(oldsp->shapec()->getChangeCount() + 1);
+        newsp->setParent(this, newsp->getID());
+        im->replace(pos, newsp, false);
     }
+    im->rebuildIndex();     // 所有图形都变了，批量重建比逐个更新快
+    im->resetChanges();
+}
+
+void MgShapes::rebuildIndex()
+{
+    im->rebuildIndex();
+    im->resetChanges();     // 图形可能被直接改变了，不能只看修改记录
 }
 
 MgShape* MgShapes::cloneShape(int sid) const
 {
-    const MgShape* p = im->findShape(sid);
+    const MgShape* p = im->loaded(im->findShape(sid));
     return p ? p->cloneShape() : MgShape::Null();
 }
 
 MgShape* MgShapes::addShape(const MgShape& src)
 {
-    MgShape* p = src.cloneShape();
+    MgShape* p = im->takeSpare(src.getType());
+    if (p) {
+        p->copy(src);           // 同类图形复制内容，可沿用其顶点等缓冲
+    } else {
+        p = src.cloneShape();
+    }
     if (p) {
         p->setParent(this, im->getNewID(src.getID()));
-        im->shapes.push_back(p);
-        im->id2shape[p->getID()] = p;
+        im->append(p);
+        im->logChange(p->getID(), kShapeAdded);
     }
     return p;
 }
@@ -206,8 +319,8 @@ bool MgShapes::addShapeDirect(MgShape* shape, bool force)
     if (shape && (force || !shape->getParent() || shape->getParent() == this)) {
         shape->shape()->update();
         shape->setParent(this, im->getNewID(0));
-        im->shapes.push_back(shape);
-        im->id2shape[shape->getID()] = shape;
+        im->append(shape);
+        im->logChange(shape->getID(), kShapeAdded);
         return true;
     }
     return false;
@@ -215,13 +328,11 @@ bool MgShapes::addShapeDirect(MgShape* shape, bool force)
 
 bool MgShapes::removeShape(int sid)
 {
-    I::iterator it = im->findPositionOfID(sid);
+    int pos = im->findPos(sid);
     
-    if (it != im->shapes.end()) {
-        MgShape* shape = *it;
-        im->shapes.erase(it);
-        im->id2shape.erase(shape->getID());
-        shape->release();
+    if (pos >= 0) {
+        im->erase(pos);
+        im->logChange(sid, kShapeRemoved);
         return true;
     }
     
@@ -230,15 +341,17 @@ bool MgShapes::removeShape(int sid)
 
 bool MgShapes::moveShapeTo(int sid, MgShapes* dest)
 {
-    I::iterator it = im->findPositionOfID(sid);
+    int pos = im->findPos(sid);
     
-    if (dest && dest != this && it != im->shapes.end()) {
-        MgShape* newsp = (*it)->cloneShape();
+    if (dest && dest != this && pos >= 0) {
+        MgShape* newsp = im->loaded(im->shapes[pos])->cloneShape();
         newsp->setParent(dest, dest->im->getNewID(newsp->getID()));
-        dest->im->shapes.push_back(newsp);
-        dest->im->id2shape[newsp->getID()] = newsp;
+        dest->im->append(newsp);
+        dest->im->logChange(newsp->getID(), kShapeAdded);
+        im->erase(pos);
+        im->logChange(sid, kShapeRemoved);
         
-        return removeShape(sid);
+        return true;
     }
     
     return false;
@@ -247,23 +360,22 @@ bool MgShapes::moveShapeTo(int sid, MgShapes* dest)
 void MgShapes::copyShapesTo(MgShapes* dest) const
 {
     if (dest && dest != this) {
-        for (I::iterator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
-            MgShape* newsp = (*it)->cloneShape();
+        for (I::citerator it = im->begin(); it != im->end(); ++it) {
+            MgShape* newsp = im->loaded(*it)->cloneShape();
             newsp->setParent(dest, dest->im->getNewID(newsp->getID()));
-            dest->im->shapes.push_back(newsp);
-            dest->im->id2shape[newsp->getID()] = newsp;
+            dest->im->append(newsp);
+            dest->im->logChange(newsp->getID(), kShapeAdded);
         }
     }
 }
 
 bool MgShapes::bringToFront(int sid)
 {
-    I::iterator it = im->findPositionOfID(sid);
+    int pos = im->findPos(sid);
     
-    if (it != im->shapes.end()) {
-        MgShape* shape = *it;
-        im->shapes.erase(it);
-        im->shapes.push_back(shape);
+    if (pos >= 0) {
+        im->append(im->detach(pos), false);
+        im->logChange(sid, kShapeReordered);
         return true;
     }
     
@@ -272,12 +384,16 @@ bool MgShapes::bringToFront(int sid)
 
 bool MgShapes::bringToBack(int sid)
 {
-    I::iterator it = im->findPositionOfID(sid);
+    int pos = im->findPos(sid);
     
-    if (it != im->shapes.end()) {
-        MgShape* shape = *it;
-        im->shapes.erase(it);
-        im->shapes.push_front(shape);
+    if (pos >= 0) {
+        MgShape* shape = im->detach(pos);
+        if (im->head == 0) {
+            im->growFront(mgMax(16, im->count() / 4));
+        }
+        im->shapes.at(--im->head) = shape;
+        im->setPos(sid, im->head);
+        im->logChange(sid, kShapeReordered);
         return true;
     }
     
@@ -286,17 +402,45 @@ bool MgShapes::bringToBack(int sid)
 
 bool MgShapes::bringToIndex(int sid, int index)
 {
-    I::iterator it = im->findPositionOfID(sid);
+    int pos = im->findPos(sid);
     
-    if (it != im->shapes.end()) {
-        MgShape* shape = *it;
-        im->shapes.erase(it);
-        it = im->findPositionOfIndex(index);
-        im->shapes.insert(it, shape);
-        return true;
+    if (pos < 0) {
+        return false;
     }
     
-    return false;
+    const int last = im->count() - 1;
+    int from = im->indexOf(pos);
+    int to = (index < 0 || index > last) ? last : index;
+    int dest = im->rawPos(to);
+    I::Container& arr = im->shapes;
+    MgShape* shape = arr[pos];
+    
+    if (to < from) {                    // 前移，中间的图形后移一格
+        for (int i = pos; i > dest; i--) {
+            MgShape* sp = arr[i - 1];
+            arr.at(i) = sp;
+        }
+    } else if (to > from) {             // 后移，中间的图形前移一格
+        for (int i = pos; i < dest; i++) {
+            MgShape* sp = arr[i + 1];
+            arr.at(i) = sp;
+        }
+    }
+    arr.at(dest) = shape;
+    if (to < from) {
+        im->shiftPos(dest + 1, pos, 1);
+    } else if (to > from) {
+        im->shiftPos(pos, dest - 1, -1);
+    }
+    im->setPos(sid, dest);
+    if (im->holes > 0) {
+        im->recountHoles(mgMin(pos, dest), mgMax(pos, dest));
+    }
+    if (to != from) {
+        im->logChange(sid, kShapeReordered);
+    }
+    
+    return true;
 }
 
 bool MgShapes::reorderShapes(int n, const int *ids)
@@ -305,66 +449,113 @@ bool MgShapes::reorderShapes(int n, const int *ids)
     std::set<int> newids;
     
     for (int i = 0; i < n; i++) {
-        const MgShape* sp = findShape(ids[i]);
+        MgShape* sp = im->findShape(ids[i]);
         if (sp) {
-            shapes.push_back((MgShape*)sp);
+            sp->addRef();
+            shapes.push_back(sp);
             newids.insert(sp->getID());
         }
     }
-    if (!newids.empty() && newids.size() == im->shapes.size()) {
-        im->shapes = shapes;
+    if (!newids.empty() && (int)newids.size() == im->count()) {
+        im->shapes.swap(shapes);
+        im->head = 0;
+        im->holes = 0;
+        im->blockHoles.clear();
+        im->rehash();
+        im->logChange(0, kShapeReordered);
         return true;
     }
     return false;
 }
 
+long MgShapes::getChangeEpoch() const
+{
+    return im->changes.empty() ? im->changeBase : im->changes.back().stamp;
+}
+
+bool MgShapes::getChangesSince(long epoch, std::vector<int>& changes) const
+{
+    int lo = 0, hi = im->changes.size();
+    
+    if (epoch != im->changeBase) {          // 按序号二分查找 epoch 对应的记录
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (im->changes[mid].stamp < epoch)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == im->changes.size() || im->changes[lo].stamp != epoch) {
+            return false;
+        }
+        lo++;
+        hi = im->changes.size();
+    }
+    for (; lo < hi; lo++) {
+        changes.push_back(im->changes[lo].sid);
+        changes.push_back(im->changes[lo].type);
+    }
+    
+    return true;
+}
+
 int MgShapes::getShapeCount() const
 {
-    return (int)im->shapes.size();
+    return im->count();
 }
 
 void MgShapes::freeIterator(void*& it) const
 {
     if (it) {
-        delete (I::citerator*)it;
+        delete (int*)it;
         it = (void*)0;
+        giAtomicDecrement(&im->iterating);
     }
 }
 
+// 迭代器记录的是减去 origin 后的位置，在 bringToBack 整体后移时仍有效
 const MgShape* MgShapes::getFirstShape(void*& it) const
 {
-    if (im->shapes.empty()) {
+    if (im->count() == 0) {
         it = NULL;
         return MgShape::Null();
     }
-    it = (void*)(new I::citerator(im->shapes.begin()));
-    return im->shapes.empty() ? MgShape::Null() : im->shapes.front();
+    giAtomicIncrement(&im->iterating);
+    it = (void*)(new int(im->head - im->origin));
+    return im->loaded(im->shapes[im->head]);
 }
 
 const MgShape* MgShapes::getNextShape(void*& it) const
 {
-    I::citerator* pit = (I::citerator*)it;
-    if (pit && *pit != im->shapes.end()) {
-        ++(*pit);
-        if (*pit != im->shapes.end())
-            return *(*pit);
+    int* pit = (int*)it;
+    
+    if (pit) {
+        int pos = *pit + im->origin;
+        const int n = (int)im->shapes.size();
+        
+        pos = mgMax(pos + 1, im->head);
+        while (pos < n && !im->shapes[pos])
+            pos++;
+        *pit = pos - im->origin;
+        if (pos < n)
+            return im->loaded(im->shapes[pos]);
     }
     return MgShape::Null();
 }
 
 const MgShape* MgShapes::getHeadShape() const
 {
-    return im->shapes.empty() ? MgShape::Null() : im->shapes.front();
+    return im->count() == 0 ? MgShape::Null() : im->loaded(im->shapes[im->head]);
 }
 
 const MgShape* MgShapes::getLastShape() const
 {
-    return im->shapes.empty() ? MgShape::Null() : im->shapes.back();
+    return im->count() == 0 ? MgShape::Null() : im->loaded(im->shapes.back());
 }
 
 const MgShape* MgShapes::findShape(int sid) const
 {
-    return im->findShape(sid);
+    return im->loaded(im->findShape(sid));
 }
 
 const MgShape* MgShapes::findShapeByTag(int tag) const
@@ -372,9 +563,9 @@ const MgShape* MgShapes::findShapeByTag(int tag) const
     if (0 == tag) {
         return MgShape::Null();
     }
-    for (I::citerator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
+    for (I::citerator it = im->begin(); it != im->end(); ++it) {
         if ((*it)->getTag() == tag)
-            return *it;
+            return im->loaded(*it);
     }
     return MgShape::Null();
 }
@@ -382,7 +573,7 @@ const MgShape* MgShapes::findShapeByTag(int tag) const
 int MgShapes::getShapeCountByTypeOrTag(int type, int tag) const
 {
     int n = 0;
-    for (I::citerator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
+    for (I::citerator it = im->begin(); it != im->end(); ++it) {
         if ((type != 0 && type == (*it)->shapec()->getType()) ||
             (tag != 0 && tag == (*it)->getTag())) {
             n++;
@@ -393,18 +584,13 @@ int MgShapes::getShapeCountByTypeOrTag(int type, int tag) const
 
 int MgShapes::getShapeIndex(int sid) const
 {
-    int i = 0;
-    for (I::citerator it = im->shapes.begin(); it != im->shapes.end(); ++it, ++i) {
-        if ((*it)->getID() == sid)
-            return i;
-    }
-    return -1;
+    int pos = im->findPos(sid);
+    return pos < 0 ? -1 : im->indexOf(pos);
 }
 
 const MgShape* MgShapes::getShapeAtIndex(int index) const
 {
-    I::citerator it = im->findPositionOfIndex(index);
-    return it != im->shapes.end() ? *it : MgShape::Null();
+    return index >= 0 && index < im->count() ? im->loaded(im->shapes[im->rawPos(index)]) : MgShape::Null();
 }
 
 const MgShape* MgShapes::findShapeByType(int type) const
@@ -412,18 +598,18 @@ const MgShape* MgShapes::findShapeByType(int type) const
     if (0 == type) {
         return MgShape::Null();
     }
-    for (I::citerator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
+    for (I::citerator it = im->begin(); it != im->end(); ++it) {
         if ((*it)->shapec()->getType() == type)
-            return *it;
+            return im->loaded(*it);
     }
     return MgShape::Null();
 }
 
 const MgShape* MgShapes::findShapeByTypeAndTag(int type, int tag) const
 {
-    for (I::citerator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
+    for (I::citerator it = im->begin(); it != im->end(); ++it) {
         if ((*it)->shapec()->getType() == type && (*it)->getTag() == tag)
-            return *it;
+            return im->loaded(*it);
     }
     return MgShape::Null();
 }
@@ -432,13 +618,13 @@ int MgShapes::traverseByType(int type, void (*c)(const MgShape*, void*), void* d
 {
     int count = 0;
     
-    for (I::citerator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
+    for (I::citerator it = im->begin(); it != im->end(); ++it) {
         const MgBaseShape* shape = (*it)->shapec();
         if (type == 0 || shape->isKindOf(type)) {
-            (*c)(*it, d);
+            (*c)(im->loaded(*it), d);
             count++;
         } else if (shape->isKindOf(MgComposite::Type())) {
-            const MgComposite *composite = (const MgComposite *)shape;
+            const MgComposite *composite = (const MgComposite *)im->loaded(*it)->shapec();
             count += composite->shapes()->traverseByType(type, c, d);
         }
     }
@@ -462,7 +648,7 @@ static const float EXTENT_LIMIT = 1e5f - 1.f;
 Box2d MgShapes::getExtent() const
 {
     Box2d extent;
-    for (I::citerator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
+    for (I::citerator it = im->begin(); it != im->end(); ++it) {
         Box2d box((*it)->shapec()->getExtent());
         if (box.xmin > -EXTENT_LIMIT && box.ymin > -EXTENT_LIMIT &&
             box.xmax <  EXTENT_LIMIT && box.ymax <  EXTENT_LIMIT) {
@@ -478,63 +664,118 @@ static bool isVisibleAndLocked(const MgBaseShape* shape)
     return (shape->isVisible() && (!shape->isLocked() || shape->getFlag(kMgCanSelLocked)));
 }
 
+static inline bool loadShape(MgLazyShapes* lazy, const MgShape* sp)
+{
+    if (lazy)
+        lazy->load(sp);
+    return true;
+}
+
+static void hitTestShape(const MgShape* sp, const Box2d& limits, MgHitResult& res,
+                         MgShapes::Filter filter, void* data, const MgShape*& retshape,
+                         MgLazyShapes* lazy)
+{
+    const MgBaseShape* shape = sp->shapec();
+    Box2d extent(shape->getExtent());
+    
+    if (extent.isIntersect(limits) && loadShape(lazy, sp)
+        && (filter || isVisibleAndLocked(shape))
+        && (!filter || filter(sp, data)))
+    {
+        MgHitResult tmpRes;
+        float  tol = (!sp->hasFillColor() ? limits.width() / 2
+                      : mgMax(extent.width(), extent.height()));
+        float  dist = shape->hitTest(limits.center(), tol, tmpRes);
+        
+        tmpRes.contained = limits.contains(extent);
+        if (res.contained == tmpRes.contained
+            ? res.dist > dist - _MGZERO         // 让末尾图形优先选中
+            : tmpRes.contained)                 // 在捕捉盒子内的小图形优先
+        {
+            res = tmpRes;
+            res.dist = dist;
+            retshape = sp;
+        }
+    }
+}
+
 const MgShape* MgShapes::hitTest(const Box2d& limits, MgHitResult& res,
                                  Filter filter, void* data) const
 {
     const MgShape* retshape = MgShape::Null();
+    std::vector<const MgShape*> arr;
     
     res.dist = limits.width() > 1e4f ? limits.width() : limits.width() * 20.f;
-    for (I::citerator it = im->shapes.begin(); it != im->shapes.end(); ++it) {
-        const MgBaseShape* shape = (*it)->shapec();
-        Box2d extent(shape->getExtent());
-        
-        if ((filter || isVisibleAndLocked(shape))
-            && extent.isIntersect(limits)
-            && (!filter || filter(*it, data)))
-        {
-            MgHitResult tmpRes;
-            float  tol = (!(*it)->hasFillColor() ? limits.width() / 2
-                          : mgMax(extent.width(), extent.height()));
-            float  dist = shape->hitTest(limits.center(), tol, tmpRes);
-            
-            tmpRes.contained = limits.contains(extent);
-            if (res.contained == tmpRes.contained
-                ? res.dist > dist - _MGZERO         // 让末尾图形优先选中
-                : tmpRes.contained)                 // 在捕捉盒子内的小图形优先
-            {
-                res = tmpRes;
-                res.dist = dist;
-                retshape = *it;
-            }
+    if (im->queryShapes(limits, arr)) {
+        for (size_t i = 0; i < arr.size(); i++) {
+            hitTestShape(arr[i], limits, res, filter, data, retshape, im->lazy);
+        }
+    } else {
+        for (I::citerator it = im->begin(); it != im->end(); ++it) {
+            hitTestShape(*it, limits, res, filter, data, retshape, im->lazy);
         }
     }
     
     return retshape;
 }
 
+int MgShapes::queryBox(const Box2d& box, void (*c)(const MgShape*, void*), void* d) const
+{
+    std::vector<const MgShape*> arr;
+    int count = 0;
+    
+    if (im->queryShapes(box, arr)) {
+        for (size_t i = 0; i < arr.size(); i++) {
+            (*c)(im->loaded(arr[i]), d);
+        }
+        count = (int)arr.size();
+    } else {
+        for (I::citerator it = im->begin(); it != im->end(); ++it) {
+            if ((*it)->shapec()->getExtent().isIntersect(box)) {
+                (*c)(im->loaded(*it), d);
+                count++;
+            }
+        }
+    }
+    
+    return count;
+}
+
 int MgShapes::draw(GiGraphics& gs, const GiContext *ctx) const
 {
     return dyndraw(0, gs, ctx, -1);
 }
 
+static bool dyndrawShape(const MgShape* sp, int mode, GiGraphics& gs, const GiContext *ctx,
+                         int segment, const int* ignoreIds, const Box2d& clip,
+                         MgLazyShapes* lazy)
+{
+    if (ignoreIds) {
+        for (int i = 0; ignoreIds[i]; i++) {
+            if (sp->getID() == ignoreIds[i]) {
+                return false;
+            }
+        }
+    }
+    return (sp->shapec()->getExtent().isIntersect(clip) && loadShape(lazy, sp)
+            && sp->shapec()->isVisible() && sp->draw(mode, gs, ctx, segment));
+}
+
 int MgShapes::dyndraw(int mode, GiGraphics& gs, const GiContext *ctx,
                       int segment, const int* ignoreIds) const
 {
     Box2d clip(gs.getClipModel());
+    std::vector<const MgShape*> arr;
     int count = 0;
     
-    for (I::citerator it = im->shapes.begin(); it != im->shapes.end() && !gs.isStopping(); ++it) {
-        const MgShape* sp = *it;
-        if (ignoreIds) {
-            for (int i = 0; ignoreIds[i]; i++) {
-                if (sp->getID() == ignoreIds[i]) {
-                    sp = MgShape::Null();
-                    break;
-                }
-            }
+    if (im->queryShapes(clip, arr)) {
+        for (size_t i = 0; i < arr.size() && !gs.isStopping(); i++) {
+            if (dyndrawShape(arr[i], mode, gs, ctx, segment, ignoreIds, clip, im->lazy))
+                count++;
         }
-        if (sp && sp->shapec()->isVisible() && sp->shapec()->getExtent().isIntersect(clip)) {
-            if (sp->draw(mode, gs, ctx, segment))
+    } else {
+        for (I::citerator it = im->begin(); it != im->end() && !gs.isStopping(); ++it) {
+            if (dyndrawShape(*it, mode, gs, ctx, segment, ignoreIds, clip, im->lazy))
                 count++;
         }
     }
@@ -542,6 +783,36 @@ int MgShapes::dyndraw(int mode, GiGraphics& gs, const GiContext *ctx,
     return count;
 }
 
+int MgShapes::dyndraw(int mode, GiGraphics& gs, MgDrawProgress& progress,
+                      const int* ignoreIds) const
+{
+    Box2d clip(gs.getClipModel());
+    const MgShape* sp;
+    int count = 0;
+    
+    if (!progress.isListed(this)) {     // 开始绘制本图层，先按显示顺序列出可见图形
+        std::vector<const MgShape*>& arr = progress.beginList(this, getChangeEpoch());
+        
+        if (!im->queryShapes(clip, arr)) {
+            for (I::citerator it = im->begin(); it != im->end(); ++it) {
+                if ((*it)->shapec()->getExtent().isIntersect(clip))
+                    arr.push_back(*it);
+            }
+        }
+        progress.sortList(gs.xf().modelToDisplay());
+    }
+    while (!progress.isOverBudget() && (sp = progress.next()) != NULL) {
+        if (dyndrawShape(sp, mode, gs, (const GiContext*)0, -1, ignoreIds, clip, im->lazy))
+            count++;
+        if (gs.isStopping()) {          // 中止的图形可能未画完，下次重画
+            progress.undoNext();
+            break;
+        }
+    }
+    
+    return count;
+}
+
 bool MgShapes::save(MgStorage* s, int startIndex) const
 {
     bool ret = false;
@@ -552,14 +823,21 @@ bool MgShapes::save(MgStorage* s, int startIndex) const
         ret = saveExtra(s);
         rect = getExtent();
         s->writeFloatArray("extent", &rect.xmin, 4);
-        s->writeInt("count", (int)im->shapes.size() - startIndex);
+        s->writeInt("count", im->count() - startIndex);
         
-        for (I::citerator it = im->shapes.begin();
-             ret && it != im->shapes.end(); ++it, ++index)
+        for (I::citerator it = im->begin();
+             ret && it != im->end(); ++it, ++index)
         {
             if (index < startIndex)
                 continue;
-            ret = saveShape(s, *it, index - startIndex);
+            
+            // 未加载的图形桩临时加载后保存，不驻留内存
+            MgShape* tmpsp = im->lazy ? im->lazy->loadCopy(*it) : MgShape::Null();
+            
+            ret = saveShape(s, tmpsp ? tmpsp : *it, index - startIndex);
+            if (tmpsp) {
+                tmpsp->release();
+            }
         }
         s->writeNode("shapes", im->index, true);
     }
@@ -604,6 +882,9 @@ int MgShapes::load(MgShapeFactory* factory, MgStorage* s, bool addOnly)
             const int sid = s->readInt("id", 0);
             s->readFloatArray("extent", &rect.xmin, 4, false);
             
+            size_t pos = 0;
+            MgStorageSource* src = addOnly ? (MgStorageSource*)0 : s->getSource(pos);
+            
             const MgShape* oldsp = addOnly && sid ? findShape(sid) : MgShape::Null();
             MgShape* newsp = factory->createShape(type);
             
@@ -613,16 +894,26 @@ int MgShapes::load(MgShapeFactory* factory, MgStorage* s, bool addOnly)
             if (newsp) {
                 newsp->setParent(this, oldsp ? sid : im->getNewID(sid));
                 newsp->shape()->setExtent(rect);
-                ret = newsp->load(factory, s);
+                if (src) {                  // 按需加载，先只读取类型、ID、标记和范围
+                    if (!im->lazy) {
+                        im->lazy = new MgLazyShapes(src, factory);
+                    }
+                    im->lazy->add(newsp, pos);
+                    newsp->setTag(s->readInt("tag", 0));
+                } else {
+                    ret = newsp->load(factory, s);
+                }
                 if (ret) {
                     count++;
                     newsp->shape()->setFlag(kMgClosed, newsp->shape()->isClosed());
-                    im->id2shape[newsp->getID()] = newsp;
                     if (oldsp) {
                         updateShape(newsp);
                     }
                     else {
-                        im->shapes.push_back(newsp);
+                        im->append(newsp, addOnly);
+                        if (addOnly) {
+                            im->logChange(newsp->getID(), kShapeAdded);
+                        }
                     }
                 }
                 else {
@@ -634,6 +925,12 @@ int MgShapes::load(MgShapeFactory* factory, MgStorage* s, bool addOnly)
             }
             s->readNode("shape", index++, true);
         }
+        if (!addOnly) {
+            if (im->lazy) {
+                im->lazy->ready();
+            }
+            im->rebuildIndex();
+        }
         s->readNode("shapes", im->index, true);
     }
     else if (s && im->index == 0) {
@@ -650,10 +947,8 @@ void MgShapes::setNewShapeID(int sid)
 
 MgShape* MgShapes::I::findShape(int sid) const
 {
-    if (0 == sid || -1 == sid)
-        return MgShape::Null();
-    ID2SHAPE::const_iterator it = id2shape.find(sid);
-    return it != id2shape.end() ? it->second : MgShape::Null();
+    int pos = findPos(sid);
+    return pos >= 0 ? shapes[pos] : MgShape::Null();
 }
 
 int MgShapes::I::getNewID(int sid)
@@ -665,3 +960,430 @@ int MgShapes::I::getNewID(int sid)
     }
     return sid;
 }
+
+static inline unsigned hashID(int sid)
+{
+    return (unsigned)sid * 2654435761u;
+}
+
+int MgShapes::I::findPos(int sid) const
+{
+    if (0 == sid || -1 == sid)
+        return -1;
+    if (buckets.empty()) {
+        for (int pos = head; pos < (int)shapes.size(); pos++) {
+            if (shapes[pos] && shapes[pos]->getID() == sid)
+                return pos;
+        }
+        return -1;
+    }
+    
+    const unsigned mask = (unsigned)buckets.size() - 1;
+    
+    for (unsigned i = hashID(sid) & mask; ; i = (i + 1) & mask) {
+        const Bucket& b = buckets[i];
+        if (b.sid == sid)
+            return b.pos;
+        if (b.sid == 0)
+            return -1;
+    }
+}
+
+void MgShapes::I::setPos(int sid, int pos)
+{
+    if ((used + 1) * 2 > buckets.size()) {
+        rehash();               // 扩容，同时清除已删除的桶
+        if (buckets.empty())    // 图形少，由 findPos 顺序查找
+            return;
+    }
+    
+    const unsigned mask = (unsigned)buckets.size() - 1;
+    int found = -1, tomb = -1;
+    unsigned i = hashID(sid) & mask;
+    
+    for (; ; i = (i + 1) & mask) {      // 只读查找，只复制要写的块
+        const Bucket& b = buckets[i];
+        if (b.sid == sid) {
+            found = (int)i;
+            break;
+        }
+        if (b.sid == -1 && tomb < 0) {
+            tomb = (int)i;
+        }
+        else if (b.sid == 0) {
+            break;
+        }
+    }
+    if (found < 0) {
+        if (tomb < 0) {
+            used++;
+        }
+        found = tomb < 0 ? (int)i : tomb;
+        buckets.at(found).sid = sid;
+    }
+    buckets.at(found).pos = pos;
+}
+
+void MgShapes::I::removePos(int sid)
+{
+    if (0 == sid || -1 == sid || buckets.empty())
+        return;
+    
+    const unsigned mask = (unsigned)buckets.size() - 1;
+    
+    for (unsigned i = hashID(sid) & mask; buckets[i].sid != 0; i = (i + 1) & mask) {
+        if (buckets[i].sid == sid) {
+            buckets.at(i).sid = -1; // 保留已删除标记，不打断探测链
+            return;
+        }
+    }
+}
+
+// 更新已移动到 [first, last] 的图形的位置，原位置为现位置减 delta
+void MgShapes::I::shiftPos(int first, int last, int delta)
+{
+    if ((last - first) * 16 < buckets.size()) {
+        for (int i = first; i <= last; i++) {
+            if (shapes[i])
+                setPos(shapes[i]->getID(), i);
+        }
+    }
+    else {                      // 移动的图形多时顺序遍历散列表，避免随机访问
+        for (int i = 0; i < buckets.size(); i++) {
+            const Bucket& b = buckets[i];
+            if (b.sid != 0 && b.sid != -1 && b.pos >= first - delta && b.pos <= last - delta)
+                buckets.at(i).pos += delta;
+        }
+    }
+}
+
+void MgShapes::I::rehash()
+{
+    unsigned n = 16;
+    
+    if (count() <= kHashMinCount) {
+        buckets.clear();
+        used = 0;
+        return;
+    }
+    
+    while (n < (unsigned)(count() + 1) * 4)
+        n *= 2;
+    
+    Bucket empty = { 0, 0 };
+    buckets.assign(n, empty);
+    used = 0;
+    
+    const unsigned mask = n - 1;
+    for (int pos = head; pos < (int)shapes.size(); pos++) {
+        if (shapes[pos]) {
+            unsigned i = hashID(shapes[pos]->getID()) & mask;
+            while (buckets[i].sid != 0)
+                i = (i + 1) & mask;
+            buckets.at(i).sid = shapes[pos]->getID();
+            buckets.at(i).pos = pos;
+            used++;
+        }
+    }
+}
+
+int MgShapes::I::blockLive(int b) const
+{
+    int lo = mgMax(head, b << kBlockBits);
+    int hi = mgMin((int)shapes.size(), (b + 1) << kBlockBits);
+    int n = b < (int)blockHoles.size() ? blockHoles[b] : 0;
+    
+    return hi > lo ? hi - lo - n : 0;
+}
+
+// 有删除的空位时先按块跳过，再在块内逐个查找
+int MgShapes::I::rawPos(int index) const
+{
+    if (holes == 0) {
+        return head + index;
+    }
+    
+    int b = head >> kBlockBits;
+    for (int n = blockLive(b); index >= n; n = blockLive(++b)) {
+        index -= n;
+    }
+    
+    int pos = mgMax(head, b << kBlockBits);
+    for (;; pos++) {
+        if (shapes[pos] && index-- == 0)
+            break;
+    }
+    return pos;
+}
+
+int MgShapes::I::indexOf(int pos) const
+{
+    if (holes == 0) {
+        return pos - head;
+    }
+    
+    int index = 0;
+    int b = head >> kBlockBits;
+    
+    for (; b < (pos >> kBlockBits); b++) {
+        index += blockLive(b);
+    }
+    for (int i = mgMax(head, b << kBlockBits); i < pos; i++) {
+        if (shapes[i])
+            index++;
+    }
+    return index;
+}
+
+void MgShapes::I::markHole(int pos, int delta)
+{
+    int b = pos >> kBlockBits;
+    
+    if (b >= (int)blockHoles.size()) {
+        blockHoles.resize(b + 1, 0);
+    }
+    blockHoles[b] += delta;
+}
+
+void MgShapes::I::recountHoles(int first, int last)
+{
+    for (int b = first >> kBlockBits; b <= (last >> kBlockBits); b++) {
+        int lo = mgMax(head, b << kBlockBits);
+        int hi = mgMin((int)shapes.size(), (b + 1) << kBlockBits);
+        int n = 0;
+        
+        for (int i = lo; i < hi; i++) {
+            if (!shapes[i])
+                n++;
+        }
+        if (n > 0 || b < (int)blockHoles.size()) {
+            markHole(b << kBlockBits, n - (b < (int)blockHoles.size() ? blockHoles[b] : 0));
+        }
+    }
+}
+
+void MgShapes::I::append(MgShape* sp, bool indexed)
+{
+    shapes.push_back(sp);
+    setPos(sp->getID(), (int)shapes.size() - 1);
+    if (indexed) {
+        if (this->indexed()) {
+            rtree.insert(sp->getID(), sp->shapec()->getExtent());
+        } else if (count() >= kIndexMinCount) {
+            rebuildIndex();
+        }
+    }
+}
+
+void MgShapes::I::replace(int pos, MgShape* newsp, bool indexed)
+{
+    MgShape* oldsp = shapes[pos];
+    
+    if (indexed && this->indexed()) {
+        rtree.update(newsp->getID(), oldsp->shapec()->getExtent(), newsp->shapec()->getExtent());
+    }
+    shapes.at(pos) = newsp;
+    oldsp->release();
+}
+
+MgShape* MgShapes::I::detach(int pos)
+{
+    MgShape* shape = shapes[pos];
+    
+    shapes.at(pos) = NULL;
+    holes++;
+    markHole(pos, 1);
+    removePos(shape->getID());
+    
+    while ((int)shapes.size() > head && !shapes.back()) {
+        markHole((int)shapes.size() - 1, -1);
+        shapes.pop_back();
+        holes--;
+    }
+    while (head < (int)shapes.size() && !shapes[head]) {
+        markHole(head, -1);
+        head++;
+        holes--;
+    }
+    if (!iterating && holes > 32 && holes > count() / 2) {
+        compact();
+    }
+    
+    return shape;
+}
+
+void MgShapes::I::erase(int pos)
+{
+    MgShape* shape = detach(pos);
+    
+    if (indexed()) {
+        rtree.remove(shape->getID(), shape->shapec()->getExtent());
+    }
+    shape->release();
+}
+
+void MgShapes::I::compact()
+{
+    Container arr;
+    
+    arr.reserve(count());
+    for (citerator it = begin(); it != end(); ++it) {
+        (*it)->addRef();
+        arr.push_back(*it);
+    }
+    shapes.swap(arr);
+    head = 0;
+    holes = 0;
+    blockHoles.clear();
+    rehash();
+}
+
+void MgShapes::I::growFront(int gap)
+{
+    int chunks = (gap + Container::kChunkMask) >> Container::kChunkBits;
+    
+    gap = chunks << Container::kChunkBits;
+    shapes.insertChunks(chunks);
+    head += gap;
+    origin += gap;
+    blockHoles.clear();
+    if (holes > 0) {
+        recountHoles(head, (int)shapes.size() - 1);
+    }
+    
+    for (int i = 0; i < buckets.size(); i++) {
+        if (buckets[i].sid != 0 && buckets[i].sid != -1)
+            buckets.at(i).pos += gap;
+    }
+}
+
+void MgShapes::I::share(const I& src)
+{
+    shapes = src.shapes;
+    head = src.head;
+    holes = src.holes;
+    blockHoles = src.blockHoles;
+    buckets = src.buckets;
+    used = src.used;
+    rtree = src.rtree;
+    changes = src.changes;
+    changeBase = src.changeBase;
+    if (src.lazy) {
+        src.lazy->addRef();
+    }
+    if (lazy) {
+        lazy->release();
+    }
+    lazy = src.lazy;
+}
+
+void MgShapes::I::clear(bool keepCapacity)
+{
+    if (keepCapacity && !lazy) {
+        for (citerator it = begin(); it != end() && spares.size() < kMaxSpares; ++it) {
+            (*it)->addRef();
+            spares.push_back(*it);
+        }
+    }
+    shapes.clear(keepCapacity);
+    head = 0;
+    holes = 0;
+    blockHoles.clear();
+    buckets.clear(keepCapacity);
+    used = 0;
+    rtree.clear();
+    if (lazy) {
+        lazy->release();
+        lazy = (MgLazyShapes*)0;
+    }
+    resetChanges(keepCapacity);
+    if (keepCapacity) {
+        newShapeID = 1;         // 与新建的图形列表一样分配ID
+    }
+    
+    for (size_t i = spares.size(); i > 0; i--) {
+        if (!keepCapacity || spares[i - 1]->isShared()) {   // 还被其他列表引用的图形不能重用
+            spares[i - 1]->release();
+            spares.erase(spares.begin() + (i - 1));
+        }
+    }
+}
+
+MgShape* MgShapes::I::takeSpare(int type)
+{
+    for (size_t i = spares.size(); i > 0; i--) {
+        MgShape* sp = spares[i - 1];
+        if (sp->getType() == type) {
+            spares.erase(spares.begin() + (i - 1));
+            return sp;
+        }
+    }
+    return MgShape::Null();
+}
+
+void MgShapes::I::logChange(int sid, int type)
+{
+    if (!logging) {           // 不记录时只更新序号，getChangesSince 将返回 false
+        changeBase = giAtomicIncrement(&_changeStamp);
+        return;
+    }
+    if (changes.size() >= kMaxChanges) {
+        changeBase = changes.back().stamp;
+        changes.clear();
+    }
+    Change c = { giAtomicIncrement(&_changeStamp), sid, type };
+    changes.push_back(c);
+}
+
+void MgShapes::I::resetChanges(bool keepCapacity)
+{
+    changes.clear(keepCapacity);
+    changeBase = giAtomicIncrement(&_changeStamp);
+}
+
+void MgShapes::I::rebuildIndex()
+{
+    std::vector<int> ids;
+    std::vector<Box2d> boxes;
+    
+    if (count() < kIndexMinCount) {
+        rtree.clear();
+        return;
+    }
+    ids.reserve(count());
+    boxes.reserve(count());
+    for (citerator it = begin(); it != end(); ++it) {
+        ids.push_back((*it)->getID());
+        boxes.push_back((*it)->shapec()->getExtent());
+    }
+    rtree.build((int)ids.size(), ids.empty() ? (const int*)0 : &ids.front(),
+                boxes.empty() ? (const Box2d*)0 : &boxes.front());
+}
+
+bool MgShapes::I::queryShapes(const Box2d& box, std::vector<const MgShape*>& arr) const
+{
+    // 图形少或查询范围包含了所有图形时，直接遍历比用索引快
+    if (!indexed() || count() < kIndexMinCount || box.contains(rtree.getBounds())) {
+        return false;
+    }
+    
+    std::vector<int> ids;
+    std::vector<int> slots;
+    
+    rtree.query(box, ids);
+    slots.reserve(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        int pos = findPos(ids[i]);
+        if (pos >= 0 && shapes[pos]->shapec()->getExtent().isIntersect(box)) {
+            slots.push_back(pos);
+        }
+    }
+    std::sort(slots.begin(), slots.end());  // 位置即显示顺序
+    
+    arr.resize(slots.size());
+    for (size_t i = 0; i < slots.size(); i++) {
+        arr[i] = shapes[slots[i]];
+    }
+    
+    return true;
+}
@@ -6,6 +6,7 @@
 #include "mgstorage.h"
 #include <vector>
 #include "mglayer.h"
+#include "mgdrawprogress.h"
 #include "mgcomposite.h"
 #include "mglog.h"
 
@@ -289,6 +290,59 @@ int MgShapeDoc::dyndraw(int mode, GiGraphics& gs, const int* ignoreIds) const
     return n;
 }
 
+int MgShapeDoc::queryBox(const Box2d& box, void (*c)(const MgShape*, void*), void* d) const
+{
+    int n = 0;
+    
+    for (unsigned i = 0; i < im->layers.size(); i++) {
+        if (!im->layers[i]->isHided()) {
+            n += im->layers[i]->queryBox(box, c, d);
+        }
+    }
+    
+    return n;
+}
+
+bool MgShapeDoc::resumeDraw(MgDrawProgress& progress, const Box2d& clip) const
+{
+    if (!progress.begin(this, clip)) {
+        return false;
+    }
+    
+    bool changed = progress.getLayer() > (int)im->layers.size();
+    
+    for (int i = 0; !changed && i <= progress.getLayer(); i++) {
+        changed = (progress.getListedShapes(i)          // 只比较指针，已删除的图层不能访问
+                   && (i >= (int)im->layers.size() || !progress.isListed(i, im->layers[i])));
+    }
+    if (changed) {                          // 已绘图层被删除、替换或修改时从头开始
+        progress.reset();
+        progress.begin(this, clip);
+    }
+    
+    return !changed;
+}
+
+int MgShapeDoc::dyndraw(int mode, GiGraphics& gs, MgDrawProgress& progress) const
+{
+    int n = 0;
+    
+    resumeDraw(progress, gs.getClipModel());
+    for (; progress.getLayer() < (int)im->layers.size(); progress.nextLayer()) {
+        const MgLayer* layer = im->layers[progress.getLayer()];
+        
+        if (!layer->isHided()) {
+            n += layer->dyndraw(mode, gs, progress);
+            if (!progress.isLayerDone()) {      // 预算用完或中止绘制
+                return n;
+            }
+        }
+    }
+    progress.setFinished();
+    
+    return n;
+}
+
 bool MgShapeDoc::save(MgStorage* s, int startIndex) const
 {
     bool ret = true;
@@ -13,6 +13,7 @@
 #include <mgpath.h>
 
 #include <mgshapes.h>
+#include <mgdrawprogress.h>
 #include <mgbasesp.h>
 #include <mgcomposite.h>
 #include <mggrid.h>
@@ -49,6 +50,7 @@
 %include <mgshape.h>
 %include <mgspfactory.h>
 %include <mgshapes.h>
+%include <mgdrawprogress.h>
 %include <mgbasesp.h>
 %include <mgrect.h>
 %include <mgcomposite.h>
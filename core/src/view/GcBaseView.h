@@ -8,6 +8,9 @@
 #include "gigesture.h"
 #include "mgcmd.h"
 #include "mgshapedoc.h"
+#include "gishapecache.h"
+#include "gidisplaylist.h"
+#include "githread.h"
 
 class GiView;
 
@@ -27,29 +30,47 @@ public:
     void setZoomEnabled(bool enabled) { _zoomEnabled = enabled; }
     
     void submitBackXform() { _gsFront.copy(_gsBack); }              //!< 应用后端坐标系对象到前端
-    void copyGs(GiGraphics* gs) { gs->copy(_gsBack); }              //!< 复制坐标系参数
+    void copyGs(GiGraphics* gs);                                    //!< 复制坐标系参数，按选项设置图形缓存
     void checkZoomTimes();                                          //!< 检查放缩改变与否
     
     GiGraphics* frontGraph() { return &_gsFront; }                  //!< 得到前端图形显示对象
     GiTransform* xform() { return &_gsBack._xf(); }                 //!< 得到后端坐标系对象
     GiGraphics* graph() { return &_gsBack; }                        //!< 得到后端图形显示对象
+    GiShapeCache* shapeCache() { return &_shapeCache; }             //!< 得到图形显示列表的缓存对象
     virtual void onSize(int dpi, int w, int h);                     //!< 设置视图的宽高
     
     virtual bool onGesture(const MgMotion& motion);                 //!< 传递单指触摸手势消息
     virtual bool twoFingersMove(const MgMotion& motion);            //!< 传递双指移动手势(可放缩旋转)
     virtual void draw(GiGraphics& gs);                              //!< 绘制额外的静态图形
     virtual void dyndraw(GiGraphics& gs);                           //!< 绘制额外的动态图形
+    
+    //! 在双指放缩平移期间重放保留的文档显示列表，代替遍历文档，changeCount 为文档的改变次数
+    bool drawRetained(const MgShapeDoc* doc, long changeCount, GiGraphics& gs, GiCanvas* canvas, int& n);
+
+private:
+    void endXformGesture();
 
 private:
     MgView*     _mgview;
     GiView*     _view;
     GiGraphics  _gsFront;
     GiGraphics  _gsBack;
+    GiShapeCache    _shapeCache;
     Point2d     _lastCenter;
     float       _lastScale;
     bool        _zooming;
     bool        _zoomEnabled;
     long        _zoomTimes;
+    
+    bool        _xformGesture;      //!< 双指放缩平移时只按坐标变换显示
+    Matrix2d    _regenMat;          //!< 最近一次重新构建显示时的模型到显示坐标的矩阵
+    long        _regenCount;        //!< 手势中重新构建显示的次数
+    GiMutex     _retainLock;        //!< 保护 _xformGesture、_regenCount 和以下显示列表，绘制线程也会访问
+    GiDisplayList   _retained;      //!< 最近一次重新构建时记录的文档显示列表，显示坐标
+    Matrix2d    _retainedMat;
+    long        _retainedRegen;
+    long        _retainedChange;
+    int         _retainedShapes;
 };
 
 #endif // TOUCHVG_CORE_BASEVIEW_H
@@ -3,6 +3,7 @@
 // Copyright (c) 2004-2015, https://github.com/rhcad/vgcore, BSD License
 
 #include "GcGraphView.h"
+#include "giview.h"
 #include "mglog.h"
 
 // GcBaseView
@@ -17,6 +18,7 @@ void GcBaseView::onSize(int dpi, int w, int h)
 {
     xform()->setResolution((float)dpi);
     xform()->setWndSize(w, h);
+    endXformGesture();                              // 保留的显示列表已不适用新的视图大小
 }
 
 bool GcBaseView::onGesture(const MgMotion& )
@@ -51,6 +53,10 @@ bool GcBaseView::twoFingersMove(const MgMotion& motion)
     }
     if (motion.gestureState <= kMgGestureBegan) {
         _lastScale = xform()->getZoomValue(_lastCenter);
+        _retainLock.lock();
+        _xformGesture = _mgview->getOptionBool("gestureXform", true);
+        _retainLock.unlock();
+        _regenMat = xform()->modelToDisplay();
     }
     else if (motion.gestureState == kMgGestureMoved
         && motion.startPt != motion.startPt2
@@ -66,16 +72,78 @@ bool GcBaseView::twoFingersMove(const MgMotion& motion)
         xform()->zoomPan(pt.x - at.x, pt.y - at.y); // 平移到当前点
         
         _zooming = true;
-        cmdView()->regenAll(false);
+        
+        // 相对于上次重新构建的显示只有放缩和平移，无旋转
+        Matrix2d mat(_regenMat.inverse() * xform()->modelToDisplay());
+        float maxScale = mgMax(1.01f, _mgview->getOptionFloat("gestureRegenScale", 2.f));
+        
+        _retainLock.lock();
+        bool byXform = _xformGesture && mat.m11 < maxScale && mat.m11 > 1.f / maxScale;
+        if (!byXform) {
+            _regenCount++;
+        }
+        _retainLock.unlock();
+        
+        if (byXform) {
+            checkZoomTimes();
+            _view->regenXform(mat.m11, mat.dx, mat.dy);
+        } else {
+            _regenMat = xform()->modelToDisplay();
+            cmdView()->regenAll(false);
+        }
     }
-    else if (_zooming) {
-        _zooming = false;
-        cmdView()->regenAll(false);
+    else if (_zooming || motion.gestureState >= kMgGestureEnded) {
+        endXformGesture();                          // 未移动就结束或取消的手势也不再重放显示列表
+        if (_zooming) {                             // 手势结束后重新构建显示
+            _zooming = false;
+            cmdView()->regenAll(false);
+        }
     }
     
     return true;
 }
 
+void GcBaseView::endXformGesture()
+{
+    _retainLock.lock();
+    _xformGesture = false;
+    _retained = GiDisplayList();                    // 释放显示列表的缓冲
+    _retainedRegen = -1;
+    _retainLock.unlock();
+}
+
+bool GcBaseView::drawRetained(const MgShapeDoc* doc, long changeCount,
+                              GiGraphics& gs, GiCanvas* canvas, int& n)
+{
+    if (!doc || !canvas) {
+        return false;
+    }
+    
+    _retainLock.lock();
+    
+    bool ret = _xformGesture;
+    
+    if (ret && (_retainedRegen != _regenCount || _retainedChange != changeCount)) {
+        _retained.clear();                          // 手势开始、放缩过多或文档已改变时重新记录
+        ret = gs.beginPaint(&_retained);
+        if (ret) {
+            _retainedShapes = doc->dyndraw(0, gs);
+            gs.endPaint();
+            _retainedMat = gs.xf().modelToDisplay();
+            _retainedRegen = _regenCount;
+            _retainedChange = changeCount;
+        }
+    }
+    if (ret) {
+        Matrix2d mat(_retainedMat.inverse() * gs.xf().modelToDisplay());
+        _retained.replay(canvas, mat.isIdentity() ? (const Matrix2d*)0 : &mat);
+        n = _retainedShapes;
+    }
+    _retainLock.unlock();
+    
+    return ret;
+}
+
 void GcBaseView::draw(GiGraphics&)
 {
 }
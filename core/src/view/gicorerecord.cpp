@@ -22,6 +22,10 @@ bool GiCoreView::startRecord(const char* path, long doc, bool forUndo,
                              long curTick, MgStringCallback* c)
 {
     MgRecordShapes* p = new MgRecordShapes(path, MgShapeDoc::fromHandle(doc), forUndo, curTick);
+    p->setBinaryFormat(impl->getOptionBool("binaryStorage", false));
+    p->setJournalFormat(impl->getOptionBool("recordJournal", false));   // 各帧追加到一个日志文件中
+    p->setKeyframeInterval(impl->getOptionInt("keyframeSteps", 0),      // 定期写完整文档，便于回放定位
+                           impl->getOptionInt("keyframeBytes", 0));
     impl->setRecorder(forUndo, p);
     
     if (isPlaying() || forUndo) {
@@ -71,6 +75,7 @@ bool GiCoreView::recordShapes(bool forUndo, long tick, long changeCount, long do
                                    MgShapeDoc::fromHandle(doc),
                                    MgShapes::fromHandle(shapes), arr) ? 2 : 1;
         if (ret > 1 && c) {
+            recorder->flush(false);
             c->onGetString(recorder->getFileName(false, recorder->getFileCount() - 1).c_str());
         }
     } else {
@@ -92,6 +97,10 @@ bool GiCoreView::restoreRecord(int type, const char* path, long doc, long change
         return false;
     
     recorder = new MgRecordShapes(path, MgShapeDoc::fromHandle(doc), type == 0, curTick);
+    recorder->setBinaryFormat(impl->getOptionBool("binaryStorage", false));
+    recorder->setJournalFormat(impl->getOptionBool("recordJournal", false));
+    recorder->setKeyframeInterval(impl->getOptionInt("keyframeSteps", 0),
+                                  impl->getOptionInt("keyframeBytes", 0));
     recorder->restore(index, count, tick, curTick);
     impl->setRecorder(type == 0, recorder);
     
@@ -252,23 +261,136 @@ bool GiCoreView::onResume(long curTick)
     return false;
 }
 
+// GiFrontSlots
+//
+
+//! 一个线程发布、多个线程读取的引用计数对象，读者不加锁
+/*! 三个槽位轮换：最新发布的，读者可能正在取的旧版本，写者可写的。
+    读者先固定槽位再确认其仍是最新的，确认后才读取对象；写者只回收未固定的旧槽位，
+    只在读者正在取对象(固定到增加引用之间)且两个旧槽位都被固定时才等待。
+    未被读者取过就被替换的版本不再显示，写者回收其槽位时可重用该对象。
+ */
+template <class T>
+class GiFrontSlots
+{
+public:
+    GiFrontSlots() : _latest(-1), _skipped(0) {
+        for (int i = 0; i < kSlots; i++) {
+            _objs[i] = (T*)0;
+            _pins[i] = 0;
+            _seen[i] = 0;
+        }
+    }
+    
+    ~GiFrontSlots() { clear(); }
+    
+    //! 取最新发布的对象并增加引用，可在任意线程中调用，只在取的过程中有新发布时重试
+    T* acquire() {
+        for (;;) {
+            long i = _latest;
+            if (i < 0)
+                return (T*)0;
+            giAtomicIncrement(&_pins[i]);
+            if (giAtomicCompareAndSwap(&_latest, i, i)) {   // 固定后仍是最新的，写者不会回收
+                T* p = _objs[i];
+                p->addRef();
+                _seen[i] = 1;
+                giAtomicDecrement(&_pins[i]);
+                return p;
+            }
+            giAtomicDecrement(&_pins[i]);
+        }
+    }
+    
+    //! 写者取一个可发布的槽位，释放其中已被读取过的对象，返回未被读取过的对象以便重用
+    T* reclaim(int& slot) {
+        for (;;) {
+            for (int i = 0; i < kSlots; i++) {
+                if (i != _latest && giAtomicCompareAndSwap(&_pins[i], 0, 0)) {
+                    T* p = _objs[i];
+                    _objs[i] = (T*)0;
+                    slot = i;
+                    if (p && _seen[i]) {
+                        p->release();
+                        p = (T*)0;
+                    } else if (p) {
+                        giAtomicIncrement(&_skipped);
+                    }
+                    return p;
+                }
+            }
+        }
+    }
+    
+    //! 写者在 reclaim() 得到的槽位中发布对象，接管其引用
+    void publish(int slot, T* p) {
+        _objs[slot] = p;
+        _seen[slot] = 0;
+        long old = _latest;
+        giAtomicCompareAndSwap(&_latest, slot, old);        // 完整屏障，之前写入的对象对读者可见
+        if (old >= 0 && giAtomicCompareAndSwap(&_pins[old], 0, 0) && _seen[old]) {
+            MgObject::release_pointer(_objs[old]);          // 及早释放已显示的旧版本
+        }
+    }
+    
+    //! 写者释放所有对象
+    void clear() {
+        giAtomicCompareAndSwap(&_latest, -1, _latest);
+        for (int i = 0; i < kSlots; i++) {
+            while (!giAtomicCompareAndSwap(&_pins[i], 0, 0)) ;
+            MgObject::release_pointer(_objs[i]);
+        }
+    }
+    
+    //! 返回未被读取过就被替换的版本数
+    long skipped() const { return _skipped; }
+    
+private:
+    enum { kSlots = 3 };
+    T*              _objs[kSlots];
+    volatile long   _pins[kSlots];      //!< 正在取对象的读者数
+    volatile long   _seen[kSlots];      //!< 对象是否已被读者取过
+    volatile long   _latest;            //!< 最新发布的槽位，-1表示没有
+    volatile long   _skipped;
+};
+
 // GiPlaying
 //
 
 struct GiPlaying::Impl {
-    MgShapeDoc* frontDoc_;
+    GiFrontSlots<MgShapeDoc> frontDocs;
+    GiFrontSlots<MgShapes>   fronts;
     MgShapeDoc* backDoc;
-    MgShapes*   front_;
     MgShapes*   back;
+    std::vector<MgShapes*> spares;      // 用过的动态图形列表，显示线程都释放后重用
     int         tag;
     bool        doubleSided;
     volatile long stopping;
     
-    Impl(int tag, bool doubleSided) : frontDoc_(NULL), backDoc(NULL)
-        , front_(NULL), back(NULL), tag(tag), doubleSided(doubleSided), stopping(0) {}
+    enum { kMaxSpares = 4 };
+    
+    Impl(int tag, bool doubleSided) : backDoc(NULL), back(NULL)
+        , tag(tag), doubleSided(doubleSided), stopping(0) {}
+    
+    MgShapes* takeSpare() {
+        for (size_t i = 0; i < spares.size(); i++) {
+            MgShapes* p = spares[i];
+            if (!p->isShared()) {
+                spares.erase(spares.begin() + i);
+                p->clear(true);
+                return p;
+            }
+        }
+        return NULL;
+    }
     
-    MgShapeDoc*& frontDoc() { return doubleSided ? frontDoc_ : backDoc; }
-    MgShapes*& frontShapes() { return doubleSided ? front_ : back; }
+    void keepSpare(MgShapes* p) {
+        if (spares.size() < kMaxSpares) {
+            spares.push_back(p);
+        } else {
+            p->release();
+        }
+    }
 };
 
 GiPlaying* GiPlaying::create(MgCoreView* v, int tag, bool doubleSided)
@@ -300,10 +422,14 @@ GiPlaying::~GiPlaying()
 
 void GiPlaying::clear()
 {
-    MgObject::release_pointer(impl->frontDoc_);
+    impl->frontDocs.clear();
     MgObject::release_pointer(impl->backDoc);
-    MgObject::release_pointer(impl->front_);
+    impl->fronts.clear();
     MgObject::release_pointer(impl->back);
+    for (size_t i = 0; i < impl->spares.size(); i++) {
+        impl->spares[i]->release();
+    }
+    impl->spares.clear();
 }
 
 int GiPlaying::getTag() const
@@ -323,10 +449,14 @@ bool GiPlaying::isStopping() const
 
 long GiPlaying::acquireFrontDoc()
 {
-    if (!impl->frontDoc())
-        return 0;
-    impl->frontDoc()->addRef();
-    return impl->frontDoc()->toHandle();
+    if (!impl->doubleSided) {
+        if (!impl->backDoc)
+            return 0;
+        impl->backDoc->addRef();
+        return impl->backDoc->toHandle();
+    }
+    MgShapeDoc* doc = impl->frontDocs.acquire();
+    return doc ? doc->toHandle() : 0;
 }
 
 void GiPlaying::releaseDoc(long doc)
@@ -345,20 +475,34 @@ MgShapeDoc* GiPlaying::getBackDoc()
 
 void GiPlaying::submitBackDoc()
 {
-    if (impl->doubleSided) {
-        MgObject::release_pointer(impl->frontDoc_);
-        if (impl->backDoc) {
-            impl->frontDoc_ = impl->backDoc->shallowCopy();
+    if (impl->doubleSided && impl->backDoc) {
+        int slot;
+        MgShapeDoc* doc = impl->frontDocs.reclaim(slot);
+        
+        if (doc) {                              // 重用未显示过的版本，不再分配文档和图层
+            doc->copyShapes(impl->backDoc, false);
+        } else {
+            doc = impl->backDoc->shallowCopy();
         }
+        impl->frontDocs.publish(slot, doc);
     }
 }
 
+int GiPlaying::getSkippedDocs() const
+{
+    return (int)impl->frontDocs.skipped();
+}
+
 long GiPlaying::acquireFrontShapes()
 {
-    if (!impl->frontShapes())
-        return 0;
-    impl->frontShapes()->addRef();
-    return impl->frontShapes()->toHandle();
+    if (!impl->doubleSided) {
+        if (!impl->back)
+            return 0;
+        impl->back->addRef();
+        return impl->back->toHandle();
+    }
+    MgShapes* shapes = impl->fronts.acquire();
+    return shapes ? shapes->toHandle() : 0;
 }
 
 void GiPlaying::releaseShapes(long shapes)
@@ -375,21 +519,32 @@ long GiPlaying::getBackShapesHandle(bool needClear)
 MgShapes* GiPlaying::getBackShapes(bool needClear)
 {
     if (needClear || !impl->back) {
-        MgObject::release_pointer(impl->back);
-        impl->back = MgShapes::create();
+        MgShapes* shapes = impl->takeSpare();
+        if (impl->back) {
+            impl->keepSpare(impl->back);
+        }
+        impl->back = shapes ? shapes : MgShapes::create();
     } else {
         MgShapes* old = impl->back;
         impl->back = old->shallowCopy();
-        MgObject::release_pointer(old);
+        impl->keepSpare(old);
     }
     return impl->back;
 }
 
 void GiPlaying::submitBackShapes()
 {
-    if (impl->doubleSided) {
-        MgObject::release_pointer(impl->front_);
-        impl->front_ = impl->back;
-        impl->front_->addRef();
+    if (impl->doubleSided && impl->back) {
+        int slot;
+        MgShapes* old = impl->fronts.reclaim(slot);
+        
+        MgObject::release_pointer(old);
+        impl->back->addRef();
+        impl->fronts.publish(slot, impl->back);
     }
 }
+
+int GiPlaying::getSkippedShapes() const
+{
+    return (int)impl->fronts.skipped();
+}
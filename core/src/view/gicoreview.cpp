@@ -11,9 +11,12 @@
 #include "mgbasicspreg.h"
 #include "mgbasicsps.h"
 #include "svgcanvas.h"
+#include "girastercanvas.h"
 #include "../corever.h"
 #include "mgimagesp.h"
 #include "mglocal.h"
+#include "mgbinarystorage.h"
+#include "mgdrawprogress.h"
 #include <sstream>
 
 static volatile long _viewCount = 0;    // 总视图数
@@ -25,6 +28,7 @@ float GiCoreViewImpl::_factor = 1.0f;   // 屏幕放大系数，Android高清屏
 
 GcBaseView::GcBaseView(MgView* mgview, GiView *view)
     : _mgview(mgview), _view(view), _zooming(false), _zoomEnabled(true), _zoomTimes(0)
+    , _xformGesture(false), _regenCount(0), _retainedRegen(-1), _retainedChange(0), _retainedShapes(0)
 {
     mgview->document()->addView(this);
     LOGD("View %p created", this);
@@ -36,7 +40,7 @@ GcBaseView::GcBaseView(MgView* mgview, GiView *view)
 GiCoreViewImpl::GiCoreViewImpl(GiCoreView* owner, bool useCmds)
     : _cmds(NULL), curview(NULL), refcount(1)
     , gestureHandler(0), regenPending(-1), appendPending(-1), redrawPending(-1)
-    , changeCount(0), drawCount(0), stopping(0)
+    , changeCount(0), drawCount(0), stopping(0), tilePool(NULL), regenWorker(NULL)
 {
     memset(&gsBuf, 0, sizeof(gsBuf));
     memset((void*)&gsUsed, 0, sizeof(gsUsed));
@@ -52,6 +56,7 @@ GiCoreViewImpl::GiCoreViewImpl(GiCoreView* owner, bool useCmds)
     _motion.gestureType = 0;
     _motion.gestureState = kMgGesturePossible;
     _gcdoc = new GcShapeDoc();
+    defaultStorage.setStreamMode(true);     // 边解析边加载，getContent() 时不建立DOM
     
     MgBasicShapes::registerShapes(this);
     if (useCmds) {
@@ -64,9 +69,11 @@ GiCoreViewImpl::GiCoreViewImpl(GiCoreView* owner, bool useCmds)
 
 GiCoreViewImpl::~GiCoreViewImpl()
 {
+    delete regenWorker;                         // 先结束后台构建，其中用到视图和文档
     for (unsigned i = 0; i < sizeof(gsBuf)/sizeof(gsBuf[0]); i++) {
         delete gsBuf[i];
     }
+    delete tilePool;
     MgObject::release_pointer(_cmds);
     delete _gcdoc;
 }
@@ -105,6 +112,71 @@ void GiCoreViewImpl::resetOptions()
     setOptionInt("selectDrawFlags", 0xFF);
 }
 
+// 图形在其范围外的显示像素宽度，含线宽和箭头
+static float calcDirtyMargin(const GiGraphics* gs, const MgShape* shape)
+{
+    float px = 0;
+    
+    if (shape->shapec()->isKindOf(MgComposite::Type())) {
+        MgShapeIterator it(((const MgComposite*)shape->shapec())->shapes());
+        while (const MgShape* sp = it.getNext()) {
+            px = mgMax(px, calcDirtyMargin(gs, sp));
+        }
+    }
+    else {
+        const GiContext& ctx = shape->context();
+        float w = gs->calcPenWidth(ctx.getLineWidth(), ctx.isAutoScale());
+        
+        px = w / 2;
+        if (ctx.hasArrayHead()) {   // 箭头大小同 GiGraphics::drawPathWithArrayHead
+            px += gs->xf().getWorldToDisplayX() * (1 + mgMax(0.f, (w - 4.f) / 5));
+        }
+    }
+    return px;
+}
+
+Box2d GiCoreViewImpl::calcDirtyRect(const MgShape* shape)
+{
+    const GiGraphics* gs = curview->graph();
+    Box2d rect(shape->shapec()->getExtent());
+    
+    rect.inflate(gs->xf().displayToModel(2 + calcDirtyMargin(gs, shape)));
+    return rect;
+}
+
+void GiCoreViewImpl::regenRect(const Box2d& rectM)
+{
+    if (regenPending >= 0) {                    // 在 DrawLocker 结束时合并显示
+        dirtyRect.unionWith(rectM);
+        return;
+    }
+    if (!curview || rectM.isEmpty()) {
+        return;
+    }
+    
+    bool zooming = curview->isZooming();
+    
+    for (int i = -1; i < _gcdoc->getViewCount(); i++) {
+        GcBaseView* v = i < 0 ? curview : _gcdoc->getView(i);
+        
+        if (i < 0 || (v != curview && !zooming)) {
+            Box2d rect(rectM * v->xform()->modelToDisplay());
+            Box2d wnd(v->xform()->getWndRect());
+            
+            rect.set(floorf(rect.xmin), floorf(rect.ymin), ceilf(rect.xmax), ceilf(rect.ymax));
+            if (!rect.intersectWith(wnd).isEmpty()) {
+                v->deviceView()->regenRect(rect.xmin, rect.ymin, rect.width(), rect.height());
+            } else {                            // 不在视图内时仍需通知提交文档
+                v->deviceView()->regenRect(0, 0, 0, 0);
+            }
+        }
+        if (i >= 0) {
+            v->checkZoomTimes();
+        }
+    }
+    curview->deviceView()->contentChanged();
+}
+
 void GiCoreViewImpl::calcContextButtonPosition(mgvector<float>& pos, int n, const Box2d& box)
 {
     Box2d selbox(box);
@@ -424,6 +496,9 @@ void GiCoreView::destoryView(GiView* view)
 {
     GcBaseView* aview = impl->_gcdoc->findView(view);
 
+    if (aview && impl->regenWorker) {
+        impl->regenWorker->cancel(view);
+    }
     if (aview && impl->_gcdoc->removeView(aview)) {
         if (impl->curview == aview) {
             impl->curview = impl->_gcdoc->firstView();
@@ -490,6 +565,9 @@ int GiCoreView::stopDrawing(bool stop)
             n++;
         }
     }
+    if (stop && impl->regenWorker) {
+        impl->regenWorker->stop();
+    }
     return n;
 }
 
@@ -550,7 +628,41 @@ void GiCoreView::releaseGraphics(long hGs)
 int GiCoreView::drawAll(GiView* view, GiCanvas* canvas) {
     long doc = acquireFrontDoc();
     long hGs = acquireGraphics(view);
-    int n = drawAll(doc, hGs, canvas);
+    GcBaseView* aview = impl->_gcdoc->findView(view);
+    int n = -1;
+    
+    if (!doc || !hGs || !aview              // 双指放缩平移时重放该视图保留的显示列表
+        || !aview->drawRetained(MgShapeDoc::fromHandle(doc), impl->changeCount,
+                                *GiGraphics::fromHandle(hGs), canvas, n)) {
+        n = drawAll(doc, hGs, canvas);
+    }
+    releaseDoc(doc);
+    releaseGraphics(hGs);
+    return n;
+}
+
+int GiCoreView::drawAll(GiView* view, GiCanvas* canvas, float x, float y, float w, float h) {
+    long doc = acquireFrontDoc();
+    long hGs = acquireGraphics(view);
+    int n = drawAll(doc, hGs, canvas, x, y, w, h);
+    releaseDoc(doc);
+    releaseGraphics(hGs);
+    return n;
+}
+
+int GiCoreView::drawAll(GiView* view, GiCanvas* canvas, MgDrawProgress* progress) {
+    long doc = acquireFrontDoc();
+    long hGs = acquireGraphics(view);
+    int n = drawAll(doc, hGs, canvas, progress);
+    releaseDoc(doc);
+    releaseGraphics(hGs);
+    return n;
+}
+
+int GiCoreView::drawAll(GiView* view, GiTileCanvasFactory* factory, int tiles) {
+    long doc = acquireFrontDoc();
+    long hGs = acquireGraphics(view);
+    int n = drawAll(doc, hGs, factory, tiles);
     releaseDoc(doc);
     releaseGraphics(hGs);
     return n;
@@ -587,6 +699,460 @@ int GiCoreView::drawAll(long doc, long hGs, GiCanvas* canvas)
     return n;
 }
 
+int GiCoreView::drawAll(long doc, long hGs, GiCanvas* canvas, float x, float y, float w, float h)
+{
+    int n = -1;
+    GiGraphics* gs = GiGraphics::fromHandle(hGs);
+    RECT_2D rc;
+    
+    rc.left = x;
+    rc.top = y;
+    rc.right = x + w;
+    rc.bottom = y + h;
+    if (w < 1 || h < 1) {
+        n = 0;
+    }
+    else if (doc && gs && gs->beginPaint(canvas, rc)) {     // 只显示与此范围相交的图形
+        canvas->saveClip();
+        if (canvas->clipRect(x, y, w, h)) {                 // 不改变此范围外的已有像素
+            canvas->clearRect(x, y, w, h);
+            n = MgShapeDoc::fromHandle(doc)->dyndraw(isZooming() ? 2 : 0, *gs);
+        }
+        gs->endPaint();
+        canvas->restoreClip();
+    }
+
+    return n;
+}
+
+int GiCoreView::drawAll(long doc, long hGs, GiCanvas* canvas, MgDrawProgress* progress)
+{
+    int n = -1;
+    GiGraphics* gs = GiGraphics::fromHandle(hGs);
+    MgShapeDoc* pdoc = MgShapeDoc::fromHandle(doc);
+    
+    if (!progress) {
+        n = drawAll(doc, hGs, canvas);
+    }
+    else if (pdoc && gs && gs->beginPaint(canvas)) {
+        bool drawn = progress->getDrawnCount() > 0;
+        if (!pdoc->resumeDraw(*progress, gs->getClipModel()) && drawn) {
+            canvas->clearRect(0, 0, (float)gs->xf().getWidth(), (float)gs->xf().getHeight());
+        }                                                   // 文档、显示范围或已绘图层已变，清除上次画的图形
+        n = pdoc->dyndraw(isZooming() ? 2 : 0, *gs, *progress);
+        gs->endPaint();
+    }
+    
+    return n;
+}
+
+//! 视图的一个分块，在工作线程中显示分到此块的图形
+struct GiTile {
+    RECT_2D     rc;
+    GiCanvas*   canvas;
+    GiGraphics* gs;
+    Box2d       clip;       //!< 剪裁范围，模型坐标
+    std::vector<std::pair<const MgShape*, int> > shapes;    //!< 分到此块的图形及其序号
+    std::vector<char> drawn;                                //!< 各图形在此块的显示结果
+};
+
+//! 按显示顺序将各图形分到与其范围相交的分块
+struct GiTileBuckets {
+    std::vector<GiTile>& tiles;
+    int         rows, cols;
+    std::vector<Box2d> colRect;     //!< 每列分块的显示范围
+    std::vector<Box2d> rowRect;     //!< 每行分块的显示范围
+    Matrix2d    m2d;
+    const GiGraphics* src;
+    int         mode;
+    int         count;          //!< 已分块的图形数
+    
+    GiTileBuckets(std::vector<GiTile>& t, int r, int c)
+        : tiles(t), rows(r), cols(c), colRect(c), rowRect(r), count(0) {}
+    
+    static void addShape(const MgShape* sp, void* data) {
+        GiTileBuckets* p = (GiTileBuckets*)data;
+        
+        if (!sp->shapec()->isVisible()) {
+            return;
+        }
+        
+        Box2d extent(sp->shapec()->getExtent());
+        Box2d rect(extent * p->m2d);
+        int c0 = 0, c1 = p->cols - 1, r0 = 0, r1 = p->rows - 1;
+        
+        while (c0 < c1 && p->colRect[c0].xmax < rect.xmin) c0++;    // 先按显示范围找出行列
+        while (c1 > c0 && p->colRect[c1].xmin > rect.xmax) c1--;
+        while (r0 < r1 && p->rowRect[r0].ymax < rect.ymin) r0++;
+        while (r1 > r0 && p->rowRect[r1].ymin > rect.ymax) r1--;
+        
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                GiTile& tile = p->tiles[r * p->cols + c];
+                if (tile.gs && extent.isIntersect(tile.clip)) {
+                    tile.shapes.push_back(std::pair<const MgShape*, int>(sp, p->count));
+                }
+            }
+        }
+        p->count++;
+    }
+    
+    static void drawTile(void* data, int index) {
+        GiTileBuckets* p = (GiTileBuckets*)data;
+        GiTile& tile = p->tiles[index];
+        
+        if (!tile.gs) {
+            return;
+        }
+        tile.drawn.resize(tile.shapes.size(), 0);
+        for (size_t i = 0; i < tile.shapes.size(); i++) {
+            if (tile.gs->isStopping() || p->src->isStopping()) {
+                break;
+            }
+            tile.drawn[i] = tile.shapes[i].first->draw(p->mode, *tile.gs, NULL, -1) ? 1 : 0;
+        }
+        tile.gs->endPaint();
+    }
+};
+
+int GiCoreView::drawAll(long doc, long hGs, GiTileCanvasFactory* factory, int tiles)
+{
+    GiGraphics* gs = GiGraphics::fromHandle(hGs);
+    MgShapeDoc* pdoc = MgShapeDoc::fromHandle(doc);
+    
+    if (!pdoc || !gs || !factory || gs->isStopping()) {
+        return -1;
+    }
+    if (tiles < 1) {
+        tiles = GiThreadPool::getProcessorCount();
+    }
+    tiles = mgMin(tiles, 64);
+    
+    int w = gs->xf().getWidth(), h = gs->xf().getHeight();
+    float ratio = (float)w / mgMax(h, 1);
+    int i, n = 0, cols = 1;
+    
+    for (i = 2; i <= tiles; i++) {                  // 取分块的宽高比最接近1的列数
+        if (tiles % i == 0 && fabsf(logf(ratio * tiles / (i * i)))
+            < fabsf(logf(ratio * tiles / (cols * cols)))) {
+            cols = i;
+        }
+    }
+    
+    int rows = tiles / cols;
+    std::vector<GiTile> arr(rows * cols);
+    GiTileBuckets buckets(arr, rows, cols);
+    Box2d clip;
+    
+    buckets.m2d = gs->xf().modelToDisplay();
+    buckets.src = gs;
+    buckets.mode = isZooming() ? 2 : 0;
+    
+    for (i = 0; i < rows * cols; i++) {             // 在调用线程中创建各分块的画布
+        GiTile& tile = arr[i];
+        int r = i / cols, c = i % cols;
+        
+        tile.rc.left = (float)(w * c / cols);
+        tile.rc.top = (float)(h * r / rows);
+        tile.rc.right = (float)(w * (c + 1) / cols);
+        tile.rc.bottom = (float)(h * (r + 1) / rows);
+        tile.gs = NULL;
+        tile.canvas = Box2d(tile.rc).isEmpty() ? NULL : factory->createTileCanvas(
+            i, tile.rc.left, tile.rc.top, tile.rc.right - tile.rc.left, tile.rc.bottom - tile.rc.top);
+        if (tile.canvas) {
+            tile.gs = new GiGraphics(*gs);
+            tile.gs->setShapeCache(NULL);           // 显示列表按视图记录，分块各自直接绘制
+            if (tile.gs->beginPaint(tile.canvas, tile.rc)) {
+                tile.clip = tile.gs->getClipModel();
+                clip.unionWith(tile.clip);
+            } else {
+                delete tile.gs;
+                tile.gs = NULL;
+            }
+        }
+        
+        Box2d rect(tile.gs ? tile.clip * buckets.m2d : Box2d(tile.rc));
+        buckets.colRect[c].unionWith(rect);
+        buckets.rowRect[r].unionWith(rect);
+    }
+    
+    pdoc->queryBox(clip, GiTileBuckets::addShape, &buckets);  // 按显示顺序分块，可能建立空间索引
+    
+    impl->tileLock.lock();
+    if (!impl->tilePool) {
+        impl->tilePool = new GiThreadPool();
+    }
+    impl->tileLock.unlock();
+    impl->tilePool->run(GiTileBuckets::drawTile, &buckets, rows * cols);
+    
+    std::vector<char> drawn(buckets.count, 0);      // 跨多个分块的图形只计一次
+    
+    for (i = 0; i < rows * cols; i++) {             // 在调用线程中合成
+        GiTile& tile = arr[i];
+        if (tile.canvas) {
+            factory->compositeTile(i, tile.canvas, tile.rc.left, tile.rc.top,
+                                   tile.rc.right - tile.rc.left, tile.rc.bottom - tile.rc.top);
+        }
+        for (size_t j = 0; j < tile.drawn.size(); j++) {
+            if (tile.drawn[j] && !drawn[tile.shapes[j].second]) {
+                drawn[tile.shapes[j].second] = 1;
+                n++;
+            }
+        }
+        delete tile.gs;
+    }
+    
+    return n;
+}
+
+// GiRegenWorker
+//
+
+GiRegenWorker::GiRegenWorker()
+    : _quit(false), _building(false), _builds(0), _notifying(NULL), _waiters(0)
+    , _recording(new GiDisplayList())
+{
+    _running.view = NULL;
+    _running.doc = 0;
+    _running.gs = NULL;
+    _thread.start(threadProc, this);
+}
+
+GiRegenWorker::~GiRegenWorker()
+{
+    cancel(NULL);
+    _lock.lock();
+    _quit = true;
+    _lock.unlock();
+    _wake.post();
+    _thread.join();
+    delete _recording;
+}
+
+void GiRegenWorker::threadProc(void* p)
+{
+    GiRegenWorker* w = (GiRegenWorker*)p;
+    Job job;
+    
+    for (;;) {
+        w->_wake.wait();                        // 被替换的请求也唤醒一次，可能没有待构建的请求
+        bool ret = w->take(job);
+        if (ret && job.view) {
+            w->build(job);
+        }
+        if (!ret)
+            break;
+    }
+}
+
+bool GiRegenWorker::take(Job& job)
+{
+    _lock.lock();
+    bool ret = !_quit;
+    job.view = NULL;
+    if (ret && !_pending.empty()) {
+        job = _pending.front();
+        _pending.erase(_pending.begin());
+        _running = job;
+        _building = true;
+    }
+    _lock.unlock();
+    return ret;
+}
+
+void GiRegenWorker::build(const Job& job)
+{
+    int n = -1;
+    
+    _recording->clear();                        // 保留上次的缓冲容量
+    if (job.gs->beginPaint(_recording)) {
+        n = MgShapeDoc::fromHandle(job.doc)->dyndraw(0, *job.gs);
+        job.gs->endPaint();
+    }
+    
+    _lock.lock();
+    bool done = (n >= 0 && _running.gs == job.gs   // 已取消的请求其 _running 已清除
+                 && !job.gs->isStopping() && !_quit);
+    if (done) {
+        size_t i = 0;
+        for (; i < _results.size() && _results[i].view != job.view; i++) ;
+        if (i == _results.size()) {
+            Result r;
+            r.view = job.view;
+            r.list = new GiDisplayList();
+            _results.push_back(r);
+        }
+        std::swap(_results[i].list, _recording);    // 旧的显示列表留作下次记录
+        _results[i].mat = job.gs->xf().modelToDisplay();
+        _results[i].shapes = n;
+        _notifying = job.view;                  // 此后取消该视图时等待回调结束
+    }
+    _running.view = NULL;
+    _running.gs = NULL;
+    _lock.unlock();
+    
+    release(job);
+    
+    _lock.lock();
+    _building = false;
+    _builds++;
+    wakeWaiters();
+    _lock.unlock();
+    
+    if (done) {                                 // 不加锁回调，回调中可取消请求
+        job.view->regenPrepared();
+        _lock.lock();
+        _notifying = NULL;
+        wakeWaiters();
+        _lock.unlock();
+    }
+}
+
+void GiRegenWorker::wakeWaiters()
+{
+    for (; _waiters > 0; _waiters--) {
+        _idle.post();
+    }
+}
+
+void GiRegenWorker::release(const Job& job)
+{
+    MgShapeDoc* doc = MgShapeDoc::fromHandle(job.doc);
+    MgObject::release_pointer(doc);
+    delete job.gs;
+}
+
+void GiRegenWorker::request(GiView* view, long doc, GiGraphics* gs)
+{
+    Job job = { view, doc, gs };
+    
+    if (!_thread.started()) {                   // 不支持线程时直接构建并回调
+        _lock.lock();
+        _running = job;
+        _building = true;
+        _lock.unlock();
+        build(job);
+        return;
+    }
+    
+    _lock.lock();
+    if (_running.view == view) {                // 该视图正在构建的请求已过时
+        _running.gs->stopDrawing(true);
+        _running.view = NULL;
+        _running.gs = NULL;
+    }
+    
+    size_t i = 0;
+    for (; i < _pending.size() && _pending[i].view != view; i++) ;
+    if (i < _pending.size()) {
+        release(_pending[i]);
+        _pending[i] = job;
+    } else {
+        _pending.push_back(job);
+    }
+    _lock.unlock();
+    _wake.post();
+}
+
+void GiRegenWorker::cancel(GiView* view)
+{
+    _lock.lock();
+    for (size_t i = _pending.size(); i > 0; i--) {
+        if (!view || _pending[i - 1].view == view) {
+            release(_pending[i - 1]);
+            _pending.erase(_pending.begin() + (i - 1));
+        }
+    }
+    if (_running.gs && (!view || _running.view == view)) {
+        _running.gs->stopDrawing(true);
+        _running.view = NULL;
+        _running.gs = NULL;
+    }
+    for (size_t i = _results.size(); i > 0; i--) {
+        if (!view || _results[i - 1].view == view) {
+            delete _results[i - 1].list;
+            _results.erase(_results.begin() + (i - 1));
+        }
+    }
+    
+    // 等待正在构建的请求和该视图的回调结束，在回调中或没有工作线程时不等待
+    const bool inWorker = !_thread.started() || _thread.isCurrent();
+    const long builds = _builds;
+    
+    while (!inWorker && ((_building && _builds == builds)
+                         || (_notifying && (!view || _notifying == view)))) {
+        _waiters++;
+        _lock.unlock();
+        _idle.wait();
+        _lock.lock();
+    }
+    _lock.unlock();
+}
+
+void GiRegenWorker::stop()
+{
+    _lock.lock();
+    if (_running.gs) {
+        _running.gs->stopDrawing(true);
+    }
+    _lock.unlock();
+}
+
+int GiRegenWorker::draw(GiView* view, GiCanvas* canvas, const Matrix2d& modelToDisplay)
+{
+    int n = -1;
+    
+    _lock.lock();
+    for (size_t i = 0; i < _results.size(); i++) {
+        if (_results[i].view == view) {
+            Matrix2d mat(_results[i].mat.inverse() * modelToDisplay);
+            _results[i].list->replay(canvas, mat.isIdentity() ? (const Matrix2d*)0 : &mat);
+            n = _results[i].shapes;
+            break;
+        }
+    }
+    _lock.unlock();
+    
+    return n;
+}
+
+bool GiCoreView::regenAsync(GiView* view)
+{
+    GcBaseView* aview = impl->_gcdoc->findView(view);
+    if (!aview) {
+        return false;
+    }
+    
+    GiGraphics* gs = new GiGraphics();
+    aview->copyGs(gs);
+    gs->setShapeCache(NULL);                    // 形状缓存不在工作线程中使用
+    
+    impl->tileLock.lock();
+    if (!impl->regenWorker) {
+        impl->regenWorker = new GiRegenWorker();
+    }
+    impl->tileLock.unlock();
+    impl->regenWorker->request(view, acquireFrontDoc(), gs);
+    
+    return true;
+}
+
+int GiCoreView::drawPrepared(GiView* view, GiCanvas* canvas)
+{
+    GcBaseView* aview = impl->_gcdoc->findView(view);
+    if (!aview || !canvas || !impl->regenWorker) {
+        return -1;
+    }
+    return impl->regenWorker->draw(view, canvas, aview->xform()->modelToDisplay());
+}
+
+void GiCoreView::cancelRegen(GiView* view)
+{
+    if (impl->regenWorker) {
+        impl->regenWorker->cancel(view);
+    }
+}
+
 int GiCoreView::drawAll(const mgvector<long>& docs, long hGs, GiCanvas* canvas)
 {
     mgvector<int> ignoreIds;
@@ -635,6 +1201,7 @@ int GiCoreView::dynDraw(long hShapes, long hGs, GiCanvas* canvas)
     GiGraphics* gs = GiGraphics::fromHandle(hGs);
     
     if (hShapes && gs && impl->curview && gs->beginPaint(canvas)) {
+        gs->setShapeCache((GiShapeCache*)0);    // 动态图形随时改变，不缓存
         mgCopy(impl->motion()->d2mgs, impl->cmds()->displayMmToModel(1, gs));
         impl->curview->dyndraw(*gs);
         n = MgShapes::fromHandle(hShapes)->dyndraw(isZooming() ? 2 : 0, *gs, NULL, -1);
@@ -651,6 +1218,7 @@ int GiCoreView::dynDraw(const mgvector<long>& shapes, long hGs, GiCanvas* canvas
     
     if (gs && impl->curview && gs->beginPaint(canvas)) {
         n = 0;
+        gs->setShapeCache((GiShapeCache*)0);    // 动态图形随时改变，不缓存
         mgCopy(impl->motion()->d2mgs, impl->cmds()->displayMmToModel(1, gs));
         impl->curview->dyndraw(*gs);
         for (int i = 0; i < shapes.count(); i++) {
@@ -1135,9 +1703,17 @@ bool GiCoreView::loadFromFile(const char* vgfile, bool readOnly)
         return loadShapes(NULL, readOnly) && fp;
     }
     
-    MgJsonStorage s;
-    bool ret = loadShapes(s.storageForRead(fp), readOnly);
-
+    bool ret;
+    
+    if (MgBinaryStorage::isBinaryFile(fp)) {
+        MgBinaryStorage s;
+        s.setLazyLoading(impl->getOptionBool("lazyLoading", false));   // 显示或选择到时才加载图形
+        ret = loadShapes(s.storageForRead(fp), readOnly);
+    } else {
+        MgJsonStorage s;
+        s.setStreamMode(true);
+        ret = loadShapes(s.storageForRead(fp), readOnly);
+    }
     fclose(fp);
     LOGD("loadFromFile: %d, %s", ret, vgfile);
 
@@ -1146,11 +1722,20 @@ bool GiCoreView::loadFromFile(const char* vgfile, bool readOnly)
 
 bool GiCoreView::saveToFile(long doc, const char* vgfile, bool pretty)
 {
-    FILE *fp = doc ? mgopenfile(vgfile, "wt") : NULL;
-    MgJsonStorage s;
-    bool ret = (fp != NULL
-                && saveShapes(doc, s.storageForWrite())
-                && s.save(fp, pretty));
+    // .vgb 文件或设置了 binaryStorage 选项时保存为二进制格式，读取时按文件头判断
+    bool binary = (MgBinaryStorage::isBinaryName(vgfile)
+                   || impl->getOptionBool("binaryStorage", false));
+    FILE *fp = doc ? mgopenfile(vgfile, binary ? "wb" : "wt") : NULL;
+    bool ret = false;
+    
+    if (fp && binary) {
+        MgBinaryStorage s;
+        ret = saveShapes(doc, s.storageForWrite()) && s.save(fp);
+    }
+    else if (fp) {
+        MgJsonStorage s;
+        ret = saveShapes(doc, s.storageForWrite(fp, pretty)) && !ferror(fp);
+    }
     
     if (fp) {
         fclose(fp);
@@ -1186,14 +1771,83 @@ int GiCoreView::exportSVG(GiView* view, const char* filename) {
     return n;
 }
 
+int GiCoreView::exportPNG(long doc, long hGs, const char* filename)
+{
+    GiGraphics* gs = GiGraphics::fromHandle(hGs);
+    GiRasterCanvas canvas;
+    int n = -1;
+    
+    if (doc && gs && filename
+        && canvas.create(gs->xf().getWidth(), gs->xf().getHeight()))
+    {
+        n = renderToBuffer(doc, hGs, canvas.getPixels(), canvas.getWidth(), canvas.getHeight());
+    }
+    
+    return n >= 0 && canvas.savePNG(filename) ? n : -1;
+}
+
+int GiCoreView::exportPNG(GiView* view, const char* filename) {
+    long doc = acquireFrontDoc();
+    long hGs = acquireGraphics(view);
+    int n = exportPNG(doc, hGs, filename);
+    releaseDoc(doc);
+    releaseGraphics(hGs);
+    return n;
+}
+
+int GiCoreView::renderToBuffer(long doc, long hGs, unsigned char* pixels,
+                               int width, int height, int stride)
+{
+    GiGraphics* src = GiGraphics::fromHandle(hGs);
+    GiRasterCanvas canvas;
+    GiTransform xf;
+    GiGraphics gs(&xf);
+    int n = -1;
+    
+    if (doc && src && canvas.attach(pixels, width, height, stride)) {
+        gs.copy(*src);
+        gs.setShapeCache((GiShapeCache*)0);     // 缓存的图形按视图的显示比例
+        
+        if (width != xf.getWidth() || height != xf.getHeight()) {
+            RECT_2D rc;
+            
+            rc.right = (float)width;
+            rc.bottom = (float)height;
+            Box2d rectW(src->xf().getWndRectW());
+            
+            xf.setWndSize(width, height);       // 按缓冲大小放缩显示视图范围
+            xf.zoomTo(rectW, &rc, false);
+        }
+        
+        GiColor bk(gs.getBkColor());
+        canvas.fill(bk.a == 255 ? bk.getARGB() : 0);
+        
+        if (gs.beginPaint(&canvas)) {
+            n = MgShapeDoc::fromHandle(doc)->dyndraw(0, gs);
+            gs.endPaint();
+        }
+    }
+    
+    return n;
+}
+
 void GcBaseView::checkZoomTimes()
 {
     if (_zoomTimes != xform()->getZoomTimes()) {
         _zoomTimes = xform()->getZoomTimes();
+        if (!_zooming) {                            // 手势外放缩平移后保留的显示列表已过时
+            endXformGesture();
+        }
         _view->zoomChanged();
     }
 }
 
+void GcBaseView::copyGs(GiGraphics* gs)
+{
+    gs->copy(_gsBack);
+    gs->setShapeCache(_mgview->getOptionBool("shapeCache", false) ? &_shapeCache : (GiShapeCache*)0);
+}
+
 bool GiCoreView::zoomToInitial()
 {
     bool ret = impl->doc()->zoomToInitial(impl->xform());
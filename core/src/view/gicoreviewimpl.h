@@ -19,6 +19,9 @@
 #include "mglayer.h"
 #include "mgcomposite.h"
 #include "mglog.h"
+#include "githreadpool.h"
+#include "githread.h"
+#include "gidisplaylist.h"
 #include <map>
 
 #define CALL_VIEW(func) if (curview) curview->func
@@ -64,6 +67,62 @@ public:
     }
 };
 
+//! 在工作线程中按前端文档重新构建各视图的显示列表
+/*! 同一视图的新请求取消其尚未完成的请求，不支持线程的平台上在请求时直接构建。
+    \see GiCoreView::regenAsync
+ */
+class GiRegenWorker
+{
+public:
+    GiRegenWorker();
+    ~GiRegenWorker();
+    
+    //! 请求重新构建，接管文档句柄和图形显示对象
+    void request(GiView* view, long doc, GiGraphics* gs);
+    
+    //! 取消视图(为NULL则所有视图)的请求并丢弃其结果，等待正在构建的请求和该视图正在进行的回调结束，在回调中调用时不等待
+    void cancel(GiView* view);
+    
+    //! 停止正在构建的请求
+    void stop();
+    
+    //! 显示已构建好的显示列表，按构建后的坐标系变化进行变换
+    int draw(GiView* view, GiCanvas* canvas, const Matrix2d& modelToDisplay);
+    
+private:
+    struct Job {
+        GiView*     view;
+        long        doc;
+        GiGraphics* gs;
+    };
+    struct Result {
+        GiView*         view;
+        GiDisplayList*  list;
+        Matrix2d        mat;        //!< 构建时的模型到显示坐标的矩阵
+        int             shapes;
+    };
+    
+    static void threadProc(void* p);
+    bool take(Job& job);
+    void build(const Job& job);
+    static void release(const Job& job);
+    void wakeWaiters();
+    
+    GiThread            _thread;
+    GiSemaphore         _wake;
+    GiSemaphore         _idle;      //!< 构建或回调结束时唤醒等待的 cancel()
+    GiMutex             _lock;      //!< 保护以下成员
+    std::vector<Job>    _pending;   //!< 每个视图最多一个待构建的请求
+    Job                 _running;
+    std::vector<Result> _results;
+    bool                _quit;
+    bool                _building;  //!< 正在构建，不含回调
+    long                _builds;    //!< 已结束的构建次数，cancel() 只等待调用时正在进行的构建
+    GiView*             _notifying; //!< 正在回调 regenPrepared() 的视图
+    int                 _waiters;   //!< 等待 _idle 的 cancel() 个数
+    GiDisplayList*      _recording; //!< 只在构建线程中使用
+};
+
 //! GiCoreView实现类
 class GiCoreViewImpl : public GiCoreViewData, public MgShapeFactory
 {
@@ -80,6 +139,7 @@ public:
     long            regenPending;
     long            appendPending;
     long            redrawPending;
+    Box2d           dirtyRect;      //!< 在 DrawLocker 期间待重新构建显示的模型范围
     volatile long   changeCount;
     volatile long   drawCount;
     
@@ -93,6 +153,9 @@ public:
     GiGraphics*     gsBuf[20];
     volatile long   gsUsed[20];
     volatile long   stopping;
+    GiThreadPool*   tilePool;       // 分块并行显示的线程池，首次分块显示时创建
+    GiMutex         tileLock;
+    GiRegenWorker*  regenWorker;    // 后台重新构建显示的工作线程，首次请求时创建
     
 public:
     GiCoreViewImpl(GiCoreView* owner, bool useCmds = true);
@@ -203,6 +266,7 @@ public:
             && shape->getParent()->findShape(shape->getID()) == shape
             && !shape->shapec()->getFlag(kMgNoDel)) {
             int sid = shape->getID();
+            regenShape(shape);
             ret = getCmdSubject()->onShapeDeleted(motion(), shape);
             ret += shape->getParent()->removeShape(shape->getID()) ? 1 : 0;
             CALL_VIEW(deviceView()->shapeDeleted(sid));
@@ -279,6 +343,15 @@ public:
         }
     }
     
+    void regenShape(const MgShape* shape) {
+        if (shape && curview) {
+            regenRect(calcDirtyRect(shape));
+        }
+    }
+    
+    Box2d calcDirtyRect(const MgShape* shape);
+    void regenRect(const Box2d& rectM);
+    
     void regenAppend(int sid, long playh = 0) {
         if (appendPending >= 0 && sid) {
             if (appendPending == 0 || appendPending == sid) {
@@ -378,13 +451,24 @@ public:
         long regenPending = _impl->regenPending;
         long appendPending = _impl->appendPending;
         long redrawPending = _impl->redrawPending;
+        Box2d dirtyRect(_impl->dirtyRect);
         
         _impl->regenPending = -1;
         _impl->appendPending = -1;
         _impl->redrawPending = -1;
+        _impl->dirtyRect.empty();
         
         if (regenPending > 0) {
-            _impl->regenAll(regenPending >= 100);
+            _impl->regenAll(regenPending >= 100 || !dirtyRect.isEmpty());
+        }
+        else if (!dirtyRect.isEmpty()) {
+            if (appendPending > 0) {
+                const MgShape* sp = _impl->shapes()->findShape((int)appendPending);
+                if (sp) {
+                    dirtyRect.unionWith(_impl->calcDirtyRect(sp));
+                }
+            }
+            _impl->regenRect(dirtyRect);
         }
         else if (appendPending > 0) {
             _impl->regenAppend((int)appendPending);